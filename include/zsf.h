@@ -10,6 +10,8 @@
 #ifndef ZSF_ZSF_H
 #define ZSF_ZSF_H
 
+#include <stddef.h>
+
 #if defined(_WIN32)
 #  if defined ZSF_STATIC
 #    define ZSF_EXPORT
@@ -135,6 +137,16 @@ typedef struct zsf_aux_results_t {
   zsf_phase_transports_t transports_phase_4;
 } zsf_aux_results_t;
 
+/* One locking cycle (phases 1 to 4) in an operating schedule */
+typedef struct zsf_locking_cycle_t {
+  double time;
+  double t_level;
+  double t_open_lake;
+  double t_open_sea;
+  double ship_volume_sea_to_lake;
+  double ship_volume_lake_to_sea;
+} zsf_locking_cycle_t;
+
 /* zsf_initialize_state:
  *      fill zsf_state_t with an initial condition for an empty (no ships) lock */
 ZSF_EXPORT int ZSF_CALLCONV zsf_initialize_state(const zsf_param_t *p, zsf_phase_state_t *state,
@@ -170,6 +182,20 @@ ZSF_EXPORT int ZSF_CALLCONV zsf_step_flush_doors_closed(const zsf_param_t *p, do
                                                         zsf_phase_state_t *state,
                                                         zsf_phase_transports_t *results);
 
+/* zsf_resolve_phase:
+ *      sample the transports within a phase of the given duration at
+ *      num_times times since its start (0 <= t <= duration), without
+ *      changing the state. The routine is 1 to 4, or -2/-4 for flushing with
+ *      the doors closed. Volumes and mass transports are cumulative since the
+ *      start of the phase, discharges and salinities are instantaneous. Ships
+ *      exit at the start of the phase and enter at the end, so the last
+ *      sample at t = duration has the volumes and mass transports of the
+ *      corresponding zsf_step_* function. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_resolve_phase(const zsf_param_t *p, int routine, double duration,
+                                              const zsf_phase_state_t *state, int num_times,
+                                              const double *times,
+                                              zsf_phase_transports_t *samples);
+
 /* zsf_param_default:
  *      fill zsf_param_t with default values */
 ZSF_EXPORT void ZSF_CALLCONV zsf_param_default(zsf_param_t *p);
@@ -178,6 +204,720 @@ ZSF_EXPORT void ZSF_CALLCONV zsf_param_default(zsf_param_t *p);
  *      calculate the salt intrusion for a set of parameters, assuming steady operation*/
 ZSF_EXPORT int ZSF_CALLCONV zsf_calc_steady(const zsf_param_t *p, zsf_results_t *results,
                                             zsf_aux_results_t *aux_results);
+/* zsf_calc_periodic:
+ *      calculate the periodic (e.g. tidal) steady state of a lock operated
+ *      according to a schedule of locking cycles, with the head (and
+ *      optionally salinity) at sea given as num_samples equidistant samples
+ *      over the period. Outputs the period-averaged results, the transports
+ *      of every locking cycle and the periodic state at the start of the
+ *      period. The latter two are optional. Returns ZSF_ERR_NOT_CONVERGED
+ *      if the periodic state is not found within rtol and atol. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_calc_periodic(const zsf_param_t *p, double t_period,
+                                              int num_samples, const double *head_sea,
+                                              const double *salinity_sea, int num_lockings,
+                                              const zsf_locking_cycle_t *cycles,
+                                              zsf_results_t *results,
+                                              zsf_phase_transports_t *cycle_transports,
+                                              zsf_phase_state_t *state);
+
+/* Lake salt balance
+ * ~~~~~~~~~~~~~~~~~
+ * Box model of a lake and a sea compartment, each well mixed, connected by
+ * one or more locks in steady operation. The compartments have inflows and
+ * outflows given as time series of num_samples equidistant samples, and
+ * their salinities evolve with the salt loads of the locks. A compartment
+ * with zero volume is infinitely large, i.e. has a constant salinity. */
+typedef struct zsf_compartment_t {
+  double volume;
+  double salinity;
+} zsf_compartment_t;
+
+/* An outflow of ZSF_NAN keeps the volume of the compartment constant */
+typedef struct zsf_box_forcing_t {
+  double inflow_lake;
+  double salinity_inflow_lake;
+  double outflow_lake;
+  double inflow_sea;
+  double salinity_inflow_sea;
+  double outflow_sea;
+} zsf_box_forcing_t;
+
+typedef struct zsf_box_output_t {
+  double volume_lake;
+  double salinity_lake;
+  double volume_sea;
+  double salinity_sea;
+  double salt_load_lake;
+  double salt_load_sea;
+} zsf_box_output_t;
+
+/* zsf_run_box_model:
+ *      integrate the salt balance of the compartments from time 0 to the
+ *      last of the num_outputs output times, with adaptive time steps that
+ *      keep the local error in the salinities below tolerance. The
+ *      compartments hold the initial state on input, and the final state
+ *      on output. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_run_box_model(int num_locks, const zsf_param_t *p,
+                                              int num_samples, double dt_forcing,
+                                              const zsf_box_forcing_t *forcing, double tolerance,
+                                              double max_time_step, zsf_compartment_t *lake,
+                                              zsf_compartment_t *sea, int num_outputs,
+                                              const double *t_output, zsf_box_output_t *outputs);
+
+/* Batches and sweeps
+ * ~~~~~~~~~~~~~~~~~~
+ * Steady state calculations for many sets of parameters, storing only the
+ * fields of zsf_results_t selected in output_mask. Selected field j (in the
+ * order of zsf_results_t) of calculation i is written to
+ * outputs[i * row_stride + j * column_stride], so that the outputs can be
+ * stored per row (row_stride = number of selected fields, column_stride = 1)
+ * or per column (row_stride = 1, column_stride = number of calculations). */
+#define ZSF_OUTPUT_MASS_TRANSPORT_LAKE 0x001
+#define ZSF_OUTPUT_SALT_LOAD_LAKE 0x002
+#define ZSF_OUTPUT_DISCHARGE_FROM_LAKE 0x004
+#define ZSF_OUTPUT_DISCHARGE_TO_LAKE 0x008
+#define ZSF_OUTPUT_SALINITY_TO_LAKE 0x010
+#define ZSF_OUTPUT_MASS_TRANSPORT_SEA 0x020
+#define ZSF_OUTPUT_SALT_LOAD_SEA 0x040
+#define ZSF_OUTPUT_DISCHARGE_FROM_SEA 0x080
+#define ZSF_OUTPUT_DISCHARGE_TO_SEA 0x100
+#define ZSF_OUTPUT_SALINITY_TO_SEA 0x200
+#define ZSF_OUTPUT_ALL 0x3FF
+
+#define ZSF_SWEEP_MAX_AXES 8
+
+/* zsf_calc_steady_batch:
+ *      calculate the steady state for num_locks sets of parameters. The
+ *      outputs of failed calculations are set to ZSF_NAN, and their error
+ *      codes are written to errors (optional). Returns the first error. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_calc_steady_batch(int num_locks, const zsf_param_t *p,
+                                                  int output_mask, double *outputs,
+                                                  int row_stride, int column_stride, int *errors);
+
+/* zsf_calc_steady_sweep:
+ *      calculate the steady state on all nodes of a rectilinear grid over the
+ *      parameters named in axis_names (last axis varying fastest), like
+ *      zsf_surrogate_build, and store them like zsf_calc_steady_batch */
+ZSF_EXPORT int ZSF_CALLCONV zsf_calc_steady_sweep(const zsf_param_t *p, int num_axes,
+                                                  const char *const *axis_names,
+                                                  const int *num_points, const double *axis_values,
+                                                  int output_mask, double *outputs,
+                                                  int row_stride, int column_stride, int *errors);
+
+/* zsf_calc_steady_bounds:
+ *      calculate guaranteed lower and upper bounds on the steady results for
+ *      all parameters between p_lo and p_hi, using interval arithmetic. The
+ *      parameter box is bisected into at most max_boxes boxes to tighten the
+ *      bounds. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_calc_steady_bounds(const zsf_param_t *p_lo,
+                                                   const zsf_param_t *p_hi, int max_boxes,
+                                                   zsf_results_t *results_lo,
+                                                   zsf_results_t *results_hi);
+
+/* Surrogate tables
+ * ~~~~~~~~~~~~~~~~
+ * A surrogate tabulates the results of zsf_calc_steady on a rectilinear grid
+ * over one or more parameters, with all other parameters fixed. Queries are
+ * answered by interpolation in the table, which is orders of magnitude
+ * faster than solving for the steady state. */
+#define ZSF_SURROGATE_MAX_AXES 8
+
+#define ZSF_INTERP_LINEAR 1
+#define ZSF_INTERP_CUBIC 3
+
+typedef struct zsf_surrogate_t zsf_surrogate_t;
+
+/* zsf_surrogate_build:
+ *      tabulate zsf_calc_steady over the parameters named in axis_names. The
+ *      (strictly increasing) grid values of all axes are concatenated in
+ *      axis_values, with num_points[i] values for axis i. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_surrogate_build(const zsf_param_t *p, int num_axes,
+                                                const char *const *axis_names,
+                                                const int *num_points, const double *axis_values,
+                                                zsf_surrogate_t **surrogate);
+
+/* zsf_surrogate_eval:
+ *      interpolate the steady results at point x (one value per axis). Points
+ *      outside of the grid are clamped to its bounds. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_surrogate_eval(const zsf_surrogate_t *surrogate, const double *x,
+                                               int method, zsf_results_t *results);
+
+/* zsf_surrogate_validate:
+ *      compare interpolated results with zsf_calc_steady at random points
+ *      inside the grid, and report the maximum absolute and relative error */
+ZSF_EXPORT int ZSF_CALLCONV zsf_surrogate_validate(const zsf_surrogate_t *surrogate,
+                                                   int num_samples, int seed, int method,
+                                                   zsf_results_t *max_abs_error,
+                                                   zsf_results_t *max_rel_error);
+
+/* zsf_surrogate_num_axes:
+ *      get the number of axes (dimensions) of the surrogate */
+ZSF_EXPORT int ZSF_CALLCONV zsf_surrogate_num_axes(const zsf_surrogate_t *surrogate);
+
+/* zsf_surrogate_axis_name:
+ *      get the name of the parameter along an axis, or NULL if out of range */
+ZSF_EXPORT const char *ZSF_CALLCONV zsf_surrogate_axis_name(const zsf_surrogate_t *surrogate,
+                                                            int axis);
+
+/* zsf_surrogate_save:
+ *      write the surrogate to a binary file */
+ZSF_EXPORT int ZSF_CALLCONV zsf_surrogate_save(const zsf_surrogate_t *surrogate,
+                                               const char *path);
+
+/* zsf_surrogate_load:
+ *      read a surrogate from a binary file written by zsf_surrogate_save */
+ZSF_EXPORT int ZSF_CALLCONV zsf_surrogate_load(const char *path, zsf_surrogate_t **surrogate);
+
+/* zsf_surrogate_free:
+ *      release all memory held by the surrogate */
+ZSF_EXPORT void ZSF_CALLCONV zsf_surrogate_free(zsf_surrogate_t *surrogate);
+
+/* Lockage schedules
+ * ~~~~~~~~~~~~~~~~~
+ * A lockage is a single phase in the operation of the lock, as it would be
+ * passed to one of the zsf_step_* functions. The routine is the phase (1 to
+ * 4), or -2/-4 for flushing with the doors closed at lake/sea level. Only
+ * the ship volume entering in phase 2 (lake to sea) or 4 (sea to lake) is
+ * non-zero.
+ *
+ * Sequences of lockages can be generated on the fly from a traffic model:
+ * Poisson ship arrivals at both sides with an exponential growth rate, ship
+ * displacements drawn from a mix of lognormally distributed ship classes,
+ * and an operating policy of the lock. */
+typedef struct zsf_lockage_t {
+  double time;
+  double routine;
+  double duration;
+  double ship_volume_lake_to_sea;
+  double ship_volume_sea_to_lake;
+  double num_ships;
+} zsf_lockage_t;
+
+typedef struct zsf_traffic_t {
+  double ships_per_day_lake;
+  double ships_per_day_sea;
+  double annual_growth;
+} zsf_traffic_t;
+
+typedef struct zsf_fleet_class_t {
+  double share;
+  double volume_mean;
+  double volume_std;
+  double volume_max;
+} zsf_fleet_class_t;
+
+typedef struct zsf_lock_policy_t {
+  double leveling_time;
+  double door_time;
+  double time_per_ship;
+  double max_wait;
+  double max_ships;
+  double max_ship_volume;
+  double flushing_when_idle;
+  double max_flushing_time;
+} zsf_lock_policy_t;
+
+typedef struct zsf_traffic_stats_t {
+  double num_ships;
+  double num_lockings;
+  double mean_wait;
+  double max_wait;
+} zsf_traffic_stats_t;
+
+typedef struct zsf_lockage_generator_t zsf_lockage_generator_t;
+
+/* zsf_lockage_generator_create:
+ *      create a generator of lockages for the given traffic, fleet mix and
+ *      operating policy. The lock starts empty at lake side at time 0. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_lockage_generator_create(const zsf_traffic_t *traffic,
+                                                         int num_classes,
+                                                         const zsf_fleet_class_t *fleet,
+                                                         const zsf_lock_policy_t *policy,
+                                                         int seed,
+                                                         zsf_lockage_generator_t **generator);
+
+/* zsf_lockage_generator_next:
+ *      get the next (at most max_lockages) lockages starting before t_end */
+ZSF_EXPORT int ZSF_CALLCONV zsf_lockage_generator_next(zsf_lockage_generator_t *generator,
+                                                       double t_end, int max_lockages,
+                                                       zsf_lockage_t *lockages,
+                                                       int *num_lockages);
+
+/* zsf_lockage_generator_stats:
+ *      get statistics on the ships that departed so far */
+ZSF_EXPORT int ZSF_CALLCONV zsf_lockage_generator_stats(const zsf_lockage_generator_t *generator,
+                                                        zsf_traffic_stats_t *stats);
+
+/* zsf_lockage_generator_free:
+ *      release all memory held by the generator */
+ZSF_EXPORT void ZSF_CALLCONV zsf_lockage_generator_free(zsf_lockage_generator_t *generator);
+
+/* zsf_step_lockages:
+ *      step through a sequence of lockages. The ship volumes in p are
+ *      ignored, and taken from the lockages instead. The transports of every
+ *      lockage are written to transports, unless it is NULL. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_lockages(const zsf_param_t *p, int num_lockages,
+                                              const zsf_lockage_t *lockages,
+                                              zsf_phase_state_t *state,
+                                              zsf_phase_transports_t *transports);
+
+/* zsf_step_lockages_parallel:
+ *      as zsf_step_lockages, but with the sequence split over num_threads
+ *      threads. The state and transports match those of zsf_step_lockages
+ *      within the tolerances rtol and atol in p. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_lockages_parallel(const zsf_param_t *p, int num_lockages,
+                                                       const zsf_lockage_t *lockages,
+                                                       zsf_phase_state_t *state,
+                                                       zsf_phase_transports_t *transports,
+                                                       int num_threads);
+
+/* zsf_run_lockages:
+ *      stream the lockages of a generator up to t_end through
+ *      zsf_step_lockages, and average the transports over the time since the
+ *      previous call (or the start) */
+ZSF_EXPORT int ZSF_CALLCONV zsf_run_lockages(const zsf_param_t *p,
+                                             zsf_lockage_generator_t *generator, double t_end,
+                                             zsf_phase_state_t *state, zsf_results_t *results);
+
+/* zsf_replay_variants:
+ *      step through a sequence of lockages for num_variants parameter sets at
+ *      once, which may only differ in the flushing discharges, density
+ *      current factors, bubble screen distances and sill heights. The ship
+ *      volumes are taken from the lockages. The states of all variants are
+ *      updated, and their transports averaged over the lockages. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_replay_variants(int num_variants, const zsf_param_t *variants,
+                                                int num_lockages, const zsf_lockage_t *lockages,
+                                                zsf_phase_state_t *states,
+                                                zsf_results_t *results);
+
+/* Networks of locks
+ * ~~~~~~~~~~~~~~~~~
+ * The locks in a network are operated independently, each with the
+ * lockages of its own generator. A discrete-event engine steps every lock
+ * only at its own phase boundaries, in the order of time over the whole
+ * network, and hands out the transports of all locks on a common output
+ * clock. The transports of a phase are spread evenly over its duration. */
+typedef struct zsf_network_t zsf_network_t;
+
+/* zsf_network_create:
+ *      create a network of num_locks locks with the given parameters,
+ *      initial states and lockage generators, with outputs every dt_output
+ *      seconds from time 0. The generators are not copied, and have to
+ *      outlive the network. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_network_create(int num_locks, const zsf_param_t *p,
+                                               const zsf_phase_state_t *states,
+                                               zsf_lockage_generator_t *const *generators,
+                                               double dt_output, zsf_network_t **network);
+
+/* zsf_network_set_param:
+ *      change the parameters of a lock from its next lockage on, e.g. to
+ *      follow the head at sea. The ship volumes are ignored. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_network_set_param(zsf_network_t *network, int lock,
+                                                  const zsf_param_t *p);
+
+/* zsf_network_advance:
+ *      process all events up to the next output time, and get the
+ *      transports of every lock over the output interval (with discharges
+ *      averaged over dt_output). After an error, the network cannot be
+ *      advanced any further. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_network_advance(zsf_network_t *network,
+                                                zsf_phase_transports_t *transports);
+
+/* zsf_network_state:
+ *      get the state of a lock after the last lockage that has started */
+ZSF_EXPORT int ZSF_CALLCONV zsf_network_state(const zsf_network_t *network, int lock,
+                                              zsf_phase_state_t *state);
+
+/* zsf_network_free:
+ *      release all memory held by the network, except for the generators */
+ZSF_EXPORT void ZSF_CALLCONV zsf_network_free(zsf_network_t *network);
+
+/* Boundary forcing
+ * ~~~~~~~~~~~~~~~~
+ * Instead of passing in series of boundary conditions, they can be
+ * evaluated on demand from a harmonic tide and seasonal curves. The head at
+ * sea is mean_sea_level plus the sum of amplitude * cos(speed * t - phase)
+ * over the tidal constituents, with the phase (lag) in degrees and the speed
+ * in degrees per hour, as is customary. All times are in seconds since
+ * time 0 though. Nodal corrections have to be included in the amplitudes
+ * and phases. Seasonal variations of
+ * the mean sea level can be added as the constituents Sa and Ssa.
+ *
+ * Any other parameter (e.g. salinity_sea or temperature_lake) can follow a
+ * seasonal curve, with annual and semiannual harmonics that peak at t_max
+ * and t_max_semiannual seconds after time 0, respectively. A year lasts
+ * 365.25 days. A mean of ZSF_NAN keeps the value of the parameters passed at
+ * evaluation, around which the harmonics vary. */
+typedef struct zsf_tidal_constituent_t {
+  double amplitude;
+  double phase;
+  double speed;
+} zsf_tidal_constituent_t;
+
+typedef struct zsf_seasonal_t {
+  double mean;
+  double amplitude;
+  double t_max;
+  double amplitude_semiannual;
+  double t_max_semiannual;
+} zsf_seasonal_t;
+
+typedef struct zsf_forcing_t zsf_forcing_t;
+
+/* zsf_forcing_create:
+ *      create a forcing from num_constituents tidal constituents, and
+ *      num_curves seasonal curves of the parameters with the given names.
+ *      With a mean_sea_level of ZSF_NAN (and no constituents), the head at
+ *      sea is not forced. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_forcing_create(double mean_sea_level, int num_constituents,
+                                               const zsf_tidal_constituent_t *constituents,
+                                               int num_curves, const char *const *parameters,
+                                               const zsf_seasonal_t *curves,
+                                               zsf_forcing_t **forcing);
+
+/* zsf_forcing_eval:
+ *      get the parameters p with the forced ones evaluated at the times
+ *      t0 + i * dt for i < num_times */
+ZSF_EXPORT int ZSF_CALLCONV zsf_forcing_eval(const zsf_forcing_t *forcing, const zsf_param_t *p,
+                                             double t0, double dt, int num_times,
+                                             zsf_param_t *out);
+
+/* zsf_calc_steady_forced:
+ *      calculate the steady state at the times t0 + i * dt for
+ *      i < num_times, and store the results like zsf_calc_steady_batch. The
+ *      parameters are evaluated in small blocks, so memory use does not
+ *      depend on num_times. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_calc_steady_forced(const zsf_param_t *p,
+                                                   const zsf_forcing_t *forcing, double t0,
+                                                   double dt, int num_times, int output_mask,
+                                                   double *outputs, int row_stride,
+                                                   int column_stride, int *errors);
+
+/* zsf_step_lockages_forced:
+ *      as zsf_step_lockages, with the parameters evaluated at the start of
+ *      every lockage, or at the end for levelings. While the doors are open,
+ *      a forced head on that side stays at the head the lock leveled to. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_lockages_forced(const zsf_param_t *p,
+                                                     const zsf_forcing_t *forcing,
+                                                     int num_lockages,
+                                                     const zsf_lockage_t *lockages,
+                                                     zsf_phase_state_t *state,
+                                                     zsf_phase_transports_t *transports);
+
+/* zsf_forcing_free:
+ *      release all memory held by the forcing */
+ZSF_EXPORT void ZSF_CALLCONV zsf_forcing_free(zsf_forcing_t *forcing);
+
+/* Optimal lock operation
+ * ~~~~~~~~~~~~~~~~~~~~~~
+ * Given the arrivals of ships over a period (e.g. a day), find the door
+ * open times and flushing times of every visit of the lock to either of its
+ * sides that minimise the salt intrusion into the lake. No ship may wait
+ * longer than max_wait between its arrival and the doors closing behind it,
+ * and the total flushing with the doors closed may not use more than
+ * flushing_volume. The lock starts empty at time 0, levels towards the side
+ * of the first ship, and visits the sides in turn while there are ships. */
+typedef struct zsf_ship_arrival_t {
+  double time;
+  double side;
+  double volume;
+} zsf_ship_arrival_t;
+
+typedef struct zsf_schedule_limits_t {
+  double t_end;
+  double leveling_time;
+  double door_time;
+  double time_per_ship;
+  double max_wait;
+  double max_ships;
+  double max_ship_volume;
+  double door_open_min;
+  double door_open_max;
+  double flushing_max;
+  double flushing_volume;
+  double num_candidates;
+} zsf_schedule_limits_t;
+
+/* zsf_schedule_optimize:
+ *      optimise the operation of the lock for the given ship arrivals, and
+ *      write the lockages of the optimal schedule and (unless NULL) their
+ *      transports. The transports are averaged over the period in results.
+ *      Returns ZSF_ERR_SCHEDULE_INFEASIBLE if the best schedule found still
+ *      violates the limits, in which case it is written nonetheless. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_schedule_optimize(const zsf_param_t *p,
+                                                  const zsf_phase_state_t *state, int num_ships,
+                                                  const zsf_ship_arrival_t *ships,
+                                                  const zsf_schedule_limits_t *limits,
+                                                  int max_lockages, zsf_lockage_t *lockages,
+                                                  zsf_phase_transports_t *transports,
+                                                  int *num_lockages, zsf_results_t *results);
+
+/* Snapshots
+ * ~~~~~~~~~
+ * A snapshot holds the parameters, phase state and (optionally) running
+ * transport totals of one or many locks, so that a simulation can be
+ * restarted from a checkpoint without spin-up. The data is stored verbatim
+ * in native byte order, and a restored run continues bit-identically. The
+ * arrays are stored as contiguous blocks, so that reading and writing the
+ * snapshot of a whole fleet comes down to a few bulk copies. */
+#define ZSF_SNAPSHOT_VERSION 1
+
+/* zsf_snapshot_size:
+ *      get the size in bytes of the snapshot of num_locks locks */
+ZSF_EXPORT size_t ZSF_CALLCONV zsf_snapshot_size(int num_locks, int with_totals);
+
+/* zsf_snapshot_write:
+ *      write the snapshot of num_locks locks to a buffer of (at least)
+ *      zsf_snapshot_size bytes. The totals are optional (NULL). */
+ZSF_EXPORT int ZSF_CALLCONV zsf_snapshot_write(void *buffer, size_t size, int num_locks,
+                                               const zsf_param_t *p,
+                                               const zsf_phase_state_t *state,
+                                               const zsf_phase_transports_t *totals);
+
+/* zsf_snapshot_read:
+ *      read a snapshot from a buffer into arrays of max_locks locks. If p is
+ *      NULL only num_locks is returned. Totals are set to zero if the
+ *      snapshot does not hold any. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_snapshot_read(const void *buffer, size_t size, int max_locks,
+                                              int *num_locks, zsf_param_t *p,
+                                              zsf_phase_state_t *state,
+                                              zsf_phase_transports_t *totals);
+
+/* zsf_snapshot_save:
+ *      write the snapshot of num_locks locks to a binary file */
+ZSF_EXPORT int ZSF_CALLCONV zsf_snapshot_save(const char *path, int num_locks,
+                                              const zsf_param_t *p,
+                                              const zsf_phase_state_t *state,
+                                              const zsf_phase_transports_t *totals);
+
+/* zsf_snapshot_load:
+ *      read a snapshot from a binary file written by zsf_snapshot_save, see
+ *      also zsf_snapshot_read */
+ZSF_EXPORT int ZSF_CALLCONV zsf_snapshot_load(const char *path, int max_locks, int *num_locks,
+                                              zsf_param_t *p, zsf_phase_state_t *state,
+                                              zsf_phase_transports_t *totals);
+
+/* Asynchronous coupling
+ * ~~~~~~~~~~~~~~~~~~~~~
+ * When coupled to a hydrodynamic model, the lock can be calculated by a
+ * worker thread in parallel with the update of the host model. Every host
+ * timestep, the host posts the parameters (boundary conditions) and the
+ * lockages of that timestep, and gets the transports of the previous
+ * timestep in return: the lock lags the host by exactly one timestep. Both
+ * the inputs and outputs are double buffered, and handed over between the
+ * host and the worker without locks. All functions on one zsf_async_t have
+ * to be called from the same (host) thread. */
+typedef struct zsf_async_t zsf_async_t;
+
+/* zsf_async_create:
+ *      start a worker thread for a lock with the given initial state, which
+ *      accepts at most max_lockages lockages per timestep */
+ZSF_EXPORT int ZSF_CALLCONV zsf_async_create(const zsf_phase_state_t *state, int max_lockages,
+                                             zsf_async_t **async);
+
+/* zsf_async_step:
+ *      post timestep n, and wait for the results of timestep n - 1: the
+ *      transports over that timestep (with discharges averaged over dt) and
+ *      the state at its end. The inputs are copied, the lockages are stepped
+ *      as in zsf_step_lockages. Returns the error code of timestep n - 1. On
+ *      the first call the transports are zero and the state is the initial
+ *      state. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_async_step(zsf_async_t *async, const zsf_param_t *p, double dt,
+                                           int num_lockages, const zsf_lockage_t *lockages,
+                                           zsf_phase_transports_t *transports,
+                                           zsf_phase_state_t *state);
+
+/* zsf_async_finish:
+ *      wait for the results of the last posted timestep, e.g. at the end of
+ *      a run. The outputs are optional (NULL). */
+ZSF_EXPORT int ZSF_CALLCONV zsf_async_finish(zsf_async_t *async,
+                                             zsf_phase_transports_t *transports,
+                                             zsf_phase_state_t *state);
+
+/* zsf_async_free:
+ *      wait for the worker to finish the current timestep, stop it and
+ *      release all memory */
+ZSF_EXPORT void ZSF_CALLCONV zsf_async_free(zsf_async_t *async);
+
+/* Output streams
+ * ~~~~~~~~~~~~~~
+ * Long runs of many locks produce far more records than fit in memory. The
+ * stepping threads push their records into a lock-free ring buffer per
+ * thread, which a background writer drains into a compressed columnar file.
+ * A producer only waits for the writer when its ring buffer is full. The
+ * file consists of chunks of (at most) chunk_rows records, with the minimum
+ * and maximum of every column per chunk, so that readers can skip chunks
+ * and decode only the columns they need. */
+#define ZSF_OUTPUT_VERSION 1
+
+/* One record, e.g. the transports of a lockage. The columns of the file are
+ * the fields of the record, with the transports flattened. */
+typedef struct zsf_output_record_t {
+  double time;
+  double lock;
+  double routine;
+  zsf_phase_transports_t transports;
+} zsf_output_record_t;
+
+typedef struct zsf_output_t zsf_output_t;
+typedef struct zsf_output_reader_t zsf_output_reader_t;
+
+/* zsf_output_open:
+ *      create an output file and start its writer thread, with a ring buffer
+ *      of ring_capacity (a power of two) records for every producer */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_open(const char *path, int num_producers,
+                                            int ring_capacity, int chunk_rows,
+                                            zsf_output_t **output);
+
+/* zsf_output_push:
+ *      copy records into the ring buffer of a producer. Every producer must
+ *      only be pushed to from one thread at a time. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_push(zsf_output_t *output, int producer, int num_records,
+                                            const zsf_output_record_t *records);
+
+/* zsf_output_open_columns:
+ *      as zsf_output_open, but for rows of num_columns doubles with the given
+ *      column names (of less than 32 characters) instead of records */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_open_columns(const char *path, int num_columns,
+                                                    const char *const *column_names,
+                                                    int num_producers, int ring_capacity,
+                                                    int chunk_rows, zsf_output_t **output);
+
+/* zsf_output_push_rows:
+ *      as zsf_output_push, for an output opened with zsf_output_open_columns.
+ *      The rows are stored one after the other. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_push_rows(zsf_output_t *output, int producer, int num_rows,
+                                                 const double *rows);
+
+/* zsf_output_close:
+ *      write all pushed records, stop the writer thread and release all
+ *      memory. No producer may push concurrently. Returns the first error of
+ *      the writer. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_close(zsf_output_t *output);
+
+/* zsf_output_reader_open:
+ *      open an output file, reading only the directory of its chunks */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_reader_open(const char *path,
+                                                   zsf_output_reader_t **reader);
+
+/* zsf_output_reader_num_columns:
+ *      get the number of columns */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_reader_num_columns(const zsf_output_reader_t *reader);
+
+/* zsf_output_reader_column_name:
+ *      get the name of a column, or NULL if there is no such column */
+ZSF_EXPORT const char *ZSF_CALLCONV zsf_output_reader_column_name(const zsf_output_reader_t *reader,
+                                                                int column);
+
+/* zsf_output_reader_num_chunks:
+ *      get the number of chunks */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_reader_num_chunks(const zsf_output_reader_t *reader);
+
+/* zsf_output_reader_chunk_info:
+ *      get the number of rows of a chunk, and the minimum and maximum of one
+ *      of its columns */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_reader_chunk_info(const zsf_output_reader_t *reader,
+                                                         int chunk, int column, int *num_rows,
+                                                         double *min, double *max);
+
+/* zsf_output_reader_read:
+ *      decode one column of a chunk into values, which has room for the
+ *      number of rows of the chunk */
+ZSF_EXPORT int ZSF_CALLCONV zsf_output_reader_read(zsf_output_reader_t *reader, int chunk,
+                                                   int column, double *values);
+
+/* zsf_output_reader_free:
+ *      close the file and release all memory */
+ZSF_EXPORT void ZSF_CALLCONV zsf_output_reader_free(zsf_output_reader_t *reader);
+
+/* Calculation service
+ * ~~~~~~~~~~~~~~~~~~~
+ * A server process per machine does the calculations for many client
+ * processes, which share its warm cache instead of each calculating the
+ * same parameters again. Clients write their parameters into slots in shared
+ * memory, and read the results from there. The server coalesces all
+ * submitted slots into one batch, calculates identical parameters only
+ * once, and divides the calculations over its threads. A slot is claimed,
+ * filled, submitted, waited for and released by one client thread. */
+#define ZSF_SERVICE_VERSION 1
+
+typedef struct zsf_service_stats_t {
+  double num_requests;
+  double num_batches;
+  double num_calculated;
+  double num_duplicates;
+  double num_cached;
+} zsf_service_stats_t;
+
+typedef struct zsf_service_t zsf_service_t;
+typedef struct zsf_client_t zsf_client_t;
+
+/* zsf_service_create:
+ *      create the shared memory of a service with num_slots slots of
+ *      slot_capacity parameters each, num_threads calculation threads and a
+ *      cache of (at least) cache_size results */
+ZSF_EXPORT int ZSF_CALLCONV zsf_service_create(const char *name, int num_slots,
+                                               int slot_capacity, int num_threads,
+                                               int cache_size, zsf_service_t **service);
+
+/* zsf_service_run:
+ *      serve the clients until zsf_service_stop is called */
+ZSF_EXPORT int ZSF_CALLCONV zsf_service_run(zsf_service_t *service);
+
+/* zsf_service_stop:
+ *      make zsf_service_run return after the current batch. Can be called
+ *      from any thread, or from a signal handler. */
+ZSF_EXPORT void ZSF_CALLCONV zsf_service_stop(zsf_service_t *service);
+
+/* zsf_service_stats:
+ *      get the number of requests, batches and calculations so far */
+ZSF_EXPORT void ZSF_CALLCONV zsf_service_stats(const zsf_service_t *service,
+                                               zsf_service_stats_t *stats);
+
+/* zsf_service_free:
+ *      remove the shared memory, stop the threads and release all memory */
+ZSF_EXPORT void ZSF_CALLCONV zsf_service_free(zsf_service_t *service);
+
+/* zsf_client_connect:
+ *      connect to the service with the given name */
+ZSF_EXPORT int ZSF_CALLCONV zsf_client_connect(const char *name, zsf_client_t **client);
+
+/* zsf_client_slot_capacity:
+ *      get the maximum number of parameters per slot */
+ZSF_EXPORT int ZSF_CALLCONV zsf_client_slot_capacity(const zsf_client_t *client);
+
+/* zsf_client_acquire:
+ *      claim a free slot, and get the array in shared memory to write the
+ *      parameters to */
+ZSF_EXPORT int ZSF_CALLCONV zsf_client_acquire(zsf_client_t *client, int *slot, zsf_param_t **p);
+
+/* zsf_client_submit:
+ *      submit the first num_params parameters of a claimed slot */
+ZSF_EXPORT int ZSF_CALLCONV zsf_client_submit(zsf_client_t *client, int slot, int num_params);
+
+/* zsf_client_wait:
+ *      wait for the results of a submitted slot, and get the arrays in
+ *      shared memory holding them. They are valid until the slot is
+ *      released. */
+ZSF_EXPORT int ZSF_CALLCONV zsf_client_wait(zsf_client_t *client, int slot,
+                                            const zsf_results_t **results, const int **errors);
+
+/* zsf_client_release:
+ *      hand a slot back to the service after reading its results */
+ZSF_EXPORT void ZSF_CALLCONV zsf_client_release(zsf_client_t *client, int slot);
+
+/* zsf_client_calc_steady_batch:
+ *      calculate the steady state of any number of parameters through the
+ *      service, like zsf_calc_steady_batch with all outputs. The errors are
+ *      optional (NULL). */
+ZSF_EXPORT int ZSF_CALLCONV zsf_client_calc_steady_batch(zsf_client_t *client, int num_params,
+                                                         const zsf_param_t *p,
+                                                         zsf_results_t *results, int *errors);
+
+/* zsf_client_disconnect:
+ *      unmap the shared memory and release all memory of the client */
+ZSF_EXPORT void ZSF_CALLCONV zsf_client_disconnect(zsf_client_t *client);
+
 /* zsf_error_msg:
  *      Get error messeage corresponding to error code */
 ZSF_EXPORT const char *ZSF_CALLCONV zsf_error_msg(int code);
@@ -0,0 +1,724 @@
+/*****************************************************************************
+ * zsf.hpp: zsf header-only C++ interface
+ *****************************************************************************/
+
+// A thin C++17 layer over the C interface in zsf.h. The C structs are used
+// as they are, and all bulk calls take spans into memory owned by the
+// caller, so nothing is allocated or copied on top of the C calls. Opaque
+// handles (surrogates, lockage generators, networks, forcings, asynchronous
+// locks) are owned by move-only objects. Error codes are turned into
+// zsf::error exceptions, or into std::expected for the try_* functions when
+// compiled as C++23.
+//
+// With C++20 zsf::span is std::span, otherwise a minimal equivalent. When
+// the standard library supports parallel algorithms, the bulk calls also
+// accept an execution policy (e.g. std::execution::par_unseq).
+
+#ifndef ZSF_ZSF_HPP
+#define ZSF_ZSF_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<version>)
+#  include <version>
+#endif
+
+#if defined(__cpp_lib_span) && __cpp_lib_span >= 202002L
+#  include <span>
+#endif
+
+#if defined(__cpp_lib_execution) && __cpp_lib_execution >= 201603L
+#  include <algorithm>
+#  include <execution>
+#  define ZSF_HAS_EXECUTION 1
+#endif
+
+#if defined(__cpp_lib_expected) && __cpp_lib_expected >= 202202L
+#  include <expected>
+#  define ZSF_HAS_EXPECTED 1
+#endif
+
+#include "zsf.h"
+
+namespace zsf {
+
+/* Errors
+ * ~~~~~~ */
+enum class errc : int {
+  success = 0,
+  ship_too_big = 1,
+  remaining_head_diff = 2,
+  sal_lock_out_of_bounds = 3,
+  invalid_argument = 4,
+  out_of_memory = 5,
+  io = 6,
+  file_format = 7,
+  compartment_out_of_bounds = 8,
+  service_unavailable = 9,
+  schedule_infeasible = 10,
+  not_converged = 11,
+};
+
+class error : public std::runtime_error {
+public:
+  explicit error(errc code)
+      : std::runtime_error(zsf_error_msg(static_cast<int>(code))), code_(code) {}
+
+  errc code() const noexcept { return code_; }
+
+private:
+  errc code_;
+};
+
+inline void check(int err) {
+  if (err)
+    throw error(static_cast<errc>(err));
+}
+
+#ifdef ZSF_HAS_EXPECTED
+template <class T> using expected = std::expected<T, errc>;
+#endif
+
+/* Spans
+ * ~~~~~ */
+#if defined(__cpp_lib_span) && __cpp_lib_span >= 202002L
+template <class T> using span = std::span<T>;
+#else
+template <class T> class span {
+public:
+  constexpr span() noexcept = default;
+  constexpr span(T *data, std::size_t size) noexcept : data_(data), size_(size) {}
+  template <std::size_t N> constexpr span(T (&array)[N]) noexcept : data_(array), size_(N) {}
+
+  // Any contiguous container, e.g. std::vector or std::array
+  template <class C, class E = std::remove_pointer_t<decltype(std::declval<C &>().data())>,
+            class = std::enable_if_t<std::is_convertible_v<E (*)[], T (*)[]>>>
+  constexpr span(C &c) noexcept : data_(c.data()), size_(c.size()) {}
+
+  // From span<U> to span<const U>
+  template <class U, class = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+  constexpr span(const span<U> &s) noexcept : data_(s.data()), size_(s.size()) {}
+
+  constexpr T *data() const noexcept { return data_; }
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr T *begin() const noexcept { return data_; }
+  constexpr T *end() const noexcept { return data_ + size_; }
+  constexpr T &operator[](std::size_t i) const noexcept { return data_[i]; }
+  constexpr span first(std::size_t n) const noexcept { return span(data_, n); }
+
+private:
+  T *data_ = nullptr;
+  std::size_t size_ = 0;
+};
+#endif
+
+/* Parameters
+ * ~~~~~~~~~~
+ * Builder of zsf_param_t starting from the default values, e.g.
+ *
+ *     zsf_param_t p = zsf::param_builder().head_sea(0.5).salinity_sea(25.0); */
+#define ZSF_HPP_PARAM_FIELDS(X)                                                                    \
+  X(lock_length)                                                                                   \
+  X(lock_width)                                                                                    \
+  X(lock_bottom)                                                                                   \
+  X(num_cycles)                                                                                    \
+  X(door_time_to_open)                                                                             \
+  X(leveling_time)                                                                                 \
+  X(calibration_coefficient)                                                                       \
+  X(symmetry_coefficient)                                                                          \
+  X(ship_volume_sea_to_lake)                                                                       \
+  X(ship_volume_lake_to_sea)                                                                       \
+  X(salinity_lock)                                                                                 \
+  X(head_sea)                                                                                      \
+  X(salinity_sea)                                                                                  \
+  X(temperature_sea)                                                                               \
+  X(head_lake)                                                                                     \
+  X(salinity_lake)                                                                                 \
+  X(temperature_lake)                                                                              \
+  X(flushing_discharge_high_tide)                                                                  \
+  X(flushing_discharge_low_tide)                                                                   \
+  X(density_current_factor_sea)                                                                    \
+  X(density_current_factor_lake)                                                                   \
+  X(distance_door_bubble_screen_sea)                                                               \
+  X(distance_door_bubble_screen_lake)                                                              \
+  X(sill_height_sea)                                                                               \
+  X(sill_height_lake)                                                                              \
+  X(rtol)                                                                                          \
+  X(atol)
+
+class param_builder {
+public:
+  param_builder() noexcept { zsf_param_default(&p_); }
+  explicit param_builder(const zsf_param_t &p) noexcept : p_(p) {}
+
+#define ZSF_HPP_SETTER(NAME)                                                                       \
+  param_builder &NAME(double value) noexcept {                                                     \
+    p_.NAME = value;                                                                               \
+    return *this;                                                                                  \
+  }
+  ZSF_HPP_PARAM_FIELDS(ZSF_HPP_SETTER)
+#undef ZSF_HPP_SETTER
+
+  const zsf_param_t &build() const noexcept { return p_; }
+  operator const zsf_param_t &() const noexcept { return p_; }
+
+private:
+  zsf_param_t p_;
+};
+
+#undef ZSF_HPP_PARAM_FIELDS
+
+/* Steady state
+ * ~~~~~~~~~~~~ */
+inline zsf_results_t calc_steady(const zsf_param_t &p) {
+  zsf_results_t results;
+  check(zsf_calc_steady(&p, &results, nullptr));
+  return results;
+}
+
+inline zsf_results_t calc_steady(const zsf_param_t &p, zsf_aux_results_t &aux_results) {
+  zsf_results_t results;
+  check(zsf_calc_steady(&p, &results, &aux_results));
+  return results;
+}
+
+#ifdef ZSF_HAS_EXPECTED
+inline expected<zsf_results_t> try_calc_steady(const zsf_param_t &p) noexcept {
+  zsf_results_t results;
+  int err = zsf_calc_steady(&p, &results, nullptr);
+  if (err)
+    return std::unexpected(static_cast<errc>(err));
+  return results;
+}
+#endif
+
+namespace detail {
+// zsf_results_t only holds doubles, so a span of them is a row-major table
+constexpr int num_results = sizeof(zsf_results_t) / sizeof(double);
+
+inline double *results_data(span<zsf_results_t> results) noexcept {
+  return reinterpret_cast<double *>(results.data());
+}
+
+// Whether num_rows rows of the fields in output_mask, stored with the given
+// strides, lie within outputs
+inline bool fits(span<double> outputs, std::size_t num_rows, int output_mask, int row_stride,
+                 int column_stride) noexcept {
+  std::ptrdiff_t num_fields = 0;
+  for (unsigned mask = static_cast<unsigned>(output_mask) & ZSF_OUTPUT_ALL; mask; mask >>= 1)
+    num_fields += mask & 1;
+  if (num_rows == 0 || num_fields == 0)
+    return true;
+
+  // The extreme indices are at the corners
+  std::ptrdiff_t last_row = static_cast<std::ptrdiff_t>(num_rows - 1) * row_stride;
+  std::ptrdiff_t last_field = (num_fields - 1) * column_stride;
+  std::ptrdiff_t lo = (last_row < 0 ? last_row : 0) + (last_field < 0 ? last_field : 0);
+  std::ptrdiff_t hi = (last_row > 0 ? last_row : 0) + (last_field > 0 ? last_field : 0);
+  return lo >= 0 && hi < static_cast<std::ptrdiff_t>(outputs.size());
+}
+
+// With per-calculation error codes the caller inspects those, otherwise the
+// first error is thrown.
+inline errc batch_error(int err, span<int> errors) {
+  if (errors.empty())
+    check(err);
+  return static_cast<errc>(err);
+}
+} // namespace detail
+
+/* calc_steady_batch:
+ *      steady state of every set of parameters, see zsf_calc_steady_batch.
+ *      The results of failed calculations are set to ZSF_NAN. Without
+ *      errors the first error is thrown, otherwise it is returned. */
+inline errc calc_steady_batch(span<const zsf_param_t> p, span<zsf_results_t> results,
+                              span<int> errors = {}) {
+  if (results.size() != p.size() || (!errors.empty() && errors.size() != p.size()))
+    throw error(errc::invalid_argument);
+
+  int err = zsf_calc_steady_batch(static_cast<int>(p.size()), p.data(), ZSF_OUTPUT_ALL,
+                                  detail::results_data(results), detail::num_results, 1,
+                                  errors.empty() ? nullptr : errors.data());
+  return detail::batch_error(err, errors);
+}
+
+/* calc_steady_batch:
+ *      as above, but only the fields in output_mask, stored with the given
+ *      strides in outputs */
+inline errc calc_steady_batch(span<const zsf_param_t> p, int output_mask, span<double> outputs,
+                              int row_stride, int column_stride, span<int> errors = {}) {
+  if ((!errors.empty() && errors.size() != p.size()) ||
+      !detail::fits(outputs, p.size(), output_mask, row_stride, column_stride))
+    throw error(errc::invalid_argument);
+
+  int err = zsf_calc_steady_batch(static_cast<int>(p.size()), p.data(), output_mask,
+                                  outputs.data(), row_stride, column_stride,
+                                  errors.empty() ? nullptr : errors.data());
+  return detail::batch_error(err, errors);
+}
+
+#ifdef ZSF_HAS_EXECUTION
+namespace detail {
+template <class T>
+using if_execution_policy =
+    std::enable_if_t<std::is_execution_policy_v<std::remove_cv_t<std::remove_reference_t<T>>>>;
+} // namespace detail
+
+/* calc_steady_batch:
+ *      as above, with the calculations distributed according to the
+ *      execution policy */
+template <class ExecutionPolicy, class = detail::if_execution_policy<ExecutionPolicy>>
+errc calc_steady_batch(ExecutionPolicy &&policy, span<const zsf_param_t> p,
+                       span<zsf_results_t> results, span<int> errors = {}) {
+  if (results.size() != p.size() || (!errors.empty() && errors.size() != p.size()))
+    throw error(errc::invalid_argument);
+
+  // Exceptions must not escape the parallel algorithm, so the first error
+  // is collected and only thrown afterwards.
+  std::atomic<int> first_err{0};
+  std::for_each(std::forward<ExecutionPolicy>(policy), p.begin(), p.end(),
+                [&](const zsf_param_t &pi) {
+                  std::size_t i = static_cast<std::size_t>(&pi - p.data());
+                  int err = zsf_calc_steady_batch(1, &pi, ZSF_OUTPUT_ALL,
+                                                  detail::results_data(results) +
+                                                      i * detail::num_results,
+                                                  detail::num_results, 1, nullptr);
+                  if (!errors.empty())
+                    errors[i] = err;
+                  int expected = 0;
+                  if (err)
+                    first_err.compare_exchange_strong(expected, err);
+                });
+
+  return detail::batch_error(first_err.load(), errors);
+}
+#endif
+
+/* calc_steady_bounds:
+ *      lower and upper bounds on the steady results for all parameters
+ *      between lo and hi, see zsf_calc_steady_bounds */
+inline std::pair<zsf_results_t, zsf_results_t> calc_steady_bounds(const zsf_param_t &lo,
+                                                                  const zsf_param_t &hi,
+                                                                  int max_boxes = 1) {
+  std::pair<zsf_results_t, zsf_results_t> bounds;
+  check(zsf_calc_steady_bounds(&lo, &hi, max_boxes, &bounds.first, &bounds.second));
+  return bounds;
+}
+
+/* Phase-wise calculation
+ * ~~~~~~~~~~~~~~~~~~~~~~
+ * A lock holds its parameters and phase state by value. The parameters can
+ * be changed between steps, e.g. to follow the head at sea. */
+class lock {
+public:
+  lock(const zsf_param_t &p, double salinity_lock, double head_lock) : p_(p) {
+    check(zsf_initialize_state(&p_, &state_, salinity_lock, head_lock));
+  }
+  lock(const zsf_param_t &p, const zsf_phase_state_t &state) noexcept : p_(p), state_(state) {}
+
+  zsf_param_t &params() noexcept { return p_; }
+  const zsf_param_t &params() const noexcept { return p_; }
+  const zsf_phase_state_t &state() const noexcept { return state_; }
+
+  zsf_phase_transports_t step_phase_1(double t_level) {
+    zsf_phase_transports_t results;
+    check(zsf_step_phase_1(&p_, t_level, &state_, &results));
+    return results;
+  }
+
+  zsf_phase_transports_t step_phase_2(double t_open_lake) {
+    zsf_phase_transports_t results;
+    check(zsf_step_phase_2(&p_, t_open_lake, &state_, &results));
+    return results;
+  }
+
+  zsf_phase_transports_t step_phase_3(double t_level) {
+    zsf_phase_transports_t results;
+    check(zsf_step_phase_3(&p_, t_level, &state_, &results));
+    return results;
+  }
+
+  zsf_phase_transports_t step_phase_4(double t_open_sea) {
+    zsf_phase_transports_t results;
+    check(zsf_step_phase_4(&p_, t_open_sea, &state_, &results));
+    return results;
+  }
+
+  zsf_phase_transports_t step_flush_doors_closed(double t_flushing) {
+    zsf_phase_transports_t results;
+    check(zsf_step_flush_doors_closed(&p_, t_flushing, &state_, &results));
+    return results;
+  }
+
+  /* step_lockages:
+   *      replay a sequence of lockages, see zsf_step_lockages. The transports
+   *      of every lockage are optional. */
+  void step_lockages(span<const zsf_lockage_t> lockages,
+                     span<zsf_phase_transports_t> transports = {}) {
+    if (!transports.empty() && transports.size() != lockages.size())
+      throw error(errc::invalid_argument);
+    check(zsf_step_lockages(&p_, static_cast<int>(lockages.size()), lockages.data(), &state_,
+                            transports.empty() ? nullptr : transports.data()));
+  }
+
+  /* step_lockages_parallel:
+   *      as step_lockages, with the sequence split over num_threads threads,
+   *      see zsf_step_lockages_parallel */
+  void step_lockages_parallel(span<const zsf_lockage_t> lockages, int num_threads,
+                              span<zsf_phase_transports_t> transports = {}) {
+    if (!transports.empty() && transports.size() != lockages.size())
+      throw error(errc::invalid_argument);
+    check(zsf_step_lockages_parallel(&p_, static_cast<int>(lockages.size()), lockages.data(),
+                                     &state_, transports.empty() ? nullptr : transports.data(),
+                                     num_threads));
+  }
+
+  /* resolve_phase:
+   *      sample the transports within a phase, see zsf_resolve_phase */
+  void resolve_phase(int routine, double duration, span<const double> times,
+                     span<zsf_phase_transports_t> samples) const {
+    if (samples.size() != times.size())
+      throw error(errc::invalid_argument);
+    check(zsf_resolve_phase(&p_, routine, duration, &state_, static_cast<int>(times.size()),
+                            times.data(), samples.data()));
+  }
+
+private:
+  friend class lockage_generator;
+  friend class forcing;
+
+  zsf_param_t p_;
+  zsf_phase_state_t state_;
+};
+
+/* replay_variants:
+ *      replay a sequence of lockages for variants of the countermeasures of
+ *      the same lock at once, see zsf_replay_variants */
+inline void replay_variants(span<const zsf_param_t> variants, span<const zsf_lockage_t> lockages,
+                            span<zsf_phase_state_t> states, span<zsf_results_t> results) {
+  if (states.size() != variants.size() || results.size() != variants.size())
+    throw error(errc::invalid_argument);
+  check(zsf_replay_variants(static_cast<int>(variants.size()), variants.data(),
+                            static_cast<int>(lockages.size()), lockages.data(), states.data(),
+                            results.data()));
+}
+
+/* schedule_optimize:
+ *      optimise the operation of the lock for the given ship arrivals, see
+ *      zsf_schedule_optimize. Returns the number of lockages written. */
+inline std::size_t schedule_optimize(const lock &l, span<const zsf_ship_arrival_t> ships,
+                                     const zsf_schedule_limits_t &limits,
+                                     span<zsf_lockage_t> lockages, zsf_results_t &results,
+                                     span<zsf_phase_transports_t> transports = {}) {
+  if (!transports.empty() && transports.size() != lockages.size())
+    throw error(errc::invalid_argument);
+  int num_lockages = 0;
+  check(zsf_schedule_optimize(&l.params(), &l.state(), static_cast<int>(ships.size()),
+                              ships.data(), &limits, static_cast<int>(lockages.size()),
+                              lockages.data(), transports.empty() ? nullptr : transports.data(),
+                              &num_lockages, &results));
+  return static_cast<std::size_t>(num_lockages);
+}
+
+/* Snapshots
+ * ~~~~~~~~~ */
+inline void snapshot_save(const char *path, span<const zsf_param_t> p,
+                          span<const zsf_phase_state_t> state,
+                          span<const zsf_phase_transports_t> totals = {}) {
+  if (state.size() != p.size() || (!totals.empty() && totals.size() != p.size()))
+    throw error(errc::invalid_argument);
+  check(zsf_snapshot_save(path, static_cast<int>(p.size()), p.data(), state.data(),
+                          totals.empty() ? nullptr : totals.data()));
+}
+
+/* snapshot_load:
+ *      read at most p.size() locks, and return the number of locks read */
+inline std::size_t snapshot_load(const char *path, span<zsf_param_t> p,
+                                 span<zsf_phase_state_t> state,
+                                 span<zsf_phase_transports_t> totals = {}) {
+  if (state.size() != p.size() || (!totals.empty() && totals.size() != p.size()))
+    throw error(errc::invalid_argument);
+  int num_locks = 0;
+  check(zsf_snapshot_load(path, static_cast<int>(p.size()), &num_locks, p.data(), state.data(),
+                          totals.empty() ? nullptr : totals.data()));
+  return static_cast<std::size_t>(num_locks);
+}
+
+namespace detail {
+struct surrogate_deleter {
+  void operator()(zsf_surrogate_t *s) const noexcept { zsf_surrogate_free(s); }
+};
+struct lockage_generator_deleter {
+  void operator()(zsf_lockage_generator_t *g) const noexcept { zsf_lockage_generator_free(g); }
+};
+struct network_deleter {
+  void operator()(zsf_network_t *n) const noexcept { zsf_network_free(n); }
+};
+struct forcing_deleter {
+  void operator()(zsf_forcing_t *f) const noexcept { zsf_forcing_free(f); }
+};
+struct async_deleter {
+  void operator()(zsf_async_t *a) const noexcept { zsf_async_free(a); }
+};
+} // namespace detail
+
+/* Surrogate tables
+ * ~~~~~~~~~~~~~~~~ */
+class surrogate {
+public:
+  static surrogate build(const zsf_param_t &p, span<const char *const> axis_names,
+                         span<const int> num_points, span<const double> axis_values) {
+    std::size_t num_values = 0;
+    for (int n : num_points)
+      num_values += static_cast<std::size_t>(n > 0 ? n : 0);
+    if (num_points.size() != axis_names.size() || axis_values.size() != num_values)
+      throw error(errc::invalid_argument);
+    zsf_surrogate_t *s = nullptr;
+    check(zsf_surrogate_build(&p, static_cast<int>(axis_names.size()), axis_names.data(),
+                              num_points.data(), axis_values.data(), &s));
+    return surrogate(s);
+  }
+
+  static surrogate load(const char *path) {
+    zsf_surrogate_t *s = nullptr;
+    check(zsf_surrogate_load(path, &s));
+    return surrogate(s);
+  }
+
+  void save(const char *path) const { check(zsf_surrogate_save(s_.get(), path)); }
+
+  int num_axes() const noexcept { return zsf_surrogate_num_axes(s_.get()); }
+  const char *axis_name(int axis) const noexcept { return zsf_surrogate_axis_name(s_.get(), axis); }
+
+  zsf_results_t operator()(span<const double> x, int method = ZSF_INTERP_LINEAR) const {
+    if (x.size() != static_cast<std::size_t>(num_axes()))
+      throw error(errc::invalid_argument);
+    zsf_results_t results;
+    check(zsf_surrogate_eval(s_.get(), x.data(), method, &results));
+    return results;
+  }
+
+#ifdef ZSF_HAS_EXECUTION
+  /* eval:
+   *      interpolate at many points, stored one after the other in x, with
+   *      the points distributed according to the execution policy */
+  template <class ExecutionPolicy, class = detail::if_execution_policy<ExecutionPolicy>>
+  void eval(ExecutionPolicy &&policy, span<const double> x, span<zsf_results_t> results,
+            int method = ZSF_INTERP_LINEAR) const {
+    std::size_t n = static_cast<std::size_t>(num_axes());
+    if (x.size() != results.size() * n)
+      throw error(errc::invalid_argument);
+
+    // Evaluation only fails on invalid arguments, which are the same for
+    // all points.
+    std::atomic<int> first_err{0};
+    const zsf_surrogate_t *s = s_.get();
+    std::for_each(std::forward<ExecutionPolicy>(policy), results.begin(), results.end(),
+                  [&](zsf_results_t &r) {
+                    std::size_t i = static_cast<std::size_t>(&r - results.data());
+                    int err = zsf_surrogate_eval(s, x.data() + i * n, method, &r);
+                    int expected = 0;
+                    if (err)
+                      first_err.compare_exchange_strong(expected, err);
+                  });
+    check(first_err.load());
+  }
+#endif
+
+  zsf_surrogate_t *get() const noexcept { return s_.get(); }
+
+private:
+  explicit surrogate(zsf_surrogate_t *s) noexcept : s_(s) {}
+
+  std::unique_ptr<zsf_surrogate_t, detail::surrogate_deleter> s_;
+};
+
+/* Lockage schedules
+ * ~~~~~~~~~~~~~~~~~ */
+class lockage_generator {
+public:
+  lockage_generator(const zsf_traffic_t &traffic, span<const zsf_fleet_class_t> fleet,
+                    const zsf_lock_policy_t &policy, int seed) {
+    zsf_lockage_generator_t *g = nullptr;
+    check(zsf_lockage_generator_create(&traffic, static_cast<int>(fleet.size()), fleet.data(),
+                                       &policy, seed, &g));
+    g_.reset(g);
+  }
+
+  /* next:
+   *      fill the buffer with the next lockages starting before t_end, and
+   *      return the part of it that was filled */
+  span<zsf_lockage_t> next(double t_end, span<zsf_lockage_t> buffer) {
+    int n = 0;
+    check(zsf_lockage_generator_next(g_.get(), t_end, static_cast<int>(buffer.size()),
+                                     buffer.data(), &n));
+    return buffer.first(static_cast<std::size_t>(n));
+  }
+
+  /* run:
+   *      stream the lockages up to t_end through the lock, see
+   *      zsf_run_lockages */
+  zsf_results_t run(lock &l, double t_end) {
+    zsf_results_t results;
+    check(zsf_run_lockages(&l.p_, g_.get(), t_end, &l.state_, &results));
+    return results;
+  }
+
+  zsf_traffic_stats_t stats() const {
+    zsf_traffic_stats_t stats;
+    check(zsf_lockage_generator_stats(g_.get(), &stats));
+    return stats;
+  }
+
+  zsf_lockage_generator_t *get() const noexcept { return g_.get(); }
+
+private:
+  std::unique_ptr<zsf_lockage_generator_t, detail::lockage_generator_deleter> g_;
+};
+
+/* Networks of locks
+ * ~~~~~~~~~~~~~~~~~
+ * The generators are not owned by the network, and have to outlive it. */
+class network {
+public:
+  network(span<const zsf_param_t> p, span<const zsf_phase_state_t> states,
+          span<zsf_lockage_generator_t *const> generators, double dt_output) {
+    if (states.size() != p.size() || generators.size() != p.size())
+      throw error(errc::invalid_argument);
+    zsf_network_t *n = nullptr;
+    check(zsf_network_create(static_cast<int>(p.size()), p.data(), states.data(),
+                             generators.data(), dt_output, &n));
+    n_.reset(n);
+    num_locks_ = p.size();
+  }
+
+  /* advance:
+   *      process all events up to the next output time, and get the
+   *      transports of every lock over the output interval, see
+   *      zsf_network_advance */
+  void advance(span<zsf_phase_transports_t> transports) {
+    if (transports.size() != num_locks_)
+      throw error(errc::invalid_argument);
+    check(zsf_network_advance(n_.get(), transports.data()));
+  }
+
+  void set_param(int lock, const zsf_param_t &p) {
+    check(zsf_network_set_param(n_.get(), lock, &p));
+  }
+
+  zsf_phase_state_t state(int lock) const {
+    zsf_phase_state_t state;
+    check(zsf_network_state(n_.get(), lock, &state));
+    return state;
+  }
+
+  std::size_t size() const noexcept { return num_locks_; }
+  zsf_network_t *get() const noexcept { return n_.get(); }
+
+private:
+  std::unique_ptr<zsf_network_t, detail::network_deleter> n_;
+  std::size_t num_locks_ = 0;
+};
+
+/* Boundary forcing
+ * ~~~~~~~~~~~~~~~~ */
+class forcing {
+public:
+  forcing(double mean_sea_level, span<const zsf_tidal_constituent_t> constituents,
+          span<const char *const> parameters = {}, span<const zsf_seasonal_t> curves = {}) {
+    if (curves.size() != parameters.size())
+      throw error(errc::invalid_argument);
+    zsf_forcing_t *f = nullptr;
+    check(zsf_forcing_create(mean_sea_level, static_cast<int>(constituents.size()),
+                             constituents.data(), static_cast<int>(curves.size()),
+                             parameters.data(), curves.data(), &f));
+    f_.reset(f);
+  }
+
+  /* eval:
+   *      the parameters p with the forced ones evaluated at the times
+   *      t0 + i * dt, one per element of out */
+  void eval(const zsf_param_t &p, double t0, double dt, span<zsf_param_t> out) const {
+    check(zsf_forcing_eval(f_.get(), &p, t0, dt, static_cast<int>(out.size()), out.data()));
+  }
+
+  /* calc_steady:
+   *      steady state at the times t0 + i * dt, one per element of results,
+   *      see zsf_calc_steady_forced. Failed calculations are handled as in
+   *      calc_steady_batch. */
+  errc calc_steady(const zsf_param_t &p, double t0, double dt, span<zsf_results_t> results,
+                   span<int> errors = {}) const {
+    if (!errors.empty() && errors.size() != results.size())
+      throw error(errc::invalid_argument);
+    int err = zsf_calc_steady_forced(&p, f_.get(), t0, dt, static_cast<int>(results.size()),
+                                     ZSF_OUTPUT_ALL, detail::results_data(results),
+                                     detail::num_results, 1,
+                                     errors.empty() ? nullptr : errors.data());
+    return detail::batch_error(err, errors);
+  }
+
+  /* step_lockages:
+   *      replay a sequence of lockages through the lock with its parameters
+   *      forced, see zsf_step_lockages_forced */
+  void step_lockages(lock &l, span<const zsf_lockage_t> lockages,
+                     span<zsf_phase_transports_t> transports = {}) const {
+    if (!transports.empty() && transports.size() != lockages.size())
+      throw error(errc::invalid_argument);
+    check(zsf_step_lockages_forced(&l.p_, f_.get(), static_cast<int>(lockages.size()),
+                                   lockages.data(), &l.state_,
+                                   transports.empty() ? nullptr : transports.data()));
+  }
+
+  zsf_forcing_t *get() const noexcept { return f_.get(); }
+
+private:
+  std::unique_ptr<zsf_forcing_t, detail::forcing_deleter> f_;
+};
+
+/* Asynchronous coupling
+ * ~~~~~~~~~~~~~~~~~~~~~
+ * The worker thread is stopped when the object is destroyed. */
+class async_lock {
+public:
+  struct output {
+    zsf_phase_transports_t transports;
+    zsf_phase_state_t state;
+  };
+
+  async_lock(const zsf_phase_state_t &state, int max_lockages) {
+    zsf_async_t *a = nullptr;
+    check(zsf_async_create(&state, max_lockages, &a));
+    a_.reset(a);
+  }
+
+  /* step:
+   *      post a timestep, and get the output of the previous one, see
+   *      zsf_async_step */
+  output step(const zsf_param_t &p, double dt, span<const zsf_lockage_t> lockages) {
+    output out;
+    check(zsf_async_step(a_.get(), &p, dt, static_cast<int>(lockages.size()), lockages.data(),
+                         &out.transports, &out.state));
+    return out;
+  }
+
+  output finish() {
+    output out;
+    check(zsf_async_finish(a_.get(), &out.transports, &out.state));
+    return out;
+  }
+
+  zsf_async_t *get() const noexcept { return a_.get(); }
+
+private:
+  std::unique_ptr<zsf_async_t, detail::async_deleter> a_;
+};
+
+} // namespace zsf
+
+#endif
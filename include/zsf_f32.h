@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * zsf_f32.h: zsf single precision public header
+ *****************************************************************************/
+
+// Single precision (float) variants of the phase-wise and steady state
+// calculations. These are meant for bulk calculations (scenario generation,
+// Monte Carlo, grid sweeps) where single precision is sufficient, and halve
+// the memory footprint of the inputs and outputs. The structures mirror
+// those in zsf.h, but note that they are therefore packed at 4 bytes.
+//
+// The convergence criterion of the steady state calculation should not be
+// tighter than what single precision can resolve, i.e. a relative tolerance
+// of at least 1E-6.
+
+#ifndef ZSF_ZSF_F32_H
+#define ZSF_ZSF_F32_H
+
+#include "zsf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct zsf_param_f32_t {
+  float lock_length;
+  float lock_width;
+  float lock_bottom;
+  float num_cycles;
+  float door_time_to_open;
+  float leveling_time;
+  float calibration_coefficient;
+  float symmetry_coefficient;
+  float ship_volume_sea_to_lake;
+  float ship_volume_lake_to_sea;
+  float salinity_lock;
+  float head_sea;
+  float salinity_sea;
+  float temperature_sea;
+  float head_lake;
+  float salinity_lake;
+  float temperature_lake;
+  float flushing_discharge_high_tide;
+  float flushing_discharge_low_tide;
+  float density_current_factor_sea;
+  float density_current_factor_lake;
+  float distance_door_bubble_screen_sea;
+  float distance_door_bubble_screen_lake;
+  float sill_height_sea;
+  float sill_height_lake;
+  float rtol;
+  float atol;
+} zsf_param_f32_t;
+
+typedef struct zsf_results_f32_t {
+  float mass_transport_lake;
+  float salt_load_lake;
+  float discharge_from_lake;
+  float discharge_to_lake;
+  float salinity_to_lake;
+
+  float mass_transport_sea;
+  float salt_load_sea;
+  float discharge_from_sea;
+  float discharge_to_sea;
+  float salinity_to_sea;
+} zsf_results_f32_t;
+
+typedef struct zsf_phase_state_f32_t {
+  float salinity_lock;
+  float saltmass_lock;
+  float head_lock;
+  float volume_ship_in_lock;
+} zsf_phase_state_f32_t;
+
+typedef struct zsf_phase_transports_f32_t {
+  float mass_transport_lake;
+  float volume_from_lake;
+  float volume_to_lake;
+  float discharge_from_lake;
+  float discharge_to_lake;
+  float salinity_to_lake;
+
+  float mass_transport_sea;
+  float volume_from_sea;
+  float volume_to_sea;
+  float discharge_from_sea;
+  float discharge_to_sea;
+  float salinity_to_sea;
+} zsf_phase_transports_f32_t;
+
+/* zsf_param_to_f32:
+ *      convert double precision parameters to single precision */
+ZSF_EXPORT void ZSF_CALLCONV zsf_param_to_f32(const zsf_param_t *p, zsf_param_f32_t *p_f32);
+
+/* zsf_param_default_f32:
+ *      fill zsf_param_f32_t with default values */
+ZSF_EXPORT void ZSF_CALLCONV zsf_param_default_f32(zsf_param_f32_t *p);
+
+/* zsf_initialize_state_f32:
+ *      single precision variant of zsf_initialize_state */
+ZSF_EXPORT int ZSF_CALLCONV zsf_initialize_state_f32(const zsf_param_f32_t *p,
+                                                     zsf_phase_state_f32_t *state,
+                                                     float salinity_lock, float head_lock);
+
+/* zsf_step_phase_1_f32:
+ *      single precision variant of zsf_step_phase_1 */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_phase_1_f32(const zsf_param_f32_t *p, float t_level,
+                                                 zsf_phase_state_f32_t *state,
+                                                 zsf_phase_transports_f32_t *results);
+
+/* zsf_step_phase_2_f32:
+ *      single precision variant of zsf_step_phase_2 */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_phase_2_f32(const zsf_param_f32_t *p, float t_open_lake,
+                                                 zsf_phase_state_f32_t *state,
+                                                 zsf_phase_transports_f32_t *results);
+
+/* zsf_step_phase_3_f32:
+ *      single precision variant of zsf_step_phase_3 */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_phase_3_f32(const zsf_param_f32_t *p, float t_level,
+                                                 zsf_phase_state_f32_t *state,
+                                                 zsf_phase_transports_f32_t *results);
+
+/* zsf_step_phase_4_f32:
+ *      single precision variant of zsf_step_phase_4 */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_phase_4_f32(const zsf_param_f32_t *p, float t_open_sea,
+                                                 zsf_phase_state_f32_t *state,
+                                                 zsf_phase_transports_f32_t *results);
+
+/* zsf_step_flush_doors_closed_f32:
+ *      single precision variant of zsf_step_flush_doors_closed */
+ZSF_EXPORT int ZSF_CALLCONV zsf_step_flush_doors_closed_f32(const zsf_param_f32_t *p,
+                                                            float t_flushing,
+                                                            zsf_phase_state_f32_t *state,
+                                                            zsf_phase_transports_f32_t *results);
+
+/* zsf_calc_steady_f32:
+ *      single precision variant of zsf_calc_steady, without auxiliary results */
+ZSF_EXPORT int ZSF_CALLCONV zsf_calc_steady_f32(const zsf_param_f32_t *p,
+                                                zsf_results_f32_t *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
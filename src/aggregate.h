@@ -0,0 +1,71 @@
+#ifndef ZSF_AGGREGATE_H
+#define ZSF_AGGREGATE_H
+
+#include "zsf.h"
+#include <string.h>
+
+// Accumulates the transports of a sequence of phases. Volumes and mass
+// transports are summed, and salinities are weighted by volume.
+typedef struct aggregate_t {
+  zsf_phase_transports_t sum;
+  double salt_to_lake;
+  double salt_to_sea;
+} aggregate_t;
+
+static inline void aggregate_reset(aggregate_t *a) { memset(a, 0, sizeof(aggregate_t)); }
+
+static inline void aggregate_add(aggregate_t *a, const zsf_phase_transports_t *tp) {
+  a->sum.mass_transport_lake += tp->mass_transport_lake;
+  a->sum.volume_from_lake += tp->volume_from_lake;
+  a->sum.volume_to_lake += tp->volume_to_lake;
+  a->sum.mass_transport_sea += tp->mass_transport_sea;
+  a->sum.volume_from_sea += tp->volume_from_sea;
+  a->sum.volume_to_sea += tp->volume_to_sea;
+
+  a->salt_to_lake += tp->volume_to_lake * tp->salinity_to_lake;
+  a->salt_to_sea += tp->volume_to_sea * tp->salinity_to_sea;
+
+  // Fallback when nothing flows out of the lock over the whole period
+  if (a->sum.volume_to_lake == 0.0)
+    a->sum.salinity_to_lake = tp->salinity_to_lake;
+  if (a->sum.volume_to_sea == 0.0)
+    a->sum.salinity_to_sea = tp->salinity_to_sea;
+}
+
+// Totals over the aggregated phases, with discharges averaged over the given
+// duration.
+static inline void aggregate_finish(const aggregate_t *a, double duration,
+                                    zsf_phase_transports_t *out) {
+  *out = a->sum;
+
+  out->discharge_from_lake = a->sum.volume_from_lake / duration;
+  out->discharge_to_lake = a->sum.volume_to_lake / duration;
+  if (a->sum.volume_to_lake > 0.0)
+    out->salinity_to_lake = a->salt_to_lake / a->sum.volume_to_lake;
+
+  out->discharge_from_sea = a->sum.volume_from_sea / duration;
+  out->discharge_to_sea = a->sum.volume_to_sea / duration;
+  if (a->sum.volume_to_sea > 0.0)
+    out->salinity_to_sea = a->salt_to_sea / a->sum.volume_to_sea;
+}
+
+// Cycle or period averages in the same form as the output of zsf_calc_steady
+static inline void aggregate_finish_results(const aggregate_t *a, double duration,
+                                            zsf_results_t *results) {
+  zsf_phase_transports_t tp;
+  aggregate_finish(a, duration, &tp);
+
+  results->mass_transport_lake = tp.mass_transport_lake;
+  results->salt_load_lake = tp.mass_transport_lake / duration;
+  results->discharge_from_lake = tp.discharge_from_lake;
+  results->discharge_to_lake = tp.discharge_to_lake;
+  results->salinity_to_lake = tp.salinity_to_lake;
+
+  results->mass_transport_sea = tp.mass_transport_sea;
+  results->salt_load_sea = tp.mass_transport_sea / duration;
+  results->discharge_from_sea = tp.discharge_from_sea;
+  results->discharge_to_sea = tp.discharge_to_sea;
+  results->salinity_to_sea = tp.salinity_to_sea;
+}
+
+#endif
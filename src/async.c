@@ -0,0 +1,197 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "aggregate.h"
+#include "errors.h"
+#include "threads.h"
+#include "zsf.h"
+
+// The host and the worker each own one of the counters below, which count
+// the timesteps posted and completed. As the host never runs more than two
+// timesteps ahead, a timestep n lives in slot n % 2 of both the inputs and
+// the outputs. Counters are only compared for equality, so they may wrap.
+#define NUM_SLOTS 2
+
+// Keep the counters written by different threads on different cache lines
+#define CACHE_LINE 64
+
+typedef struct input_slot_t {
+  zsf_param_t p;
+  double dt;
+  int num_lockages;
+  zsf_lockage_t *lockages;
+} input_slot_t;
+
+typedef struct output_slot_t {
+  int err;
+  zsf_phase_transports_t transports;
+  zsf_phase_state_t state;
+} output_slot_t;
+
+struct zsf_async_t {
+  // Written by the host
+  volatile long posted;
+  volatile long stop;
+  char pad_host[CACHE_LINE];
+
+  // Written by the worker
+  volatile long done;
+  char pad_worker[CACHE_LINE];
+
+  input_slot_t inputs[NUM_SLOTS];
+  output_slot_t outputs[NUM_SLOTS];
+  zsf_phase_state_t initial_state;
+
+  // Owned by the worker
+  zsf_phase_state_t state;
+  zsf_phase_transports_t *transports;
+
+  int max_lockages;
+  thread_t thread;
+  thread_start_t start;
+};
+
+static void compute(zsf_async_t *a, const input_slot_t *in, output_slot_t *out) {
+  out->err = zsf_step_lockages(&in->p, in->num_lockages, in->lockages, &a->state, a->transports);
+
+  // The state may have advanced partially on error, but the transports of
+  // the timestep are incomplete and therefore not reported.
+  if (out->err) {
+    memset(&out->transports, 0, sizeof(zsf_phase_transports_t));
+  } else {
+    aggregate_t totals;
+    aggregate_reset(&totals);
+    for (int i = 0; i < in->num_lockages; i++)
+      aggregate_add(&totals, &a->transports[i]);
+    aggregate_finish(&totals, in->dt, &out->transports);
+  }
+  out->state = a->state;
+}
+
+static void worker(void *arg) {
+  zsf_async_t *a = arg;
+  unsigned long k = 0;
+
+  while (1) {
+    backoff_t b = {0};
+    while (atomic_load_acquire(&a->posted) == (long)k) {
+      if (atomic_load_acquire(&a->stop))
+        return;
+      backoff_wait(&b);
+    }
+
+    compute(a, &a->inputs[k % NUM_SLOTS], &a->outputs[k % NUM_SLOTS]);
+
+    k++;
+    atomic_store_release(&a->done, (long)k);
+  }
+}
+
+// Wait until the worker has completed timestep n - 1. With n timesteps
+// posted, the worker has done either n - 1 or n (or n + 1, if timestep n
+// has been posted already) of them.
+static void wait_done(zsf_async_t *a, unsigned long n) {
+  if (n == 0)
+    return;
+
+  backoff_t b = {0};
+  while (atomic_load_acquire(&a->done) == (long)(n - 1))
+    backoff_wait(&b);
+}
+
+static int get_output(const zsf_async_t *a, unsigned long n, zsf_phase_transports_t *transports,
+                      zsf_phase_state_t *state) {
+  if (n == 0) {
+    if (transports != NULL)
+      memset(transports, 0, sizeof(zsf_phase_transports_t));
+    if (state != NULL)
+      *state = a->initial_state;
+    return ZSF_SUCCESS;
+  }
+
+  const output_slot_t *out = &a->outputs[(n - 1) % NUM_SLOTS];
+  if (transports != NULL)
+    *transports = out->transports;
+  if (state != NULL)
+    *state = out->state;
+  return out->err;
+}
+
+int ZSF_CALLCONV zsf_async_create(const zsf_phase_state_t *state, int max_lockages,
+                                  zsf_async_t **async) {
+  *async = NULL;
+  if (max_lockages < 0)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  zsf_async_t *a = calloc(1, sizeof(zsf_async_t));
+  if (a == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  a->max_lockages = max_lockages;
+  a->initial_state = *state;
+  a->state = *state;
+
+  // Allocate at least one element, as malloc(0) may return NULL
+  size_t n = max_lockages > 0 ? max_lockages : 1;
+  a->transports = malloc(n * sizeof(zsf_phase_transports_t));
+  int ok = a->transports != NULL;
+  for (int i = 0; i < NUM_SLOTS; i++) {
+    a->inputs[i].lockages = malloc(n * sizeof(zsf_lockage_t));
+    ok = ok && a->inputs[i].lockages != NULL;
+  }
+
+  if (!ok || thread_create(&a->thread, &a->start, worker, a)) {
+    for (int i = 0; i < NUM_SLOTS; i++)
+      free(a->inputs[i].lockages);
+    free(a->transports);
+    free(a);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  *async = a;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_async_step(zsf_async_t *a, const zsf_param_t *p, double dt, int num_lockages,
+                                const zsf_lockage_t *lockages, zsf_phase_transports_t *transports,
+                                zsf_phase_state_t *state) {
+  if (num_lockages < 0 || num_lockages > a->max_lockages || !(dt > 0.0))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  // The previous call waited for timestep n - 2, so its slot is free
+  unsigned long n = (unsigned long)a->posted;
+  input_slot_t *in = &a->inputs[n % NUM_SLOTS];
+  in->p = *p;
+  in->dt = dt;
+  in->num_lockages = num_lockages;
+  memcpy(in->lockages, lockages, num_lockages * sizeof(zsf_lockage_t));
+
+  atomic_store_release(&a->posted, (long)(n + 1));
+
+  wait_done(a, n);
+  return get_output(a, n, transports, state);
+}
+
+int ZSF_CALLCONV zsf_async_finish(zsf_async_t *a, zsf_phase_transports_t *transports,
+                                  zsf_phase_state_t *state) {
+  unsigned long n = (unsigned long)a->posted;
+  wait_done(a, n);
+  return get_output(a, n, transports, state);
+}
+
+void ZSF_CALLCONV zsf_async_free(zsf_async_t *a) {
+  if (a == NULL)
+    return;
+
+  atomic_store_release(&a->stop, 1);
+  thread_join(a->thread);
+
+  for (int i = 0; i < NUM_SLOTS; i++)
+    free(a->inputs[i].lockages);
+  free(a->transports);
+  free(a);
+}
@@ -0,0 +1,104 @@
+#include <stddef.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "zsf.h"
+
+// Poor man's static assertion that there is an output flag for every field
+typedef char output_flags_complete[ZSF_OUTPUT_ALL == (1 << ZSF_NUM_RESULTS_FIELDS) - 1 ? 1 : -1];
+
+typedef struct selection_t {
+  int num_fields;
+  int field[ZSF_NUM_RESULTS_FIELDS];
+} selection_t;
+
+static int select_outputs(int output_mask, selection_t *sel) {
+  if (output_mask == 0 || (output_mask & ~ZSF_OUTPUT_ALL) != 0)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  sel->num_fields = 0;
+  for (int k = 0; k < ZSF_NUM_RESULTS_FIELDS; k++) {
+    if (output_mask & (1 << k))
+      sel->field[sel->num_fields++] = k;
+  }
+  return ZSF_SUCCESS;
+}
+
+// Calculate the steady state for one set of parameters, and store only the
+// selected fields. The auxiliary results are never requested.
+static int calc_one(const zsf_param_t *p, const selection_t *sel, double *out,
+                    ptrdiff_t column_stride) {
+  zsf_results_t results;
+  int err = zsf_calc_steady(p, &results, NULL);
+
+  for (int j = 0; j < sel->num_fields; j++)
+    out[j * column_stride] = err ? ZSF_NAN : *results_field(&results, sel->field[j]);
+
+  return err;
+}
+
+int ZSF_CALLCONV zsf_calc_steady_batch(int num_locks, const zsf_param_t *p, int output_mask,
+                                       double *outputs, int row_stride, int column_stride,
+                                       int *errors) {
+  selection_t sel;
+  if (num_locks < 0 || select_outputs(output_mask, &sel))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int first_err = ZSF_SUCCESS;
+  for (int i = 0; i < num_locks; i++) {
+    int err = calc_one(&p[i], &sel, &outputs[(ptrdiff_t)i * row_stride], column_stride);
+    if (errors != NULL)
+      errors[i] = err;
+    if (err && !first_err)
+      first_err = err;
+  }
+
+  return first_err;
+}
+
+int ZSF_CALLCONV zsf_calc_steady_sweep(const zsf_param_t *p, int num_axes,
+                                       const char *const *axis_names, const int *num_points,
+                                       const double *axis_values, int output_mask,
+                                       double *outputs, int row_stride, int column_stride,
+                                       int *errors) {
+  selection_t sel;
+  if (num_axes < 1 || num_axes > ZSF_SWEEP_MAX_AXES || select_outputs(output_mask, &sel))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int axis_field[ZSF_SWEEP_MAX_AXES];
+  const double *values[ZSF_SWEEP_MAX_AXES];
+  size_t stride[ZSF_SWEEP_MAX_AXES];
+
+  const double *v = axis_values;
+  for (int i = 0; i < num_axes; i++) {
+    axis_field[i] = param_field_index(axis_names[i]);
+    if (axis_field[i] < 0 || num_points[i] < 1)
+      return ZSF_ERR_INVALID_ARGUMENT;
+    values[i] = v;
+    v += num_points[i];
+  }
+
+  // The last axis varies fastest
+  size_t num_nodes = 1;
+  for (int i = num_axes - 1; i >= 0; i--) {
+    stride[i] = num_nodes;
+    num_nodes *= (size_t)num_points[i];
+  }
+
+  int first_err = ZSF_SUCCESS;
+  zsf_param_t node_p = *p;
+  for (size_t n = 0; n < num_nodes; n++) {
+    for (int i = 0; i < num_axes; i++) {
+      size_t j = (n / stride[i]) % (size_t)num_points[i];
+      *param_field(&node_p, axis_field[i]) = values[i][j];
+    }
+
+    int err = calc_one(&node_p, &sel, &outputs[(ptrdiff_t)n * row_stride], column_stride);
+    if (errors != NULL)
+      errors[n] = err;
+    if (err && !first_err)
+      first_err = err;
+  }
+
+  return first_err;
+}
@@ -0,0 +1,696 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "zsf.h"
+
+// Bounds on the steady state over ranges of parameters
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Every quantity of the steady cycle is replaced by an interval that is
+// guaranteed to contain its value for all parameters in the box. The
+// kernels of phases.h cannot be reused for that, so the phases are written
+// out below in terms of the excess salinity of the lock over the lake,
+// which is also what the clipping to the boundary salinities acts on. The
+// expressions are rearranged (exactly) such that the excess occurs only
+// once where possible, as every repeated occurrence of a quantity widens
+// the intervals.
+//
+// The steady state is a fixed point of the locking cycle, and the excess
+// salinity at the start of the cycle always lies between zero and the
+// difference between sea and lake. Every fixed point in an interval is also
+// in the image of the cycle of that interval, so we contract the interval
+// by intersecting it with its image until it no longer shrinks.
+//
+// The bounds are those of the exact solution of the model, i.e. the limit of
+// zsf_calc_steady for rtol and atol going to zero.
+
+// Interval arithmetic
+// ~~~~~~~~~~~~~~~~~~~
+// The arithmetic operations and sqrt are correctly rounded, so rounding
+// every bound one ulp outward suffices. The other functions of the C
+// library are only accurate to a few ulps.
+#define LIBM_ULPS 4
+
+typedef struct interval_t {
+  double lo;
+  double hi;
+} interval_t;
+
+static interval_t iv(double lo, double hi) {
+  interval_t r = {lo, hi};
+  return r;
+}
+
+static interval_t iv_point(double x) { return iv(x, x); }
+
+// Sums of zero and products and quotients of a zero are exact
+static double round_down(double x) { return (x == 0.0) ? 0.0 : nextafter(x, -INFINITY); }
+static double round_up(double x) { return (x == 0.0) ? 0.0 : nextafter(x, INFINITY); }
+
+static double mul_down(double a, double b) {
+  return (a == 0.0 || b == 0.0) ? 0.0 : nextafter(a * b, -INFINITY);
+}
+static double mul_up(double a, double b) {
+  return (a == 0.0 || b == 0.0) ? 0.0 : nextafter(a * b, INFINITY);
+}
+
+static interval_t widen(interval_t a, int ulps) {
+  for (int i = 0; i < ulps; i++) {
+    a.lo = nextafter(a.lo, -INFINITY);
+    a.hi = nextafter(a.hi, INFINITY);
+  }
+  return a;
+}
+
+static interval_t iv_add(interval_t a, interval_t b) {
+  return iv(round_down(a.lo + b.lo), round_up(a.hi + b.hi));
+}
+
+static interval_t iv_sub(interval_t a, interval_t b) {
+  return iv(round_down(a.lo - b.hi), round_up(a.hi - b.lo));
+}
+
+static interval_t iv_mul(interval_t a, interval_t b) {
+  double lo = fmin(fmin(mul_down(a.lo, b.lo), mul_down(a.lo, b.hi)),
+                   fmin(mul_down(a.hi, b.lo), mul_down(a.hi, b.hi)));
+  double hi = fmax(fmax(mul_up(a.lo, b.lo), mul_up(a.lo, b.hi)),
+                   fmax(mul_up(a.hi, b.lo), mul_up(a.hi, b.hi)));
+  return iv(lo, hi);
+}
+
+static interval_t iv_scale(double c, interval_t a) { return iv_mul(iv_point(c), a); }
+
+static interval_t iv_sqr(interval_t a) {
+  if (a.lo >= 0.0)
+    return iv(mul_down(a.lo, a.lo), mul_up(a.hi, a.hi));
+  if (a.hi <= 0.0)
+    return iv(mul_down(a.hi, a.hi), mul_up(a.lo, a.lo));
+  double m = fmax(-a.lo, a.hi);
+  return iv(0.0, mul_up(m, m));
+}
+
+// Division by an interval that contains zero is only bounded on one side for
+// a non-negative numerator and divisor, e.g. a time scale of an exchange
+// that might not happen at all.
+static interval_t iv_div(interval_t a, interval_t b) {
+  if (b.lo > 0.0 || b.hi < 0.0) {
+    double q[4] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+    double lo = q[0];
+    double hi = q[0];
+    for (int i = 1; i < 4; i++) {
+      lo = fmin(lo, q[i]);
+      hi = fmax(hi, q[i]);
+    }
+    return iv(round_down(lo), round_up(hi));
+  }
+  if (b.lo == 0.0 && b.hi > 0.0 && a.lo >= 0.0)
+    return iv(round_down(a.lo / b.hi), INFINITY);
+  return iv(-INFINITY, INFINITY);
+}
+
+static interval_t iv_sqrt(interval_t a) {
+  return iv(fmax(round_down(sqrt(fmax(a.lo, 0.0))), 0.0), round_up(sqrt(fmax(a.hi, 0.0))));
+}
+
+static interval_t iv_cbrt(interval_t a) { return widen(iv(cbrt(a.lo), cbrt(a.hi)), LIBM_ULPS); }
+
+static interval_t iv_tanh(interval_t a) {
+  interval_t r = widen(iv(tanh(a.lo), tanh(a.hi)), LIBM_ULPS);
+  return iv(fmax(r.lo, -1.0), fmin(r.hi, 1.0));
+}
+
+static interval_t iv_min(interval_t a, interval_t b) {
+  return iv(fmin(a.lo, b.lo), fmin(a.hi, b.hi));
+}
+
+static interval_t iv_max(interval_t a, interval_t b) {
+  return iv(fmax(a.lo, b.lo), fmax(a.hi, b.hi));
+}
+
+static interval_t iv_hull(interval_t a, interval_t b) {
+  return iv(fmin(a.lo, b.lo), fmax(a.hi, b.hi));
+}
+
+static interval_t iv_abs(interval_t a) {
+  if (a.lo >= 0.0)
+    return a;
+  if (a.hi <= 0.0)
+    return iv(-a.hi, -a.lo);
+  return iv(0.0, fmax(-a.lo, a.hi));
+}
+
+// copysign(a, b) of a non-negative a. The sign of a zero b does not matter
+// to the callers, as a bubble screen at the door has no effect.
+static interval_t iv_copysign(interval_t a, interval_t b) {
+  if (b.lo >= 0.0)
+    return a;
+  if (b.hi <= 0.0)
+    return iv(-a.hi, -a.lo);
+  return iv(-a.hi, a.hi);
+}
+
+static const interval_t ZERO = {0.0, 0.0};
+static const interval_t ONE = {1.0, 1.0};
+
+// Parameters and derived parameters
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#define PARAM_INTERVAL(NAME) interval_t NAME;
+typedef struct param_bounds_t {
+  ZSF_PARAM_FIELDS(PARAM_INTERVAL)
+} param_bounds_t;
+#undef PARAM_INTERVAL
+
+typedef struct derived_bounds_t {
+  interval_t area;
+  interval_t volume_lock_at_lake;
+  interval_t volume_lock_at_sea;
+  interval_t t_cycle;
+  interval_t t_open_lake;
+  interval_t t_open_sea;
+  interval_t flushing_discharge;
+  interval_t density_average;
+  interval_t sal_diff;
+} derived_bounds_t;
+
+// The UNESCO 1981 density of sea water (see sal_psu_2_density in util.h)
+static interval_t density_psu(interval_t sal_psu, interval_t t) {
+  interval_t a = iv_point(5.3875E-9);
+  a = iv_add(iv_mul(a, t), iv_point(-8.2467E-7));
+  a = iv_add(iv_mul(a, t), iv_point(7.6438E-5));
+  a = iv_add(iv_mul(a, t), iv_point(-4.0899E-3));
+  a = iv_add(iv_mul(a, t), iv_point(8.24493E-1));
+
+  interval_t b = iv_point(-1.6546E-6);
+  b = iv_add(iv_mul(b, t), iv_point(1.0227E-4));
+  b = iv_add(iv_mul(b, t), iv_point(-5.72466E-3));
+
+  interval_t rho_ref = iv_point(6.536332E-9);
+  rho_ref = iv_add(iv_mul(rho_ref, t), iv_point(-1.120083E-6));
+  rho_ref = iv_add(iv_mul(rho_ref, t), iv_point(1.001685E-4));
+  rho_ref = iv_add(iv_mul(rho_ref, t), iv_point(-9.095290E-3));
+  rho_ref = iv_add(iv_mul(rho_ref, t), iv_point(6.793952E-2));
+  rho_ref = iv_add(iv_mul(rho_ref, t), iv_point(999.842594));
+
+  interval_t sal_1_5 = iv_mul(sal_psu, iv_sqrt(sal_psu));
+  interval_t rho = iv_add(rho_ref, iv_mul(a, sal_psu));
+  rho = iv_add(rho, iv_mul(b, sal_1_5));
+  return iv_add(rho, iv_scale(4.8314E-4, iv_sqr(sal_psu)));
+}
+
+// The density for a salinity in kg/m3 is the fixed point of the iteration in
+// sal_2_density. When the iteration maps an interval into itself, all its
+// iterates (and thus its limit) stay in there.
+static int density(interval_t sal_kgm3, interval_t t, interval_t *rho) {
+  interval_t r = iv(900.0, 1100.0);
+  for (int i = 0; i < 100; i++) {
+    interval_t next = density_psu(iv_div(iv_scale(1000.0, sal_kgm3), r), t);
+    if (i == 0 && (next.lo < r.lo || next.hi > r.hi))
+      return ZSF_ERR_INVALID_ARGUMENT;
+
+    next = iv(fmax(next.lo, r.lo), fmin(next.hi, r.hi));
+    if (next.lo == r.lo && next.hi == r.hi)
+      break;
+    r = next;
+  }
+  *rho = r;
+  return ZSF_SUCCESS;
+}
+
+static int derived_parameters(const param_bounds_t *p, derived_bounds_t *o) {
+  o->area = iv_mul(p->lock_length, p->lock_width);
+  o->volume_lock_at_lake = iv_mul(o->area, iv_sub(p->head_lake, p->lock_bottom));
+  o->volume_lock_at_sea = iv_mul(o->area, iv_sub(p->head_sea, p->lock_bottom));
+
+  o->t_cycle = iv_div(iv_point(24.0 * 3600.0), p->num_cycles);
+  interval_t t_open_avg =
+      iv_sub(iv_scale(0.5, o->t_cycle), iv_add(p->leveling_time, p->door_time_to_open));
+  interval_t t_open = iv_mul(p->calibration_coefficient, t_open_avg);
+  o->t_open_lake = iv_mul(p->symmetry_coefficient, t_open);
+  o->t_open_sea = iv_mul(iv_sub(iv_point(2.0), p->symmetry_coefficient), t_open);
+
+  // The flushing discharge of either tide, or both when the tide is unknown
+  if (p->head_sea.lo >= p->head_lake.hi)
+    o->flushing_discharge = p->flushing_discharge_high_tide;
+  else if (p->head_sea.hi < p->head_lake.lo)
+    o->flushing_discharge = p->flushing_discharge_low_tide;
+  else
+    o->flushing_discharge =
+        iv_hull(p->flushing_discharge_high_tide, p->flushing_discharge_low_tide);
+
+  interval_t rho_lake, rho_sea;
+  int err = density(p->salinity_lake, p->temperature_lake, &rho_lake);
+  if (!err)
+    err = density(p->salinity_sea, p->temperature_sea, &rho_sea);
+  o->density_average = iv_scale(0.5, iv_add(rho_lake, rho_sea));
+
+  o->sal_diff = iv_sub(p->salinity_sea, p->salinity_lake);
+  return err;
+}
+
+// Phases
+// ~~~~~~
+// The mass transports follow from the volumes and the salt carried in
+// excess of the salinity of the lake, with mass_transport_lake =
+// net_lake * salinity_lake - excess_lake and mass_transport_sea =
+// net_sea * salinity_lake + excess_sea, where net_lake is the volume from
+// the lake minus that to the lake, and net_sea the volume to the sea minus
+// that from the sea.
+typedef struct transports_bounds_t {
+  interval_t volume_from_lake;
+  interval_t volume_to_lake;
+  interval_t net_lake;
+  interval_t excess_lake;
+  interval_t volume_from_sea;
+  interval_t volume_to_sea;
+  interval_t net_sea;
+  interval_t excess_sea;
+} transports_bounds_t;
+
+// The clipping of the salinity of the lock to the boundary salinities
+static interval_t clip(const derived_bounds_t *o, interval_t excess) {
+  return iv_max(iv_min(excess, o->sal_diff), ZERO);
+}
+
+static interval_t velocity_exchange(const derived_bounds_t *o, interval_t sal_diff,
+                                    interval_t head) {
+  interval_t x = iv_div(iv_scale(9.81 * 0.8, sal_diff), o->density_average);
+  return iv_scale(0.5, iv_sqrt(iv_mul(x, head)));
+}
+
+// Leveling to the lake side, with the lock at sea level and the ship from
+// the sea in it
+static void phase_1(const param_bounds_t *p, const derived_bounds_t *o, interval_t *excess,
+                    transports_bounds_t *t) {
+  interval_t head_diff = iv_sub(p->head_lake, p->head_sea);
+  interval_t volume_from_lake = iv_mul(o->area, iv_max(head_diff, ZERO));
+  interval_t volume_to_lake = iv_mul(o->area, iv_max(iv_sub(ZERO, head_diff), ZERO));
+
+  t->volume_from_lake = volume_from_lake;
+  t->volume_to_lake = volume_to_lake;
+  t->net_lake = iv_mul(o->area, head_diff);
+  t->excess_lake = iv_mul(volume_to_lake, *excess);
+  t->volume_from_sea = ZERO;
+  t->volume_to_sea = ZERO;
+  t->net_sea = ZERO;
+  t->excess_sea = ZERO;
+
+  interval_t volume_water = iv_sub(o->volume_lock_at_lake, p->ship_volume_sea_to_lake);
+  interval_t refreshed = iv_div(volume_from_lake, volume_water);
+  *excess = clip(o, iv_mul(*excess, iv_sub(ONE, refreshed)));
+}
+
+static void phase_2(const param_bounds_t *p, const derived_bounds_t *o, interval_t *excess,
+                    transports_bounds_t *t) {
+  // Ship exiting towards the lake
+  interval_t ship_exiting = p->ship_volume_sea_to_lake;
+  interval_t ship_entering = p->ship_volume_lake_to_sea;
+  interval_t excess_2a = iv_mul(*excess, iv_sub(ONE, iv_div(ship_exiting, o->volume_lock_at_lake)));
+
+  // Lock exchange and flushing, tracking the fraction of the (effective)
+  // volume of the lock that is not exchanged
+  interval_t head = iv_sub(p->head_lake, p->lock_bottom);
+  interval_t head_above_sill = iv_sub(head, p->sill_height_lake);
+  interval_t head_dc_effective = iv_sub(head, iv_scale(0.8, p->sill_height_lake));
+  interval_t volume_effective = iv_mul(o->area, head_dc_effective);
+
+  interval_t velocity_flushing =
+      iv_div(o->flushing_discharge, iv_mul(p->lock_width, head_above_sill));
+  interval_t velocity_raw = velocity_exchange(o, excess_2a, head_dc_effective);
+  interval_t two_length = iv_scale(2.0, p->lock_length);
+
+  // Until the density current reaches the bubble screen
+  interval_t distance = p->distance_door_bubble_screen_lake;
+  interval_t velocity = iv_sub(velocity_raw, iv_copysign(velocity_flushing, distance));
+  velocity = iv_max(velocity, iv_point(1E-10));
+  interval_t t_raw = iv_min(iv_div(iv_abs(distance), velocity), o->t_open_lake);
+
+  interval_t frac_raw = iv_max(iv_sub(ONE, iv_div(velocity_flushing, velocity_raw)), ZERO);
+  interval_t tanh_raw = iv_tanh(iv_div(iv_mul(t_raw, velocity_raw), two_length));
+  interval_t remaining = iv_sub(ONE, iv_mul(frac_raw, tanh_raw));
+
+  // After the current reaches the bubble screen
+  interval_t velocity_eta = iv_mul(p->density_current_factor_lake, velocity_raw);
+  interval_t frac = iv_max(iv_sub(ONE, iv_div(velocity_flushing, velocity_eta)), ZERO);
+  interval_t t_eta = iv_max(iv_sub(o->t_open_lake, t_raw), ZERO);
+  interval_t tanh_eta = iv_tanh(iv_div(iv_mul(t_eta, velocity_eta), two_length));
+  remaining = iv_mul(remaining, iv_sub(ONE, iv_mul(frac, tanh_eta)));
+
+  interval_t volume_exchange = iv_mul(volume_effective, iv_sub(ONE, remaining));
+  interval_t volume_flush = iv_mul(o->flushing_discharge, o->t_open_lake);
+  interval_t volume_unrefreshed =
+      iv_max(iv_sub(iv_mul(volume_effective, remaining), volume_flush), ZERO);
+  interval_t volume_refresh = iv_min(volume_flush, iv_mul(volume_effective, remaining));
+
+  // All water that is exchanged or flushed out has the salinity of the lake
+  interval_t volume_replaced = iv_sub(volume_effective, volume_unrefreshed);
+  interval_t excess_2b =
+      iv_mul(excess_2a, iv_sub(ONE, iv_div(volume_replaced, o->volume_lock_at_lake)));
+
+  // Ship entering from the lake, which does not change the salinity
+  t->volume_from_lake = iv_add(iv_add(ship_exiting, volume_exchange), volume_flush);
+  t->volume_to_lake = iv_add(volume_exchange, ship_entering);
+  t->net_lake = iv_sub(iv_add(ship_exiting, volume_flush), ship_entering);
+  t->excess_lake = iv_add(iv_mul(volume_exchange, excess_2a), iv_mul(ship_entering, excess_2b));
+  t->volume_from_sea = ZERO;
+  t->volume_to_sea = volume_flush;
+  t->net_sea = volume_flush;
+  t->excess_sea = iv_mul(volume_refresh, excess_2a);
+
+  *excess = clip(o, excess_2b);
+}
+
+// Leveling to the sea side, with the ship from the lake in the lock
+static void phase_3(const param_bounds_t *p, const derived_bounds_t *o, interval_t *excess,
+                    transports_bounds_t *t) {
+  interval_t head_diff = iv_sub(p->head_lake, p->head_sea);
+  interval_t volume_to_sea = iv_mul(o->area, iv_max(head_diff, ZERO));
+  interval_t volume_from_sea = iv_mul(o->area, iv_max(iv_sub(ZERO, head_diff), ZERO));
+
+  t->volume_from_lake = ZERO;
+  t->volume_to_lake = ZERO;
+  t->net_lake = ZERO;
+  t->excess_lake = ZERO;
+  t->volume_from_sea = volume_from_sea;
+  t->volume_to_sea = volume_to_sea;
+  t->net_sea = iv_mul(o->area, head_diff);
+  t->excess_sea = iv_sub(iv_mul(volume_to_sea, *excess), iv_mul(volume_from_sea, o->sal_diff));
+
+  interval_t volume_water = iv_sub(o->volume_lock_at_sea, p->ship_volume_lake_to_sea);
+  interval_t f = iv_div(volume_from_sea, volume_water);
+  *excess = clip(o, iv_add(iv_mul(*excess, iv_sub(ONE, f)), iv_mul(f, o->sal_diff)));
+}
+
+static void phase_4(const param_bounds_t *p, const derived_bounds_t *o, interval_t *excess,
+                    transports_bounds_t *t) {
+  // Ship exiting towards the sea
+  interval_t ship_exiting = p->ship_volume_lake_to_sea;
+  interval_t ship_entering = p->ship_volume_sea_to_lake;
+  interval_t f = iv_div(ship_exiting, o->volume_lock_at_sea);
+  interval_t excess_4a = iv_add(iv_mul(*excess, iv_sub(ONE, f)), iv_mul(f, o->sal_diff));
+  interval_t deficit_4a = iv_max(iv_mul(iv_sub(o->sal_diff, *excess), iv_sub(ONE, f)), ZERO);
+
+  // Lock exchange and flushing
+  interval_t head = iv_sub(p->head_sea, p->lock_bottom);
+  interval_t head_above_sill = iv_sub(head, p->sill_height_sea);
+  interval_t head_dc_effective = iv_sub(head, iv_scale(0.8, p->sill_height_sea));
+
+  interval_t velocity_flushing =
+      iv_div(o->flushing_discharge, iv_mul(p->lock_width, head_above_sill));
+  interval_t velocity_raw = velocity_exchange(o, deficit_4a, head_dc_effective);
+
+  // Fraction of the lock above the equilibrium depth of the boundary layer
+  interval_t q = iv_div(o->flushing_discharge, p->lock_width);
+  interval_t head_equilibrium = iv_cbrt(iv_div(iv_mul(iv_scale(2.0, iv_sqr(q)), o->density_average),
+                                               iv_scale(9.81 * 0.8, o->sal_diff)));
+  head_equilibrium = iv_min(head_equilibrium, head);
+  interval_t frac = iv_sub(ONE, iv_div(head_equilibrium, head));
+  interval_t two_length_frac = iv_mul(iv_scale(2.0, p->lock_length), frac);
+
+  // Until the density current reaches the bubble screen
+  interval_t distance = p->distance_door_bubble_screen_sea;
+  interval_t velocity = iv_add(velocity_raw, iv_copysign(velocity_flushing, distance));
+  velocity = iv_max(velocity, iv_point(1E-10));
+  interval_t t_raw = iv_min(iv_div(iv_abs(distance), velocity), o->t_open_sea);
+
+  interval_t tanh_raw = iv_tanh(
+      iv_div(iv_mul(t_raw, iv_sub(velocity_raw, velocity_flushing)), two_length_frac));
+  interval_t remaining = iv_sub(ONE, iv_mul(frac, tanh_raw));
+
+  // After the current reaches the bubble screen, if it is not flushed out
+  interval_t velocity_eta = iv_mul(p->density_current_factor_sea, velocity_raw);
+  interval_t velocity_net = iv_max(iv_sub(velocity_eta, velocity_flushing), ZERO);
+  interval_t t_eta = iv_max(iv_sub(o->t_open_sea, t_raw), ZERO);
+  interval_t tanh_eta = iv_tanh(iv_div(iv_mul(t_eta, velocity_net), two_length_frac));
+  remaining = iv_mul(remaining, iv_sub(ONE, iv_mul(frac, tanh_eta)));
+
+  interval_t volume_exchange = iv_mul(o->volume_lock_at_sea, iv_sub(ONE, remaining));
+  interval_t volume_flush = iv_mul(o->flushing_discharge, o->t_open_sea);
+  interval_t volume_refresh = iv_min(volume_flush, iv_mul(o->volume_lock_at_sea, remaining));
+
+  // Exchanged water has the salinity of the sea, and flushed water that of
+  // the lake
+  interval_t flush_fraction = iv_div(volume_flush, o->volume_lock_at_sea);
+  interval_t excess_4b = iv_add(iv_mul(excess_4a, iv_max(iv_sub(remaining, flush_fraction), ZERO)),
+                                iv_mul(iv_sub(ONE, remaining), o->sal_diff));
+
+  // Ship entering from the sea, which does not change the salinity
+  t->volume_from_lake = volume_flush;
+  t->volume_to_lake = ZERO;
+  t->net_lake = volume_flush;
+  t->excess_lake = ZERO;
+  t->volume_from_sea = iv_add(volume_exchange, ship_exiting);
+  t->volume_to_sea = iv_add(iv_add(volume_exchange, volume_flush), ship_entering);
+  t->net_sea = iv_sub(iv_add(volume_flush, ship_entering), ship_exiting);
+  interval_t excess_to_sea =
+      iv_add(iv_mul(ship_entering, excess_4b), iv_mul(volume_refresh, excess_4a));
+  interval_t deficit_from_sea =
+      iv_add(iv_mul(ship_exiting, o->sal_diff), iv_mul(volume_exchange, deficit_4a));
+  t->excess_sea = iv_sub(excess_to_sea, deficit_from_sea);
+
+  *excess = clip(o, excess_4b);
+}
+
+// Steady state
+// ~~~~~~~~~~~~
+#define MAX_ITERATIONS 10000
+
+#define RESULTS_INTERVAL(NAME) interval_t NAME;
+typedef struct results_bounds_t {
+  ZSF_RESULTS_FIELDS(RESULTS_INTERVAL)
+} results_bounds_t;
+#undef RESULTS_INTERVAL
+
+typedef struct box_t {
+  zsf_param_t lo;
+  zsf_param_t hi;
+  results_bounds_t results;
+} box_t;
+
+static void hull_transports(transports_bounds_t *a, const transports_bounds_t *b) {
+  a->volume_from_lake = iv_hull(a->volume_from_lake, b->volume_from_lake);
+  a->volume_to_lake = iv_hull(a->volume_to_lake, b->volume_to_lake);
+  a->net_lake = iv_hull(a->net_lake, b->net_lake);
+  a->excess_lake = iv_hull(a->excess_lake, b->excess_lake);
+  a->volume_from_sea = iv_hull(a->volume_from_sea, b->volume_from_sea);
+  a->volume_to_sea = iv_hull(a->volume_to_sea, b->volume_to_sea);
+  a->net_sea = iv_hull(a->net_sea, b->net_sea);
+  a->excess_sea = iv_hull(a->excess_sea, b->excess_sea);
+}
+
+// The excess salinity occurs in many places in a cycle, so the image of a
+// wide interval is much wider than the range of the cycle on it. We take the
+// hull of the images of a number of pieces of the interval instead.
+#define EXCESS_PIECES 32
+
+static void cycle(const param_bounds_t *p, const derived_bounds_t *o, interval_t *excess,
+                  transports_bounds_t *t) {
+  interval_t image = ZERO;
+  double width = excess->hi - excess->lo;
+
+  for (int k = 0; k < EXCESS_PIECES; k++) {
+    // The pieces overlap in their rounded end points, so they cover the
+    // whole interval
+    double lo = (k == 0) ? excess->lo : round_down(excess->lo + width * k / EXCESS_PIECES);
+    double hi = (k == EXCESS_PIECES - 1)
+                    ? excess->hi
+                    : round_up(excess->lo + width * (k + 1) / EXCESS_PIECES);
+    interval_t e = iv(fmax(lo, excess->lo), fmin(hi, excess->hi));
+
+    transports_bounds_t t_piece[4];
+    phase_1(p, o, &e, &t_piece[0]);
+    phase_2(p, o, &e, &t_piece[1]);
+    phase_3(p, o, &e, &t_piece[2]);
+    phase_4(p, o, &e, &t_piece[3]);
+
+    image = (k == 0) ? e : iv_hull(image, e);
+    for (int j = 0; j < 4; j++) {
+      if (k == 0)
+        t[j] = t_piece[j];
+      else
+        hull_transports(&t[j], &t_piece[j]);
+    }
+  }
+  *excess = image;
+}
+
+static int is_valid(interval_t x) { return !isnan(x.lo) && !isnan(x.hi); }
+
+static int steady_bounds(box_t *b) {
+  param_bounds_t p;
+  interval_t *fields_p = (interval_t *)&p;
+  for (int i = 0; i < ZSF_NUM_PARAM_FIELDS; i++)
+    fields_p[i] = iv(*param_field(&b->lo, i), *param_field(&b->hi, i));
+
+  // Every parameter set in the box has to be valid
+  if (p.salinity_lake.lo < 0.0 || p.salinity_lake.hi > p.salinity_sea.lo)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  derived_bounds_t o;
+  int err = derived_parameters(&p, &o);
+  if (err)
+    return err;
+
+  if (fmax(p.ship_volume_lake_to_sea.hi, p.ship_volume_sea_to_lake.hi) >
+      fmin(o.volume_lock_at_lake.lo, o.volume_lock_at_sea.lo))
+    return ZSF_SHIP_TOO_BIG;
+
+  // Contract the excess salinity at the start of the cycle
+  interval_t excess = iv(0.0, o.sal_diff.hi);
+  transports_bounds_t t[4];
+  for (int i = 0; i < MAX_ITERATIONS; i++) {
+    interval_t next = excess;
+    cycle(&p, &o, &next, t);
+    if (!is_valid(next))
+      return ZSF_ERR_INVALID_ARGUMENT;
+
+    next = iv(fmax(next.lo, excess.lo), fmin(next.hi, excess.hi));
+    int converged = next.hi - next.lo >= 0.9999 * (excess.hi - excess.lo);
+    excess = next;
+    if (converged)
+      break;
+  }
+
+  // Totals over the cycle, of which the transports are those of the last
+  // (and smallest) interval that contains the steady state
+  transports_bounds_t s = t[0];
+  for (int k = 1; k < 4; k++) {
+    s.volume_from_lake = iv_add(s.volume_from_lake, t[k].volume_from_lake);
+    s.volume_to_lake = iv_add(s.volume_to_lake, t[k].volume_to_lake);
+    s.net_lake = iv_add(s.net_lake, t[k].net_lake);
+    s.excess_lake = iv_add(s.excess_lake, t[k].excess_lake);
+    s.volume_from_sea = iv_add(s.volume_from_sea, t[k].volume_from_sea);
+    s.volume_to_sea = iv_add(s.volume_to_sea, t[k].volume_to_sea);
+    s.net_sea = iv_add(s.net_sea, t[k].net_sea);
+    s.excess_sea = iv_add(s.excess_sea, t[k].excess_sea);
+  }
+
+  interval_t mt_lake = iv_sub(iv_mul(s.net_lake, p.salinity_lake), s.excess_lake);
+  interval_t mt_sea = iv_add(iv_mul(s.net_sea, p.salinity_lake), s.excess_sea);
+  interval_t excess_from_sea = iv_add(s.excess_sea, iv_mul(s.volume_from_sea, o.sal_diff));
+
+  results_bounds_t *r = &b->results;
+  r->mass_transport_lake = mt_lake;
+  r->salt_load_lake = iv_div(mt_lake, o.t_cycle);
+  r->discharge_from_lake = iv_div(s.volume_from_lake, o.t_cycle);
+  r->discharge_to_lake = iv_div(s.volume_to_lake, o.t_cycle);
+  r->salinity_to_lake = iv_add(p.salinity_lake, iv_div(s.excess_lake, s.volume_to_lake));
+  r->mass_transport_sea = mt_sea;
+  r->salt_load_sea = iv_div(mt_sea, o.t_cycle);
+  r->discharge_from_sea = iv_div(s.volume_from_sea, o.t_cycle);
+  r->discharge_to_sea = iv_div(s.volume_to_sea, o.t_cycle);
+  r->salinity_to_sea = iv_add(p.salinity_lake, iv_div(excess_from_sea, s.volume_to_sea));
+
+  const interval_t *fields_r = (const interval_t *)r;
+  for (int j = 0; j < ZSF_NUM_RESULTS_FIELDS; j++) {
+    if (!is_valid(fields_r[j]))
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+  return ZSF_SUCCESS;
+}
+
+// Domain splitting
+// ~~~~~~~~~~~~~~~~
+// The intervals widen with the width of the box, and more than in
+// proportion where the response is not monotone. Bisecting the box and
+// taking the union of the bounds of both halves is therefore tighter. We
+// always bisect the box with the widest bounds on the salt load (lake),
+// along the parameter for which that helps most.
+
+// Parameters that do not affect the steady state
+static int is_ignored(int field) {
+  const char *name = param_field_names[field];
+  return !strcmp(name, "salinity_lock") || !strcmp(name, "rtol") || !strcmp(name, "atol");
+}
+
+static double salt_load_width(const box_t *b) {
+  return b->results.salt_load_lake.hi - b->results.salt_load_lake.lo;
+}
+
+// Bisects a box into halves, unless no parameter can be bisected any further
+static int bisect(const box_t *b, box_t *halves, int *bisected) {
+  double best_width = INFINITY;
+  int err = ZSF_SUCCESS;
+
+  *bisected = 0;
+  for (int i = 0; i < ZSF_NUM_PARAM_FIELDS && !err; i++) {
+    double lo = ((const double *)&b->lo)[i];
+    double hi = ((const double *)&b->hi)[i];
+    double mid = lo + 0.5 * (hi - lo);
+    if (is_ignored(i) || !(mid > lo && mid < hi))
+      continue;
+
+    box_t h[2] = {*b, *b};
+    *param_field(&h[0].hi, i) = mid;
+    *param_field(&h[1].lo, i) = mid;
+    err = steady_bounds(&h[0]);
+    if (!err)
+      err = steady_bounds(&h[1]);
+
+    double width = fmax(salt_load_width(&h[0]), salt_load_width(&h[1]));
+    if (!err && (!*bisected || width < best_width)) {
+      *bisected = 1;
+      best_width = width;
+      halves[0] = h[0];
+      halves[1] = h[1];
+    }
+  }
+
+  return err;
+}
+
+int ZSF_CALLCONV zsf_calc_steady_bounds(const zsf_param_t *p_lo, const zsf_param_t *p_hi,
+                                        int max_boxes, zsf_results_t *results_lo,
+                                        zsf_results_t *results_hi) {
+  if (max_boxes < 1)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  for (int i = 0; i < ZSF_NUM_PARAM_FIELDS; i++) {
+    double lo = ((const double *)p_lo)[i];
+    double hi = ((const double *)p_hi)[i];
+    if (!(lo <= hi) && !is_ignored(i))
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  box_t *boxes = malloc(max_boxes * sizeof(box_t));
+  if (boxes == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  boxes[0].lo = *p_lo;
+  boxes[0].hi = *p_hi;
+  int err = steady_bounds(&boxes[0]);
+
+  int num_boxes = 1;
+  while (!err && num_boxes < max_boxes) {
+    int k = 0;
+    for (int j = 1; j < num_boxes; j++) {
+      if (salt_load_width(&boxes[j]) > salt_load_width(&boxes[k]))
+        k = j;
+    }
+    if (!(salt_load_width(&boxes[k]) > 0.0))
+      break;
+
+    box_t halves[2];
+    int bisected;
+    err = bisect(&boxes[k], halves, &bisected);
+    if (!bisected)
+      break;
+    if (!err) {
+      boxes[k] = halves[0];
+      boxes[num_boxes++] = halves[1];
+    }
+  }
+
+  if (!err) {
+    for (int j = 0; j < ZSF_NUM_RESULTS_FIELDS; j++) {
+      interval_t r = ((const interval_t *)&boxes[0].results)[j];
+      for (int k = 1; k < num_boxes; k++)
+        r = iv_hull(r, ((const interval_t *)&boxes[k].results)[j]);
+      *results_field(results_lo, j) = r.lo;
+      *results_field(results_hi, j) = r.hi;
+    }
+  }
+
+  free(boxes);
+  return err;
+}
@@ -0,0 +1,292 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "errors.h"
+#include "zsf.h"
+
+// Bounds on the growth and shrinkage of the time step between steps
+#define MIN_STEP_FACTOR 0.2
+#define MAX_STEP_FACTOR 2.0
+#define SAFETY_FACTOR 0.9
+
+// Number of consecutive rejected steps before giving up, and the smallest
+// time step relative to the maximum one. The latter typically happens when
+// a compartment runs dry.
+#define MAX_REJECTED 50
+#define MIN_STEP_FRACTION 1E-6
+
+#define NUM_COMPARTMENTS 2
+#define LAKE 0
+#define SEA 1
+
+// The volumes and salt masses of the compartments are the state variables
+// of the integration. Salinities follow from them.
+typedef struct box_state_t {
+  double volume[NUM_COMPARTMENTS];
+  double saltmass[NUM_COMPARTMENTS];
+} box_state_t;
+
+typedef struct box_model_t {
+  int num_locks;
+  const zsf_param_t *p;
+  double *sal_lock; // Converged salinity of every lock, to start the next calculation from
+  int num_samples;
+  double dt_forcing;
+  const zsf_box_forcing_t *forcing;
+  int infinite[NUM_COMPARTMENTS];
+  double salinity[NUM_COMPARTMENTS]; // Of infinite compartments
+} box_model_t;
+
+// Linear interpolation of the forcing, holding the first and last sample
+// before and after the series. An outflow of ZSF_NAN (i.e. a constant
+// volume) in either of the surrounding samples holds for the whole interval.
+static void interp_forcing(const box_model_t *m, double t, zsf_box_forcing_t *f) {
+  double x = t / m->dt_forcing;
+  int i = (int)floor(x);
+  double frac = x - i;
+
+  if (i < 0) {
+    i = 0;
+    frac = 0.0;
+  } else if (i >= m->num_samples - 1) {
+    i = m->num_samples - 1;
+    frac = 0.0;
+  }
+  int j = (i + 1 < m->num_samples) ? i + 1 : i;
+
+  const zsf_box_forcing_t *a = &m->forcing[i];
+  const zsf_box_forcing_t *b = &m->forcing[j];
+
+#define INTERP(field) f->field = (1.0 - frac) * a->field + frac * b->field
+  INTERP(inflow_lake);
+  INTERP(salinity_inflow_lake);
+  INTERP(inflow_sea);
+  INTERP(salinity_inflow_sea);
+#undef INTERP
+
+  f->outflow_lake = (a->outflow_lake == ZSF_NAN || b->outflow_lake == ZSF_NAN)
+                        ? ZSF_NAN
+                        : (1.0 - frac) * a->outflow_lake + frac * b->outflow_lake;
+  f->outflow_sea = (a->outflow_sea == ZSF_NAN || b->outflow_sea == ZSF_NAN)
+                       ? ZSF_NAN
+                       : (1.0 - frac) * a->outflow_sea + frac * b->outflow_sea;
+}
+
+static double salinity(const box_model_t *m, const box_state_t *s, int k) {
+  return m->infinite[k] ? m->salinity[k] : s->saltmass[k] / s->volume[k];
+}
+
+// Rates of change of the volumes and salt masses, and the total salt loads
+// of the locks. Every lock is in the steady state for the salinities of the
+// compartments at time t, starting from the salinity it converged to the
+// previous time, which saves most of the iterations.
+static int box_rates(box_model_t *m, double t, const box_state_t *s, box_state_t *rate,
+                     double *salt_load_lake, double *salt_load_sea) {
+  double sal_lake = salinity(m, s, LAKE);
+  double sal_sea = salinity(m, s, SEA);
+
+  if (!(sal_lake <= sal_sea) || sal_lake < 0.0)
+    return ZSF_ERR_COMPARTMENT_OUT_OF_BOUNDS;
+
+  double discharge_lake = 0.0; // Net discharge from the locks into the lake
+  double discharge_sea = 0.0;
+  double load_lake = 0.0; // Net salt transport from the lake into the locks
+  double load_sea = 0.0;
+
+  for (int i = 0; i < m->num_locks; i++) {
+    zsf_param_t p = m->p[i];
+    p.salinity_lake = sal_lake;
+    p.salinity_sea = sal_sea;
+    p.salinity_lock = fmin(fmax(m->sal_lock[i], sal_lake), sal_sea);
+
+    zsf_results_t results;
+    zsf_aux_results_t aux;
+    int err = zsf_calc_steady(&p, &results, &aux);
+    if (err)
+      return err;
+
+    m->sal_lock[i] = aux.salinity_lock_4;
+
+    discharge_lake += results.discharge_to_lake - results.discharge_from_lake;
+    discharge_sea += results.discharge_to_sea - results.discharge_from_sea;
+    load_lake += results.salt_load_lake;
+    load_sea += results.salt_load_sea;
+  }
+
+  zsf_box_forcing_t f;
+  interp_forcing(m, t, &f);
+
+  // Without an outflow, it balances the other discharges.
+  double outflow_lake =
+      (f.outflow_lake == ZSF_NAN) ? f.inflow_lake + discharge_lake : f.outflow_lake;
+  double outflow_sea = (f.outflow_sea == ZSF_NAN) ? f.inflow_sea + discharge_sea : f.outflow_sea;
+
+  rate->volume[LAKE] = f.inflow_lake + discharge_lake - outflow_lake;
+  rate->saltmass[LAKE] =
+      f.inflow_lake * f.salinity_inflow_lake - outflow_lake * sal_lake - load_lake;
+
+  rate->volume[SEA] = f.inflow_sea + discharge_sea - outflow_sea;
+  rate->saltmass[SEA] = f.inflow_sea * f.salinity_inflow_sea - outflow_sea * sal_sea + load_sea;
+
+  *salt_load_lake = load_lake;
+  *salt_load_sea = load_sea;
+
+  return ZSF_SUCCESS;
+}
+
+static void box_euler(const box_model_t *m, const box_state_t *s, const box_state_t *rate,
+                      double dt, box_state_t *out) {
+  for (int k = 0; k < NUM_COMPARTMENTS; k++) {
+    out->volume[k] = m->infinite[k] ? s->volume[k] : s->volume[k] + dt * rate->volume[k];
+    out->saltmass[k] = m->infinite[k] ? s->saltmass[k] : s->saltmass[k] + dt * rate->saltmass[k];
+  }
+}
+
+static int box_valid(const box_model_t *m, const box_state_t *s) {
+  for (int k = 0; k < NUM_COMPARTMENTS; k++) {
+    if (!m->infinite[k] && !(s->volume[k] > 0.0 && s->saltmass[k] >= 0.0))
+      return 0;
+  }
+  return 1;
+}
+
+static void box_output(const box_model_t *m, const box_state_t *s, double salt_load_lake,
+                       double salt_load_sea, zsf_box_output_t *out) {
+  out->volume_lake = m->infinite[LAKE] ? 0.0 : s->volume[LAKE];
+  out->salinity_lake = salinity(m, s, LAKE);
+  out->volume_sea = m->infinite[SEA] ? 0.0 : s->volume[SEA];
+  out->salinity_sea = salinity(m, s, SEA);
+  out->salt_load_lake = salt_load_lake;
+  out->salt_load_sea = salt_load_sea;
+}
+
+int ZSF_CALLCONV zsf_run_box_model(int num_locks, const zsf_param_t *p, int num_samples,
+                                   double dt_forcing, const zsf_box_forcing_t *forcing,
+                                   double tolerance, double max_time_step,
+                                   zsf_compartment_t *lake, zsf_compartment_t *sea,
+                                   int num_outputs, const double *t_output,
+                                   zsf_box_output_t *outputs) {
+  if (num_locks < 0 || num_samples < 1 || !(dt_forcing > 0.0) || !(tolerance > 0.0) ||
+      !(max_time_step > 0.0) || num_outputs < 1)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  for (int i = 0; i < num_outputs; i++) {
+    if (!(t_output[i] >= 0.0) || (i > 0 && t_output[i] < t_output[i - 1]))
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  zsf_compartment_t *compartments[NUM_COMPARTMENTS] = {lake, sea};
+  box_model_t m = {num_locks, p, NULL, num_samples, dt_forcing, forcing, {0, 0}, {0.0, 0.0}};
+  box_state_t s;
+
+  // A compartment without volume is infinitely large, i.e. its salinity is
+  // constant.
+  for (int k = 0; k < NUM_COMPARTMENTS; k++) {
+    const zsf_compartment_t *c = compartments[k];
+    if (!(c->volume >= 0.0) || !(c->salinity >= 0.0))
+      return ZSF_ERR_INVALID_ARGUMENT;
+
+    m.infinite[k] = (c->volume == 0.0);
+    m.salinity[k] = c->salinity;
+    s.volume[k] = c->volume;
+    s.saltmass[k] = c->volume * c->salinity;
+  }
+
+  m.sal_lock = malloc((num_locks > 0 ? num_locks : 1) * sizeof(double));
+  if (m.sal_lock == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+  for (int i = 0; i < num_locks; i++) {
+    double sal_lock = p[i].salinity_lock;
+    m.sal_lock[i] = (sal_lock == ZSF_NAN) ? 0.5 * (lake->salinity + sea->salinity) : sal_lock;
+  }
+
+  // Adaptive time stepping with Heun's method. The difference with the
+  // forward Euler step estimates the local error in the salinities, which
+  // is kept below the tolerance.
+  double t = 0.0;
+  double dt = fmin(max_time_step, dt_forcing);
+  int err = ZSF_SUCCESS;
+  int rejected = 0;
+
+  box_state_t rate;
+  double salt_load_lake, salt_load_sea;
+  err = box_rates(&m, t, &s, &rate, &salt_load_lake, &salt_load_sea);
+
+  for (int i = 0; i < num_outputs && !err; i++) {
+    while (t < t_output[i] && !err) {
+      if (dt < MIN_STEP_FRACTION * max_time_step) {
+        err = ZSF_ERR_COMPARTMENT_OUT_OF_BOUNDS;
+        break;
+      }
+
+      // Do not step past the output time
+      double h = fmin(dt, t_output[i] - t);
+
+      box_state_t euler, heun, rate_euler;
+      double load_lake_euler, load_sea_euler;
+      box_euler(&m, &s, &rate, h, &euler);
+
+      int valid = box_valid(&m, &euler);
+      if (valid) {
+        err = box_rates(&m, t + h, &euler, &rate_euler, &load_lake_euler, &load_sea_euler);
+        if (err == ZSF_ERR_COMPARTMENT_OUT_OF_BOUNDS) {
+          // Overshoot of a salinity, try again with a smaller step
+          valid = 0;
+          err = ZSF_SUCCESS;
+        }
+      }
+
+      double error = INFINITY;
+      if (valid && !err) {
+        for (int k = 0; k < NUM_COMPARTMENTS; k++) {
+          heun.volume[k] = euler.volume[k] + 0.5 * h * (rate_euler.volume[k] - rate.volume[k]);
+          heun.saltmass[k] =
+              euler.saltmass[k] + 0.5 * h * (rate_euler.saltmass[k] - rate.saltmass[k]);
+        }
+
+        if (box_valid(&m, &heun)) {
+          error = 0.0;
+          for (int k = 0; k < NUM_COMPARTMENTS; k++)
+            error = fmax(error, fabs(salinity(&m, &heun, k) - salinity(&m, &euler, k)));
+        }
+      }
+
+      if (err)
+        break;
+
+      // The error of Heun's method is of second order in the time step
+      double factor = (error > 0.0) ? SAFETY_FACTOR * sqrt(tolerance / error) : MAX_STEP_FACTOR;
+      factor = fmin(fmax(factor, MIN_STEP_FACTOR), MAX_STEP_FACTOR);
+
+      if (error <= tolerance) {
+        // A step that was cut short by an output time says little about
+        // the step that is possible.
+        if (h == dt)
+          dt = fmin(h * factor, max_time_step);
+
+        t = (h == t_output[i] - t) ? t_output[i] : t + h;
+        s = heun;
+        rejected = 0;
+        err = box_rates(&m, t, &s, &rate, &salt_load_lake, &salt_load_sea);
+      } else if (++rejected > MAX_REJECTED) {
+        err = ZSF_ERR_COMPARTMENT_OUT_OF_BOUNDS;
+      } else {
+        dt = h * factor;
+      }
+    }
+
+    if (!err)
+      box_output(&m, &s, salt_load_lake, salt_load_sea, &outputs[i]);
+  }
+
+  free(m.sal_lock);
+
+  if (err)
+    return err;
+
+  for (int k = 0; k < NUM_COMPARTMENTS; k++) {
+    compartments[k]->volume = m.infinite[k] ? 0.0 : s.volume[k];
+    compartments[k]->salinity = salinity(&m, &s, k);
+  }
+
+  return ZSF_SUCCESS;
+}
@@ -0,0 +1,22 @@
+#ifndef ZSF_ERRORS_H
+#define ZSF_ERRORS_H
+
+#define ERROR_CODES(X)                                                                             \
+  X(ZSF_SUCCESS, "Success")                                                                        \
+  X(ZSF_SHIP_TOO_BIG, "The ship is too large for the lock")                                        \
+  X(ZSF_ERR_REMAINING_HEAD_DIFF, "Remaining head difference when opening doors")                   \
+  X(ZSF_ERR_SAL_LOCK_OUT_OF_BOUNDS, "The salinity of the lock exceeds that of the boundaries")     \
+  X(ZSF_ERR_INVALID_ARGUMENT, "Invalid argument")                                                  \
+  X(ZSF_ERR_OUT_OF_MEMORY, "Out of memory")                                                        \
+  X(ZSF_ERR_IO, "Could not read or write file")                                                    \
+  X(ZSF_ERR_FILE_FORMAT, "Invalid or incompatible file format")                                    \
+  X(ZSF_ERR_COMPARTMENT_OUT_OF_BOUNDS, "A compartment ran dry or became saltier than the sea")     \
+  X(ZSF_ERR_SERVICE_UNAVAILABLE, "The calculation service is not running")                         \
+  X(ZSF_ERR_SCHEDULE_INFEASIBLE, "No schedule satisfies the waiting time and flushing limits")     \
+  X(ZSF_ERR_NOT_CONVERGED, "The iteration did not converge")
+
+#define ERROR_ENUM(ID, TEXT) ID,
+enum error_ids { ERROR_CODES(ERROR_ENUM) ZSF_NUM_ERRORS };
+#undef ERROR_ENUM
+
+#endif
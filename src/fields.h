@@ -0,0 +1,98 @@
+#ifndef ZSF_FIELDS_H
+#define ZSF_FIELDS_H
+
+#include "zsf.h"
+#include <stddef.h>
+#include <string.h>
+
+// All public structures consist of doubles only (see zsf.h), so we can
+// address their fields by offset. These lists have to be kept in sync with
+// the structure definitions in zsf.h.
+#define ZSF_PARAM_FIELDS(X)                                                                        \
+  X(lock_length)                                                                                   \
+  X(lock_width)                                                                                    \
+  X(lock_bottom)                                                                                   \
+  X(num_cycles)                                                                                    \
+  X(door_time_to_open)                                                                             \
+  X(leveling_time)                                                                                 \
+  X(calibration_coefficient)                                                                       \
+  X(symmetry_coefficient)                                                                          \
+  X(ship_volume_sea_to_lake)                                                                       \
+  X(ship_volume_lake_to_sea)                                                                       \
+  X(salinity_lock)                                                                                 \
+  X(head_sea)                                                                                      \
+  X(salinity_sea)                                                                                  \
+  X(temperature_sea)                                                                               \
+  X(head_lake)                                                                                     \
+  X(salinity_lake)                                                                                 \
+  X(temperature_lake)                                                                              \
+  X(flushing_discharge_high_tide)                                                                  \
+  X(flushing_discharge_low_tide)                                                                   \
+  X(density_current_factor_sea)                                                                    \
+  X(density_current_factor_lake)                                                                   \
+  X(distance_door_bubble_screen_sea)                                                               \
+  X(distance_door_bubble_screen_lake)                                                              \
+  X(sill_height_sea)                                                                               \
+  X(sill_height_lake)                                                                              \
+  X(rtol)                                                                                          \
+  X(atol)
+
+#define ZSF_RESULTS_FIELDS(X)                                                                      \
+  X(mass_transport_lake)                                                                           \
+  X(salt_load_lake)                                                                                \
+  X(discharge_from_lake)                                                                           \
+  X(discharge_to_lake)                                                                             \
+  X(salinity_to_lake)                                                                              \
+  X(mass_transport_sea)                                                                            \
+  X(salt_load_sea)                                                                                 \
+  X(discharge_from_sea)                                                                            \
+  X(discharge_to_sea)                                                                              \
+  X(salinity_to_sea)
+
+#define ZSF_TRANSPORTS_FIELDS(X)                                                                   \
+  X(mass_transport_lake)                                                                           \
+  X(volume_from_lake)                                                                              \
+  X(volume_to_lake)                                                                                \
+  X(discharge_from_lake)                                                                           \
+  X(discharge_to_lake)                                                                             \
+  X(salinity_to_lake)                                                                              \
+  X(mass_transport_sea)                                                                            \
+  X(volume_from_sea)                                                                               \
+  X(volume_to_sea)                                                                                 \
+  X(discharge_from_sea)                                                                            \
+  X(discharge_to_sea)                                                                              \
+  X(salinity_to_sea)
+
+#define ZSF_FIELD_COUNT(NAME) +1
+#define ZSF_NUM_PARAM_FIELDS (0 ZSF_PARAM_FIELDS(ZSF_FIELD_COUNT))
+#define ZSF_NUM_RESULTS_FIELDS (0 ZSF_RESULTS_FIELDS(ZSF_FIELD_COUNT))
+#define ZSF_NUM_TRANSPORTS_FIELDS (0 ZSF_TRANSPORTS_FIELDS(ZSF_FIELD_COUNT))
+
+// Poor man's static assertion that the lists above are complete
+#define ZSF_ALL_DOUBLES(NAME, T, N) typedef char NAME[sizeof(T) == (N) * sizeof(double) ? 1 : -1]
+ZSF_ALL_DOUBLES(param_fields_complete, zsf_param_t, ZSF_NUM_PARAM_FIELDS);
+ZSF_ALL_DOUBLES(results_fields_complete, zsf_results_t, ZSF_NUM_RESULTS_FIELDS);
+ZSF_ALL_DOUBLES(transports_fields_complete, zsf_phase_transports_t, ZSF_NUM_TRANSPORTS_FIELDS);
+#undef ZSF_ALL_DOUBLES
+
+#define ZSF_FIELD_NAME(NAME) #NAME,
+static const char *const param_field_names[] = {ZSF_PARAM_FIELDS(ZSF_FIELD_NAME)};
+static const char *const results_field_names[] = {ZSF_RESULTS_FIELDS(ZSF_FIELD_NAME)};
+static const char *const transports_field_names[] = {ZSF_TRANSPORTS_FIELDS(ZSF_FIELD_NAME)};
+#undef ZSF_FIELD_NAME
+
+// Returns the index of the parameter with the given name, or -1 if there is
+// no such parameter.
+static inline int param_field_index(const char *name) {
+  for (int i = 0; i < ZSF_NUM_PARAM_FIELDS; i++) {
+    if (strcmp(param_field_names[i], name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static inline double *param_field(zsf_param_t *p, int index) { return (double *)p + index; }
+
+static inline double *results_field(zsf_results_t *r, int index) { return (double *)r + index; }
+
+#endif
@@ -0,0 +1,303 @@
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "zsf.h"
+
+// Harmonic boundary forcing
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+// Every forced parameter is a mean plus a sum of harmonic terms
+//
+//   x(t) = mean + sum(amplitude * cos(omega * t - phase))
+//
+// which covers both the tidal constituents of the head at sea and the
+// annual and semiannual harmonics of the seasonal curves.
+//
+// At the equidistant times t_b + k * dt of a block starting at t_b, with
+// theta_b = omega * t_b - phase and phi_k = omega * k * dt, a term equals
+//
+//   amplitude * (cos(theta_b) * cos(phi_k) - sin(theta_b) * sin(phi_k))
+//
+// The rotations phi_k only depend on the time step, and are tabulated once
+// per call. A block then only costs a single cos and sin per term, and the
+// remaining loop over its times vectorizes. Unlike a running recurrence, the
+// rounding errors do not accumulate over the run.
+
+#define PI 3.14159265358979323846
+#define DEG_TO_RAD (PI / 180.0)
+#define SECONDS_PER_HOUR 3600.0
+#define SECONDS_PER_YEAR (365.25 * 86400.0)
+
+// The number of times evaluated at once. The forced columns of a block fit
+// comfortably in the L1 cache.
+#define BLOCK_SIZE 64
+
+typedef struct forcing_term_t {
+  int slot;
+  double amplitude;
+  double omega;
+  double phase;
+} forcing_term_t;
+
+struct zsf_forcing_t {
+  // The forced parameters, and their means (or ZSF_NAN to keep the value of
+  // the parameters passed at evaluation)
+  int num_slots;
+  int field[ZSF_NUM_PARAM_FIELDS];
+  double mean[ZSF_NUM_PARAM_FIELDS];
+
+  int num_terms;
+  forcing_term_t *terms;
+};
+
+static void add_term(zsf_forcing_t *f, int slot, double amplitude, double omega, double phase) {
+  if (amplitude == 0.0)
+    return;
+
+  forcing_term_t *term = &f->terms[f->num_terms++];
+  term->slot = slot;
+  term->amplitude = amplitude;
+  term->omega = omega;
+  term->phase = phase;
+}
+
+static int is_valid_curve(const zsf_seasonal_t *c) {
+  return isfinite(c->mean) && isfinite(c->amplitude) && isfinite(c->t_max) &&
+         isfinite(c->amplitude_semiannual) && isfinite(c->t_max_semiannual);
+}
+
+void ZSF_CALLCONV zsf_forcing_free(zsf_forcing_t *forcing) {
+  if (forcing == NULL)
+    return;
+
+  free(forcing->terms);
+  free(forcing);
+}
+
+int ZSF_CALLCONV zsf_forcing_create(double mean_sea_level, int num_constituents,
+                                    const zsf_tidal_constituent_t *constituents, int num_curves,
+                                    const char *const *parameters, const zsf_seasonal_t *curves,
+                                    zsf_forcing_t **forcing) {
+  *forcing = NULL;
+  if (num_constituents < 0 || num_curves < 0 || num_curves >= ZSF_NUM_PARAM_FIELDS)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  if ((num_constituents > 0 && constituents == NULL) ||
+      (num_curves > 0 && (parameters == NULL || curves == NULL)))
+    return ZSF_ERR_INVALID_ARGUMENT;
+  if (!isfinite(mean_sea_level) || (mean_sea_level == ZSF_NAN && num_constituents > 0))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  for (int i = 0; i < num_constituents; i++) {
+    const zsf_tidal_constituent_t *c = &constituents[i];
+    if (!isfinite(c->amplitude) || !isfinite(c->phase) || !isfinite(c->speed))
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  // The head at sea is only forced by the tide, and every other parameter by
+  // at most one curve
+  int used[ZSF_NUM_PARAM_FIELDS] = {0};
+  used[param_field_index("head_sea")] = 1;
+  for (int i = 0; i < num_curves; i++) {
+    int field = param_field_index(parameters[i]);
+    if (field < 0 || used[field] || !is_valid_curve(&curves[i]))
+      return ZSF_ERR_INVALID_ARGUMENT;
+    used[field] = 1;
+  }
+
+  zsf_forcing_t *f = calloc(1, sizeof(zsf_forcing_t));
+  if (f == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  f->terms = malloc((num_constituents + 2 * num_curves + 1) * sizeof(forcing_term_t));
+  if (f->terms == NULL) {
+    zsf_forcing_free(f);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  if (mean_sea_level != ZSF_NAN) {
+    int slot = f->num_slots++;
+    f->field[slot] = param_field_index("head_sea");
+    f->mean[slot] = mean_sea_level;
+
+    for (int i = 0; i < num_constituents; i++) {
+      const zsf_tidal_constituent_t *c = &constituents[i];
+      add_term(f, slot, c->amplitude, c->speed * DEG_TO_RAD / SECONDS_PER_HOUR,
+               c->phase * DEG_TO_RAD);
+    }
+  }
+
+  double omega_annual = 2.0 * PI / SECONDS_PER_YEAR;
+  for (int i = 0; i < num_curves; i++) {
+    const zsf_seasonal_t *c = &curves[i];
+    int slot = f->num_slots++;
+    f->field[slot] = param_field_index(parameters[i]);
+    f->mean[slot] = c->mean;
+
+    add_term(f, slot, c->amplitude, omega_annual, omega_annual * c->t_max);
+    add_term(f, slot, c->amplitude_semiannual, 2.0 * omega_annual,
+             2.0 * omega_annual * c->t_max_semiannual);
+  }
+
+  *forcing = f;
+  return ZSF_SUCCESS;
+}
+
+static int is_forced(const zsf_forcing_t *f, int field) {
+  for (int s = 0; s < f->num_slots; s++) {
+    if (f->field[s] == field)
+      return 1;
+  }
+  return 0;
+}
+
+// The mean of a slot, or the value of its parameter in p when not given
+static double slot_mean(const zsf_forcing_t *f, const zsf_param_t *p, int s) {
+  return (f->mean[s] == ZSF_NAN) ? *param_field((zsf_param_t *)p, f->field[s]) : f->mean[s];
+}
+
+// The forcing at a single time t, on top of the parameters p
+static void eval_at(const zsf_forcing_t *f, const zsf_param_t *p, double t, zsf_param_t *out) {
+  double values[ZSF_NUM_PARAM_FIELDS];
+  for (int s = 0; s < f->num_slots; s++)
+    values[s] = slot_mean(f, p, s);
+
+  for (int j = 0; j < f->num_terms; j++) {
+    const forcing_term_t *term = &f->terms[j];
+    values[term->slot] += term->amplitude * cos(term->omega * t - term->phase);
+  }
+
+  *out = *p;
+  for (int s = 0; s < f->num_slots; s++)
+    *param_field(out, f->field[s]) = values[s];
+}
+
+// Tabulates cos(omega * k * dt) and sin(omega * k * dt) of every term for the
+// times k < num_times within a block
+static double *rotation_table(const zsf_forcing_t *f, double dt, int num_times) {
+  double *table = malloc((2 * (size_t)f->num_terms * num_times + 1) * sizeof(double));
+  if (table == NULL)
+    return NULL;
+
+  for (int j = 0; j < f->num_terms; j++) {
+    double *c = &table[2 * j * num_times];
+    double *s = c + num_times;
+    for (int k = 0; k < num_times; k++) {
+      c[k] = cos(f->terms[j].omega * k * dt);
+      s[k] = sin(f->terms[j].omega * k * dt);
+    }
+  }
+  return table;
+}
+
+// The forcing at the times t + k * dt for k < num_times (at most the block
+// size the table was made for), on top of the parameters p
+static void eval_block(const zsf_forcing_t *f, const double *table, int table_size,
+                       const zsf_param_t *p, double t, int num_times, zsf_param_t *out) {
+  double columns[ZSF_NUM_PARAM_FIELDS][BLOCK_SIZE];
+
+  for (int s = 0; s < f->num_slots; s++) {
+    double mean = slot_mean(f, p, s);
+    for (int k = 0; k < num_times; k++)
+      columns[s][k] = mean;
+  }
+
+  for (int j = 0; j < f->num_terms; j++) {
+    const forcing_term_t *term = &f->terms[j];
+    const double *c = &table[2 * j * table_size];
+    const double *s = c + table_size;
+    double theta = term->omega * t - term->phase;
+    double a_cos = term->amplitude * cos(theta);
+    double a_sin = term->amplitude * sin(theta);
+
+    double *column = columns[term->slot];
+    for (int k = 0; k < num_times; k++)
+      column[k] += a_cos * c[k] - a_sin * s[k];
+  }
+
+  for (int k = 0; k < num_times; k++) {
+    out[k] = *p;
+    for (int s = 0; s < f->num_slots; s++)
+      *param_field(&out[k], f->field[s]) = columns[s][k];
+  }
+}
+
+int ZSF_CALLCONV zsf_forcing_eval(const zsf_forcing_t *forcing, const zsf_param_t *p, double t0,
+                                  double dt, int num_times, zsf_param_t *out) {
+  if (num_times < 0 || !isfinite(t0) || !isfinite(dt))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int table_size = num_times < BLOCK_SIZE ? num_times : BLOCK_SIZE;
+  double *table = rotation_table(forcing, dt, table_size);
+  if (table == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  for (int i = 0; i < num_times; i += BLOCK_SIZE) {
+    int n = (num_times - i < BLOCK_SIZE) ? num_times - i : BLOCK_SIZE;
+    eval_block(forcing, table, table_size, p, t0 + i * dt, n, &out[i]);
+  }
+
+  free(table);
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_calc_steady_forced(const zsf_param_t *p, const zsf_forcing_t *forcing,
+                                        double t0, double dt, int num_times, int output_mask,
+                                        double *outputs, int row_stride, int column_stride,
+                                        int *errors) {
+  if (num_times < 0 || !isfinite(t0) || !isfinite(dt) || output_mask == 0 ||
+      (output_mask & ~ZSF_OUTPUT_ALL) != 0)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int table_size = num_times < BLOCK_SIZE ? num_times : BLOCK_SIZE;
+  double *table = rotation_table(forcing, dt, table_size);
+  if (table == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  // Only a single block of parameters is ever materialized
+  zsf_param_t block[BLOCK_SIZE];
+  int first_err = ZSF_SUCCESS;
+
+  for (int i = 0; i < num_times; i += BLOCK_SIZE) {
+    int n = (num_times - i < BLOCK_SIZE) ? num_times - i : BLOCK_SIZE;
+    eval_block(forcing, table, table_size, p, t0 + i * dt, n, block);
+
+    int err = zsf_calc_steady_batch(n, block, output_mask, &outputs[(ptrdiff_t)i * row_stride],
+                                    row_stride, column_stride, errors ? &errors[i] : NULL);
+    if (err && !first_err)
+      first_err = err;
+  }
+
+  free(table);
+  return first_err;
+}
+
+int ZSF_CALLCONV zsf_step_lockages_forced(const zsf_param_t *p, const zsf_forcing_t *forcing,
+                                          int num_lockages, const zsf_lockage_t *lockages,
+                                          zsf_phase_state_t *state,
+                                          zsf_phase_transports_t *transports) {
+  int head_lake_forced = is_forced(forcing, param_field_index("head_lake"));
+  int head_sea_forced = is_forced(forcing, param_field_index("head_sea"));
+  zsf_param_t pl;
+
+  for (int i = 0; i < num_lockages; i++) {
+    const zsf_lockage_t *l = &lockages[i];
+    int routine = (int)l->routine;
+
+    // A leveling ends at the forced head on the other side at the moment the
+    // doors open, which then also holds while the doors are open.
+    double t = (routine == 1 || routine == 3) ? l->time + l->duration : l->time;
+    eval_at(forcing, p, t, &pl);
+    if (routine == 2 && head_lake_forced)
+      pl.head_lake = state->head_lock;
+    else if (routine == 4 && head_sea_forced)
+      pl.head_sea = state->head_lock;
+
+    int err = zsf_step_lockages(&pl, 1, l, state, transports ? &transports[i] : NULL);
+    if (err)
+      return err;
+  }
+
+  return ZSF_SUCCESS;
+}
@@ -0,0 +1,468 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aggregate.h"
+#include "errors.h"
+#include "random.h"
+#include "zsf.h"
+
+#define SIDE_LAKE 0
+#define SIDE_SEA 1
+
+#define SECONDS_PER_DAY 86400.0
+#define SECONDS_PER_YEAR (365.25 * SECONDS_PER_DAY)
+
+// A single visit of the lock to one of its sides results in at most four
+// lockages (doors open, flushing, leveling, doors open).
+#define MAX_PENDING 8
+
+// Number of lockages that zsf_run_lockages generates and steps at once
+#define BATCH_SIZE 128
+
+typedef struct ship_t {
+  double arrival;
+  double volume;
+} ship_t;
+
+// Ships waiting at one side of the lock (FIFO)
+typedef struct ship_queue_t {
+  ship_t *ships;
+  size_t capacity;
+  size_t head;
+  size_t count;
+} ship_queue_t;
+
+typedef struct side_t {
+  double rate; // ships per second at time 0
+  ship_t next; // the next ship to arrive
+  ship_queue_t queue;
+} side_t;
+
+struct zsf_lockage_generator_t {
+  zsf_lock_policy_t policy;
+  uint64_t rng;
+
+  // Traffic
+  double growth; // exponential growth rate of the arrivals [1/s]
+  side_t sides[2];
+
+  // Fleet mix, with the parameters of the lognormal distributions
+  int num_classes;
+  double *cumulative_share;
+  double *mu;
+  double *sigma;
+  double *volume_max;
+
+  // The lock. If not idle, its doors open at the given side and time with
+  // num_exiting ships inside.
+  int side;
+  int idle;
+  double time;
+  int num_exiting;
+  int finished;
+
+  // Lockages determined by the simulation, but not handed out yet
+  zsf_lockage_t pending[MAX_PENDING];
+  int pending_head;
+  int num_pending;
+
+  double horizon;
+
+  // Statistics
+  double num_ships;
+  double num_lockings;
+  double sum_wait;
+  double max_wait;
+};
+
+static int queue_push(ship_queue_t *q, ship_t ship) {
+  if (q->count == q->capacity) {
+    size_t capacity = q->capacity ? 2 * q->capacity : 64;
+    ship_t *ships = malloc(capacity * sizeof(ship_t));
+    if (ships == NULL)
+      return ZSF_ERR_OUT_OF_MEMORY;
+    for (size_t i = 0; i < q->count; i++)
+      ships[i] = q->ships[(q->head + i) % q->capacity];
+    free(q->ships);
+    q->ships = ships;
+    q->capacity = capacity;
+    q->head = 0;
+  }
+  q->ships[(q->head + q->count) % q->capacity] = ship;
+  q->count++;
+  return ZSF_SUCCESS;
+}
+
+static const ship_t *queue_front(const ship_queue_t *q) {
+  return q->count ? &q->ships[q->head] : NULL;
+}
+
+static void queue_pop(ship_queue_t *q) {
+  q->head = (q->head + 1) % q->capacity;
+  q->count--;
+}
+
+static double draw_volume(zsf_lockage_generator_t *g) {
+  double u = random_uniform(&g->rng) * g->cumulative_share[g->num_classes - 1];
+  int c = 0;
+  while (c < g->num_classes - 1 && u >= g->cumulative_share[c])
+    c++;
+
+  double volume = exp(g->mu[c] + g->sigma[c] * random_normal(&g->rng));
+  if (g->volume_max[c] > 0.0)
+    volume = fmin(volume, g->volume_max[c]);
+  return volume;
+}
+
+// Draw the next arrival after the current one. The arrival rate grows
+// exponentially, i.e. rate(t) = rate * exp(growth * t), which we sample by
+// inversion of the cumulative intensity. With a negative growth the total
+// intensity up to infinity is finite, and once it is used up no more ships
+// arrive.
+static void draw_arrival(zsf_lockage_generator_t *g, side_t *s) {
+  if (s->rate <= 0.0) {
+    s->next.arrival = INFINITY;
+    return;
+  }
+
+  double t = s->next.arrival;
+  double e = random_exponential(&g->rng);
+  if (g->growth == 0.0) {
+    s->next.arrival = t + e / s->rate;
+  } else {
+    double x = g->growth * e / (s->rate * exp(g->growth * t));
+    s->next.arrival = (x > -1.0) ? t + log1p(x) / g->growth : INFINITY;
+  }
+  s->next.volume = draw_volume(g);
+}
+
+// Put all ships that arrived up to time t in the queue
+static int admit_arrivals(zsf_lockage_generator_t *g, int side, double t) {
+  side_t *s = &g->sides[side];
+  while (s->next.arrival <= t) {
+    int err = queue_push(&s->queue, s->next);
+    if (err)
+      return err;
+    draw_arrival(g, s);
+  }
+  return ZSF_SUCCESS;
+}
+
+static void emit(zsf_lockage_generator_t *g, double time, int routine, double duration,
+                 double ship_volume_lake_to_sea, double ship_volume_sea_to_lake, int num_ships) {
+  zsf_lockage_t *l = &g->pending[(g->pending_head + g->num_pending) % MAX_PENDING];
+  l->time = time;
+  l->routine = routine;
+  l->duration = duration;
+  l->ship_volume_lake_to_sea = ship_volume_lake_to_sea;
+  l->ship_volume_sea_to_lake = ship_volume_sea_to_lake;
+  l->num_ships = num_ships;
+  g->num_pending++;
+}
+
+// Routine numbers of the phases at either side
+static int routine_door_open(int side) { return side == SIDE_LAKE ? 2 : 4; }
+static int routine_level(int side) { return side == SIDE_LAKE ? 1 : 3; }
+static int routine_flush(int side) { return side == SIDE_LAKE ? -2 : -4; }
+
+// The lock is empty with the doors closed at its side from t_closed on,
+// and no ships are waiting. Flush (if enabled) until the next ship arrives,
+// and level towards the side where it arrives.
+static void lock_idle(zsf_lockage_generator_t *g, double t_closed) {
+  const zsf_lock_policy_t *policy = &g->policy;
+  int a = g->side;
+  int b = 1 - a;
+
+  double t_next_a = g->sides[a].next.arrival;
+  double t_next_b = g->sides[b].next.arrival;
+  double t_next = fmin(t_next_a, t_next_b);
+  if (t_next == INFINITY) {
+    g->finished = 1;
+    return;
+  }
+
+  double t_flushing = fmin(t_next - t_closed, policy->max_flushing_time);
+  if (policy->flushing_when_idle != 0.0 && t_flushing > 0.0)
+    emit(g, t_closed, routine_flush(a), t_flushing, 0.0, 0.0, 0);
+
+  // Level again before reopening on the same side, as the head may have
+  // changed in the meantime.
+  if (t_next_b < t_next_a) {
+    g->side = b;
+    g->num_lockings++;
+  }
+  emit(g, t_next, routine_level(g->side), policy->leveling_time, 0.0, 0.0, 0);
+
+  g->idle = 0;
+  g->time = t_next + policy->leveling_time;
+  g->num_exiting = 0;
+}
+
+typedef struct loading_t {
+  int num_ships;
+  double volume;
+  double first_arrival;
+  double sum_arrival;
+  double t_ready;
+} loading_t;
+
+// Let the waiting ships enter the lock while they fit, including those that
+// arrive in the meantime. Returns whether the lock is full.
+static int load_ships(zsf_lockage_generator_t *g, int side, loading_t *l, int *err) {
+  const zsf_lock_policy_t *policy = &g->policy;
+  ship_queue_t *q = &g->sides[side].queue;
+
+  while (1) {
+    if ((*err = admit_arrivals(g, side, l->t_ready)))
+      return 1;
+
+    const ship_t *ship = queue_front(q);
+    if (ship == NULL)
+      return 0;
+
+    // A ship that is larger than the capacity can still go alone
+    int fits = (policy->max_ships <= 0.0 || l->num_ships + 1 <= policy->max_ships) &&
+               (policy->max_ship_volume <= 0.0 || l->num_ships == 0 ||
+                l->volume + ship->volume <= policy->max_ship_volume);
+    if (!fits)
+      return 1;
+
+    l->num_ships++;
+    l->volume += ship->volume;
+    l->first_arrival = fmin(l->first_arrival, ship->arrival);
+    l->sum_arrival += ship->arrival;
+    l->t_ready += policy->time_per_ship;
+    queue_pop(q);
+  }
+}
+
+// The doors open at the side of the lock. Ships exit and enter, and the lock
+// either departs towards the other side, or becomes idle.
+static int lock_visit(zsf_lockage_generator_t *g) {
+  const zsf_lock_policy_t *policy = &g->policy;
+  int a = g->side;
+  int b = 1 - a;
+  double t_open = g->time;
+
+  loading_t l = {0, 0.0, INFINITY, 0.0, 0.0};
+  l.t_ready = t_open + policy->door_time + policy->time_per_ship * g->num_exiting;
+
+  int err = ZSF_SUCCESS;
+  int full = load_ships(g, a, &l, &err);
+  if (err)
+    return err;
+
+  while (1) {
+    const ship_t *waiting_b = queue_front(&g->sides[b].queue);
+    double t_first_b = waiting_b ? waiting_b->arrival : g->sides[b].next.arrival;
+
+    if (l.num_ships == 0) {
+      if (t_first_b <= l.t_ready)
+        break;
+
+      // Nothing to do, so close the doors
+      emit(g, t_open, routine_door_open(a), l.t_ready - t_open, 0.0, 0.0, 0);
+      g->idle = 1;
+      lock_idle(g, l.t_ready);
+      return ZSF_SUCCESS;
+    }
+
+    // Wait for more ships, as long as neither the ships inside nor those
+    // waiting on the other side have to wait too long.
+    double t_limit = fmin(l.first_arrival, t_first_b) + policy->max_wait;
+    if (full || l.t_ready >= t_limit)
+      break;
+
+    double t_next_a = g->sides[a].next.arrival;
+    if (t_next_a > t_limit) {
+      l.t_ready = t_limit;
+      break;
+    }
+
+    l.t_ready = fmax(l.t_ready, t_next_a);
+    full = load_ships(g, a, &l, &err);
+    if (err)
+      return err;
+  }
+
+  // Depart towards the other side
+  double t_depart = l.t_ready;
+  emit(g, t_open, routine_door_open(a), t_depart - t_open, a == SIDE_LAKE ? l.volume : 0.0,
+       a == SIDE_SEA ? l.volume : 0.0, l.num_ships);
+  emit(g, t_depart, routine_level(b), policy->leveling_time, 0.0, 0.0, 0);
+
+  g->num_ships += l.num_ships;
+  g->num_lockings++;
+  g->sum_wait += l.num_ships * t_depart - l.sum_arrival;
+  if (l.num_ships > 0)
+    g->max_wait = fmax(g->max_wait, t_depart - l.first_arrival);
+
+  g->side = b;
+  g->time = t_depart + policy->leveling_time;
+  g->num_exiting = l.num_ships;
+
+  return ZSF_SUCCESS;
+}
+
+void ZSF_CALLCONV zsf_lockage_generator_free(zsf_lockage_generator_t *g) {
+  if (g == NULL)
+    return;
+  free(g->sides[SIDE_LAKE].queue.ships);
+  free(g->sides[SIDE_SEA].queue.ships);
+  free(g->cumulative_share);
+  free(g->mu);
+  free(g->sigma);
+  free(g->volume_max);
+  free(g);
+}
+
+int ZSF_CALLCONV zsf_lockage_generator_create(const zsf_traffic_t *traffic, int num_classes,
+                                              const zsf_fleet_class_t *fleet,
+                                              const zsf_lock_policy_t *policy, int seed,
+                                              zsf_lockage_generator_t **generator) {
+  *generator = NULL;
+
+  if (!(traffic->ships_per_day_lake >= 0.0) || !(traffic->ships_per_day_sea >= 0.0) ||
+      !(traffic->annual_growth > -1.0) || num_classes < 1)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  if (!(policy->leveling_time > 0.0) || !(policy->door_time > 0.0) ||
+      !(policy->time_per_ship >= 0.0) || !(policy->max_wait >= 0.0) ||
+      !(policy->max_flushing_time >= 0.0))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  double total_share = 0.0;
+  for (int c = 0; c < num_classes; c++) {
+    if (!(fleet[c].share >= 0.0) || !(fleet[c].volume_mean >= 0.0) ||
+        !(fleet[c].volume_std >= 0.0))
+      return ZSF_ERR_INVALID_ARGUMENT;
+    total_share += fleet[c].share;
+  }
+  if (!(total_share > 0.0))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  zsf_lockage_generator_t *g = calloc(1, sizeof(zsf_lockage_generator_t));
+  if (g == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  g->num_classes = num_classes;
+  g->cumulative_share = malloc(num_classes * sizeof(double));
+  g->mu = malloc(num_classes * sizeof(double));
+  g->sigma = malloc(num_classes * sizeof(double));
+  g->volume_max = malloc(num_classes * sizeof(double));
+  if (!g->cumulative_share || !g->mu || !g->sigma || !g->volume_max) {
+    zsf_lockage_generator_free(g);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  // Lognormal distribution with the given mean and standard deviation
+  double cumulative_share = 0.0;
+  for (int c = 0; c < num_classes; c++) {
+    cumulative_share += fleet[c].share;
+    g->cumulative_share[c] = cumulative_share;
+
+    double cv = fleet[c].volume_mean > 0.0 ? fleet[c].volume_std / fleet[c].volume_mean : 0.0;
+    g->sigma[c] = sqrt(log1p(cv * cv));
+    g->mu[c] = log(fleet[c].volume_mean) - 0.5 * g->sigma[c] * g->sigma[c];
+    g->volume_max[c] = fleet[c].volume_max;
+  }
+
+  g->policy = *policy;
+  g->rng = (uint64_t)seed;
+  g->growth = log1p(traffic->annual_growth) / SECONDS_PER_YEAR;
+
+  g->sides[SIDE_LAKE].rate = traffic->ships_per_day_lake / SECONDS_PER_DAY;
+  g->sides[SIDE_SEA].rate = traffic->ships_per_day_sea / SECONDS_PER_DAY;
+  for (int s = 0; s < 2; s++) {
+    g->sides[s].next.arrival = 0.0;
+    draw_arrival(g, &g->sides[s]);
+  }
+
+  g->side = SIDE_LAKE;
+  g->idle = 1;
+  g->time = 0.0;
+
+  *generator = g;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_lockage_generator_next(zsf_lockage_generator_t *g, double t_end,
+                                            int max_lockages, zsf_lockage_t *lockages,
+                                            int *num_lockages) {
+  int n = 0;
+
+  while (n < max_lockages) {
+    if (g->num_pending == 0) {
+      if (g->finished)
+        break;
+
+      if (g->idle) {
+        lock_idle(g, g->time);
+      } else {
+        int err = lock_visit(g);
+        if (err) {
+          *num_lockages = n;
+          return err;
+        }
+      }
+      continue;
+    }
+
+    const zsf_lockage_t *l = &g->pending[g->pending_head];
+    if (l->time >= t_end)
+      break;
+
+    lockages[n++] = *l;
+    g->pending_head = (g->pending_head + 1) % MAX_PENDING;
+    g->num_pending--;
+  }
+
+  // All lockages up to t_end have been handed out only if we did not stop
+  // because the output was full.
+  if (n < max_lockages)
+    g->horizon = fmax(g->horizon, t_end);
+
+  *num_lockages = n;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_lockage_generator_stats(const zsf_lockage_generator_t *g,
+                                             zsf_traffic_stats_t *stats) {
+  stats->num_ships = g->num_ships;
+  stats->num_lockings = g->num_lockings;
+  stats->mean_wait = g->num_ships > 0.0 ? g->sum_wait / g->num_ships : 0.0;
+  stats->max_wait = g->max_wait;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_run_lockages(const zsf_param_t *p, zsf_lockage_generator_t *g, double t_end,
+                                  zsf_phase_state_t *state, zsf_results_t *results) {
+  double t_start = g->horizon;
+  if (!(t_end > t_start))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  zsf_lockage_t lockages[BATCH_SIZE];
+  zsf_phase_transports_t transports[BATCH_SIZE];
+
+  aggregate_t totals;
+  aggregate_reset(&totals);
+
+  while (1) {
+    int n;
+    int err = zsf_lockage_generator_next(g, t_end, BATCH_SIZE, lockages, &n);
+    if (!err)
+      err = zsf_step_lockages(p, n, lockages, state, transports);
+    if (err)
+      return err;
+
+    for (int i = 0; i < n; i++)
+      aggregate_add(&totals, &transports[i]);
+
+    if (n < BATCH_SIZE)
+      break;
+  }
+
+  aggregate_finish_results(&totals, t_end - t_start, results);
+  return ZSF_SUCCESS;
+}
@@ -0,0 +1,261 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aggregate.h"
+#include "errors.h"
+#include "stepper.h"
+#include "zsf.h"
+
+// Discrete-event engine for networks of locks
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Every lock only has events at the starts of its lockages, which is also
+// where the previous phase ends. The next event of every lock is kept in a
+// min-heap, so each event costs O(log(num_locks)) on top of the
+// stepping of its lockage. The lockages of a lock are fetched from its
+// generator in small batches, regardless of the output times, so that the
+// events between two outputs only touch the locks they belong to. Every
+// output then credits all locks up to the output time, as each of them
+// reports its transports.
+//
+// The transports of a phase are spread evenly over its duration, and
+// credited to the output intervals it overlaps. A lock keeps track of the
+// time up to which its current phase has been credited, so that a phase
+// that spans several output intervals is split over them.
+
+// A single visit of the lock to one of its sides results in at most four
+// lockages, which is a natural batch size for the generators.
+#define LOCKAGE_BATCH 4
+
+typedef struct event_t {
+  double time;
+  int lock;
+} event_t;
+
+// The stepper of a lock directly follows it in memory, such that an event
+// touches as few cache lines as possible.
+typedef struct network_lock_t {
+  zsf_phase_state_t state;
+  zsf_lockage_generator_t *generator;
+
+  // Lockages fetched from the generator, but not stepped yet
+  zsf_lockage_t lockages[LOCKAGE_BATCH];
+  int next_lockage;
+  int num_lockages;
+
+  // The phase in progress (or the last one), credited up to t_credited
+  zsf_phase_transports_t phase;
+  double t_start;
+  double t_end;
+  double t_credited;
+
+  // Transports over the current output interval
+  aggregate_t totals;
+} network_lock_t;
+
+struct zsf_network_t {
+  int num_locks;
+  size_t lock_size;
+  char *locks;
+  event_t *heap;
+
+  double dt_output;
+  double time;
+  int err;
+};
+
+static network_lock_t *get_lock(const zsf_network_t *n, int i) {
+  return (network_lock_t *)(n->locks + i * n->lock_size);
+}
+
+static stepper_t *get_stepper(network_lock_t *l) { return (stepper_t *)(l + 1); }
+
+// Min-heap of events, with ties broken by lock for reproducibility. The heap
+// is 4-ary, as the children of a node then share a cache line, and the heap
+// is only half as deep as a binary one.
+#define HEAP_ARITY 4
+
+static int event_before(const event_t *a, const event_t *b) {
+  return a->time < b->time || (a->time == b->time && a->lock < b->lock);
+}
+
+static void sift_down(event_t *heap, int n, int i) {
+  event_t e = heap[i];
+  while (1) {
+    int first = HEAP_ARITY * i + 1;
+    if (first >= n)
+      break;
+
+    int c = first;
+    int last = (first + HEAP_ARITY < n) ? first + HEAP_ARITY : n;
+    for (int j = first + 1; j < last; j++) {
+      if (event_before(&heap[j], &heap[c]))
+        c = j;
+    }
+    if (!event_before(&heap[c], &e))
+      break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = e;
+}
+
+static void heapify(event_t *heap, int n) {
+  for (int i = (n - 2) / HEAP_ARITY; i >= 0; i--)
+    sift_down(heap, n, i);
+}
+
+// The time of the next lockage of a lock, fetching the next lockages from
+// its generator if it has none left. Without any, the time is infinite.
+static int next_event(network_lock_t *l, double *time) {
+  if (l->next_lockage == l->num_lockages) {
+    int n;
+    int err = zsf_lockage_generator_next(l->generator, INFINITY, LOCKAGE_BATCH, l->lockages, &n);
+    if (err)
+      return err;
+    l->next_lockage = 0;
+    l->num_lockages = n;
+  }
+
+  *time = (l->next_lockage < l->num_lockages) ? l->lockages[l->next_lockage].time : INFINITY;
+  return ZSF_SUCCESS;
+}
+
+// Credits the part of the current phase up to time t
+static void credit(network_lock_t *l, double t) {
+  double t_credit = fmin(t, l->t_end);
+  if (!(t_credit > l->t_credited))
+    return;
+
+  double f = (t_credit - l->t_credited) / (l->t_end - l->t_start);
+  zsf_phase_transports_t tp = l->phase;
+  tp.mass_transport_lake *= f;
+  tp.volume_from_lake *= f;
+  tp.volume_to_lake *= f;
+  tp.mass_transport_sea *= f;
+  tp.volume_from_sea *= f;
+  tp.volume_to_sea *= f;
+  aggregate_add(&l->totals, &tp);
+
+  l->t_credited = t_credit;
+}
+
+static int process_event(network_lock_t *l) {
+  const zsf_lockage_t *lockage = &l->lockages[l->next_lockage++];
+
+  // The previous phase has ended by now
+  credit(l, l->t_end);
+
+  zsf_phase_transports_t tp;
+  int err = stepper_step(get_stepper(l), lockage, &l->state, &tp);
+  if (err)
+    return err;
+
+  if (lockage->duration > 0.0) {
+    l->phase = tp;
+    l->t_start = lockage->time;
+    l->t_end = lockage->time + lockage->duration;
+    l->t_credited = l->t_start;
+  } else {
+    aggregate_add(&l->totals, &tp);
+  }
+  return ZSF_SUCCESS;
+}
+
+void ZSF_CALLCONV zsf_network_free(zsf_network_t *network) {
+  if (network == NULL)
+    return;
+
+  free(network->locks);
+  free(network->heap);
+  free(network);
+}
+
+int ZSF_CALLCONV zsf_network_create(int num_locks, const zsf_param_t *p,
+                                    const zsf_phase_state_t *states,
+                                    zsf_lockage_generator_t *const *generators, double dt_output,
+                                    zsf_network_t **network) {
+  *network = NULL;
+  if (num_locks < 1 || !(dt_output > 0.0))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  zsf_network_t *n = calloc(1, sizeof(zsf_network_t));
+  if (n == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  n->num_locks = num_locks;
+  n->dt_output = dt_output;
+  n->lock_size = sizeof(network_lock_t) + stepper_size();
+  n->locks = calloc(num_locks, n->lock_size);
+  n->heap = malloc(num_locks * sizeof(event_t));
+  if (n->locks == NULL || n->heap == NULL) {
+    zsf_network_free(n);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  int err = ZSF_SUCCESS;
+  for (int i = 0; i < num_locks && !err; i++) {
+    network_lock_t *l = get_lock(n, i);
+    stepper_set_param(get_stepper(l), &p[i]);
+    l->state = states[i];
+    l->generator = generators[i];
+    aggregate_reset(&l->totals);
+
+    n->heap[i].lock = i;
+    err = next_event(l, &n->heap[i].time);
+  }
+
+  if (err) {
+    zsf_network_free(n);
+    return err;
+  }
+
+  heapify(n->heap, num_locks);
+  *network = n;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_network_set_param(zsf_network_t *network, int lock, const zsf_param_t *p) {
+  if (lock < 0 || lock >= network->num_locks)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  stepper_set_param(get_stepper(get_lock(network, lock)), p);
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_network_advance(zsf_network_t *network, zsf_phase_transports_t *transports) {
+  zsf_network_t *n = network;
+  double t_output = n->time + n->dt_output;
+
+  while (!n->err && n->heap[0].time < t_output) {
+    network_lock_t *l = get_lock(n, n->heap[0].lock);
+    n->err = process_event(l);
+    if (!n->err)
+      n->err = next_event(l, &n->heap[0].time);
+    sift_down(n->heap, n->num_locks, 0);
+  }
+
+  // Once failed, the network cannot be advanced any further
+  if (n->err) {
+    memset(transports, 0, n->num_locks * sizeof(zsf_phase_transports_t));
+    return n->err;
+  }
+
+  for (int i = 0; i < n->num_locks; i++) {
+    network_lock_t *l = get_lock(n, i);
+    credit(l, t_output);
+    aggregate_finish(&l->totals, n->dt_output, &transports[i]);
+    aggregate_reset(&l->totals);
+  }
+  n->time = t_output;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_network_state(const zsf_network_t *network, int lock,
+                                   zsf_phase_state_t *state) {
+  if (lock < 0 || lock >= network->num_locks)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  *state = get_lock(network, lock)->state;
+  return ZSF_SUCCESS;
+}
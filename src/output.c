@@ -0,0 +1,718 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "threads.h"
+#include "zsf.h"
+
+#define OUTPUT_MAGIC "ZSFCOLS"
+#define CHUNK_MAGIC "ZSFCHNK"
+
+#define NUM_RECORD_COLUMNS (sizeof(zsf_output_record_t) / sizeof(double))
+#define NAME_LENGTH 32
+#define MAX_COLUMNS 1024
+
+// Keep the counters written by different threads on different cache lines
+#define CACHE_LINE 64
+
+// Layout (native endianness):
+//   file_header_t
+//   char[num_columns][NAME_LENGTH]      column names
+//   for every chunk:
+//     chunk_header_t
+//     column_info_t[num_columns]
+//     the encoded columns, one after the other
+//
+// There is no index at the end of the file, so that all chunks that were
+// written completely can be read even if the run was aborted. Writers flush
+// every chunk, and readers find the chunks by skipping from chunk header to
+// chunk header instead, up to a last chunk that was cut off.
+typedef struct file_header_t {
+  char magic[8];
+  int32_t version;
+  int32_t num_columns;
+  int32_t chunk_rows;
+  int32_t reserved[3];
+} file_header_t;
+
+typedef struct chunk_header_t {
+  char magic[8];
+  int32_t num_rows;
+  int32_t num_columns;
+} chunk_header_t;
+
+typedef struct column_info_t {
+  double min;
+  double max;
+  int64_t size;
+} column_info_t;
+
+#define OUTPUT_COLUMNS(X) X(time) X(lock) X(routine) ZSF_TRANSPORTS_FIELDS(X)
+
+typedef char output_columns_complete
+    [NUM_RECORD_COLUMNS == (0 OUTPUT_COLUMNS(ZSF_FIELD_COUNT)) ? 1 : -1];
+
+#define ZSF_FIELD_NAME(NAME) #NAME,
+static const char *const column_names[] = {OUTPUT_COLUMNS(ZSF_FIELD_NAME)};
+#undef ZSF_FIELD_NAME
+
+// 64-bit file offsets, as output files easily exceed 2 GB
+static int file_seek(FILE *f, int64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(f, offset, SEEK_SET);
+#else
+  return fseeko(f, (off_t)offset, SEEK_SET);
+#endif
+}
+
+static int64_t file_size(FILE *f) {
+#if defined(_WIN32)
+  if (_fseeki64(f, 0, SEEK_END) != 0)
+    return -1;
+  return _ftelli64(f);
+#else
+  if (fseeko(f, 0, SEEK_END) != 0)
+    return -1;
+  return ftello(f);
+#endif
+}
+
+// Compression
+// ~~~~~~~~~~~
+// Every value is XORed with its predecessor in the column, which zeroes the
+// sign, exponent and leading mantissa bits of slowly varying (or constant)
+// series. The results are split into byte planes, most significant byte
+// first, so that these zeros end up in long runs, and every plane is run
+// length encoded: a control byte c < 128 is followed by c + 1 literal bytes,
+// and c >= 128 by a byte that repeats c - 128 + MIN_RUN times.
+#define NUM_PLANES 8
+#define MIN_RUN 3
+#define MAX_RUN (127 + MIN_RUN)
+#define MAX_LITERAL 128
+
+// Worst case size of an encoded column, i.e. all literals
+static size_t encoded_capacity(int n) {
+  return NUM_PLANES * ((size_t)n + n / MAX_LITERAL + 1);
+}
+
+static size_t rle_encode(const unsigned char *in, int n, unsigned char *out) {
+  size_t size = 0;
+  int i = 0;
+
+  while (i < n) {
+    int run = 1;
+    while (i + run < n && run < MAX_RUN && in[i + run] == in[i])
+      run++;
+
+    if (run >= MIN_RUN) {
+      out[size++] = (unsigned char)(128 + run - MIN_RUN);
+      out[size++] = in[i];
+      i += run;
+      continue;
+    }
+
+    // Literals up to the start of the next run
+    int start = i;
+    while (i < n && i - start < MAX_LITERAL) {
+      if (i + MIN_RUN - 1 < n && in[i] == in[i + 1] && in[i] == in[i + 2])
+        break;
+      i++;
+    }
+    out[size++] = (unsigned char)(i - start - 1);
+    memcpy(out + size, in + start, i - start);
+    size += i - start;
+  }
+
+  return size;
+}
+
+// Decodes exactly n bytes, and returns the number of bytes consumed, or 0 if
+// the input is malformed
+static size_t rle_decode(const unsigned char *in, size_t size, int n, unsigned char *out) {
+  size_t pos = 0;
+  int i = 0;
+
+  while (i < n) {
+    if (pos >= size)
+      return 0;
+    int c = in[pos++];
+
+    if (c >= 128) {
+      int run = c - 128 + MIN_RUN;
+      if (pos >= size || run > n - i)
+        return 0;
+      memset(out + i, in[pos++], run);
+      i += run;
+    } else {
+      int len = c + 1;
+      if (len > n - i || (size_t)len > size - pos)
+        return 0;
+      memcpy(out + i, in + pos, len);
+      pos += len;
+      i += len;
+    }
+  }
+
+  return pos;
+}
+
+static uint64_t double_bits(double x) {
+  uint64_t u;
+  memcpy(&u, &x, sizeof(u));
+  return u;
+}
+
+static size_t encode_column(const double *values, int n, unsigned char *plane,
+                            unsigned char *out) {
+  size_t size = 0;
+
+  for (int b = 0; b < NUM_PLANES; b++) {
+    int shift = 8 * (NUM_PLANES - 1 - b);
+    uint64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+      uint64_t u = double_bits(values[i]);
+      plane[i] = (unsigned char)((u ^ prev) >> shift);
+      prev = u;
+    }
+    size += rle_encode(plane, n, out + size);
+  }
+
+  return size;
+}
+
+static int decode_column(const unsigned char *in, size_t size, int n, unsigned char *plane,
+                         uint64_t *bits, double *values) {
+  memset(bits, 0, n * sizeof(uint64_t));
+
+  for (int b = 0; b < NUM_PLANES; b++) {
+    size_t used = rle_decode(in, size, n, plane);
+    if (used == 0 && n > 0)
+      return ZSF_ERR_FILE_FORMAT;
+    in += used;
+    size -= used;
+
+    int shift = 8 * (NUM_PLANES - 1 - b);
+    for (int i = 0; i < n; i++)
+      bits[i] |= (uint64_t)plane[i] << shift;
+  }
+  if (size != 0)
+    return ZSF_ERR_FILE_FORMAT;
+
+  uint64_t prev = 0;
+  for (int i = 0; i < n; i++) {
+    prev ^= bits[i];
+    memcpy(&values[i], &prev, sizeof(double));
+  }
+
+  return ZSF_SUCCESS;
+}
+
+// Writer
+// ~~~~~~
+// Every producer owns the head of its ring buffer, and the writer thread
+// owns the tails. The counters only ever increase, so the number of records
+// in a ring is their difference, also when they wrap.
+typedef struct ring_t {
+  // Written by the producer
+  volatile long head;
+  char pad_producer[CACHE_LINE];
+
+  // Written by the writer
+  volatile long tail;
+  char pad_writer[CACHE_LINE];
+
+  double *rows;
+} ring_t;
+
+struct zsf_output_t {
+  // Written by the host
+  volatile long stop;
+  char pad_host[CACHE_LINE];
+
+  // Written by the writer
+  volatile long err;
+  char pad_writer[CACHE_LINE];
+
+  ring_t *rings;
+  int num_producers;
+  unsigned long capacity;
+  int num_columns;
+
+  // Owned by the writer
+  FILE *f;
+  int chunk_rows;
+  int num_rows;
+  double *columns; // num_columns x chunk_rows
+  column_info_t *info;
+  unsigned char *plane;
+  unsigned char *encoded;
+
+  thread_t thread;
+  thread_start_t start;
+};
+
+static int write_chunk(zsf_output_t *o) {
+  int n = o->num_rows;
+  chunk_header_t h;
+  column_info_t *info = o->info;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, CHUNK_MAGIC, 8);
+  h.num_rows = n;
+  h.num_columns = o->num_columns;
+
+  size_t size = 0;
+  for (int c = 0; c < o->num_columns; c++) {
+    const double *values = &o->columns[c * o->chunk_rows];
+
+    // NaNs are ignored by fmin/fmax, so they never match a range
+    info[c].min = INFINITY;
+    info[c].max = -INFINITY;
+    for (int i = 0; i < n; i++) {
+      info[c].min = fmin(info[c].min, values[i]);
+      info[c].max = fmax(info[c].max, values[i]);
+    }
+
+    size_t column_size = encode_column(values, n, o->plane, o->encoded + size);
+    info[c].size = (int64_t)column_size;
+    size += column_size;
+  }
+
+  // Flush every part, so that an aborted run leaves at most the last chunk
+  // incomplete, and never a complete chunk in the buffer of the stream
+  int ok = fwrite(&h, sizeof(h), 1, o->f) == 1;
+  ok = ok && fwrite(info, sizeof(column_info_t), o->num_columns, o->f) == (size_t)o->num_columns;
+  ok = ok && fflush(o->f) == 0;
+  ok = ok && fwrite(o->encoded, 1, size, o->f) == size;
+  ok = ok && fflush(o->f) == 0;
+
+  o->num_rows = 0;
+  return ok ? ZSF_SUCCESS : ZSF_ERR_IO;
+}
+
+// Copy the rows in a ring buffer into the columns of the current chunk.
+// The records are released before a full chunk is written, so that the
+// producer can continue while the writer does the I/O.
+static long drain(zsf_output_t *o, ring_t *r) {
+  unsigned long tail = (unsigned long)r->tail;
+  unsigned long head = (unsigned long)atomic_load_acquire(&r->head);
+  unsigned long mask = o->capacity - 1;
+
+  for (unsigned long k = tail; k != head; k++) {
+    const double *row = &r->rows[(k & mask) * o->num_columns];
+    for (int c = 0; c < o->num_columns; c++)
+      o->columns[c * o->chunk_rows + o->num_rows] = row[c];
+
+    if (++o->num_rows == o->chunk_rows) {
+      atomic_store_release(&r->tail, (long)(k + 1));
+
+      // After an error the records are discarded, so that producers never
+      // wait for a writer that has given up
+      if (!o->err) {
+        int err = write_chunk(o);
+        if (err)
+          atomic_store_release(&o->err, err);
+      }
+      o->num_rows = 0;
+    }
+  }
+  atomic_store_release(&r->tail, (long)head);
+
+  return (long)(head - tail);
+}
+
+static void writer(void *arg) {
+  zsf_output_t *o = arg;
+  backoff_t b = {0};
+
+  while (1) {
+    // Read the stop flag before draining, as all records pushed before it
+    // was set have to be written
+    long stop = atomic_load_acquire(&o->stop);
+
+    long drained = 0;
+    for (int i = 0; i < o->num_producers; i++)
+      drained += drain(o, &o->rings[i]);
+
+    if (drained > 0) {
+      b.count = 0;
+    } else if (stop) {
+      break;
+    } else {
+      backoff_wait(&b);
+    }
+  }
+
+  if (o->num_rows > 0 && !o->err) {
+    int err = write_chunk(o);
+    if (err)
+      atomic_store_release(&o->err, err);
+  }
+}
+
+static void output_free(zsf_output_t *o) {
+  if (o->rings != NULL) {
+    for (int i = 0; i < o->num_producers; i++)
+      free(o->rings[i].rows);
+  }
+  free(o->rings);
+  free(o->columns);
+  free(o->info);
+  free(o->plane);
+  free(o->encoded);
+  free(o);
+}
+
+int ZSF_CALLCONV zsf_output_open_columns(const char *path, int num_columns,
+                                         const char *const *column_names, int num_producers,
+                                         int ring_capacity, int chunk_rows,
+                                         zsf_output_t **output) {
+  *output = NULL;
+  if (num_columns < 1 || num_columns > MAX_COLUMNS || num_producers < 1 || ring_capacity < 1 ||
+      (ring_capacity & (ring_capacity - 1)) != 0 || chunk_rows < 1)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  for (int c = 0; c < num_columns; c++) {
+    if (strlen(column_names[c]) >= NAME_LENGTH)
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  zsf_output_t *o = calloc(1, sizeof(zsf_output_t));
+  if (o == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  o->num_producers = num_producers;
+  o->capacity = (unsigned long)ring_capacity;
+  o->num_columns = num_columns;
+  o->chunk_rows = chunk_rows;
+
+  o->rings = calloc(num_producers, sizeof(ring_t));
+  o->columns = malloc((size_t)num_columns * chunk_rows * sizeof(double));
+  o->info = malloc(num_columns * sizeof(column_info_t));
+  o->plane = malloc(chunk_rows);
+  o->encoded = malloc(num_columns * encoded_capacity(chunk_rows));
+  int ok = o->rings != NULL && o->columns != NULL && o->info != NULL && o->plane != NULL &&
+           o->encoded != NULL;
+  for (int i = 0; ok && i < num_producers; i++) {
+    o->rings[i].rows = malloc((size_t)ring_capacity * num_columns * sizeof(double));
+    ok = o->rings[i].rows != NULL;
+  }
+
+  char(*names)[NAME_LENGTH] = calloc(num_columns, NAME_LENGTH);
+  if (!ok || names == NULL) {
+    free(names);
+    output_free(o);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  o->f = fopen(path, "wb");
+  if (o->f == NULL) {
+    free(names);
+    output_free(o);
+    return ZSF_ERR_IO;
+  }
+
+  file_header_t h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, OUTPUT_MAGIC, 8);
+  h.version = ZSF_OUTPUT_VERSION;
+  h.num_columns = num_columns;
+  h.chunk_rows = chunk_rows;
+
+  for (int c = 0; c < num_columns; c++)
+    strcpy(names[c], column_names[c]);
+
+  ok = fwrite(&h, sizeof(h), 1, o->f) == 1 &&
+       fwrite(names, NAME_LENGTH, num_columns, o->f) == (size_t)num_columns &&
+       fflush(o->f) == 0;
+  free(names);
+  if (!ok) {
+    fclose(o->f);
+    output_free(o);
+    return ZSF_ERR_IO;
+  }
+
+  if (thread_create(&o->thread, &o->start, writer, o)) {
+    fclose(o->f);
+    output_free(o);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  *output = o;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_output_open(const char *path, int num_producers, int ring_capacity,
+                                 int chunk_rows, zsf_output_t **output) {
+  return zsf_output_open_columns(path, NUM_RECORD_COLUMNS, column_names, num_producers,
+                                 ring_capacity, chunk_rows, output);
+}
+
+int ZSF_CALLCONV zsf_output_push_rows(zsf_output_t *o, int producer, int num_rows,
+                                      const double *rows) {
+  if (producer < 0 || producer >= o->num_producers || num_rows < 0)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  ring_t *r = &o->rings[producer];
+  unsigned long head = (unsigned long)r->head;
+  unsigned long mask = o->capacity - 1;
+  size_t row_size = o->num_columns * sizeof(double);
+  int i = 0;
+
+  while (i < num_rows) {
+    // Only wait for the writer when the ring is full
+    backoff_t b = {0};
+    unsigned long room;
+    while ((room = o->capacity - (head - (unsigned long)atomic_load_acquire(&r->tail))) == 0) {
+      if (atomic_load_acquire(&o->err))
+        return (int)o->err;
+      backoff_wait(&b);
+    }
+
+    int n = (room < (unsigned long)(num_rows - i)) ? (int)room : num_rows - i;
+    for (int k = 0; k < n; k++)
+      memcpy(&r->rows[((head + k) & mask) * o->num_columns],
+             &rows[(size_t)(i + k) * o->num_columns], row_size);
+
+    head += n;
+    i += n;
+    atomic_store_release(&r->head, (long)head);
+  }
+
+  return (int)atomic_load_acquire(&o->err);
+}
+
+// A record is a row of doubles
+int ZSF_CALLCONV zsf_output_push(zsf_output_t *o, int producer, int num_records,
+                                 const zsf_output_record_t *records) {
+  if (o->num_columns != (int)NUM_RECORD_COLUMNS)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  return zsf_output_push_rows(o, producer, num_records, (const double *)records);
+}
+
+int ZSF_CALLCONV zsf_output_close(zsf_output_t *o) {
+  if (o == NULL)
+    return ZSF_SUCCESS;
+
+  atomic_store_release(&o->stop, 1);
+  thread_join(o->thread);
+
+  int err = (int)o->err;
+  if (fclose(o->f) != 0 && !err)
+    err = ZSF_ERR_IO;
+
+  output_free(o);
+  return err;
+}
+
+// Reader
+// ~~~~~~
+typedef struct chunk_t {
+  int64_t offset; // Of the first encoded column
+  int num_rows;
+} chunk_t;
+
+struct zsf_output_reader_t {
+  FILE *f;
+  int num_columns;
+  char (*names)[NAME_LENGTH];
+
+  int num_chunks;
+  chunk_t *chunks;
+  column_info_t *info; // num_chunks x num_columns
+
+  // Decoding buffers, sized to the largest chunk
+  int max_rows;
+  unsigned char *encoded;
+  unsigned char *plane;
+  uint64_t *bits;
+};
+
+static int reader_add_chunk(zsf_output_reader_t *r, int *capacity, int64_t offset, int num_rows,
+                            const column_info_t *info) {
+  if (r->num_chunks == *capacity) {
+    int n = *capacity > 0 ? 2 * *capacity : 64;
+    chunk_t *chunks = realloc(r->chunks, n * sizeof(chunk_t));
+    if (chunks == NULL)
+      return ZSF_ERR_OUT_OF_MEMORY;
+    r->chunks = chunks;
+
+    column_info_t *all_info = realloc(r->info, (size_t)n * r->num_columns * sizeof(column_info_t));
+    if (all_info == NULL)
+      return ZSF_ERR_OUT_OF_MEMORY;
+    r->info = all_info;
+
+    *capacity = n;
+  }
+
+  r->chunks[r->num_chunks].offset = offset;
+  r->chunks[r->num_chunks].num_rows = num_rows;
+  memcpy(&r->info[(size_t)r->num_chunks * r->num_columns], info,
+         r->num_columns * sizeof(column_info_t));
+  r->num_chunks++;
+
+  if (num_rows > r->max_rows)
+    r->max_rows = num_rows;
+  return ZSF_SUCCESS;
+}
+
+// Find the chunks. A chunk, chunk header or column info that extends past the
+// end of the file was not written completely, e.g. because the run was
+// aborted, and ends the scan.
+static int reader_scan(zsf_output_reader_t *r, int64_t offset, int64_t end) {
+  int capacity = 0;
+  size_t info_size = r->num_columns * sizeof(column_info_t);
+  column_info_t *info = malloc(info_size);
+  if (info == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  int err = ZSF_SUCCESS;
+  while (!err && end - offset >= (int64_t)(sizeof(chunk_header_t) + info_size)) {
+    chunk_header_t h;
+    if (file_seek(r->f, offset) != 0 || fread(&h, sizeof(h), 1, r->f) != 1 ||
+        fread(info, info_size, 1, r->f) != 1) {
+      err = ZSF_ERR_IO;
+      break;
+    }
+    if (memcmp(h.magic, CHUNK_MAGIC, 8) != 0 || h.num_rows < 0 || h.num_columns != r->num_columns) {
+      err = ZSF_ERR_FILE_FORMAT;
+      break;
+    }
+
+    int64_t data = offset + sizeof(chunk_header_t) + info_size;
+    int64_t size = 0;
+    for (int c = 0; c < r->num_columns; c++) {
+      if (info[c].size < 0 || (uint64_t)info[c].size > encoded_capacity(h.num_rows))
+        err = ZSF_ERR_FILE_FORMAT;
+      size += info[c].size;
+    }
+    if (err || data + size > end)
+      break;
+
+    err = reader_add_chunk(r, &capacity, data, h.num_rows, info);
+    offset = data + size;
+  }
+
+  free(info);
+  return err;
+}
+
+int ZSF_CALLCONV zsf_output_reader_open(const char *path, zsf_output_reader_t **reader) {
+  *reader = NULL;
+
+  zsf_output_reader_t *r = calloc(1, sizeof(zsf_output_reader_t));
+  if (r == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  r->f = fopen(path, "rb");
+  if (r->f == NULL) {
+    free(r);
+    return ZSF_ERR_IO;
+  }
+
+  int err = ZSF_SUCCESS;
+  file_header_t h;
+  if (fread(&h, sizeof(h), 1, r->f) != 1 || memcmp(h.magic, OUTPUT_MAGIC, 8) != 0 ||
+      h.version != ZSF_OUTPUT_VERSION || h.num_columns < 1 || h.num_columns > MAX_COLUMNS)
+    err = ZSF_ERR_FILE_FORMAT;
+
+  if (!err) {
+    r->num_columns = h.num_columns;
+    r->names = malloc(h.num_columns * sizeof(*r->names));
+    if (r->names == NULL)
+      err = ZSF_ERR_OUT_OF_MEMORY;
+    else if (fread(r->names, sizeof(*r->names), h.num_columns, r->f) != (size_t)h.num_columns)
+      err = ZSF_ERR_FILE_FORMAT;
+  }
+
+  if (!err) {
+    for (int c = 0; c < r->num_columns; c++)
+      r->names[c][NAME_LENGTH - 1] = '\0';
+
+    int64_t offset = sizeof(file_header_t) + (int64_t)h.num_columns * NAME_LENGTH;
+    int64_t end = file_size(r->f);
+    err = end < 0 ? ZSF_ERR_IO : reader_scan(r, offset, end);
+  }
+
+  if (!err) {
+    size_t n = r->max_rows > 0 ? r->max_rows : 1;
+    r->encoded = malloc(encoded_capacity((int)n));
+    r->plane = malloc(n);
+    r->bits = malloc(n * sizeof(uint64_t));
+    if (r->encoded == NULL || r->plane == NULL || r->bits == NULL)
+      err = ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  if (err) {
+    zsf_output_reader_free(r);
+    return err;
+  }
+
+  *reader = r;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_output_reader_num_columns(const zsf_output_reader_t *r) {
+  return r->num_columns;
+}
+
+const char *ZSF_CALLCONV zsf_output_reader_column_name(const zsf_output_reader_t *r, int column) {
+  if (column < 0 || column >= r->num_columns)
+    return NULL;
+  return r->names[column];
+}
+
+int ZSF_CALLCONV zsf_output_reader_num_chunks(const zsf_output_reader_t *r) {
+  return r->num_chunks;
+}
+
+int ZSF_CALLCONV zsf_output_reader_chunk_info(const zsf_output_reader_t *r, int chunk, int column,
+                                              int *num_rows, double *min, double *max) {
+  if (chunk < 0 || chunk >= r->num_chunks || column < 0 || column >= r->num_columns)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  const column_info_t *info = &r->info[(size_t)chunk * r->num_columns + column];
+  *num_rows = r->chunks[chunk].num_rows;
+  *min = info->min;
+  *max = info->max;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_output_reader_read(zsf_output_reader_t *r, int chunk, int column,
+                                        double *values) {
+  if (chunk < 0 || chunk >= r->num_chunks || column < 0 || column >= r->num_columns)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  const column_info_t *info = &r->info[(size_t)chunk * r->num_columns];
+  int64_t offset = r->chunks[chunk].offset;
+  for (int c = 0; c < column; c++)
+    offset += info[c].size;
+
+  size_t size = (size_t)info[column].size;
+  if (file_seek(r->f, offset) != 0 || fread(r->encoded, 1, size, r->f) != size)
+    return ZSF_ERR_IO;
+
+  return decode_column(r->encoded, size, r->chunks[chunk].num_rows, r->plane, r->bits, values);
+}
+
+void ZSF_CALLCONV zsf_output_reader_free(zsf_output_reader_t *r) {
+  if (r == NULL)
+    return;
+
+  if (r->f != NULL)
+    fclose(r->f);
+  free(r->names);
+  free(r->chunks);
+  free(r->info);
+  free(r->encoded);
+  free(r->plane);
+  free(r->bits);
+  free(r);
+}
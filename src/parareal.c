@@ -0,0 +1,210 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "errors.h"
+#include "threads.h"
+#include "zsf.h"
+
+// Parallel-in-time replay of a sequence of lockages
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The sequence is split into one chunk per thread, which are all stepped at
+// once from an estimate of the state at their start. The head and the ship
+// volume in the lock only depend on the lockages, so the only unknown is
+// the salinity of the lock. Every lock exchange replaces most of the water
+// in the lock, so it forgets its past salinity within a few lockings. We
+// therefore estimate the salinity at the start of a chunk by stepping
+// through the last few lockages before it, starting at an arbitrary
+// salinity. A chunk that turns out to have started at a salinity different
+// from the one at the end of the chunk before it is stepped again, until
+// all chunks connect. The first chunk is always exact, and so is every
+// chunk restarted from an exact one, so this takes at most as many rounds
+// as there are chunks. Usually it takes one.
+
+// Number of lockages stepped to estimate the salinity at the start of a
+// chunk, and the minimum length of a chunk
+#define NUM_WARMUP_LOCKAGES 64
+#define MIN_CHUNK_LOCKAGES (16 * NUM_WARMUP_LOCKAGES)
+
+typedef struct chunk_t {
+  const zsf_param_t *p;
+  const zsf_lockage_t *lockages;
+  const zsf_phase_state_t *initial;
+  zsf_phase_transports_t *transports;
+  int begin;
+  int end;
+
+  int estimate; // whether to estimate the state at the start first
+  zsf_phase_state_t start;
+  zsf_phase_state_t state;
+  int err;
+
+  thread_t thread;
+  thread_start_t thread_start;
+} chunk_t;
+
+// The state before lockage i of the sequence, with the given salinity
+static void state_before(const chunk_t *c, int i, double salinity, zsf_phase_state_t *state) {
+  const zsf_param_t *p = c->p;
+  int have_head = 0;
+  int have_ship = 0;
+
+  state->head_lock = c->initial->head_lock;
+  state->volume_ship_in_lock = c->initial->volume_ship_in_lock;
+
+  for (int j = i - 1; j >= 0 && !(have_head && have_ship); j--) {
+    const zsf_lockage_t *l = &c->lockages[j];
+    int routine = (int)l->routine;
+    if (!have_head && (routine == 1 || routine == 3)) {
+      state->head_lock = (routine == 1) ? p->head_lake : p->head_sea;
+      have_head = 1;
+    }
+    if (!have_ship && (routine == 2 || routine == 4)) {
+      state->volume_ship_in_lock =
+          (routine == 2) ? l->ship_volume_lake_to_sea : l->ship_volume_sea_to_lake;
+      have_ship = 1;
+    }
+  }
+
+  // The same salt mass as the phase kernels calculate from the salinity
+  state->salinity_lock = salinity;
+  state->saltmass_lock =
+      salinity * (p->lock_length * p->lock_width * (state->head_lock - p->lock_bottom) -
+                  state->volume_ship_in_lock);
+}
+
+static int is_close(const zsf_param_t *p, double a, double b) {
+  return fabs(a - b) <= p->atol + p->rtol * fabs(b);
+}
+
+// Estimate the state at the start of a chunk from the lockages before it.
+// Starting from a low and a high salinity, the true salinity lies in
+// between the two, so we double the number of lockages until they meet.
+static void estimate_start(chunk_t *c) {
+  const zsf_param_t *p = c->p;
+  double sal_diff = p->salinity_sea - p->salinity_lake;
+
+  for (int n = NUM_WARMUP_LOCKAGES;; n *= 2) {
+    int warmup = (c->begin > n) ? c->begin - n : 0;
+    zsf_phase_state_t low, high;
+    if (warmup == 0) {
+      low = *c->initial;
+      high = *c->initial;
+    } else {
+      state_before(c, warmup, p->salinity_lake + 0.01 * sal_diff, &low);
+      state_before(c, warmup, p->salinity_sea - 0.01 * sal_diff, &high);
+    }
+
+    if (zsf_step_lockages(p, c->begin - warmup, c->lockages + warmup, &low, NULL) ||
+        zsf_step_lockages(p, c->begin - warmup, c->lockages + warmup, &high, NULL)) {
+      // Errors are reported by the chunk these lockages belong to
+      state_before(c, c->begin, c->initial->salinity_lock, &c->start);
+      return;
+    }
+
+    // Beyond the length of the chunk it is cheaper to restart it later on
+    if (warmup == 0 || n >= c->end - c->begin ||
+        is_close(p, low.salinity_lock, high.salinity_lock)) {
+      state_before(c, c->begin, 0.5 * (low.salinity_lock + high.salinity_lock), &c->start);
+      return;
+    }
+  }
+}
+
+static void step_chunk(void *arg) {
+  chunk_t *c = arg;
+
+  if (c->estimate) {
+    estimate_start(c);
+    c->estimate = 0;
+  }
+
+  c->state = c->start;
+  c->err = zsf_step_lockages(c->p, c->end - c->begin, c->lockages + c->begin, &c->state,
+                             c->transports ? c->transports + c->begin : NULL);
+}
+
+int ZSF_CALLCONV zsf_step_lockages_parallel(const zsf_param_t *p, int num_lockages,
+                                            const zsf_lockage_t *lockages,
+                                            zsf_phase_state_t *state,
+                                            zsf_phase_transports_t *transports,
+                                            int num_threads) {
+  if (num_lockages < 0 || num_threads < 1) {
+    return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  int num_chunks = num_lockages / MIN_CHUNK_LOCKAGES;
+  num_chunks = (num_chunks < num_threads) ? num_chunks : num_threads;
+  if (num_chunks <= 1) {
+    return zsf_step_lockages(p, num_lockages, lockages, state, transports);
+  }
+
+  chunk_t *chunks = calloc(num_chunks, sizeof(chunk_t));
+  int *todo = malloc(num_chunks * sizeof(int));
+  if (chunks == NULL || todo == NULL) {
+    free(chunks);
+    free(todo);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  for (int k = 0; k < num_chunks; k++) {
+    chunk_t *c = &chunks[k];
+    c->p = p;
+    c->lockages = lockages;
+    c->initial = state;
+    c->transports = transports;
+    c->begin = (int)((long long)num_lockages * k / num_chunks);
+    c->end = (int)((long long)num_lockages * (k + 1) / num_chunks);
+    c->estimate = (k > 0);
+    c->start = *state;
+    todo[k] = k;
+  }
+
+  int num_todo = num_chunks;
+  int err = ZSF_SUCCESS;
+
+  while (num_todo > 0) {
+    // The calling thread steps the first chunk itself
+    for (int i = 1; i < num_todo; i++) {
+      chunk_t *c = &chunks[todo[i]];
+      if (thread_create(&c->thread, &c->thread_start, step_chunk, c)) {
+        step_chunk(c);
+        todo[i] = -1;
+      }
+    }
+    step_chunk(&chunks[todo[0]]);
+    for (int i = 1; i < num_todo; i++) {
+      if (todo[i] >= 0)
+        thread_join(chunks[todo[i]].thread);
+    }
+
+    // The first error is the one sequential stepping would have run into.
+    // Errors do not depend on the salinity of the lock, so the estimated
+    // start of a chunk does not matter.
+    for (int k = 0; k < num_chunks && !err; k++)
+      err = chunks[k].err;
+    if (err)
+      break;
+
+    // Restart the chunks that do not connect to the one before them
+    num_todo = 0;
+    for (int k = 1; k < num_chunks; k++) {
+      chunk_t *c = &chunks[k];
+      if (!is_close(p, c->start.salinity_lock, chunks[k - 1].state.salinity_lock)) {
+        c->start = chunks[k - 1].state;
+        todo[num_todo++] = k;
+      }
+    }
+  }
+
+  if (!err) {
+    *state = chunks[num_chunks - 1].state;
+  }
+
+  free(chunks);
+  free(todo);
+  return err;
+}
@@ -0,0 +1,204 @@
+#include <math.h>
+#include <stddef.h>
+
+#include "aggregate.h"
+#include "errors.h"
+#include "util.h"
+#include "zsf.h"
+
+// The periodic solver only works with a handful of states, so we bound the
+// number of (accelerated) iterations generously.
+#define MAX_ITERATIONS 100
+
+typedef struct periodic_problem_t {
+  const zsf_param_t *p;
+  double t_period;
+  int num_samples;
+  const double *head_sea;
+  const double *salinity_sea;
+  int num_lockings;
+  const zsf_locking_cycle_t *cycles;
+} periodic_problem_t;
+
+// Linear interpolation in a periodic series of equidistant samples
+static double interp_periodic(const double *series, int num_samples, double t_period, double t) {
+  double x = fmod(t, t_period) / t_period * num_samples;
+  if (x < 0.0)
+    x += num_samples;
+
+  int i = (int)x;
+  double frac = x - i;
+  i = i % num_samples;
+  int j = (i + 1) % num_samples;
+
+  return (1.0 - frac) * series[i] + frac * series[j];
+}
+
+// Boundary conditions at time t within the period
+static void boundary_conditions(const periodic_problem_t *prob, double t, zsf_param_t *p) {
+  p->head_sea = interp_periodic(prob->head_sea, prob->num_samples, prob->t_period, t);
+  if (prob->salinity_sea != NULL)
+    p->salinity_sea = interp_periodic(prob->salinity_sea, prob->num_samples, prob->t_period, t);
+}
+
+// The state at the start of the period is that of the lock after phase 4 of
+// the last locking cycle (of the previous period).
+static void initial_state(const periodic_problem_t *prob, double sal_lock,
+                          zsf_phase_state_t *state) {
+  const zsf_locking_cycle_t *last = &prob->cycles[prob->num_lockings - 1];
+  zsf_param_t p = *prob->p;
+  boundary_conditions(prob, last->time + 2 * last->t_level + last->t_open_lake, &p);
+
+  zsf_initialize_state(&p, state, sal_lock, p.head_sea);
+  state->volume_ship_in_lock = last->ship_volume_sea_to_lake;
+  state->saltmass_lock = sal_lock * (p.lock_length * p.lock_width * (p.head_sea - p.lock_bottom) -
+                                     state->volume_ship_in_lock);
+}
+
+// Step through all locking cycles in the period. The head at sea is taken
+// at the moment the doors open, i.e. the lock levels towards the head at sea
+// at which its doors will be opened.
+static int run_period(const periodic_problem_t *prob, zsf_phase_state_t *state,
+                      aggregate_t *period_totals, zsf_phase_transports_t *cycle_transports) {
+  zsf_param_t p = *prob->p;
+
+  if (period_totals != NULL)
+    aggregate_reset(period_totals);
+
+  for (int i = 0; i < prob->num_lockings; i++) {
+    const zsf_locking_cycle_t *c = &prob->cycles[i];
+    zsf_phase_transports_t tp[4];
+    int err;
+
+    p.ship_volume_lake_to_sea = c->ship_volume_lake_to_sea;
+    p.ship_volume_sea_to_lake = c->ship_volume_sea_to_lake;
+
+    boundary_conditions(prob, c->time + c->t_level, &p);
+    if ((err = zsf_step_phase_1(&p, c->t_level, state, &tp[0])))
+      return err;
+    if ((err = zsf_step_phase_2(&p, c->t_open_lake, state, &tp[1])))
+      return err;
+
+    boundary_conditions(prob, c->time + 2 * c->t_level + c->t_open_lake, &p);
+    if ((err = zsf_step_phase_3(&p, c->t_level, state, &tp[2])))
+      return err;
+    if ((err = zsf_step_phase_4(&p, c->t_open_sea, state, &tp[3])))
+      return err;
+
+    if (period_totals != NULL) {
+      aggregate_t cycle_totals;
+      aggregate_reset(&cycle_totals);
+      for (int k = 0; k < 4; k++) {
+        aggregate_add(period_totals, &tp[k]);
+        aggregate_add(&cycle_totals, &tp[k]);
+      }
+
+      // The cycle lasts until the next one starts
+      if (cycle_transports != NULL) {
+        double t_next = (i + 1 < prob->num_lockings) ? prob->cycles[i + 1].time
+                                                     : prob->cycles[0].time + prob->t_period;
+        aggregate_finish(&cycle_totals, t_next - c->time, &cycle_transports[i]);
+      }
+    }
+  }
+
+  return ZSF_SUCCESS;
+}
+
+// The salinity in the lock at the end of the period, given the salinity at
+// the start.
+static int period_map(const periodic_problem_t *prob, double sal_lock, double *sal_lock_end) {
+  zsf_phase_state_t state;
+  initial_state(prob, sal_lock, &state);
+
+  int err = run_period(prob, &state, NULL, NULL);
+  *sal_lock_end = state.salinity_lock;
+  return err;
+}
+
+int ZSF_CALLCONV zsf_calc_periodic(const zsf_param_t *p, double t_period, int num_samples,
+                                   const double *head_sea, const double *salinity_sea,
+                                   int num_lockings, const zsf_locking_cycle_t *cycles,
+                                   zsf_results_t *results,
+                                   zsf_phase_transports_t *cycle_transports,
+                                   zsf_phase_state_t *state) {
+  if (!(t_period > 0.0) || num_samples < 1 || num_lockings < 1)
+    return ZSF_ERR_INVALID_ARGUMENT;
+  for (int i = 0; i < num_lockings; i++) {
+    if (cycles[i].time < 0.0 || cycles[i].time >= t_period ||
+        (i > 0 && cycles[i].time <= cycles[i - 1].time))
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  periodic_problem_t prob;
+  prob.p = p;
+  prob.t_period = t_period;
+  prob.num_samples = num_samples;
+  prob.head_sea = head_sea;
+  prob.salinity_sea = salinity_sea;
+  prob.num_lockings = num_lockings;
+  prob.cycles = cycles;
+
+  double sal_min = p->salinity_lake;
+  double sal_max = p->salinity_sea;
+  if (salinity_sea != NULL) {
+    for (int i = 0; i < num_samples; i++)
+      sal_max = fmax(sal_max, salinity_sea[i]);
+  }
+
+  double sal_lock = p->salinity_lock;
+  if (sal_lock == ZSF_NAN)
+    sal_lock = 0.5 * (sal_min + sal_max);
+
+  // The period map is a contraction that is very nearly affine in the
+  // salinity of the lock. Steffensen's method (Aitken extrapolation of two
+  // fixed-point iterations) therefore typically converges in one or two
+  // steps, where plain fixed-point iteration takes as many periods as a
+  // spin-up run would.
+  int converged = 0;
+  for (int it = 0; it < MAX_ITERATIONS && !converged; it++) {
+    double s1, s2;
+    int err = period_map(&prob, sal_lock, &s1);
+    if (err)
+      return err;
+
+    if (is_close(s1, sal_lock, p->rtol, p->atol)) {
+      sal_lock = s1;
+      converged = 1;
+      break;
+    }
+
+    err = period_map(&prob, s1, &s2);
+    if (err)
+      return err;
+
+    double denom = s2 - 2.0 * s1 + sal_lock;
+    double sal_lock_next =
+        (denom != 0.0) ? sal_lock - (s1 - sal_lock) * (s1 - sal_lock) / denom : s2;
+
+    // Fall back to the plain iterate if the extrapolation is not sensible
+    if (!(sal_lock_next >= sal_min && sal_lock_next <= sal_max))
+      sal_lock_next = s2;
+
+    converged = is_close(s2, s1, p->rtol, p->atol);
+    sal_lock = sal_lock_next;
+  }
+  if (!converged)
+    return ZSF_ERR_NOT_CONVERGED;
+
+  // One final period from the periodic state to get the transports
+  zsf_phase_state_t periodic_state;
+  initial_state(&prob, sal_lock, &periodic_state);
+  if (state != NULL)
+    *state = periodic_state;
+
+  aggregate_t period_totals;
+  int err = run_period(&prob, &periodic_state, &period_totals, cycle_transports);
+  if (err)
+    return err;
+
+  if (results != NULL)
+    aggregate_finish_results(&period_totals, t_period, results);
+
+  return ZSF_SUCCESS;
+}
@@ -0,0 +1,1697 @@
+/*****************************************************************************
+ * phases.h: calculation of the individual locking phases
+ *****************************************************************************/
+
+// This file is included by every translation unit that needs the phase
+// kernels, after defining the floating point type to calculate in. That way
+// we can have double and single precision variants of the same code. The
+// following have to be defined before including this file:
+//
+//   real_t, param_t, results_t, phase_state_t, phase_transports_t
+//   R(x)        a floating point literal of type real_t
+//   FMAX, FMIN, FABS, SQRT, CBRT, POW, COPYSIGN, EXP, TANH_EXACT
+//
+// Everything in here is static, so every translation unit gets its own copy.
+
+#ifndef ZSF_PHASES_H
+#define ZSF_PHASES_H
+
+#include <assert.h>
+#include <math.h>
+
+#include "errors.h"
+#include "util.h"
+
+// The zsf_calculate loop can take advantage of shared values (e.g. a
+// reciprocal volume) between steps and the derivative parameters. Most
+// compilers cannot seem to recognize the ~20% speedup that can be gained this
+// way, so we have to force it.
+#ifdef _MSC_VER
+#  define forceinline __forceinline
+#elif defined(__GNUC__)
+#  define forceinline inline __attribute__((__always_inline__))
+#elif defined(__CLANG__)
+#  if __has_attribute(__always_inline__)
+#    define forceinline inline __attribute__((__always_inline__))
+#  else
+#    define forceinline inline
+#  endif
+#else
+#  define forceinline inline
+#endif
+
+#ifdef ZSF_USE_FAST_TANH
+static forceinline real_t TANH(const real_t x) {
+  const real_t ax = FABS(x);
+  const real_t x2 = x * x;
+
+  const real_t z1 =
+      (x *
+       (R(2.45550750702956) + R(2.45550750702956) * ax +
+        (R(0.893229853513558) + R(0.821226666969744) * ax) * x2) /
+       (R(2.44506634652299) +
+        (R(2.44506634652299) + x2) * FABS(x + R(0.814642734961073) * x * ax)));
+
+  return FMIN(z1, R(1.0));
+}
+#else
+#  define TANH TANH_EXACT
+#endif
+
+// Sanity checks on the lock state. The tolerances are those of double
+// precision, and are relaxed for other types.
+#ifndef ASSERT_TOL
+#  define ASSERT_TOL R(1E-8)
+#endif
+#define ASSERT_CLOSE(a, b) assert(FABS((a) - (b)) < ASSERT_TOL * FMAX(R(1.0), FABS(b)))
+#define ASSERT_WITHIN_BOUNDS(sal, sal_min, sal_max)                                                \
+  assert(((sal) >= (sal_min) - ASSERT_TOL * FMAX(R(1.0), FABS(sal_min))) &                         \
+         ((sal) <= (sal_max) + ASSERT_TOL * FMAX(R(1.0), FABS(sal_max))))
+
+// Countermeasures (and ships) the kernels are specialized for. Every kernel
+// takes a compile-time constant combination of these, so that the terms of
+// absent features are compiled out. The specialized kernels are bit-identical
+// to the general one (FEATURE_ALL), which kernel_features() guarantees by
+// only selecting them when the omitted terms are exactly zero.
+#define FEATURE_FLUSHING 1
+#define FEATURE_BUBBLE_SCREEN 2
+#define FEATURE_SILL 4
+#define FEATURE_SHIPS 8
+#define FEATURE_ALL 15
+#define NUM_FEATURE_VARIANTS 16
+
+#define HAS(FEATURE) ((features)&FEATURE_##FEATURE)
+
+typedef struct derived_parameters_t {
+  real_t g;
+  int is_high_tide;
+  int is_low_tide;
+  real_t volume_lock_at_sea;
+  real_t volume_lock_at_lake;
+  real_t t_cycle;
+  real_t t_open_avg;
+  real_t t_open;
+  real_t t_open_lake;
+  real_t t_open_sea;
+  real_t flushing_discharge;
+  real_t density_average;
+} derived_parameters_t;
+
+static forceinline void calculate_derived_parameters(const param_t *p,
+                                                     derived_parameters_t *o) {
+  // Gravitational constant
+  o->g = R(9.81);
+
+  // Calculate derived parameters
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  // Tide signal
+  o->is_high_tide = p->head_sea >= p->head_lake;
+  o->is_low_tide = 1 - o->is_high_tide;
+
+  // Volumes
+  o->volume_lock_at_sea = p->lock_length * p->lock_width * (p->head_sea - p->lock_bottom);
+  o->volume_lock_at_lake = p->lock_length * p->lock_width * (p->head_lake - p->lock_bottom);
+
+  // Door open times
+  o->t_cycle = R(24.0) * R(3600.0) / p->num_cycles;
+  o->t_open_avg = R(0.5) * o->t_cycle - (p->leveling_time + R(2.0) * R(0.5) * p->door_time_to_open);
+  o->t_open = p->calibration_coefficient * o->t_open_avg;
+  o->t_open_lake = p->symmetry_coefficient * o->t_open;
+  o->t_open_sea = (R(2.0) - p->symmetry_coefficient) * o->t_open;
+
+  // Flushing discharge
+  o->flushing_discharge =
+      o->is_low_tide ? p->flushing_discharge_low_tide : p->flushing_discharge_high_tide;
+
+  // Average density (for lock exchange)
+  // Always done in double precision, as it is an iterative procedure
+  o->density_average =
+      (real_t)(0.5 * (sal_2_density(p->salinity_lake, p->temperature_lake, p->rtol, p->atol) +
+                      sal_2_density(p->salinity_sea, p->temperature_sea, p->rtol, p->atol)));
+}
+
+static int check_parameters_state(const param_t *p, const derived_parameters_t *o,
+                                  const phase_state_t *state) {
+
+  if (FMAX(p->ship_volume_lake_to_sea, p->ship_volume_sea_to_lake) >
+      FMIN(o->volume_lock_at_lake, o->volume_lock_at_sea)) {
+    return ZSF_SHIP_TOO_BIG;
+  }
+  if ((state->salinity_lock > FMAX(p->salinity_lake, p->salinity_sea)) ||
+      (state->salinity_lock < FMIN(p->salinity_lake, p->salinity_sea))) {
+    return ZSF_ERR_SAL_LOCK_OUT_OF_BOUNDS;
+  }
+
+  return ZSF_SUCCESS;
+}
+
+// Positive zero, and positive finite values. Negative zeros would not
+// vanish in all of the expressions we leave out.
+#define IS_PLUS_ZERO(x) ((x) == 0.0 && !signbit(x))
+#define IS_POSITIVE_FINITE(x) ((x) > 0.0 && (x) - (x) == 0.0)
+
+// The combination of features a parameter set (and state) needs. Outside of
+// the regular domain (e.g. a lock that is not deeper than its sill) we always
+// use the general kernels, as the shortcuts of the specialized ones rely on
+// it.
+static int kernel_features(const param_t *p, const derived_parameters_t *o,
+                           const phase_state_t *state) {
+  int regular = IS_POSITIVE_FINITE(p->lock_width) &&
+                IS_POSITIVE_FINITE(p->head_lake - p->lock_bottom) &&
+                IS_POSITIVE_FINITE(p->head_sea - p->lock_bottom) &&
+                IS_POSITIVE_FINITE(p->lock_width * (p->head_lake - p->lock_bottom -
+                                                    p->sill_height_lake)) &&
+                IS_POSITIVE_FINITE(p->lock_width *
+                                   (p->head_sea - p->lock_bottom - p->sill_height_sea)) &&
+                IS_POSITIVE_FINITE(o->density_average) &&
+                o->flushing_discharge - o->flushing_discharge == 0.0 &&
+                (p->salinity_lake > 0.0 || IS_PLUS_ZERO(p->salinity_lake)) &&
+                p->salinity_sea > p->salinity_lake && p->salinity_sea - p->salinity_sea == 0.0 &&
+                !signbit(state->saltmass_lock);
+  if (!regular) {
+    return FEATURE_ALL;
+  }
+
+  int features = 0;
+  if (!IS_PLUS_ZERO(o->flushing_discharge))
+    features |= FEATURE_FLUSHING;
+  if (p->distance_door_bubble_screen_lake != 0.0 || p->distance_door_bubble_screen_sea != 0.0)
+    features |= FEATURE_BUBBLE_SCREEN;
+  if (!IS_PLUS_ZERO(p->sill_height_lake) || !IS_PLUS_ZERO(p->sill_height_sea))
+    features |= FEATURE_SILL;
+  if (!IS_PLUS_ZERO(p->ship_volume_lake_to_sea) || !IS_PLUS_ZERO(p->ship_volume_sea_to_lake) ||
+      !IS_PLUS_ZERO(state->volume_ship_in_lock))
+    features |= FEATURE_SHIPS;
+
+  return features;
+}
+
+static forceinline void step_phase_1(const param_t *p, const derived_parameters_t *o,
+                                     real_t t_level, phase_state_t *state,
+                                     phase_transports_t *results, const int features) {
+  // Phase 1: Leveling lock to lake side
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  //              Low Tide                                       High Tide
+  //
+  //      Lake                          Sea              Lake                          Sea
+  //                |             |                                |--\   ↓   /--|------------
+  //    ------------|             |                    ------------|   \_____/   |
+  //                |--\   ↑   /--|------------                    |             |
+  //                →   \_____/   |                                ←             |
+  //    ____________|_____________|____________        ____________|_____________|____________
+  //
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  real_t saltmass_lock_4 = state->saltmass_lock;
+  real_t sal_lock_4 = state->salinity_lock;
+  real_t volume_ship_in_lock_4 = state->volume_ship_in_lock;
+
+  // Leveling
+  real_t vol_to_lake = FMAX(state->head_lock - p->head_lake, 0.0) * p->lock_width * p->lock_length;
+  real_t vol_from_lake =
+      FMAX(p->head_lake - state->head_lock, 0.0) * p->lock_width * p->lock_length;
+  real_t mt_lake_1 = vol_from_lake * p->salinity_lake - vol_to_lake * sal_lock_4;
+
+  // Update the results
+  results->mass_transport_lake = mt_lake_1;
+  results->volume_from_lake = vol_from_lake;
+  results->volume_to_lake = vol_to_lake;
+  results->discharge_from_lake = vol_from_lake / t_level;
+  results->discharge_to_lake = vol_to_lake / t_level;
+  results->salinity_to_lake = sal_lock_4;
+
+  results->mass_transport_sea = 0.0;
+  results->volume_from_sea = 0.0;
+  results->volume_to_sea = 0.0;
+  results->discharge_from_sea = 0.0;
+  results->discharge_to_sea = 0.0;
+  results->salinity_to_sea = sal_lock_4;
+
+  // Update state variables of the lock
+  real_t volume_water_in_lock = HAS(SHIPS) ? o->volume_lock_at_lake - volume_ship_in_lock_4
+                                            : o->volume_lock_at_lake;
+  real_t saltmass_lock_1 = saltmass_lock_4 + mt_lake_1;
+  real_t sal_lock_1 = saltmass_lock_1 / volume_water_in_lock;
+
+  ASSERT_WITHIN_BOUNDS(sal_lock_1, p->salinity_lake, p->salinity_sea);
+
+  // Rounding errors can lead to ever so slight exceedences of the boundary
+  // conditions, so we clip the salinity and recalculate the salt mass.
+  sal_lock_1 = FMAX(sal_lock_1, p->salinity_lake);
+  sal_lock_1 = FMIN(sal_lock_1, p->salinity_sea);
+  saltmass_lock_1 = sal_lock_1 * volume_water_in_lock;
+
+  state->salinity_lock = sal_lock_1;
+  state->saltmass_lock = saltmass_lock_1;
+  state->head_lock = p->head_lake;
+  // state->volume_ship_in_lock = state->volume_ship_in_lock;  /* Unchanged */
+}
+
+static forceinline void step_phase_2(const param_t *p, const derived_parameters_t *o,
+                                     real_t t_open_lake, phase_state_t *state,
+                                     phase_transports_t *results, const int features) {
+  // Phase 2: Gate opening at lake side
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  //              Low Tide                                       High Tide
+  //
+  //      Lake                          Sea             Lake                          Sea
+  //                              |                                              |------------
+  //    --------\  <->  /---------|                    --------\  <->  /---------|
+  //             \_____/          |------------                 \_____/          |
+  //                '             → flushing                       '             → flushing
+  //    ____________'_____________|____________        ____________'_____________|____________
+  //
+  // Consists of three subphases:
+  // a. Ships exiting lock
+  // b. Lock exchange + flushing
+  // c. Ships entering lock
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  real_t saltmass_lock_1 = state->saltmass_lock;
+  real_t sal_lock_1 = state->salinity_lock;
+  real_t volume_ship_in_lock_1 = state->volume_ship_in_lock;
+
+  // Subphase a. Ships exiting the lock chamber towards the lake
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  real_t mt_lake_2_ship_exit = HAS(SHIPS) ? volume_ship_in_lock_1 * p->salinity_lake : R(0.0);
+
+  // Update state variables of the lock
+  real_t saltmass_lock_2a = HAS(SHIPS) ? saltmass_lock_1 + mt_lake_2_ship_exit : saltmass_lock_1;
+  real_t sal_lock_2a = saltmass_lock_2a / o->volume_lock_at_lake;
+
+  // Subphase b. Flushing compensated lock exchange
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // A sill is only 80% effective for reducing the lock exchange head, and
+  // also 80% effective for reducing the total amount of water that can be
+  // exchanged. In this subphase that means a salty layer of 80% the sill
+  // height will is unaffected by lock exchange or flushing.
+  real_t head_above_sill = p->head_lake - p->lock_bottom;
+  real_t head_above_sill_dc_effective = head_above_sill;
+  real_t volume_lock_at_lake_effective = o->volume_lock_at_lake;
+  if (HAS(SILL)) {
+    head_above_sill = p->head_lake - p->lock_bottom - p->sill_height_lake;
+    head_above_sill_dc_effective = p->head_lake - p->lock_bottom - R(0.8) * p->sill_height_lake;
+    volume_lock_at_lake_effective =
+        head_above_sill_dc_effective / (p->head_lake - p->lock_bottom) * o->volume_lock_at_lake;
+  }
+
+  real_t velocity_flushing =
+      HAS(FLUSHING) ? o->flushing_discharge / (p->lock_width * head_above_sill) : R(0.0);
+
+  real_t sal_diff = sal_lock_2a - p->salinity_lake;
+  real_t velocity_exchange_raw =
+      R(0.5) * SQRT(o->g * R(0.8) * sal_diff / o->density_average * head_above_sill_dc_effective);
+
+  // Calculate the time that the density current is running unprotected, in
+  // the case that the bubble screen is not exactly at the door opening. Note
+  // that for equal (absolute) distance, the time differs between a bubble
+  // screen inside and outside the lock chamber.
+  real_t volume_exchange_2 = 0.0;
+  real_t t_raw_exchange = 0.0;
+
+  // Until the density current reaches the bubble screen
+  if (HAS(BUBBLE_SCREEN) && p->distance_door_bubble_screen_lake != 0.0) {
+    real_t velocity_t_raw_exchange =
+        HAS(FLUSHING) ? velocity_exchange_raw -
+                            COPYSIGN(velocity_flushing, p->distance_door_bubble_screen_lake)
+                      : velocity_exchange_raw;
+    velocity_t_raw_exchange = FMAX(velocity_t_raw_exchange, R(1E-10));
+    t_raw_exchange = FABS(p->distance_door_bubble_screen_lake) / velocity_t_raw_exchange;
+    t_raw_exchange = FMIN(t_raw_exchange, t_open_lake);
+
+    real_t frac_lock_exchange_raw =
+        FMAX((velocity_exchange_raw - velocity_flushing) / velocity_exchange_raw, 0.0);
+    real_t t_lock_exchange_raw = 2 * p->lock_length / velocity_exchange_raw;
+    volume_exchange_2 += frac_lock_exchange_raw * volume_lock_at_lake_effective *
+                         TANH(t_raw_exchange / t_lock_exchange_raw);
+  }
+
+  // After the current reaches the bubble screen
+  real_t velocity_exchange_eta = p->density_current_factor_lake * velocity_exchange_raw;
+  real_t frac_lock_exchange =
+      FMAX((velocity_exchange_eta - velocity_flushing) / velocity_exchange_eta, 0.0);
+  real_t t_lock_exchange = 2 * p->lock_length / velocity_exchange_eta;
+  volume_exchange_2 += frac_lock_exchange * (volume_lock_at_lake_effective - volume_exchange_2) *
+                       TANH(FMAX(t_open_lake - t_raw_exchange, 0.0) / t_lock_exchange);
+
+  // Flushing itself (taking lock exchange into account)
+  real_t volume_flush = o->flushing_discharge * t_open_lake;
+
+  // Max volume that will lead to the lock being refreshed (before we
+  // reach steady state where we are flushing to the sea with salinity of
+  // lake)
+  real_t max_volume_flush_refresh = volume_lock_at_lake_effective - volume_exchange_2;
+
+  real_t volume_flush_refresh = FMIN(volume_flush, max_volume_flush_refresh);
+  real_t volume_flush_passthrough = FMAX(volume_flush - max_volume_flush_refresh, 0.0);
+
+  real_t mt_sea_2_flushing =
+      volume_flush_refresh * sal_lock_2a + volume_flush_passthrough * p->salinity_lake;
+
+  real_t volume_to_sea_2b = volume_flush;
+  real_t volume_from_lake_2b = volume_exchange_2 + volume_flush;
+  real_t volume_to_lake_2b = volume_exchange_2;
+
+  real_t mt_to_sea_2b = mt_sea_2_flushing;
+  real_t mt_to_lake_2b = volume_exchange_2 * sal_lock_2a;
+  real_t mt_from_lake_2b = (volume_exchange_2 + volume_flush) * p->salinity_lake;
+
+  // Update state variables of the lock
+  real_t saltmass_lock_2b = saltmass_lock_2a + mt_from_lake_2b - mt_to_lake_2b - mt_to_sea_2b;
+  real_t sal_lock_2b = saltmass_lock_2b / o->volume_lock_at_lake;
+
+  // Subphase c. Ship entering the lock chamber from the lake
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  real_t mt_lake_2_ship_enter = -1 * p->ship_volume_lake_to_sea * sal_lock_2b;
+  real_t volume_water_in_lock_2 = HAS(SHIPS) ? o->volume_lock_at_lake - p->ship_volume_lake_to_sea
+                                             : o->volume_lock_at_lake;
+
+#ifndef NDEBUG
+  // These variables are only needed for the assertion later on
+  // Update state variables of the lock
+  real_t saltmass_lock_2c = saltmass_lock_2b + mt_lake_2_ship_enter;
+  real_t sal_lock_2c = saltmass_lock_2c / volume_water_in_lock_2;
+#endif
+
+  // Totals for Phase 2
+  // ~~~~~~~~~~~~~~~~~~
+  // Total mass transports over both gates
+  real_t mt_lake_2 =
+      HAS(SHIPS) ? mt_lake_2_ship_exit + mt_lake_2_ship_enter + mt_from_lake_2b - mt_to_lake_2b
+                 : mt_from_lake_2b - mt_to_lake_2b;
+  real_t mt_sea_2 = mt_to_sea_2b;
+
+  // Update state variables of the lock
+  real_t saltmass_lock_2 = saltmass_lock_1 + mt_lake_2 - mt_sea_2;
+  real_t sal_lock_2 = saltmass_lock_2 / volume_water_in_lock_2;
+
+  ASSERT_CLOSE(saltmass_lock_2, saltmass_lock_2c);
+  ASSERT_CLOSE(sal_lock_2, sal_lock_2c);
+
+  ASSERT_WITHIN_BOUNDS(sal_lock_2, p->salinity_lake, p->salinity_sea);
+
+  // Rounding errors can lead to ever so slight exceedences of the boundary
+  // conditions, so we clip the salinity and recalculate the salt mass.
+  sal_lock_2 = FMAX(sal_lock_2, p->salinity_lake);
+  sal_lock_2 = FMIN(sal_lock_2, p->salinity_sea);
+  saltmass_lock_2 = sal_lock_2 * volume_water_in_lock_2;
+
+  // Update the results
+  results->mass_transport_lake = mt_lake_2;
+  results->volume_from_lake =
+      HAS(SHIPS) ? volume_ship_in_lock_1 + volume_from_lake_2b : volume_from_lake_2b;
+  results->volume_to_lake =
+      HAS(SHIPS) ? volume_to_lake_2b + p->ship_volume_lake_to_sea : volume_to_lake_2b;
+  results->discharge_from_lake = results->volume_from_lake / t_open_lake;
+  results->discharge_to_lake = results->volume_to_lake / t_open_lake;
+  results->salinity_to_lake = (results->volume_to_lake > 0.0)
+                                  ? -1 *
+                                        (mt_lake_2 - results->volume_from_lake * p->salinity_lake) /
+                                        results->volume_to_lake
+                                  : sal_lock_1;
+
+  results->mass_transport_sea = mt_sea_2;
+  results->volume_from_sea = 0.0;
+  results->volume_to_sea = o->flushing_discharge * t_open_lake;
+  results->discharge_from_sea = 0.0;
+  results->discharge_to_sea = o->flushing_discharge;
+  results->salinity_to_sea =
+      (results->volume_to_sea > 0.0) ? mt_sea_2 / results->volume_to_sea : sal_lock_1;
+
+  // Update state variables of the lock
+  state->saltmass_lock = saltmass_lock_2;
+  state->salinity_lock = sal_lock_2;
+  // state->head_lock = state->head_lock;  /* Unchanged */
+  state->volume_ship_in_lock = p->ship_volume_lake_to_sea;
+}
+
+static forceinline void step_phase_3(const param_t *p, const derived_parameters_t *o,
+                                     real_t t_level, phase_state_t *state,
+                                     phase_transports_t *results, const int features) {
+  // Phase 3: Leveling lock to sea side
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  //              Low Tide                                       High Tide
+  //
+  //      Lake                          Sea              Lake                          Sea
+  //                |             |                                |             |------------
+  //    ------------|--\   ↓   /--|                    ------------|--\   ↑   /--|
+  //                |   \_____/   |------------                    |   \_____/   |
+  //                |             →                                |             ←
+  //    ____________|_____________|____________        ____________|_____________|____________
+  //
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  real_t saltmass_lock_2 = state->saltmass_lock;
+  real_t sal_lock_2 = state->salinity_lock;
+  real_t volume_ship_in_lock_2 = state->volume_ship_in_lock;
+
+  // Leveling
+  real_t vol_to_sea = FMAX(state->head_lock - p->head_sea, 0.0) * p->lock_width * p->lock_length;
+  real_t vol_from_sea = FMAX(p->head_sea - state->head_lock, 0.0) * p->lock_width * p->lock_length;
+  real_t mt_sea_3 = vol_to_sea * sal_lock_2 - vol_from_sea * p->salinity_sea;
+
+  // Update the results
+  results->mass_transport_lake = 0.0;
+  results->volume_from_lake = 0.0;
+  results->volume_to_lake = 0.0;
+  results->discharge_from_lake = 0.0;
+  results->discharge_to_lake = 0.0;
+  results->salinity_to_lake = sal_lock_2;
+
+  results->mass_transport_sea = mt_sea_3;
+  results->volume_from_sea = vol_from_sea;
+  results->volume_to_sea = vol_to_sea;
+  results->discharge_from_sea = vol_from_sea / t_level;
+  results->discharge_to_sea = vol_to_sea / t_level;
+  results->salinity_to_sea = sal_lock_2;
+
+  // Update state variables of the lock
+  real_t volume_water_in_lock = HAS(SHIPS) ? o->volume_lock_at_sea - volume_ship_in_lock_2
+                                            : o->volume_lock_at_sea;
+  real_t saltmass_lock_3 = saltmass_lock_2 - mt_sea_3;
+  real_t sal_lock_3 = saltmass_lock_3 / volume_water_in_lock;
+
+  ASSERT_WITHIN_BOUNDS(sal_lock_3, p->salinity_lake, p->salinity_sea);
+
+  // Rounding errors can lead to ever so slight exceedences of the boundary
+  // conditions, so we clip the salinity and recalculate the salt mass.
+  sal_lock_3 = FMAX(sal_lock_3, p->salinity_lake);
+  sal_lock_3 = FMIN(sal_lock_3, p->salinity_sea);
+  saltmass_lock_3 = sal_lock_3 * volume_water_in_lock;
+
+  state->salinity_lock = sal_lock_3;
+  state->saltmass_lock = saltmass_lock_3;
+  state->head_lock = p->head_sea;
+  // state->volume_ship_in_lock = state->volume_ship_in_lock;  /* Unchanged */
+}
+
+static forceinline void step_phase_4(const param_t *p, const derived_parameters_t *o,
+                                     real_t t_open_sea, phase_state_t *state,
+                                     phase_transports_t *results, const int features) {
+  // Phase 4: Gate opening at sea side
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  //              Low Tide                                       High Tide
+  //
+  //      Lake                          Sea              Lake                          Sea
+  //                |                                              |---------\  <->  /--------
+  //    ------------|                                  ------------|          \_____/
+  //                |---------\  <->  /--------                    |             '
+  //                |          \_____/                             |             '
+  //    ____________|_____________'____________        ____________|_____________'____________
+  //
+  // Consists of three subphases:
+  // a. Ships exiting lock
+  // b. Lock exchange + flushing
+  // c. Ships entering lock
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  real_t saltmass_lock_3 = state->saltmass_lock;
+  real_t sal_lock_3 = state->salinity_lock;
+  real_t volume_ship_in_lock_3 = state->volume_ship_in_lock;
+
+  // Subphase a. Ships exiting the lock chamber towards the sea
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  real_t mt_sea_4_ship_exit = HAS(SHIPS) ? -1 * volume_ship_in_lock_3 * p->salinity_sea : R(0.0);
+
+  // Update state variables of the lock
+  real_t saltmass_lock_4a = HAS(SHIPS) ? saltmass_lock_3 - mt_sea_4_ship_exit : saltmass_lock_3;
+  real_t sal_lock_4a = saltmass_lock_4a / o->volume_lock_at_sea;
+
+  // Subphase b. Flushing compensated lock exchange
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // A sill is only 80% effective for reducing the lock exchange head, but on
+  // this side not effective in reducing the maximum amount of water that can
+  // be exchanged.
+  real_t head_above_sill = p->head_sea - p->lock_bottom;
+  real_t head_above_sill_dc_effective = head_above_sill;
+  if (HAS(SILL)) {
+    head_above_sill = p->head_sea - p->lock_bottom - p->sill_height_sea;
+    head_above_sill_dc_effective = p->head_sea - p->lock_bottom - R(0.8) * p->sill_height_sea;
+  }
+
+  real_t velocity_flushing =
+      HAS(FLUSHING) ? o->flushing_discharge / (p->lock_width * head_above_sill) : R(0.0);
+
+  real_t sal_diff = p->salinity_sea - sal_lock_4a;
+  real_t velocity_exchange_raw =
+      R(0.5) * SQRT(o->g * R(0.8) * sal_diff / o->density_average * head_above_sill_dc_effective);
+
+  // The equilibrium depth of the boundary layer between the salt (sal_sea)
+  // and fresh (sal_lake) water when flushing for a very long time. Without
+  // flushing it is zero, and the whole lock takes part in the exchange.
+  real_t frac_lock_exchange = R(1.0);
+  if (HAS(FLUSHING)) {
+    real_t head_equilibrium =
+        CBRT(R(2.0) * POW(o->flushing_discharge / p->lock_width, R(2.0)) * o->density_average /
+             (o->g * R(0.8) * (p->salinity_sea - p->salinity_lake)));
+
+    head_equilibrium = FMIN(head_equilibrium, p->head_sea - p->lock_bottom);
+
+    frac_lock_exchange =
+        (p->head_sea - p->lock_bottom - head_equilibrium) / (p->head_sea - p->lock_bottom);
+  }
+
+  // If we flush so much that the density current never enters the lock, we
+  // might get division by zero. Avoid by branching such that we can still
+  // use fast math (which typically does not work with non-finite values).
+  real_t volume_exchange_4 = 0.0;
+  real_t t_raw_exchange = 0.0;
+
+  // Until the density current reaches the bubble screen
+  if (HAS(BUBBLE_SCREEN) && p->distance_door_bubble_screen_sea != 0.0) {
+    real_t velocity_t_raw_exchange =
+        HAS(FLUSHING) ? velocity_exchange_raw +
+                            COPYSIGN(velocity_flushing, p->distance_door_bubble_screen_sea)
+                      : velocity_exchange_raw;
+    velocity_t_raw_exchange = FMAX(velocity_t_raw_exchange, R(1E-10));
+    t_raw_exchange = FABS(p->distance_door_bubble_screen_sea) / velocity_t_raw_exchange;
+    t_raw_exchange = FMIN(t_raw_exchange, t_open_sea);
+
+    real_t t_lock_exchange_raw =
+        2 * p->lock_length * frac_lock_exchange / (velocity_exchange_raw - velocity_flushing);
+
+    volume_exchange_4 +=
+        frac_lock_exchange * o->volume_lock_at_sea * TANH(t_raw_exchange / t_lock_exchange_raw);
+  }
+
+  // After the current reaches the bubble screen
+  real_t velocity_exchange_eta = p->density_current_factor_sea * velocity_exchange_raw;
+
+  if (velocity_exchange_eta > velocity_flushing) {
+    real_t t_lock_exchange =
+        2 * p->lock_length * frac_lock_exchange / (velocity_exchange_eta - velocity_flushing);
+    volume_exchange_4 += frac_lock_exchange * (o->volume_lock_at_sea - volume_exchange_4) *
+                         TANH(FMAX(t_open_sea - t_raw_exchange, 0.0) / t_lock_exchange);
+  }
+
+  // Flushing itself (taking lock exchange into account)
+  real_t volume_flush = o->flushing_discharge * t_open_sea;
+
+  // Max volume that will lead to the lock being refreshed (before we
+  // reach steady state where we are flushing to the sea with salinity of
+  // lake)
+  real_t max_volume_flush_refresh = o->volume_lock_at_sea - volume_exchange_4;
+
+  real_t volume_flush_refresh = FMIN(volume_flush, max_volume_flush_refresh);
+  real_t volume_flush_passthrough = FMAX(volume_flush - max_volume_flush_refresh, 0.0);
+
+  real_t mt_lake_4_flushing =
+      volume_flush_refresh * p->salinity_lake + volume_flush_passthrough * p->salinity_lake;
+  real_t mt_sea_4_flushing =
+      volume_flush_refresh * sal_lock_4a + volume_flush_passthrough * p->salinity_lake;
+
+  real_t volume_to_sea_4b = volume_exchange_4 + volume_flush;
+  real_t volume_from_sea_4b = volume_exchange_4;
+  real_t volume_from_lake_4b = volume_flush;
+
+  real_t mt_to_sea_4b = mt_sea_4_flushing + volume_exchange_4 * sal_lock_4a;
+  real_t mt_from_sea_4b = volume_exchange_4 * p->salinity_sea;
+  real_t mt_from_lake_4b = mt_lake_4_flushing;
+
+  // Update state variables of the lock
+  real_t saltmass_lock_4b = saltmass_lock_4a + mt_from_sea_4b - mt_to_sea_4b + mt_from_lake_4b;
+  real_t sal_lock_4b = saltmass_lock_4b / o->volume_lock_at_sea;
+
+  // Subphase c. Ship entering the lock chamber from the sea
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  real_t mt_sea_4_ship_enter = p->ship_volume_sea_to_lake * sal_lock_4b;
+  real_t volume_water_in_lock_4 = HAS(SHIPS) ? o->volume_lock_at_sea - p->ship_volume_sea_to_lake
+                                             : o->volume_lock_at_sea;
+
+#ifndef NDEBUG
+  // These variables are only needed for the assertion later on
+  // Update state variables of the lock
+  real_t saltmass_lock_4c = saltmass_lock_4b - mt_sea_4_ship_enter;
+  real_t sal_lock_4c = saltmass_lock_4c / volume_water_in_lock_4;
+#endif
+
+  // Totals for Phase 4
+  // ~~~~~~~~~~~~~~~~~~
+  // Total mass transports over both gates
+  real_t mt_sea_4 =
+      HAS(SHIPS) ? mt_sea_4_ship_exit + mt_sea_4_ship_enter + mt_to_sea_4b - mt_from_sea_4b
+                 : mt_to_sea_4b - mt_from_sea_4b;
+  real_t mt_lake_4 = mt_from_lake_4b;
+
+  // Update state variables of the lock
+  real_t saltmass_lock_4 = saltmass_lock_3 + mt_lake_4 - mt_sea_4;
+  real_t sal_lock_4 = saltmass_lock_4 / volume_water_in_lock_4;
+
+  ASSERT_CLOSE(saltmass_lock_4, saltmass_lock_4c);
+  ASSERT_CLOSE(sal_lock_4, sal_lock_4c);
+
+  ASSERT_WITHIN_BOUNDS(sal_lock_4, p->salinity_lake, p->salinity_sea);
+
+  // Rounding errors can lead to ever so slight exceedences of the boundary
+  // conditions, so we clip the salinity and recalculate the salt mass.
+  sal_lock_4 = FMAX(sal_lock_4, p->salinity_lake);
+  sal_lock_4 = FMIN(sal_lock_4, p->salinity_sea);
+  saltmass_lock_4 = sal_lock_4 * volume_water_in_lock_4;
+
+  // Update the results
+  results->mass_transport_lake = mt_lake_4;
+  results->volume_from_lake = volume_from_lake_4b;
+  results->volume_to_lake = 0.0;
+  results->discharge_from_lake = o->flushing_discharge;
+  results->discharge_to_lake = 0.0;
+  results->salinity_to_lake = sal_lock_3;
+
+  results->mass_transport_sea = mt_sea_4;
+  results->volume_from_sea =
+      HAS(SHIPS) ? volume_from_sea_4b + volume_ship_in_lock_3 : volume_from_sea_4b;
+  results->volume_to_sea =
+      HAS(SHIPS) ? volume_to_sea_4b + p->ship_volume_sea_to_lake : volume_to_sea_4b;
+  results->discharge_from_sea = results->volume_from_sea / t_open_sea;
+  results->discharge_to_sea = results->volume_to_sea / t_open_sea;
+  results->salinity_to_sea =
+      (results->volume_to_sea > 0.0)
+          ? (mt_sea_4 + results->volume_from_sea * p->salinity_sea) / results->volume_to_sea
+          : sal_lock_3;
+
+  // Update state variables of the lock
+  state->saltmass_lock = saltmass_lock_4;
+  state->salinity_lock = sal_lock_4;
+  // state->head_lock = state->head_lock;  /* Unchanged */
+  state->volume_ship_in_lock = p->ship_volume_sea_to_lake;
+}
+
+static forceinline void step_flush_doors_closed(const param_t *p, const derived_parameters_t *o,
+                                                real_t t_flushing, phase_state_t *state,
+                                                phase_transports_t *results, const int features) {
+  // Flushing with gates closed
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  //            Low Tide (for example)
+  //
+  //      Lake                           Sea
+  //            |                   |
+  //    --------|-------------------|
+  //            |                   |-----------
+  //            → flushing          → flushing
+  //    ________|___________________|___________
+  //
+  // Note that the above schematics do not include a ship inside the lock, as
+  // flushing with the doors closed is typically done between ships going out
+  // of the lock, and ships going into the lock. This routine does however work
+  // correctly when there is a ship inside nonetheless.
+  // Also note that this routine does not care whether the lock is at sea or
+  // lake level, or anywhere inbetween. It will however not raise/lower the
+  // level in the lock, for which the levelling routines (phase 1 and 3)
+  // should be used.
+  //
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+  // Contrary to the superposition of velocities in step_phase_2/4 (which
+  // would correspond to a linear decay), we do an exponential decay. The
+  // initial "speed" of this exponential decay is the same as that of the
+  // linear decay.
+  real_t sal_diff = state->salinity_lock - p->salinity_lake;
+  real_t volume_water_in_lock =
+      p->lock_length * p->lock_width * (state->head_lock - p->lock_bottom);
+  if (HAS(SHIPS))
+    volume_water_in_lock -= state->volume_ship_in_lock;
+
+  real_t lam_exp = o->flushing_discharge * sal_diff / state->saltmass_lock;
+  real_t saltmass_lock = volume_water_in_lock * sal_diff * EXP(-R(1.0) * lam_exp * t_flushing) +
+                         volume_water_in_lock * p->salinity_lake;
+  real_t saltmass_out = state->saltmass_lock - saltmass_lock;
+
+  // Update state variables of the lock
+  real_t sal_lock = saltmass_lock / volume_water_in_lock;
+
+  ASSERT_WITHIN_BOUNDS(sal_lock, p->salinity_lake, p->salinity_sea);
+
+  // Rounding errors can lead to ever so slight exceedences of the boundary
+  // conditions, so we clip the salinity and recalculate the salt mass.
+  sal_lock = FMAX(sal_lock, p->salinity_lake);
+  sal_lock = FMIN(sal_lock, p->salinity_sea);
+  saltmass_lock = sal_lock * volume_water_in_lock;
+
+  // Update the results
+  results->mass_transport_lake = o->flushing_discharge * t_flushing * p->salinity_lake;
+  results->volume_from_lake = o->flushing_discharge * t_flushing;
+  results->volume_to_lake = 0.0;
+  results->discharge_from_lake = o->flushing_discharge;
+  results->discharge_to_lake = 0.0;
+  results->salinity_to_lake = sal_lock;
+
+  results->mass_transport_sea = saltmass_out;
+  results->volume_from_sea = 0.0;
+  results->volume_to_sea = o->flushing_discharge * t_flushing;
+  results->discharge_from_sea = 0.0;
+  results->discharge_to_sea = o->flushing_discharge;
+  results->salinity_to_sea =
+      (results->volume_to_sea > 0.0) ? saltmass_out / results->volume_to_sea : sal_lock;
+
+  // Update state variables of the lock
+  state->saltmass_lock = saltmass_lock;
+  state->salinity_lock = sal_lock;
+  // state->head_lock = state->head_lock;  /* Unchanged */
+  // state->volume_ship_in_lock = state->ship_volume_lake_to_sea; /* Unchanged */
+}
+
+// Time-resolved transports within a phase
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The volumes and mass transports at time t since the start of a phase are
+// the totals of the same phase stopped at t. The discharges and salinities
+// are instantaneous, i.e. the rates of the cumulative volumes and the
+// salinity of the water flowing out at time t. Ships exit the lock at the
+// start of the phase and enter it at the end, so the sample at the end of
+// the phase equals the totals of the step_* kernels. The terms below mirror
+// those of the step_* kernels with all features enabled, but everything
+// that does not depend on time is calculated only once.
+
+// Lock exchange through an open door, first unprotected until the density
+// current reaches the bubble screen, and then at the reduced velocity.
+typedef struct exchange_profile_t {
+  real_t volume;
+  int has_raw;
+  real_t t_raw_exchange;
+  real_t frac_lock_exchange_raw;
+  real_t t_lock_exchange_raw;
+  int has_eta;
+  real_t frac_lock_exchange;
+  real_t t_lock_exchange;
+} exchange_profile_t;
+
+// The volume exchanged up to time t, and its rate at time t
+static inline real_t exchange_volume(const exchange_profile_t *e, real_t t, real_t *rate) {
+  real_t volume_exchange = 0.0;
+  real_t t_raw_exchange = 0.0;
+  real_t th;
+
+  if (e->has_raw) {
+    t_raw_exchange = FMIN(e->t_raw_exchange, t);
+    th = TANH(t_raw_exchange / e->t_lock_exchange_raw);
+    volume_exchange += e->frac_lock_exchange_raw * e->volume * th;
+    *rate = e->frac_lock_exchange_raw * e->volume * (R(1.0) - th * th) / e->t_lock_exchange_raw;
+    if (t < e->t_raw_exchange)
+      return volume_exchange;
+  }
+
+  *rate = 0.0;
+  if (e->has_eta) {
+    th = TANH(FMAX(t - t_raw_exchange, 0.0) / e->t_lock_exchange);
+    *rate = e->frac_lock_exchange * (e->volume - volume_exchange) * (R(1.0) - th * th) /
+            e->t_lock_exchange;
+    volume_exchange += e->frac_lock_exchange * (e->volume - volume_exchange) * th;
+  }
+  return volume_exchange;
+}
+
+// The transports of the leveling phases are uniform in time
+static inline void resolve_leveling(const param_t *p, const derived_parameters_t *o, int phase,
+                                    real_t t_level, const phase_state_t *state, int num_times,
+                                    const real_t *times, phase_transports_t *samples) {
+  phase_state_t s = *state;
+  phase_transports_t tp;
+  if (phase == 1)
+    step_phase_1(p, o, t_level, &s, &tp, FEATURE_ALL);
+  else
+    step_phase_3(p, o, t_level, &s, &tp, FEATURE_ALL);
+
+  for (int i = 0; i < num_times; i++) {
+    real_t frac = times[i] / t_level;
+    phase_transports_t *r = &samples[i];
+
+    *r = tp;
+    r->mass_transport_lake = tp.mass_transport_lake * frac;
+    r->volume_from_lake = tp.volume_from_lake * frac;
+    r->volume_to_lake = tp.volume_to_lake * frac;
+    r->mass_transport_sea = tp.mass_transport_sea * frac;
+    r->volume_from_sea = tp.volume_from_sea * frac;
+    r->volume_to_sea = tp.volume_to_sea * frac;
+  }
+}
+
+static inline void resolve_phase_2(const param_t *p, const derived_parameters_t *o,
+                                   real_t t_open_lake, const phase_state_t *state, int num_times,
+                                   const real_t *times, phase_transports_t *samples) {
+  real_t sal_lock_1 = state->salinity_lock;
+  real_t volume_ship_in_lock_1 = state->volume_ship_in_lock;
+
+  // Subphase a. Ships exiting the lock chamber towards the lake
+  real_t mt_lake_2_ship_exit = volume_ship_in_lock_1 * p->salinity_lake;
+  real_t saltmass_lock_2a = state->saltmass_lock + mt_lake_2_ship_exit;
+  real_t sal_lock_2a = saltmass_lock_2a / o->volume_lock_at_lake;
+
+  // Subphase b. Flushing compensated lock exchange
+  real_t head_above_sill = p->head_lake - p->lock_bottom - p->sill_height_lake;
+  real_t head_above_sill_dc_effective =
+      p->head_lake - p->lock_bottom - R(0.8) * p->sill_height_lake;
+
+  exchange_profile_t e;
+  e.volume =
+      head_above_sill_dc_effective / (p->head_lake - p->lock_bottom) * o->volume_lock_at_lake;
+
+  real_t velocity_flushing = o->flushing_discharge / (p->lock_width * head_above_sill);
+
+  real_t sal_diff = sal_lock_2a - p->salinity_lake;
+  real_t velocity_exchange_raw =
+      R(0.5) * SQRT(o->g * R(0.8) * sal_diff / o->density_average * head_above_sill_dc_effective);
+
+  e.has_raw = p->distance_door_bubble_screen_lake != 0.0;
+  if (e.has_raw) {
+    real_t velocity_t_raw_exchange =
+        velocity_exchange_raw - COPYSIGN(velocity_flushing, p->distance_door_bubble_screen_lake);
+    velocity_t_raw_exchange = FMAX(velocity_t_raw_exchange, R(1E-10));
+    e.t_raw_exchange = FABS(p->distance_door_bubble_screen_lake) / velocity_t_raw_exchange;
+    e.frac_lock_exchange_raw =
+        FMAX((velocity_exchange_raw - velocity_flushing) / velocity_exchange_raw, 0.0);
+    e.t_lock_exchange_raw = 2 * p->lock_length / velocity_exchange_raw;
+  }
+
+  real_t velocity_exchange_eta = p->density_current_factor_lake * velocity_exchange_raw;
+  e.has_eta = 1;
+  e.frac_lock_exchange =
+      FMAX((velocity_exchange_eta - velocity_flushing) / velocity_exchange_eta, 0.0);
+  e.t_lock_exchange = 2 * p->lock_length / velocity_exchange_eta;
+
+  for (int i = 0; i < num_times; i++) {
+    real_t t = times[i];
+
+    real_t rate_exchange;
+    real_t volume_exchange_2 = exchange_volume(&e, t, &rate_exchange);
+
+    real_t volume_flush = o->flushing_discharge * t;
+    real_t max_volume_flush_refresh = e.volume - volume_exchange_2;
+    real_t volume_flush_refresh = FMIN(volume_flush, max_volume_flush_refresh);
+    real_t volume_flush_passthrough = FMAX(volume_flush - max_volume_flush_refresh, 0.0);
+
+    real_t mt_sea_2 =
+        volume_flush_refresh * sal_lock_2a + volume_flush_passthrough * p->salinity_lake;
+    real_t mt_to_lake_2b = volume_exchange_2 * sal_lock_2a;
+    real_t mt_from_lake_2b = (volume_exchange_2 + volume_flush) * p->salinity_lake;
+
+    // Subphase c. Ships entering the lock chamber at the end of the phase
+    real_t volume_ship_enter = 0.0;
+    real_t mt_lake_2_ship_enter = 0.0;
+    if (t >= t_open_lake) {
+      real_t saltmass_lock_2b = saltmass_lock_2a + mt_from_lake_2b - mt_to_lake_2b - mt_sea_2;
+      real_t sal_lock_2b = saltmass_lock_2b / o->volume_lock_at_lake;
+      volume_ship_enter = p->ship_volume_lake_to_sea;
+      mt_lake_2_ship_enter = -1 * p->ship_volume_lake_to_sea * sal_lock_2b;
+    }
+
+    // Once the lock has been refreshed, the flushing water passes through,
+    // except for the water that is still being displaced by lock exchange.
+    real_t rate_refresh =
+        (volume_flush < max_volume_flush_refresh) ? o->flushing_discharge : -rate_exchange;
+
+    phase_transports_t *r = &samples[i];
+    r->mass_transport_lake =
+        mt_lake_2_ship_exit + mt_lake_2_ship_enter + mt_from_lake_2b - mt_to_lake_2b;
+    r->volume_from_lake = volume_ship_in_lock_1 + (volume_exchange_2 + volume_flush);
+    r->volume_to_lake = volume_exchange_2 + volume_ship_enter;
+    r->discharge_from_lake = rate_exchange + o->flushing_discharge;
+    r->discharge_to_lake = rate_exchange;
+    r->salinity_to_lake = sal_lock_2a;
+
+    r->mass_transport_sea = mt_sea_2;
+    r->volume_from_sea = 0.0;
+    r->volume_to_sea = o->flushing_discharge * t;
+    r->discharge_from_sea = 0.0;
+    r->discharge_to_sea = o->flushing_discharge;
+    r->salinity_to_sea = (o->flushing_discharge > 0.0)
+                             ? (rate_refresh * sal_lock_2a +
+                                (o->flushing_discharge - rate_refresh) * p->salinity_lake) /
+                                   o->flushing_discharge
+                             : sal_lock_1;
+  }
+}
+
+static inline void resolve_phase_4(const param_t *p, const derived_parameters_t *o,
+                                   real_t t_open_sea, const phase_state_t *state, int num_times,
+                                   const real_t *times, phase_transports_t *samples) {
+  real_t sal_lock_3 = state->salinity_lock;
+  real_t volume_ship_in_lock_3 = state->volume_ship_in_lock;
+
+  // Subphase a. Ships exiting the lock chamber towards the sea
+  real_t mt_sea_4_ship_exit = -1 * volume_ship_in_lock_3 * p->salinity_sea;
+  real_t saltmass_lock_4a = state->saltmass_lock - mt_sea_4_ship_exit;
+  real_t sal_lock_4a = saltmass_lock_4a / o->volume_lock_at_sea;
+
+  // Subphase b. Flushing compensated lock exchange
+  real_t head_above_sill = p->head_sea - p->lock_bottom - p->sill_height_sea;
+  real_t head_above_sill_dc_effective = p->head_sea - p->lock_bottom - R(0.8) * p->sill_height_sea;
+
+  real_t velocity_flushing = o->flushing_discharge / (p->lock_width * head_above_sill);
+
+  real_t sal_diff = p->salinity_sea - sal_lock_4a;
+  real_t velocity_exchange_raw =
+      R(0.5) * SQRT(o->g * R(0.8) * sal_diff / o->density_average * head_above_sill_dc_effective);
+
+  real_t head_equilibrium =
+      CBRT(R(2.0) * POW(o->flushing_discharge / p->lock_width, R(2.0)) * o->density_average /
+           (o->g * R(0.8) * (p->salinity_sea - p->salinity_lake)));
+  head_equilibrium = FMIN(head_equilibrium, p->head_sea - p->lock_bottom);
+  real_t frac_lock_exchange =
+      (p->head_sea - p->lock_bottom - head_equilibrium) / (p->head_sea - p->lock_bottom);
+
+  exchange_profile_t e;
+  e.volume = o->volume_lock_at_sea;
+
+  e.has_raw = p->distance_door_bubble_screen_sea != 0.0;
+  if (e.has_raw) {
+    real_t velocity_t_raw_exchange =
+        velocity_exchange_raw + COPYSIGN(velocity_flushing, p->distance_door_bubble_screen_sea);
+    velocity_t_raw_exchange = FMAX(velocity_t_raw_exchange, R(1E-10));
+    e.t_raw_exchange = FABS(p->distance_door_bubble_screen_sea) / velocity_t_raw_exchange;
+    e.frac_lock_exchange_raw = frac_lock_exchange;
+    e.t_lock_exchange_raw =
+        2 * p->lock_length * frac_lock_exchange / (velocity_exchange_raw - velocity_flushing);
+  }
+
+  real_t velocity_exchange_eta = p->density_current_factor_sea * velocity_exchange_raw;
+  e.has_eta = velocity_exchange_eta > velocity_flushing;
+  e.frac_lock_exchange = frac_lock_exchange;
+  e.t_lock_exchange =
+      e.has_eta ? 2 * p->lock_length * frac_lock_exchange /
+                      (velocity_exchange_eta - velocity_flushing)
+                : R(0.0);
+
+  for (int i = 0; i < num_times; i++) {
+    real_t t = times[i];
+
+    real_t rate_exchange;
+    real_t volume_exchange_4 = exchange_volume(&e, t, &rate_exchange);
+
+    real_t volume_flush = o->flushing_discharge * t;
+    real_t max_volume_flush_refresh = o->volume_lock_at_sea - volume_exchange_4;
+    real_t volume_flush_refresh = FMIN(volume_flush, max_volume_flush_refresh);
+    real_t volume_flush_passthrough = FMAX(volume_flush - max_volume_flush_refresh, 0.0);
+
+    real_t mt_lake_4 =
+        volume_flush_refresh * p->salinity_lake + volume_flush_passthrough * p->salinity_lake;
+    real_t mt_sea_4_flushing =
+        volume_flush_refresh * sal_lock_4a + volume_flush_passthrough * p->salinity_lake;
+
+    real_t mt_to_sea_4b = mt_sea_4_flushing + volume_exchange_4 * sal_lock_4a;
+    real_t mt_from_sea_4b = volume_exchange_4 * p->salinity_sea;
+
+    // Subphase c. Ships entering the lock chamber at the end of the phase
+    real_t volume_ship_enter = 0.0;
+    real_t mt_sea_4_ship_enter = 0.0;
+    if (t >= t_open_sea) {
+      real_t saltmass_lock_4b = saltmass_lock_4a + mt_from_sea_4b - mt_to_sea_4b + mt_lake_4;
+      real_t sal_lock_4b = saltmass_lock_4b / o->volume_lock_at_sea;
+      volume_ship_enter = p->ship_volume_sea_to_lake;
+      mt_sea_4_ship_enter = p->ship_volume_sea_to_lake * sal_lock_4b;
+    }
+
+    // Once the lock has been refreshed, the flushing water passes through,
+    // except for the water that is still being displaced by lock exchange.
+    real_t rate_refresh =
+        (volume_flush < max_volume_flush_refresh) ? o->flushing_discharge : -rate_exchange;
+    real_t discharge_to_sea = rate_exchange + o->flushing_discharge;
+    real_t rate_mt_to_sea = rate_refresh * sal_lock_4a +
+                            (o->flushing_discharge - rate_refresh) * p->salinity_lake +
+                            rate_exchange * sal_lock_4a;
+
+    phase_transports_t *r = &samples[i];
+    r->mass_transport_lake = mt_lake_4;
+    r->volume_from_lake = volume_flush;
+    r->volume_to_lake = 0.0;
+    r->discharge_from_lake = o->flushing_discharge;
+    r->discharge_to_lake = 0.0;
+    r->salinity_to_lake = sal_lock_3;
+
+    r->mass_transport_sea =
+        mt_sea_4_ship_exit + mt_sea_4_ship_enter + mt_to_sea_4b - mt_from_sea_4b;
+    r->volume_from_sea = volume_exchange_4 + volume_ship_in_lock_3;
+    r->volume_to_sea = (volume_exchange_4 + volume_flush) + volume_ship_enter;
+    r->discharge_from_sea = rate_exchange;
+    r->discharge_to_sea = discharge_to_sea;
+    r->salinity_to_sea = (discharge_to_sea > 0.0) ? rate_mt_to_sea / discharge_to_sea : sal_lock_3;
+  }
+}
+
+static inline void resolve_flush_doors_closed(const param_t *p, const derived_parameters_t *o,
+                                              const phase_state_t *state, int num_times,
+                                              const real_t *times, phase_transports_t *samples) {
+  real_t sal_diff = state->salinity_lock - p->salinity_lake;
+  real_t volume_water_in_lock =
+      p->lock_length * p->lock_width * (state->head_lock - p->lock_bottom) -
+      state->volume_ship_in_lock;
+
+  real_t lam_exp = o->flushing_discharge * sal_diff / state->saltmass_lock;
+
+  for (int i = 0; i < num_times; i++) {
+    real_t t = times[i];
+
+    real_t decay = EXP(-R(1.0) * lam_exp * t);
+    real_t saltmass_lock =
+        volume_water_in_lock * sal_diff * decay + volume_water_in_lock * p->salinity_lake;
+    real_t saltmass_out = state->saltmass_lock - saltmass_lock;
+    real_t rate_saltmass_out = volume_water_in_lock * sal_diff * lam_exp * decay;
+
+    real_t sal_lock = saltmass_lock / volume_water_in_lock;
+    sal_lock = FMAX(sal_lock, p->salinity_lake);
+    sal_lock = FMIN(sal_lock, p->salinity_sea);
+
+    phase_transports_t *r = &samples[i];
+    r->mass_transport_lake = o->flushing_discharge * t * p->salinity_lake;
+    r->volume_from_lake = o->flushing_discharge * t;
+    r->volume_to_lake = 0.0;
+    r->discharge_from_lake = o->flushing_discharge;
+    r->discharge_to_lake = 0.0;
+    r->salinity_to_lake = sal_lock;
+
+    r->mass_transport_sea = saltmass_out;
+    r->volume_from_sea = 0.0;
+    r->volume_to_sea = o->flushing_discharge * t;
+    r->discharge_from_sea = 0.0;
+    r->discharge_to_sea = o->flushing_discharge;
+    r->salinity_to_sea =
+        (o->flushing_discharge > 0.0) ? rate_saltmass_out / o->flushing_discharge : sal_lock;
+  }
+}
+
+// Replay of countermeasure variants
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The same lockages stepped for parameter sets that differ only in the
+// countermeasures (density current factors, bubble screens, sills and
+// flushing discharges). The head and the ship volume in the lock do not
+// depend on those, so they are shared, and every variant is a lane with
+// only its own salinity and salt mass. The terms of the step_* kernels with
+// all features enabled that depend on neither are calculated once per
+// lockage, and those that depend on the countermeasures only once per lane.
+typedef struct variant_lane_t {
+  real_t flushing_discharge;
+  real_t density_current_factor_lake;
+  real_t density_current_factor_sea;
+  real_t distance_door_bubble_screen_lake;
+  real_t distance_door_bubble_screen_sea;
+
+  real_t head_above_sill_dc_effective_lake;
+  real_t head_above_sill_dc_effective_sea;
+  real_t volume_lock_at_lake_effective;
+  real_t velocity_flushing_lake;
+  real_t velocity_flushing_sea;
+  real_t frac_lock_exchange_sea;
+
+  real_t salinity_lock;
+  real_t saltmass_lock;
+} variant_lane_t;
+
+static inline void variant_lane_init(const param_t *p, const derived_parameters_t *o,
+                                     const phase_state_t *state, variant_lane_t *v) {
+  v->flushing_discharge = o->flushing_discharge;
+  v->density_current_factor_lake = p->density_current_factor_lake;
+  v->density_current_factor_sea = p->density_current_factor_sea;
+  v->distance_door_bubble_screen_lake = p->distance_door_bubble_screen_lake;
+  v->distance_door_bubble_screen_sea = p->distance_door_bubble_screen_sea;
+
+  real_t head_above_sill_lake = p->head_lake - p->lock_bottom - p->sill_height_lake;
+  v->head_above_sill_dc_effective_lake =
+      p->head_lake - p->lock_bottom - R(0.8) * p->sill_height_lake;
+  v->volume_lock_at_lake_effective = v->head_above_sill_dc_effective_lake /
+                                     (p->head_lake - p->lock_bottom) * o->volume_lock_at_lake;
+  v->velocity_flushing_lake = o->flushing_discharge / (p->lock_width * head_above_sill_lake);
+
+  real_t head_above_sill_sea = p->head_sea - p->lock_bottom - p->sill_height_sea;
+  v->head_above_sill_dc_effective_sea = p->head_sea - p->lock_bottom - R(0.8) * p->sill_height_sea;
+  v->velocity_flushing_sea = o->flushing_discharge / (p->lock_width * head_above_sill_sea);
+
+  real_t head_equilibrium =
+      CBRT(R(2.0) * POW(o->flushing_discharge / p->lock_width, R(2.0)) * o->density_average /
+           (o->g * R(0.8) * (p->salinity_sea - p->salinity_lake)));
+  head_equilibrium = FMIN(head_equilibrium, p->head_sea - p->lock_bottom);
+  v->frac_lock_exchange_sea =
+      (p->head_sea - p->lock_bottom - head_equilibrium) / (p->head_sea - p->lock_bottom);
+
+  v->salinity_lock = state->salinity_lock;
+  v->saltmass_lock = state->saltmass_lock;
+}
+
+static inline void replay_phase_1(const param_t *p, const derived_parameters_t *o, real_t t_level,
+                                  phase_state_t *state, int num_lanes, variant_lane_t *lanes,
+                                  phase_transports_t *results) {
+  real_t vol_to_lake = FMAX(state->head_lock - p->head_lake, 0.0) * p->lock_width * p->lock_length;
+  real_t vol_from_lake =
+      FMAX(p->head_lake - state->head_lock, 0.0) * p->lock_width * p->lock_length;
+  real_t mt_from_lake = vol_from_lake * p->salinity_lake;
+  real_t volume_water_in_lock = o->volume_lock_at_lake - state->volume_ship_in_lock;
+
+  phase_transports_t shared = {0};
+  shared.volume_from_lake = vol_from_lake;
+  shared.volume_to_lake = vol_to_lake;
+  shared.discharge_from_lake = vol_from_lake / t_level;
+  shared.discharge_to_lake = vol_to_lake / t_level;
+
+  for (int k = 0; k < num_lanes; k++) {
+    variant_lane_t *v = &lanes[k];
+    real_t sal_lock_4 = v->salinity_lock;
+    real_t mt_lake_1 = mt_from_lake - vol_to_lake * sal_lock_4;
+
+    real_t sal_lock_1 = (v->saltmass_lock + mt_lake_1) / volume_water_in_lock;
+    ASSERT_WITHIN_BOUNDS(sal_lock_1, p->salinity_lake, p->salinity_sea);
+    sal_lock_1 = FMAX(sal_lock_1, p->salinity_lake);
+    sal_lock_1 = FMIN(sal_lock_1, p->salinity_sea);
+
+    phase_transports_t *r = &results[k];
+    *r = shared;
+    r->mass_transport_lake = mt_lake_1;
+    r->salinity_to_lake = sal_lock_4;
+    r->salinity_to_sea = sal_lock_4;
+
+    v->salinity_lock = sal_lock_1;
+    v->saltmass_lock = sal_lock_1 * volume_water_in_lock;
+  }
+
+  state->head_lock = p->head_lake;
+}
+
+static inline void replay_phase_2(const param_t *p, const derived_parameters_t *o,
+                                  real_t t_open_lake, phase_state_t *state, int num_lanes,
+                                  variant_lane_t *lanes, phase_transports_t *results) {
+  real_t volume_ship_in_lock_1 = state->volume_ship_in_lock;
+  real_t mt_lake_2_ship_exit = volume_ship_in_lock_1 * p->salinity_lake;
+  real_t volume_water_in_lock_2 = o->volume_lock_at_lake - p->ship_volume_lake_to_sea;
+  real_t g_reduced = o->g * R(0.8);
+
+  for (int k = 0; k < num_lanes; k++) {
+    variant_lane_t *v = &lanes[k];
+    real_t sal_lock_1 = v->salinity_lock;
+    real_t saltmass_lock_1 = v->saltmass_lock;
+
+    // Subphase a. Ships exiting the lock chamber towards the lake
+    real_t saltmass_lock_2a = saltmass_lock_1 + mt_lake_2_ship_exit;
+    real_t sal_lock_2a = saltmass_lock_2a / o->volume_lock_at_lake;
+
+    // Subphase b. Flushing compensated lock exchange
+    real_t velocity_flushing = v->velocity_flushing_lake;
+    real_t sal_diff = sal_lock_2a - p->salinity_lake;
+    real_t velocity_exchange_raw = R(0.5) * SQRT(g_reduced * sal_diff / o->density_average *
+                                                 v->head_above_sill_dc_effective_lake);
+
+    real_t volume_exchange_2 = 0.0;
+    real_t t_raw_exchange = 0.0;
+
+    if (v->distance_door_bubble_screen_lake != 0.0) {
+      real_t velocity_t_raw_exchange =
+          velocity_exchange_raw - COPYSIGN(velocity_flushing, v->distance_door_bubble_screen_lake);
+      velocity_t_raw_exchange = FMAX(velocity_t_raw_exchange, R(1E-10));
+      t_raw_exchange = FABS(v->distance_door_bubble_screen_lake) / velocity_t_raw_exchange;
+      t_raw_exchange = FMIN(t_raw_exchange, t_open_lake);
+
+      real_t frac_lock_exchange_raw =
+          FMAX((velocity_exchange_raw - velocity_flushing) / velocity_exchange_raw, 0.0);
+      real_t t_lock_exchange_raw = 2 * p->lock_length / velocity_exchange_raw;
+      volume_exchange_2 += frac_lock_exchange_raw * v->volume_lock_at_lake_effective *
+                           TANH(t_raw_exchange / t_lock_exchange_raw);
+    }
+
+    real_t velocity_exchange_eta = v->density_current_factor_lake * velocity_exchange_raw;
+    real_t frac_lock_exchange =
+        FMAX((velocity_exchange_eta - velocity_flushing) / velocity_exchange_eta, 0.0);
+    real_t t_lock_exchange = 2 * p->lock_length / velocity_exchange_eta;
+    volume_exchange_2 += frac_lock_exchange *
+                         (v->volume_lock_at_lake_effective - volume_exchange_2) *
+                         TANH(FMAX(t_open_lake - t_raw_exchange, 0.0) / t_lock_exchange);
+
+    real_t volume_flush = v->flushing_discharge * t_open_lake;
+    real_t max_volume_flush_refresh = v->volume_lock_at_lake_effective - volume_exchange_2;
+    real_t volume_flush_refresh = FMIN(volume_flush, max_volume_flush_refresh);
+    real_t volume_flush_passthrough = FMAX(volume_flush - max_volume_flush_refresh, 0.0);
+
+    real_t mt_sea_2 =
+        volume_flush_refresh * sal_lock_2a + volume_flush_passthrough * p->salinity_lake;
+    real_t mt_to_lake_2b = volume_exchange_2 * sal_lock_2a;
+    real_t mt_from_lake_2b = (volume_exchange_2 + volume_flush) * p->salinity_lake;
+
+    // Subphase c. Ship entering the lock chamber from the lake
+    real_t saltmass_lock_2b = saltmass_lock_2a + mt_from_lake_2b - mt_to_lake_2b - mt_sea_2;
+    real_t sal_lock_2b = saltmass_lock_2b / o->volume_lock_at_lake;
+    real_t mt_lake_2_ship_enter = -1 * p->ship_volume_lake_to_sea * sal_lock_2b;
+
+    real_t mt_lake_2 = mt_lake_2_ship_exit + mt_lake_2_ship_enter + mt_from_lake_2b - mt_to_lake_2b;
+    real_t sal_lock_2 = (saltmass_lock_1 + mt_lake_2 - mt_sea_2) / volume_water_in_lock_2;
+    ASSERT_WITHIN_BOUNDS(sal_lock_2, p->salinity_lake, p->salinity_sea);
+    sal_lock_2 = FMAX(sal_lock_2, p->salinity_lake);
+    sal_lock_2 = FMIN(sal_lock_2, p->salinity_sea);
+
+    phase_transports_t *r = &results[k];
+    r->mass_transport_lake = mt_lake_2;
+    r->volume_from_lake = volume_ship_in_lock_1 + (volume_exchange_2 + volume_flush);
+    r->volume_to_lake = volume_exchange_2 + p->ship_volume_lake_to_sea;
+    r->discharge_from_lake = r->volume_from_lake / t_open_lake;
+    r->discharge_to_lake = r->volume_to_lake / t_open_lake;
+    r->salinity_to_lake =
+        (r->volume_to_lake > 0.0)
+            ? -1 * (mt_lake_2 - r->volume_from_lake * p->salinity_lake) / r->volume_to_lake
+            : sal_lock_1;
+
+    r->mass_transport_sea = mt_sea_2;
+    r->volume_from_sea = 0.0;
+    r->volume_to_sea = v->flushing_discharge * t_open_lake;
+    r->discharge_from_sea = 0.0;
+    r->discharge_to_sea = v->flushing_discharge;
+    r->salinity_to_sea = (r->volume_to_sea > 0.0) ? mt_sea_2 / r->volume_to_sea : sal_lock_1;
+
+    v->salinity_lock = sal_lock_2;
+    v->saltmass_lock = sal_lock_2 * volume_water_in_lock_2;
+  }
+
+  state->volume_ship_in_lock = p->ship_volume_lake_to_sea;
+}
+
+static inline void replay_phase_3(const param_t *p, const derived_parameters_t *o, real_t t_level,
+                                  phase_state_t *state, int num_lanes, variant_lane_t *lanes,
+                                  phase_transports_t *results) {
+  real_t vol_to_sea = FMAX(state->head_lock - p->head_sea, 0.0) * p->lock_width * p->lock_length;
+  real_t vol_from_sea = FMAX(p->head_sea - state->head_lock, 0.0) * p->lock_width * p->lock_length;
+  real_t mt_from_sea = vol_from_sea * p->salinity_sea;
+  real_t volume_water_in_lock = o->volume_lock_at_sea - state->volume_ship_in_lock;
+
+  phase_transports_t shared = {0};
+  shared.volume_from_sea = vol_from_sea;
+  shared.volume_to_sea = vol_to_sea;
+  shared.discharge_from_sea = vol_from_sea / t_level;
+  shared.discharge_to_sea = vol_to_sea / t_level;
+
+  for (int k = 0; k < num_lanes; k++) {
+    variant_lane_t *v = &lanes[k];
+    real_t sal_lock_2 = v->salinity_lock;
+    real_t mt_sea_3 = vol_to_sea * sal_lock_2 - mt_from_sea;
+
+    real_t sal_lock_3 = (v->saltmass_lock - mt_sea_3) / volume_water_in_lock;
+    ASSERT_WITHIN_BOUNDS(sal_lock_3, p->salinity_lake, p->salinity_sea);
+    sal_lock_3 = FMAX(sal_lock_3, p->salinity_lake);
+    sal_lock_3 = FMIN(sal_lock_3, p->salinity_sea);
+
+    phase_transports_t *r = &results[k];
+    *r = shared;
+    r->mass_transport_sea = mt_sea_3;
+    r->salinity_to_lake = sal_lock_2;
+    r->salinity_to_sea = sal_lock_2;
+
+    v->salinity_lock = sal_lock_3;
+    v->saltmass_lock = sal_lock_3 * volume_water_in_lock;
+  }
+
+  state->head_lock = p->head_sea;
+}
+
+static inline void replay_phase_4(const param_t *p, const derived_parameters_t *o,
+                                  real_t t_open_sea, phase_state_t *state, int num_lanes,
+                                  variant_lane_t *lanes, phase_transports_t *results) {
+  real_t volume_ship_in_lock_3 = state->volume_ship_in_lock;
+  real_t mt_sea_4_ship_exit = -1 * volume_ship_in_lock_3 * p->salinity_sea;
+  real_t volume_water_in_lock_4 = o->volume_lock_at_sea - p->ship_volume_sea_to_lake;
+  real_t g_reduced = o->g * R(0.8);
+
+  for (int k = 0; k < num_lanes; k++) {
+    variant_lane_t *v = &lanes[k];
+    real_t sal_lock_3 = v->salinity_lock;
+    real_t saltmass_lock_3 = v->saltmass_lock;
+
+    // Subphase a. Ships exiting the lock chamber towards the sea
+    real_t saltmass_lock_4a = saltmass_lock_3 - mt_sea_4_ship_exit;
+    real_t sal_lock_4a = saltmass_lock_4a / o->volume_lock_at_sea;
+
+    // Subphase b. Flushing compensated lock exchange
+    real_t velocity_flushing = v->velocity_flushing_sea;
+    real_t frac_lock_exchange = v->frac_lock_exchange_sea;
+    real_t sal_diff = p->salinity_sea - sal_lock_4a;
+    real_t velocity_exchange_raw = R(0.5) * SQRT(g_reduced * sal_diff / o->density_average *
+                                                 v->head_above_sill_dc_effective_sea);
+
+    real_t volume_exchange_4 = 0.0;
+    real_t t_raw_exchange = 0.0;
+
+    if (v->distance_door_bubble_screen_sea != 0.0) {
+      real_t velocity_t_raw_exchange =
+          velocity_exchange_raw + COPYSIGN(velocity_flushing, v->distance_door_bubble_screen_sea);
+      velocity_t_raw_exchange = FMAX(velocity_t_raw_exchange, R(1E-10));
+      t_raw_exchange = FABS(v->distance_door_bubble_screen_sea) / velocity_t_raw_exchange;
+      t_raw_exchange = FMIN(t_raw_exchange, t_open_sea);
+
+      real_t t_lock_exchange_raw =
+          2 * p->lock_length * frac_lock_exchange / (velocity_exchange_raw - velocity_flushing);
+      volume_exchange_4 +=
+          frac_lock_exchange * o->volume_lock_at_sea * TANH(t_raw_exchange / t_lock_exchange_raw);
+    }
+
+    real_t velocity_exchange_eta = v->density_current_factor_sea * velocity_exchange_raw;
+    if (velocity_exchange_eta > velocity_flushing) {
+      real_t t_lock_exchange =
+          2 * p->lock_length * frac_lock_exchange / (velocity_exchange_eta - velocity_flushing);
+      volume_exchange_4 += frac_lock_exchange * (o->volume_lock_at_sea - volume_exchange_4) *
+                           TANH(FMAX(t_open_sea - t_raw_exchange, 0.0) / t_lock_exchange);
+    }
+
+    real_t volume_flush = v->flushing_discharge * t_open_sea;
+    real_t max_volume_flush_refresh = o->volume_lock_at_sea - volume_exchange_4;
+    real_t volume_flush_refresh = FMIN(volume_flush, max_volume_flush_refresh);
+    real_t volume_flush_passthrough = FMAX(volume_flush - max_volume_flush_refresh, 0.0);
+
+    real_t mt_from_lake_4b =
+        volume_flush_refresh * p->salinity_lake + volume_flush_passthrough * p->salinity_lake;
+    real_t mt_to_sea_4b = volume_flush_refresh * sal_lock_4a +
+                          volume_flush_passthrough * p->salinity_lake +
+                          volume_exchange_4 * sal_lock_4a;
+    real_t mt_from_sea_4b = volume_exchange_4 * p->salinity_sea;
+
+    // Subphase c. Ship entering the lock chamber from the sea
+    real_t saltmass_lock_4b = saltmass_lock_4a + mt_from_sea_4b - mt_to_sea_4b + mt_from_lake_4b;
+    real_t sal_lock_4b = saltmass_lock_4b / o->volume_lock_at_sea;
+    real_t mt_sea_4_ship_enter = p->ship_volume_sea_to_lake * sal_lock_4b;
+
+    real_t mt_sea_4 = mt_sea_4_ship_exit + mt_sea_4_ship_enter + mt_to_sea_4b - mt_from_sea_4b;
+    real_t mt_lake_4 = mt_from_lake_4b;
+    real_t sal_lock_4 = (saltmass_lock_3 + mt_lake_4 - mt_sea_4) / volume_water_in_lock_4;
+    ASSERT_WITHIN_BOUNDS(sal_lock_4, p->salinity_lake, p->salinity_sea);
+    sal_lock_4 = FMAX(sal_lock_4, p->salinity_lake);
+    sal_lock_4 = FMIN(sal_lock_4, p->salinity_sea);
+
+    phase_transports_t *r = &results[k];
+    r->mass_transport_lake = mt_lake_4;
+    r->volume_from_lake = volume_flush;
+    r->volume_to_lake = 0.0;
+    r->discharge_from_lake = v->flushing_discharge;
+    r->discharge_to_lake = 0.0;
+    r->salinity_to_lake = sal_lock_3;
+
+    r->mass_transport_sea = mt_sea_4;
+    r->volume_from_sea = volume_exchange_4 + volume_ship_in_lock_3;
+    r->volume_to_sea = volume_exchange_4 + volume_flush + p->ship_volume_sea_to_lake;
+    r->discharge_from_sea = r->volume_from_sea / t_open_sea;
+    r->discharge_to_sea = r->volume_to_sea / t_open_sea;
+    r->salinity_to_sea =
+        (r->volume_to_sea > 0.0)
+            ? (mt_sea_4 + r->volume_from_sea * p->salinity_sea) / r->volume_to_sea
+            : sal_lock_3;
+
+    v->salinity_lock = sal_lock_4;
+    v->saltmass_lock = sal_lock_4 * volume_water_in_lock_4;
+  }
+
+  state->volume_ship_in_lock = p->ship_volume_sea_to_lake;
+}
+
+static inline void replay_flush_doors_closed(const param_t *p, real_t t_flushing,
+                                             phase_state_t *state, int num_lanes,
+                                             variant_lane_t *lanes, phase_transports_t *results) {
+  real_t volume_water_in_lock =
+      p->lock_length * p->lock_width * (state->head_lock - p->lock_bottom) -
+      state->volume_ship_in_lock;
+
+  for (int k = 0; k < num_lanes; k++) {
+    variant_lane_t *v = &lanes[k];
+    real_t sal_diff = v->salinity_lock - p->salinity_lake;
+
+    real_t lam_exp = v->flushing_discharge * sal_diff / v->saltmass_lock;
+    real_t saltmass_lock = volume_water_in_lock * sal_diff * EXP(-R(1.0) * lam_exp * t_flushing) +
+                           volume_water_in_lock * p->salinity_lake;
+    real_t saltmass_out = v->saltmass_lock - saltmass_lock;
+
+    real_t sal_lock = saltmass_lock / volume_water_in_lock;
+    ASSERT_WITHIN_BOUNDS(sal_lock, p->salinity_lake, p->salinity_sea);
+    sal_lock = FMAX(sal_lock, p->salinity_lake);
+    sal_lock = FMIN(sal_lock, p->salinity_sea);
+
+    phase_transports_t *r = &results[k];
+    r->mass_transport_lake = v->flushing_discharge * t_flushing * p->salinity_lake;
+    r->volume_from_lake = v->flushing_discharge * t_flushing;
+    r->volume_to_lake = 0.0;
+    r->discharge_from_lake = v->flushing_discharge;
+    r->discharge_to_lake = 0.0;
+    r->salinity_to_lake = sal_lock;
+
+    r->mass_transport_sea = saltmass_out;
+    r->volume_from_sea = 0.0;
+    r->volume_to_sea = v->flushing_discharge * t_flushing;
+    r->discharge_from_sea = 0.0;
+    r->discharge_to_sea = v->flushing_discharge;
+    r->salinity_to_sea = (r->volume_to_sea > 0.0) ? saltmass_out / r->volume_to_sea : sal_lock;
+
+    v->salinity_lock = sal_lock;
+    v->saltmass_lock = sal_lock * volume_water_in_lock;
+  }
+}
+
+// The transports and salinities of the last locking cycle when iterating to
+// a steady state.
+typedef struct steady_cycle_t {
+  phase_transports_t tp1;
+  phase_transports_t tp2;
+  phase_transports_t tp3;
+  phase_transports_t tp4;
+  real_t sal_lock_1;
+  real_t sal_lock_2;
+  real_t sal_lock_3;
+  real_t sal_lock_4;
+} steady_cycle_t;
+
+// Volume and mass totals over one steady locking cycle
+typedef struct steady_totals_t {
+  real_t mt_lake;
+  real_t vol_from_lake;
+  real_t vol_to_lake;
+  real_t mt_sea;
+  real_t vol_from_sea;
+  real_t vol_to_sea;
+} steady_totals_t;
+
+static forceinline void steady_cycle(const param_t *p, const derived_parameters_t *o,
+                                     phase_state_t *state, steady_cycle_t *c, const int features) {
+  step_phase_1(p, o, p->leveling_time, state, &c->tp1, features);
+  c->sal_lock_1 = state->salinity_lock;
+
+  step_phase_2(p, o, o->t_open_lake, state, &c->tp2, features);
+  c->sal_lock_2 = state->salinity_lock;
+
+  step_phase_3(p, o, p->leveling_time, state, &c->tp3, features);
+  c->sal_lock_3 = state->salinity_lock;
+
+  step_phase_4(p, o, o->t_open_sea, state, &c->tp4, features);
+  c->sal_lock_4 = state->salinity_lock;
+}
+
+// The salinity of the lock only enters the phases linearly, except through
+// the velocity of the lock exchange and the clipping to the boundary
+// salinities. When the lock exchange is saturated (the TANH is one) or
+// suppressed by the flushing, the exchanged volumes do not depend on the
+// salinity, and a locking cycle is an affine map of the start salinity. We
+// recognize that regime by the volumes being identical for two cycles.
+static forceinline int same_volumes(const phase_transports_t *a, const phase_transports_t *b) {
+  return a->volume_from_lake == b->volume_from_lake && a->volume_to_lake == b->volume_to_lake &&
+         a->volume_from_sea == b->volume_from_sea && a->volume_to_sea == b->volume_to_sea;
+}
+
+static forceinline int within_bounds(const param_t *p, real_t sal) {
+  return sal > p->salinity_lake && sal < p->salinity_sea;
+}
+
+static forceinline int steady_cycle_is_affine(const param_t *p, const steady_cycle_t *c0,
+                                              const steady_cycle_t *c1) {
+  return same_volumes(&c0->tp1, &c1->tp1) && same_volumes(&c0->tp2, &c1->tp2) &&
+         same_volumes(&c0->tp3, &c1->tp3) && same_volumes(&c0->tp4, &c1->tp4) &&
+         within_bounds(p, c0->sal_lock_1) && within_bounds(p, c0->sal_lock_2) &&
+         within_bounds(p, c0->sal_lock_3) && within_bounds(p, c0->sal_lock_4) &&
+         within_bounds(p, c1->sal_lock_1) && within_bounds(p, c1->sal_lock_2) &&
+         within_bounds(p, c1->sal_lock_3) && within_bounds(p, c1->sal_lock_4);
+}
+
+// Linear extrapolation x1 + theta * (x1 - x0) of every quantity of a cycle,
+// which is exact when the cycle is affine.
+#define EXTRAPOLATE(x) x1->x += theta * (x1->x - x0->x)
+
+static forceinline void extrapolate_transports(const phase_transports_t *x0,
+                                               phase_transports_t *x1, real_t theta) {
+  EXTRAPOLATE(mass_transport_lake);
+  EXTRAPOLATE(volume_from_lake);
+  EXTRAPOLATE(volume_to_lake);
+  EXTRAPOLATE(discharge_from_lake);
+  EXTRAPOLATE(discharge_to_lake);
+  EXTRAPOLATE(salinity_to_lake);
+  EXTRAPOLATE(mass_transport_sea);
+  EXTRAPOLATE(volume_from_sea);
+  EXTRAPOLATE(volume_to_sea);
+  EXTRAPOLATE(discharge_from_sea);
+  EXTRAPOLATE(discharge_to_sea);
+  EXTRAPOLATE(salinity_to_sea);
+}
+
+static forceinline void extrapolate_cycle(const steady_cycle_t *x0, steady_cycle_t *x1,
+                                          real_t theta) {
+  extrapolate_transports(&x0->tp1, &x1->tp1, theta);
+  extrapolate_transports(&x0->tp2, &x1->tp2, theta);
+  extrapolate_transports(&x0->tp3, &x1->tp3, theta);
+  extrapolate_transports(&x0->tp4, &x1->tp4, theta);
+  EXTRAPOLATE(sal_lock_1);
+  EXTRAPOLATE(sal_lock_2);
+  EXTRAPOLATE(sal_lock_3);
+  EXTRAPOLATE(sal_lock_4);
+}
+
+#undef EXTRAPOLATE
+
+static forceinline int steady_iterate(const param_t *p, const derived_parameters_t *o,
+                                      phase_state_t *state, steady_cycle_t *c,
+                                      const int features) {
+  // Direct solution in the affine regime
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // With s1 = F(s0) and s2 = F(s1) for an affine cycle map F, the periodic
+  // salinity is the fixed point s = s1 + (s2 - s1) / (1 - a), with slope
+  // a = (s2 - s1) / (s1 - s0). All other quantities of the cycle starting
+  // at s follow by extrapolation of the two cycles that were calculated.
+  real_t sal_lock_0 = state->salinity_lock;
+  steady_cycle_t c0;
+
+  steady_cycle(p, o, state, &c0, features);
+  if (is_close(c0.sal_lock_4, sal_lock_0, p->rtol, p->atol)) {
+    *c = c0;
+    return ZSF_SUCCESS;
+  }
+
+  steady_cycle(p, o, state, c, features);
+  if (is_close(c->sal_lock_4, c0.sal_lock_4, p->rtol, p->atol)) {
+    return ZSF_SUCCESS;
+  }
+
+  if (steady_cycle_is_affine(p, &c0, c)) {
+    real_t slope = (c->sal_lock_4 - c0.sal_lock_4) / (c0.sal_lock_4 - sal_lock_0);
+    real_t sal_lock = c0.sal_lock_4 + (c->sal_lock_4 - c0.sal_lock_4) / (R(1.0) - slope);
+
+    // A slope outside [0, 1) means that the regime changes somewhere
+    // between the start salinity and the fixed point.
+    if (slope >= 0.0 && slope < R(1.0) && within_bounds(p, sal_lock)) {
+      extrapolate_cycle(&c0, c, (sal_lock - c0.sal_lock_4) / (c0.sal_lock_4 - sal_lock_0));
+      c->sal_lock_4 = sal_lock;
+      return ZSF_SUCCESS;
+    }
+  }
+
+  // Fixed-point iteration otherwise
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  while (1) {
+    // Backup old salinity value for convergence check
+    real_t sal_lock_4_prev = state->salinity_lock;
+
+    steady_cycle(p, o, state, c, features);
+
+    // Convergence check
+    // ~~~~~~~~~~~~~~~~~
+    if (is_close(c->sal_lock_4, sal_lock_4_prev, p->rtol, p->atol)) {
+      return ZSF_SUCCESS;
+    }
+  }
+}
+
+// Instantiate the kernels and the steady state iteration for every
+// combination of features, so that they can be selected at run time with
+// kernel_features().
+typedef void (*step_kernel_t)(const param_t *, const derived_parameters_t *, real_t,
+                              phase_state_t *, phase_transports_t *);
+typedef int (*steady_kernel_t)(const param_t *, const derived_parameters_t *, phase_state_t *,
+                               steady_cycle_t *);
+
+#define FEATURE_VARIANTS(X, NAME)                                                                  \
+  X(NAME, 0) X(NAME, 1) X(NAME, 2) X(NAME, 3) X(NAME, 4) X(NAME, 5) X(NAME, 6) X(NAME, 7)          \
+  X(NAME, 8) X(NAME, 9) X(NAME, 10) X(NAME, 11) X(NAME, 12) X(NAME, 13) X(NAME, 14) X(NAME, 15)
+
+#define VARIANT_ENTRY(NAME, F) NAME##_##F,
+
+#define STEP_VARIANT(NAME, F)                                                                      \
+  static void NAME##_##F(const param_t *p, const derived_parameters_t *o, real_t t,                \
+                         phase_state_t *state, phase_transports_t *results) {                      \
+    NAME(p, o, t, state, results, F);                                                              \
+  }
+#define DEFINE_STEP_VARIANTS(NAME)                                                                 \
+  FEATURE_VARIANTS(STEP_VARIANT, NAME)                                                             \
+  static const step_kernel_t NAME##_variants[NUM_FEATURE_VARIANTS] = {                             \
+      FEATURE_VARIANTS(VARIANT_ENTRY, NAME)};
+
+#define STEADY_VARIANT(NAME, F)                                                                    \
+  static int NAME##_##F(const param_t *p, const derived_parameters_t *o, phase_state_t *state,     \
+                        steady_cycle_t *c) {                                                       \
+    return NAME(p, o, state, c, F);                                                                \
+  }
+
+DEFINE_STEP_VARIANTS(step_phase_1)
+DEFINE_STEP_VARIANTS(step_phase_2)
+DEFINE_STEP_VARIANTS(step_phase_3)
+DEFINE_STEP_VARIANTS(step_phase_4)
+DEFINE_STEP_VARIANTS(step_flush_doors_closed)
+
+FEATURE_VARIANTS(STEADY_VARIANT, steady_iterate)
+static const steady_kernel_t steady_iterate_variants[NUM_FEATURE_VARIANTS] = {
+    FEATURE_VARIANTS(VARIANT_ENTRY, steady_iterate)};
+
+static int steady_solve(const param_t *p, const derived_parameters_t *o, steady_cycle_t *c) {
+  // Start salinity and salt mass
+  phase_state_t state;
+
+  real_t sal_lock_4 = p->salinity_lock;
+  if (sal_lock_4 == ZSF_NAN)
+    sal_lock_4 = R(0.5) * (p->salinity_sea + p->salinity_lake);
+
+  state.volume_ship_in_lock = p->ship_volume_sea_to_lake;
+  state.saltmass_lock = sal_lock_4 * (o->volume_lock_at_sea - state.volume_ship_in_lock);
+  state.head_lock = p->head_sea;
+  state.salinity_lock = sal_lock_4;
+
+  int err = check_parameters_state(p, o, &state);
+  if (err) {
+    return err;
+  }
+
+  return steady_iterate_variants[kernel_features(p, o, &state)](p, o, &state, c);
+}
+
+static forceinline void steady_results(const param_t *p, const derived_parameters_t *o,
+                                       const steady_cycle_t *c, results_t *results,
+                                       steady_totals_t *t) {
+  const phase_transports_t *tp1 = &c->tp1;
+  const phase_transports_t *tp2 = &c->tp2;
+  const phase_transports_t *tp3 = &c->tp3;
+  const phase_transports_t *tp4 = &c->tp4;
+
+  // Cycle-averaged discharges and salinities
+  // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+  // Lake side
+  t->mt_lake = tp1->mass_transport_lake + tp2->mass_transport_lake + tp3->mass_transport_lake +
+               tp4->mass_transport_lake;
+
+  t->vol_from_lake =
+      tp1->volume_from_lake + tp2->volume_from_lake + tp3->volume_from_lake + tp4->volume_from_lake;
+  real_t disch_from_lake = t->vol_from_lake / o->t_cycle;
+
+  t->vol_to_lake =
+      tp1->volume_to_lake + tp2->volume_to_lake + tp3->volume_to_lake + tp4->volume_to_lake;
+  real_t disch_to_lake = t->vol_to_lake / o->t_cycle;
+
+  real_t salt_load_lake = t->mt_lake / o->t_cycle;
+  real_t sal_to_lake = -1 * (t->mt_lake - t->vol_from_lake * p->salinity_lake) / t->vol_to_lake;
+
+  // Sea side
+  t->mt_sea = tp1->mass_transport_sea + tp2->mass_transport_sea + tp3->mass_transport_sea +
+              tp4->mass_transport_sea;
+
+  t->vol_from_sea =
+      tp1->volume_from_sea + tp2->volume_from_sea + tp3->volume_from_sea + tp4->volume_from_sea;
+  real_t disch_from_sea = t->vol_from_sea / o->t_cycle;
+
+  t->vol_to_sea = tp1->volume_to_sea + tp2->volume_to_sea + tp3->volume_to_sea + tp4->volume_to_sea;
+  real_t disch_to_sea = t->vol_to_sea / o->t_cycle;
+
+  real_t salt_load_sea = t->mt_sea / o->t_cycle;
+  real_t sal_to_sea = (t->mt_sea + t->vol_from_sea * p->salinity_sea) / t->vol_to_sea;
+
+  // Put the main results in the output stucture
+  results->mass_transport_lake = t->mt_lake;
+  results->salt_load_lake = salt_load_lake;
+  results->discharge_from_lake = disch_from_lake;
+  results->discharge_to_lake = disch_to_lake;
+  results->salinity_to_lake = sal_to_lake;
+
+  results->mass_transport_sea = t->mt_sea;
+  results->salt_load_sea = salt_load_sea;
+  results->discharge_from_sea = disch_from_sea;
+  results->discharge_to_sea = disch_to_sea;
+  results->salinity_to_sea = sal_to_sea;
+}
+
+#endif
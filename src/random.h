@@ -0,0 +1,29 @@
+#ifndef ZSF_RANDOM_H
+#define ZSF_RANDOM_H
+
+#include <math.h>
+#include <stdint.h>
+
+// A small, fast and reproducible PRNG (splitmix64), so that random samples
+// are the same on every platform for the same seed.
+static inline double random_uniform(uint64_t *state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z = z ^ (z >> 31);
+  return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Exponentially distributed with unit mean
+static inline double random_exponential(uint64_t *state) {
+  return -log(1.0 - random_uniform(state));
+}
+
+// Standard normal distribution (Box-Muller)
+static inline double random_normal(uint64_t *state) {
+  double u1 = 1.0 - random_uniform(state);
+  double u2 = random_uniform(state);
+  return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+#endif
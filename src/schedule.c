@@ -0,0 +1,470 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aggregate.h"
+#include "errors.h"
+#include "zsf.h"
+
+#define SIDE_LAKE 0
+#define SIDE_SEA 1
+
+// Optimal operation of the lock over a period of traffic
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The lock visits its sides one after the other. On every visit the doors
+// open for a chosen time, in which the ships inside leave and the waiting
+// ships enter as long as they fit, after which the lock is flushed with the
+// doors closed for a chosen time. The lock then levels towards the other
+// side, or if it is empty, waits with the doors closed for the next ship.
+//
+// The door open and flushing times of every visit are optimised by a local
+// search: every visit in turn, we try all candidate times and keep the one
+// that leads to the least salt intrusion into the lake over the whole
+// period, while no ship waits longer than allowed and no more flushing water
+// is used than available. The state of the simulation before every visit is
+// kept, so a candidate only needs to be stepped from the visit it changes.
+
+// Maximum number of passes of the local search over all visits
+#define MAX_SWEEPS 8
+
+typedef struct ship_t {
+  double arrival;
+  double volume;
+} ship_t;
+
+typedef struct problem_t {
+  const zsf_param_t *p;
+  const zsf_schedule_limits_t *limits;
+  ship_t *ships[2];
+  int num_ships[2];
+  int max_visits;
+} problem_t;
+
+// The schedule and its transports, if they are to be kept
+typedef struct output_t {
+  zsf_lockage_t *lockages;
+  zsf_phase_transports_t *transports;
+  int capacity;
+  aggregate_t totals;
+} output_t;
+
+// The simulation at the start of a visit, i.e. when the lock has been
+// leveled to one of its sides and is about to open its doors.
+typedef struct sim_t {
+  double time;
+  int side;
+  int done;
+  int next[2]; // first ship at either side that has not entered the lock yet
+  int num_inside;
+  zsf_phase_state_t state;
+
+  int num_visits;
+  int num_lockages;
+  double salt_to_lake;
+  double flushing_volume;
+  double wait_excess;
+} sim_t;
+
+// What we optimise: first the constraints, then the salt intrusion
+typedef struct cost_t {
+  double flushing_excess;
+  double wait_excess;
+  double salt_to_lake;
+  int num_visits;
+  int num_lockages;
+} cost_t;
+
+static int is_better(const cost_t *a, const cost_t *b) {
+  if (a->flushing_excess != b->flushing_excess)
+    return a->flushing_excess < b->flushing_excess;
+  if (a->wait_excess != b->wait_excess)
+    return a->wait_excess < b->wait_excess;
+  return a->salt_to_lake < b->salt_to_lake;
+}
+
+static int compare_arrival(const void *a, const void *b) {
+  double ta = ((const zsf_ship_arrival_t *)a)->time;
+  double tb = ((const zsf_ship_arrival_t *)b)->time;
+  return (ta > tb) - (ta < tb);
+}
+
+static double first_waiting(const problem_t *pr, const sim_t *s, int side) {
+  int i = s->next[side];
+  return i < pr->num_ships[side] ? pr->ships[side][i].arrival : INFINITY;
+}
+
+static void add_lockage(zsf_lockage_t *l, int *n, double time, int routine, double duration) {
+  zsf_lockage_t *lockage = &l[(*n)++];
+  memset(lockage, 0, sizeof(zsf_lockage_t));
+  lockage->time = time;
+  lockage->routine = routine;
+  lockage->duration = duration;
+}
+
+// Level towards the next side to visit from time t on, with the doors closed
+static void depart(const problem_t *pr, sim_t *s, double t, zsf_lockage_t *l, int *n) {
+  int a = s->side;
+  int b = 1 - a;
+  int side = b;
+
+  if (s->num_inside == 0) {
+    double t_a = first_waiting(pr, s, a);
+    double t_b = first_waiting(pr, s, b);
+    if (t_a == INFINITY && t_b == INFINITY) {
+      s->done = 1;
+      return;
+    }
+
+    // Wait for the next ship and level towards its side. The other side goes
+    // first if ships are waiting at both.
+    double ready_a = fmax(t, t_a);
+    double ready_b = fmax(t, t_b);
+    side = (ready_b <= ready_a) ? b : a;
+    t = fmin(ready_a, ready_b);
+  }
+
+  if (t >= pr->limits->t_end) {
+    s->done = 1;
+    return;
+  }
+
+  add_lockage(l, n, t, side == SIDE_LAKE ? 1 : 3, pr->limits->leveling_time);
+  s->side = side;
+  s->time = t + pr->limits->leveling_time;
+}
+
+static int step(const problem_t *pr, sim_t *s, int n, const zsf_lockage_t *l, output_t *out) {
+  zsf_phase_transports_t tp[3];
+  int err = zsf_step_lockages(pr->p, n, l, &s->state, tp);
+  if (err)
+    return err;
+
+  for (int i = 0; i < n; i++) {
+    s->salt_to_lake -= tp[i].mass_transport_lake;
+    if (l[i].routine < 0.0)
+      s->flushing_volume += tp[i].volume_from_lake;
+
+    if (out != NULL) {
+      if (s->num_lockages < out->capacity) {
+        out->lockages[s->num_lockages] = l[i];
+        if (out->transports != NULL)
+          out->transports[s->num_lockages] = tp[i];
+      }
+      aggregate_add(&out->totals, &tp[i]);
+    }
+    s->num_lockages++;
+  }
+  return ZSF_SUCCESS;
+}
+
+static int start(const problem_t *pr, const zsf_phase_state_t *state, sim_t *s, output_t *out) {
+  const zsf_param_t *p = pr->p;
+  memset(s, 0, sizeof(sim_t));
+  s->state = *state;
+  s->side = fabs(state->head_lock - p->head_lake) <= fabs(state->head_lock - p->head_sea)
+                ? SIDE_LAKE
+                : SIDE_SEA;
+
+  zsf_lockage_t l[1];
+  int n = 0;
+  depart(pr, s, 0.0, l, &n);
+  return step(pr, s, n, l, out);
+}
+
+// Let the ships waiting at the side of the lock enter while they fit, from
+// t_ready until t_last, including those that arrive in the meantime unless
+// only_waiting is set. Returns the index of the first ship left behind.
+static int load_ships(const problem_t *pr, const sim_t *s, double t_last, int only_waiting,
+                      double *t_ready, double *volume) {
+  const zsf_schedule_limits_t *limits = pr->limits;
+  const ship_t *ships = pr->ships[s->side];
+  int first = s->next[s->side];
+  int i = first;
+
+  for (; i < pr->num_ships[s->side]; i++) {
+    // A ship that is larger than the capacity can still go alone
+    int num_ships = i - first;
+    int fits = (limits->max_ships <= 0.0 || num_ships + 1 <= limits->max_ships) &&
+               (limits->max_ship_volume <= 0.0 || num_ships == 0 ||
+                *volume + ships[i].volume <= limits->max_ship_volume);
+    double t_enter = fmax(*t_ready, ships[i].arrival);
+    if (!fits || t_enter + limits->time_per_ship > t_last ||
+        (only_waiting && ships[i].arrival > *t_ready))
+      break;
+    *t_ready = t_enter + limits->time_per_ship;
+    *volume += ships[i].volume;
+  }
+  return i;
+}
+
+// The time the doors have to be open for the ships inside to leave, and the
+// ships waiting to enter.
+static double time_to_load(const problem_t *pr, const sim_t *s) {
+  const zsf_schedule_limits_t *limits = pr->limits;
+  double t_ready = s->time + limits->door_time + limits->time_per_ship * s->num_inside;
+  double volume = 0.0;
+  load_ships(pr, s, s->time + limits->door_open_max, 1, &t_ready, &volume);
+  return t_ready - s->time;
+}
+
+// Open the doors for t_open, flush for t_flushing, and depart
+static int visit(const problem_t *pr, sim_t *s, double t_open, double t_flushing, output_t *out) {
+  const zsf_schedule_limits_t *limits = pr->limits;
+  int a = s->side;
+  const ship_t *ships = pr->ships[a];
+
+  // The ships inside leave first
+  double t_begin = s->time;
+  double t_ready = t_begin + limits->door_time + limits->time_per_ship * s->num_inside;
+  double t_last = t_begin + t_open;
+  double volume = 0.0;
+  int first = s->next[a];
+  int i = load_ships(pr, s, t_last, 0, &t_ready, &volume);
+
+  double t_close = fmax(t_last, t_ready);
+  for (int j = first; j < i; j++)
+    s->wait_excess += fmax(t_close - ships[j].arrival - limits->max_wait, 0.0);
+  s->next[a] = i;
+  s->num_inside = i - first;
+
+  zsf_lockage_t l[3];
+  int n = 0;
+  add_lockage(l, &n, t_begin, a == SIDE_LAKE ? 2 : 4, t_close - t_begin);
+  l[0].ship_volume_lake_to_sea = (a == SIDE_LAKE) ? volume : 0.0;
+  l[0].ship_volume_sea_to_lake = (a == SIDE_SEA) ? volume : 0.0;
+  l[0].num_ships = s->num_inside;
+
+  if (t_flushing > 0.0)
+    add_lockage(l, &n, t_close, a == SIDE_LAKE ? -2 : -4, t_flushing);
+
+  s->num_visits++;
+  depart(pr, s, t_close + t_flushing, l, &n);
+  return step(pr, s, n, l, out);
+}
+
+// Simulate the schedule from the start of visit k. The state before every
+// visit is kept in sims if record is set.
+static int evaluate(const problem_t *pr, int k, const double *t_open, const double *t_flushing,
+                    sim_t *sims, int record, output_t *out, cost_t *cost) {
+  const zsf_schedule_limits_t *limits = pr->limits;
+  sim_t s = sims[k];
+
+  while (!s.done && s.time < limits->t_end && s.num_visits < pr->max_visits) {
+    if (record)
+      sims[s.num_visits] = s;
+    int v = s.num_visits;
+    int err = visit(pr, &s, t_open[v], t_flushing[v], out);
+    if (err)
+      return err;
+  }
+
+  // Ships still waiting at the end of the period
+  cost->wait_excess = s.wait_excess;
+  for (int side = 0; side < 2; side++) {
+    for (int i = s.next[side]; i < pr->num_ships[side]; i++) {
+      double wait = limits->t_end - pr->ships[side][i].arrival;
+      cost->wait_excess += fmax(wait - limits->max_wait, 0.0);
+    }
+  }
+
+  cost->flushing_excess = fmax(s.flushing_volume - limits->flushing_volume, 0.0);
+  cost->salt_to_lake = s.salt_to_lake;
+  cost->num_visits = s.num_visits;
+  cost->num_lockages = s.num_lockages;
+  return ZSF_SUCCESS;
+}
+
+static double candidate(double lo, double hi, int c, int num_candidates) {
+  return lo + (hi - lo) * c / (num_candidates - 1);
+}
+
+// Start from the best of a schedule that keeps the doors open just long
+// enough for the ships that are waiting, and schedules that keep them open
+// for the same time on every visit, without flushing.
+static int initial_schedule(const problem_t *pr, double *t_open, double *t_flushing,
+                            double *t_uniform, sim_t *sims, cost_t *best) {
+  const zsf_schedule_limits_t *limits = pr->limits;
+  int num_candidates = (int)limits->num_candidates;
+  sim_t s = sims[0];
+
+  for (int v = 0; v < pr->max_visits; v++) {
+    t_open[v] = limits->door_open_max;
+    t_flushing[v] = 0.0;
+  }
+
+  while (!s.done && s.time < limits->t_end && s.num_visits < pr->max_visits) {
+    int v = s.num_visits;
+    t_open[v] = fmin(fmax(time_to_load(pr, &s), limits->door_open_min), limits->door_open_max);
+
+    int err = visit(pr, &s, t_open[v], t_flushing[v], NULL);
+    if (err)
+      return err;
+  }
+
+  int err = evaluate(pr, 0, t_open, t_flushing, sims, 1, NULL, best);
+
+  for (int c = 0; c < num_candidates && !err; c++) {
+    double value = candidate(limits->door_open_min, limits->door_open_max, c, num_candidates);
+    for (int v = 0; v < pr->max_visits; v++)
+      t_uniform[v] = value;
+
+    cost_t cost;
+    err = evaluate(pr, 0, t_uniform, t_flushing, sims, 0, NULL, &cost);
+    if (!err && is_better(&cost, best)) {
+      memcpy(t_open, t_uniform, pr->max_visits * sizeof(double));
+      err = evaluate(pr, 0, t_open, t_flushing, sims, 1, NULL, best);
+    }
+  }
+  return err;
+}
+
+static int optimize(const problem_t *pr, double *t_open, double *t_flushing, double *t_uniform,
+                    sim_t *sims, cost_t *best) {
+  const zsf_schedule_limits_t *limits = pr->limits;
+  int num_candidates = (int)limits->num_candidates;
+
+  int err = initial_schedule(pr, t_open, t_flushing, t_uniform, sims, best);
+  if (err)
+    return err;
+
+  for (int sweep = 0; sweep < MAX_SWEEPS; sweep++) {
+    int improved = 0;
+
+    for (int k = 0; k < best->num_visits; k++) {
+      for (int which = 0; which < 2; which++) {
+        double *x = (which == 0) ? t_open : t_flushing;
+        double lo = (which == 0) ? limits->door_open_min : 0.0;
+        double hi = (which == 0) ? limits->door_open_max : limits->flushing_max;
+        if (!(hi > lo))
+          continue;
+
+        double x_start = x[k];
+        double x_best = x_start;
+        for (int c = 0; c < num_candidates; c++) {
+          double value = candidate(lo, hi, c, num_candidates);
+          if (value == x_best)
+            continue;
+
+          cost_t cost;
+          x[k] = value;
+          if ((err = evaluate(pr, k, t_open, t_flushing, sims, 0, NULL, &cost)))
+            return err;
+          if (is_better(&cost, best)) {
+            *best = cost;
+            x_best = value;
+            improved = 1;
+          }
+        }
+
+        // Keep the states before the visits after k up to date
+        x[k] = x_best;
+        if (x_best != x_start) {
+          if ((err = evaluate(pr, k, t_open, t_flushing, sims, 1, NULL, best)))
+            return err;
+        }
+      }
+    }
+
+    if (!improved)
+      break;
+  }
+
+  return ZSF_SUCCESS;
+}
+
+// Optimise the schedule, and step it once more to get its lockages and
+// transports
+static int schedule(const problem_t *pr, const zsf_phase_state_t *state, double *t_open,
+                    double *t_flushing, double *t_uniform, sim_t *sims, output_t *out,
+                    cost_t *best) {
+  int err = start(pr, state, &sims[0], NULL);
+  if (!err)
+    err = optimize(pr, t_open, t_flushing, t_uniform, sims, best);
+  if (!err)
+    err = start(pr, state, &sims[0], out);
+  if (!err)
+    err = evaluate(pr, 0, t_open, t_flushing, sims, 0, out, best);
+  return err;
+}
+
+int ZSF_CALLCONV zsf_schedule_optimize(const zsf_param_t *p, const zsf_phase_state_t *state,
+                                       int num_ships, const zsf_ship_arrival_t *ships,
+                                       const zsf_schedule_limits_t *limits, int max_lockages,
+                                       zsf_lockage_t *lockages,
+                                       zsf_phase_transports_t *transports, int *num_lockages,
+                                       zsf_results_t *results) {
+  *num_lockages = 0;
+
+  if (num_ships < 0 || max_lockages < 0 || !(limits->t_end > 0.0) ||
+      !(limits->leveling_time > 0.0) || !(limits->door_time >= 0.0) ||
+      !(limits->time_per_ship >= 0.0) || !(limits->max_wait >= 0.0) ||
+      !(limits->door_open_min >= 0.0) || !(limits->door_open_max >= limits->door_open_min) ||
+      !(limits->flushing_max >= 0.0) || !(limits->flushing_volume >= 0.0) ||
+      !(limits->num_candidates >= 2.0) || !(limits->num_candidates <= INT_MAX))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  for (int i = 0; i < num_ships; i++) {
+    if (!(ships[i].side == 0.0 || ships[i].side == 1.0) || !(ships[i].time >= 0.0) ||
+        !(ships[i].volume >= 0.0))
+      return ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  // Every visit starts after leveling, within the period
+  double max_visits = floor(limits->t_end / limits->leveling_time) + 1.0;
+  if (!(max_visits < INT_MAX / sizeof(sim_t)))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  problem_t pr = {p, limits, {NULL, NULL}, {0, 0}, (int)max_visits};
+
+  size_t n = (num_ships > 0) ? num_ships : 1;
+  zsf_ship_arrival_t *sorted = malloc(n * sizeof(zsf_ship_arrival_t));
+  pr.ships[SIDE_LAKE] = malloc(n * sizeof(ship_t));
+  pr.ships[SIDE_SEA] = malloc(n * sizeof(ship_t));
+  double *t_open = malloc(pr.max_visits * sizeof(double));
+  double *t_flushing = malloc(pr.max_visits * sizeof(double));
+  double *t_uniform = malloc(pr.max_visits * sizeof(double));
+  sim_t *sims = malloc(pr.max_visits * sizeof(sim_t));
+
+  int err = ZSF_ERR_OUT_OF_MEMORY;
+  if (sorted && pr.ships[SIDE_LAKE] && pr.ships[SIDE_SEA] && t_open && t_flushing &&
+      t_uniform && sims) {
+    // Ships queue at their side in order of arrival
+    memcpy(sorted, ships, num_ships * sizeof(zsf_ship_arrival_t));
+    qsort(sorted, num_ships, sizeof(zsf_ship_arrival_t), compare_arrival);
+    for (int i = 0; i < num_ships; i++) {
+      int side = (int)sorted[i].side;
+      ship_t *ship = &pr.ships[side][pr.num_ships[side]++];
+      ship->arrival = sorted[i].time;
+      ship->volume = sorted[i].volume;
+    }
+
+    output_t out;
+    out.lockages = lockages;
+    out.transports = transports;
+    out.capacity = max_lockages;
+    aggregate_reset(&out.totals);
+
+    cost_t best;
+    err = schedule(&pr, state, t_open, t_flushing, t_uniform, sims, &out, &best);
+    if (!err) {
+      *num_lockages = best.num_lockages;
+      if (best.num_lockages > max_lockages)
+        err = ZSF_ERR_INVALID_ARGUMENT;
+    }
+    if (!err) {
+      aggregate_finish_results(&out.totals, limits->t_end, results);
+      if (best.flushing_excess > 0.0 || best.wait_excess > 0.0)
+        err = ZSF_ERR_SCHEDULE_INFEASIBLE;
+    }
+  }
+
+  free(sorted);
+  free(pr.ships[SIDE_LAKE]);
+  free(pr.ships[SIDE_SEA]);
+  free(t_open);
+  free(t_flushing);
+  free(t_uniform);
+  free(sims);
+  return err;
+}
@@ -0,0 +1,803 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "threads.h"
+#include "zsf.h"
+
+#if !defined(_WIN32)
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <signal.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#define SERVICE_MAGIC "ZSFSERV"
+#define MAX_NAME_LENGTH 200
+
+// Keep data written by different threads and processes on different cache
+// lines
+#define CACHE_LINE 64
+#define ALIGN_UP(n) (((n) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE)
+
+// Number of slots a client keeps in flight in zsf_client_calc_steady_batch
+#define MAX_IN_FLIGHT 4
+
+// A slot goes round FREE -> CLAIMED (by a client) -> SUBMITTED (by the
+// client) -> DONE (by the server) -> FREE (by the client). Only claiming a
+// free slot is contended, between clients, and uses a compare-and-swap.
+#define SLOT_FREE 0
+#define SLOT_CLAIMED 1
+#define SLOT_SUBMITTED 2
+#define SLOT_DONE 3
+
+// Layout of the shared memory (native endianness, as both sides run on the
+// same machine):
+//   service_header_t
+//   num_slots times, every part aligned to a cache line:
+//     slot_header_t
+//     zsf_param_t[slot_capacity]
+//     zsf_results_t[slot_capacity]
+//     int32_t[slot_capacity]               error codes
+typedef struct service_header_t {
+  char magic[8];
+  int32_t version;
+  int32_t num_slots;
+  int32_t slot_capacity;
+  int32_t param_size;
+  int32_t results_size;
+  int32_t pid; // Of the server, to tell whether it still runs
+  int64_t slot_size;
+
+  // Written by the server
+  char pad[CACHE_LINE];
+  volatile long running;
+  char pad_server[CACHE_LINE];
+} service_header_t;
+
+typedef struct slot_header_t {
+  volatile long state;
+  int32_t num_params;
+} slot_header_t;
+
+typedef struct slot_t {
+  slot_header_t *header;
+  zsf_param_t *p;
+  zsf_results_t *results;
+  int32_t *errors;
+} slot_t;
+
+// A mapping of the shared memory, by the server or a client
+typedef struct mapping_t {
+  char name[MAX_NAME_LENGTH + 2];
+  size_t size;
+  service_header_t *header;
+  slot_t *slots;
+#if defined(_WIN32)
+  HANDLE handle;
+#endif
+} mapping_t;
+
+static size_t slot_size(int capacity) {
+  return ALIGN_UP(sizeof(slot_header_t)) + ALIGN_UP(capacity * sizeof(zsf_param_t)) +
+         ALIGN_UP(capacity * sizeof(zsf_results_t)) + ALIGN_UP(capacity * sizeof(int32_t));
+}
+
+static size_t mapping_size(int num_slots, int capacity) {
+  return ALIGN_UP(sizeof(service_header_t)) + (size_t)num_slots * slot_size(capacity);
+}
+
+// Object names are system wide, and on POSIX have to start with a slash
+static int mapping_name(mapping_t *m, const char *name) {
+  if (name == NULL || name[0] == '\0' || strlen(name) > MAX_NAME_LENGTH || strchr(name, '/'))
+    return ZSF_ERR_INVALID_ARGUMENT;
+#if defined(_WIN32)
+  snprintf(m->name, sizeof(m->name), "%s", name);
+#else
+  snprintf(m->name, sizeof(m->name), "/%s", name);
+#endif
+  return ZSF_SUCCESS;
+}
+
+static int mapping_slots(mapping_t *m) {
+  int num_slots = m->header->num_slots;
+  int capacity = m->header->slot_capacity;
+
+  m->slots = malloc(num_slots * sizeof(slot_t));
+  if (m->slots == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  char *ptr = (char *)m->header + ALIGN_UP(sizeof(service_header_t));
+  for (int i = 0; i < num_slots; i++) {
+    slot_t *s = &m->slots[i];
+    s->header = (slot_header_t *)ptr;
+    ptr += ALIGN_UP(sizeof(slot_header_t));
+    s->p = (zsf_param_t *)ptr;
+    ptr += ALIGN_UP(capacity * sizeof(zsf_param_t));
+    s->results = (zsf_results_t *)ptr;
+    ptr += ALIGN_UP(capacity * sizeof(zsf_results_t));
+    s->errors = (int32_t *)ptr;
+    ptr += ALIGN_UP(capacity * sizeof(int32_t));
+  }
+  return ZSF_SUCCESS;
+}
+
+static void mapping_close(mapping_t *m, int owner) {
+  free(m->slots);
+#if defined(_WIN32)
+  (void)owner;
+  if (m->header != NULL)
+    UnmapViewOfFile(m->header);
+  if (m->handle != NULL)
+    CloseHandle(m->handle);
+#else
+  if (m->header != NULL)
+    munmap(m->header, m->size);
+  if (owner)
+    shm_unlink(m->name);
+#endif
+}
+
+// A server that crashed or was killed could not clear its running flag, so
+// the process itself is checked as well. A process that exists but belongs
+// to someone else counts as alive.
+static int process_alive(int32_t pid) {
+#if defined(_WIN32)
+  HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+  if (process == NULL)
+    return GetLastError() == ERROR_ACCESS_DENIED;
+  int alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+  CloseHandle(process);
+  return alive;
+#else
+  return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+#endif
+}
+
+static int server_alive(service_header_t *h) {
+  return atomic_load_acquire(&h->running) && process_alive(h->pid);
+}
+
+#if !defined(_WIN32)
+// Whether the shared memory with this name is gone, or was left behind by a
+// server that no longer runs and can be replaced
+static int mapping_is_stale(const char *name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return errno == ENOENT;
+
+  int stale = 0;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(service_header_t)) {
+    void *ptr = mmap(NULL, sizeof(service_header_t), PROT_READ, MAP_SHARED, fd, 0);
+    if (ptr != MAP_FAILED) {
+      stale = !server_alive(ptr);
+      munmap(ptr, sizeof(service_header_t));
+    }
+  }
+  close(fd);
+  return stale;
+}
+#endif
+
+// Creates the shared memory, replacing any left behind by a server that has
+// stopped running or died. The memory is zero initialized, i.e. all slots are
+// free. On Windows, the memory is gone once the last process closes it, and
+// cannot be replaced while clients of a server that died still have it open.
+static int mapping_create(mapping_t *m, int num_slots, int capacity) {
+  m->size = mapping_size(num_slots, capacity);
+#if defined(_WIN32)
+  uint64_t size = m->size;
+  m->handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(size >> 32),
+                                 (DWORD)size, m->name);
+  if (m->handle == NULL)
+    return ZSF_ERR_IO;
+  if (GetLastError() == ERROR_ALREADY_EXISTS)
+    return ZSF_ERR_INVALID_ARGUMENT; // A server with this name is running
+  m->header = MapViewOfFile(m->handle, FILE_MAP_ALL_ACCESS, 0, 0, m->size);
+#else
+  int fd = shm_open(m->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 && errno == EEXIST && mapping_is_stale(m->name)) {
+    shm_unlink(m->name);
+    fd = shm_open(m->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+  if (fd < 0)
+    return (errno == EEXIST) ? ZSF_ERR_INVALID_ARGUMENT : ZSF_ERR_IO; // As on Windows
+  if (ftruncate(fd, (off_t)m->size) != 0) {
+    close(fd);
+    shm_unlink(m->name);
+    return ZSF_ERR_IO;
+  }
+  void *ptr = mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  m->header = (ptr == MAP_FAILED) ? NULL : ptr;
+#endif
+  if (m->header == NULL)
+    return ZSF_ERR_IO;
+
+  service_header_t *h = m->header;
+  memcpy(h->magic, SERVICE_MAGIC, 8);
+  h->version = ZSF_SERVICE_VERSION;
+  h->num_slots = num_slots;
+  h->slot_capacity = capacity;
+  h->param_size = sizeof(zsf_param_t);
+  h->results_size = sizeof(zsf_results_t);
+  h->slot_size = (int64_t)slot_size(capacity);
+#if defined(_WIN32)
+  h->pid = (int32_t)GetCurrentProcessId();
+#else
+  h->pid = (int32_t)getpid();
+#endif
+
+  // Clients can connect and submit before the service runs
+  atomic_store_release(&h->running, 1);
+
+  return mapping_slots(m);
+}
+
+static int mapping_open(mapping_t *m) {
+#if defined(_WIN32)
+  m->handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, m->name);
+  if (m->handle == NULL)
+    return ZSF_ERR_SERVICE_UNAVAILABLE;
+  m->header = MapViewOfFile(m->handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+  if (m->header == NULL)
+    return ZSF_ERR_IO;
+
+  MEMORY_BASIC_INFORMATION info;
+  VirtualQuery(m->header, &info, sizeof(info));
+  m->size = info.RegionSize;
+#else
+  int fd = shm_open(m->name, O_RDWR, 0);
+  if (fd < 0)
+    return ZSF_ERR_SERVICE_UNAVAILABLE;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return ZSF_ERR_IO;
+  }
+  m->size = (size_t)st.st_size;
+
+  void *ptr = m->size > 0 ? mmap(NULL, m->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                          : MAP_FAILED;
+  close(fd);
+  if (ptr == MAP_FAILED)
+    return ZSF_ERR_IO;
+  m->header = ptr;
+#endif
+
+  // Clients built against a different layout of the structures are rejected
+  const service_header_t *h = m->header;
+  if (m->size < sizeof(service_header_t) || memcmp(h->magic, SERVICE_MAGIC, 8) != 0 ||
+      h->version != ZSF_SERVICE_VERSION || h->num_slots < 1 || h->slot_capacity < 1 ||
+      h->param_size != sizeof(zsf_param_t) || h->results_size != sizeof(zsf_results_t) ||
+      h->slot_size != (int64_t)slot_size(h->slot_capacity) ||
+      m->size < mapping_size(h->num_slots, h->slot_capacity))
+    return ZSF_ERR_FILE_FORMAT;
+
+  if (!server_alive(m->header))
+    return ZSF_ERR_SERVICE_UNAVAILABLE;
+
+  return mapping_slots(m);
+}
+
+// Server
+// ~~~~~~
+// Every round, the server collects all submitted requests in all slots into
+// one batch. Identical parameters, within the batch or calculated in an
+// earlier batch and still in the cache, are calculated only once. The
+// remaining calculations are divided over the threads, which write the
+// results straight into the slots.
+
+// A request is one set of parameters in a slot
+typedef struct request_t {
+  int slot;
+  int index;
+  uint64_t hash;
+  int source; // The request with identical parameters that is calculated, or -1
+} request_t;
+
+typedef struct cache_entry_t {
+  zsf_param_t p;
+  zsf_results_t results;
+  int err;
+  int valid;
+} cache_entry_t;
+
+typedef struct worker_t {
+  zsf_service_t *service;
+  int index;
+  int started;
+  volatile long done;
+  char pad[CACHE_LINE];
+  thread_t thread;
+  thread_start_t start;
+} worker_t;
+
+struct zsf_service_t {
+  // Written by any thread, e.g. a signal handler
+  volatile long stop;
+  char pad_stop[CACHE_LINE];
+
+  // Written by the thread running the service
+  volatile long round;
+  volatile long quit;
+  char pad_round[CACHE_LINE];
+
+  mapping_t mapping;
+
+  int num_threads;
+  worker_t *workers;
+
+  int *collected; // Slots with submitted requests in this round
+  int num_collected;
+  request_t *requests;
+  int num_requests;
+  int *todo; // Requests to calculate
+  int num_todo;
+
+  int *table; // Open addressing hash table of requests (+ 1) in a round
+  size_t table_mask;
+
+  cache_entry_t *cache;
+  size_t cache_mask;
+
+  zsf_service_stats_t stats;
+};
+
+static uint64_t param_hash(const zsf_param_t *p) {
+  // FNV-1a
+  const unsigned char *bytes = (const unsigned char *)p;
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < sizeof(zsf_param_t); i++) {
+    h ^= bytes[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static zsf_param_t *request_param(zsf_service_t *s, const request_t *r) {
+  return &s->mapping.slots[r->slot].p[r->index];
+}
+
+static void calc_request(zsf_service_t *s, const request_t *r) {
+  slot_t *slot = &s->mapping.slots[r->slot];
+  zsf_results_t *results = &slot->results[r->index];
+
+  int err = zsf_calc_steady(&slot->p[r->index], results, NULL);
+  if (err) {
+    for (int j = 0; j < ZSF_NUM_RESULTS_FIELDS; j++)
+      *results_field(results, j) = ZSF_NAN;
+  }
+  slot->errors[r->index] = err;
+}
+
+static void calc_share(zsf_service_t *s, int worker) {
+  int begin = (int)((long long)s->num_todo * worker / s->num_threads);
+  int end = (int)((long long)s->num_todo * (worker + 1) / s->num_threads);
+  for (int i = begin; i < end; i++)
+    calc_request(s, &s->requests[s->todo[i]]);
+}
+
+static void worker_main(void *arg) {
+  worker_t *w = arg;
+  zsf_service_t *s = w->service;
+  unsigned long round = 0;
+
+  while (1) {
+    backoff_t b = {0};
+    while ((unsigned long)atomic_load_acquire(&s->round) == round) {
+      if (atomic_load_acquire(&s->quit))
+        return;
+      backoff_wait_idle(&b);
+    }
+    round++;
+
+    calc_share(s, w->index);
+    atomic_store_release(&w->done, (long)round);
+  }
+}
+
+// Find an identical request earlier in this round, or in the cache
+static int find_duplicate(zsf_service_t *s, int k) {
+  request_t *r = &s->requests[k];
+  const zsf_param_t *p = request_param(s, r);
+
+  for (size_t i = r->hash & s->table_mask;; i = (i + 1) & s->table_mask) {
+    int other = s->table[i] - 1;
+    if (other < 0) {
+      s->table[i] = k + 1;
+      break;
+    }
+    if (s->requests[other].hash == r->hash &&
+        memcmp(request_param(s, &s->requests[other]), p, sizeof(zsf_param_t)) == 0) {
+      r->source = other;
+      s->stats.num_duplicates++;
+      return 1;
+    }
+  }
+
+  if (s->cache != NULL) {
+    const cache_entry_t *e = &s->cache[r->hash & s->cache_mask];
+    if (e->valid && memcmp(&e->p, p, sizeof(zsf_param_t)) == 0) {
+      slot_t *slot = &s->mapping.slots[r->slot];
+      slot->results[r->index] = e->results;
+      slot->errors[r->index] = e->err;
+      s->stats.num_cached++;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int collect(zsf_service_t *s) {
+  int capacity = s->mapping.header->slot_capacity;
+  s->num_collected = 0;
+  s->num_requests = 0;
+
+  for (int i = 0; i < s->mapping.header->num_slots; i++) {
+    slot_t *slot = &s->mapping.slots[i];
+    if (atomic_load_acquire(&slot->header->state) != SLOT_SUBMITTED)
+      continue;
+
+    int n = slot->header->num_params;
+    n = (n < 0) ? 0 : (n > capacity ? capacity : n);
+    slot->header->num_params = n;
+    s->collected[s->num_collected++] = i;
+
+    for (int j = 0; j < n; j++) {
+      request_t *r = &s->requests[s->num_requests++];
+      r->slot = i;
+      r->index = j;
+      r->source = -1;
+    }
+    s->stats.num_requests += n;
+  }
+
+  return s->num_collected;
+}
+
+static void serve_round(zsf_service_t *s) {
+  s->num_todo = 0;
+  memset(s->table, 0, (s->table_mask + 1) * sizeof(int));
+
+  for (int k = 0; k < s->num_requests; k++) {
+    request_t *r = &s->requests[k];
+    r->hash = param_hash(request_param(s, r));
+    if (!find_duplicate(s, k))
+      s->todo[s->num_todo++] = k;
+  }
+
+  // The thread running the service is worker 0
+  unsigned long round = (unsigned long)s->round + 1;
+  if (s->num_todo > 0) {
+    atomic_store_release(&s->round, (long)round);
+    calc_share(s, 0);
+    for (int i = 1; i < s->num_threads; i++) {
+      backoff_t b = {0};
+      while ((unsigned long)atomic_load_acquire(&s->workers[i].done) != round)
+        backoff_wait(&b);
+    }
+  }
+  s->stats.num_calculated += s->num_todo;
+  s->stats.num_batches++;
+
+  for (int k = 0; k < s->num_requests; k++) {
+    const request_t *r = &s->requests[k];
+    slot_t *slot = &s->mapping.slots[r->slot];
+
+    if (r->source >= 0) {
+      const request_t *src = &s->requests[r->source];
+      slot->results[r->index] = s->mapping.slots[src->slot].results[src->index];
+      slot->errors[r->index] = s->mapping.slots[src->slot].errors[src->index];
+    } else if (s->cache != NULL) {
+      cache_entry_t *e = &s->cache[r->hash & s->cache_mask];
+      e->p = slot->p[r->index];
+      e->results = slot->results[r->index];
+      e->err = slot->errors[r->index];
+      e->valid = 1;
+    }
+  }
+
+  // Hand the slots back to the clients
+  for (int i = 0; i < s->num_collected; i++)
+    atomic_store_release(&s->mapping.slots[s->collected[i]].header->state, SLOT_DONE);
+}
+
+static size_t next_power_of_two(size_t n) {
+  size_t p = 1;
+  while (p < n)
+    p *= 2;
+  return p;
+}
+
+static void service_free(zsf_service_t *s) {
+  if (s->workers != NULL) {
+    atomic_store_release(&s->quit, 1);
+    for (int i = 1; i < s->num_threads; i++) {
+      if (s->workers[i].started)
+        thread_join(s->workers[i].thread);
+    }
+  }
+  free(s->workers);
+  free(s->collected);
+  free(s->requests);
+  free(s->todo);
+  free(s->table);
+  free(s->cache);
+  free(s);
+}
+
+int ZSF_CALLCONV zsf_service_create(const char *name, int num_slots, int slot_capacity,
+                                    int num_threads, int cache_size, zsf_service_t **service) {
+  *service = NULL;
+  if (num_slots < 1 || slot_capacity < 1 || num_threads < 1 || cache_size < 0 ||
+      (long long)num_slots * slot_capacity > INT32_MAX / 4)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  zsf_service_t *s = calloc(1, sizeof(zsf_service_t));
+  if (s == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  int err = mapping_name(&s->mapping, name);
+  if (err) {
+    free(s);
+    return err;
+  }
+
+  size_t max_requests = (size_t)num_slots * slot_capacity;
+  size_t table_size = next_power_of_two(2 * max_requests);
+  s->num_threads = num_threads;
+  s->collected = malloc(num_slots * sizeof(int));
+  s->requests = malloc(max_requests * sizeof(request_t));
+  s->todo = malloc(max_requests * sizeof(int));
+  s->table = malloc(table_size * sizeof(int));
+  s->table_mask = table_size - 1;
+  s->workers = calloc(num_threads, sizeof(worker_t));
+  if (cache_size > 0) {
+    size_t n = next_power_of_two(cache_size);
+    s->cache = calloc(n, sizeof(cache_entry_t));
+    s->cache_mask = n - 1;
+  }
+  if (s->collected == NULL || s->requests == NULL || s->todo == NULL || s->table == NULL ||
+      s->workers == NULL || (cache_size > 0 && s->cache == NULL)) {
+    service_free(s);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  for (int i = 1; i < num_threads; i++) {
+    worker_t *w = &s->workers[i];
+    w->service = s;
+    w->index = i;
+    if (thread_create(&w->thread, &w->start, worker_main, w)) {
+      service_free(s);
+      return ZSF_ERR_OUT_OF_MEMORY;
+    }
+    w->started = 1;
+  }
+
+  // The name of a server that is still running is left alone
+  err = mapping_create(&s->mapping, num_slots, slot_capacity);
+  if (err) {
+    mapping_close(&s->mapping, err != ZSF_ERR_INVALID_ARGUMENT);
+    service_free(s);
+    return err;
+  }
+
+  *service = s;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_service_run(zsf_service_t *s) {
+  service_header_t *h = s->mapping.header;
+  atomic_store_release(&h->running, 1);
+
+  backoff_t b = {0};
+  while (!atomic_load_acquire(&s->stop)) {
+    if (collect(s) > 0) {
+      serve_round(s);
+      b.count = 0;
+    } else {
+      backoff_wait_idle(&b);
+    }
+  }
+
+  // Requests that were not served yet fail on the side of the client
+  atomic_store_release(&h->running, 0);
+  atomic_store_release(&s->stop, 0);
+  return ZSF_SUCCESS;
+}
+
+void ZSF_CALLCONV zsf_service_stop(zsf_service_t *s) { atomic_store_release(&s->stop, 1); }
+
+void ZSF_CALLCONV zsf_service_stats(const zsf_service_t *s, zsf_service_stats_t *stats) {
+  *stats = s->stats;
+}
+
+void ZSF_CALLCONV zsf_service_free(zsf_service_t *s) {
+  if (s == NULL)
+    return;
+
+  mapping_close(&s->mapping, 1);
+  service_free(s);
+}
+
+// Client
+// ~~~~~~
+struct zsf_client_t {
+  mapping_t mapping;
+  int next_slot;
+};
+
+// Whether a waiting client should give up. A server that died is only noticed
+// once the wait is long, as that takes a system call.
+static int server_gone(service_header_t *h, const backoff_t *b) {
+  return !atomic_load_acquire(&h->running) || (backoff_sleeping(b) && !process_alive(h->pid));
+}
+
+int ZSF_CALLCONV zsf_client_connect(const char *name, zsf_client_t **client) {
+  *client = NULL;
+
+  zsf_client_t *c = calloc(1, sizeof(zsf_client_t));
+  if (c == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  int err = mapping_name(&c->mapping, name);
+  if (!err)
+    err = mapping_open(&c->mapping);
+  if (err) {
+    mapping_close(&c->mapping, 0);
+    free(c);
+    return err;
+  }
+
+  *client = c;
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_client_slot_capacity(const zsf_client_t *c) {
+  return c->mapping.header->slot_capacity;
+}
+
+int ZSF_CALLCONV zsf_client_acquire(zsf_client_t *c, int *slot, zsf_param_t **p) {
+  service_header_t *h = c->mapping.header;
+  backoff_t b = {0};
+
+  while (1) {
+    for (int k = 0; k < h->num_slots; k++) {
+      int i = (c->next_slot + k) % h->num_slots;
+      slot_t *s = &c->mapping.slots[i];
+      if (atomic_compare_exchange(&s->header->state, SLOT_FREE, SLOT_CLAIMED)) {
+        c->next_slot = (i + 1) % h->num_slots;
+        *slot = i;
+        *p = s->p;
+        return ZSF_SUCCESS;
+      }
+    }
+
+    if (server_gone(h, &b))
+      return ZSF_ERR_SERVICE_UNAVAILABLE;
+    backoff_wait(&b);
+  }
+}
+
+int ZSF_CALLCONV zsf_client_submit(zsf_client_t *c, int slot, int num_params) {
+  if (slot < 0 || slot >= c->mapping.header->num_slots || num_params < 0 ||
+      num_params > c->mapping.header->slot_capacity)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  slot_header_t *s = c->mapping.slots[slot].header;
+  if (s->state != SLOT_CLAIMED)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  s->num_params = num_params;
+  atomic_store_release(&s->state, num_params > 0 ? SLOT_SUBMITTED : SLOT_DONE);
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_client_wait(zsf_client_t *c, int slot, const zsf_results_t **results,
+                                 const int **errors) {
+  if (slot < 0 || slot >= c->mapping.header->num_slots)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  slot_t *s = &c->mapping.slots[slot];
+  backoff_t b = {0};
+  while (atomic_load_acquire(&s->header->state) != SLOT_DONE) {
+    if (server_gone(c->mapping.header, &b))
+      return ZSF_ERR_SERVICE_UNAVAILABLE;
+    backoff_wait(&b);
+  }
+
+  if (results != NULL)
+    *results = s->results;
+  if (errors != NULL)
+    *errors = (const int *)s->errors;
+  return ZSF_SUCCESS;
+}
+
+void ZSF_CALLCONV zsf_client_release(zsf_client_t *c, int slot) {
+  if (slot >= 0 && slot < c->mapping.header->num_slots)
+    atomic_store_release(&c->mapping.slots[slot].header->state, SLOT_FREE);
+}
+
+int ZSF_CALLCONV zsf_client_calc_steady_batch(zsf_client_t *c, int num_params,
+                                              const zsf_param_t *p, zsf_results_t *results,
+                                              int *errors) {
+  if (num_params < 0)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int capacity = c->mapping.header->slot_capacity;
+  int first_err = ZSF_SUCCESS;
+
+  // Keep a few slots in flight, so that the server can coalesce them with
+  // each other and with the requests of other clients
+  int slots[MAX_IN_FLIGHT];
+  int offsets[MAX_IN_FLIGHT];
+  int num_in_flight = 0;
+  int next = 0;
+  int err = ZSF_SUCCESS;
+
+  while ((next < num_params || num_in_flight > 0) && !err) {
+    if (next < num_params && num_in_flight < MAX_IN_FLIGHT) {
+      int slot;
+      zsf_param_t *slot_p;
+      err = zsf_client_acquire(c, &slot, &slot_p);
+      if (err)
+        break;
+
+      int n = (num_params - next < capacity) ? num_params - next : capacity;
+      memcpy(slot_p, &p[next], n * sizeof(zsf_param_t));
+      zsf_client_submit(c, slot, n);
+
+      slots[num_in_flight] = slot;
+      offsets[num_in_flight] = next;
+      num_in_flight++;
+      next += n;
+      continue;
+    }
+
+    // Collect the oldest slot
+    const zsf_results_t *slot_results;
+    const int *slot_errors;
+    err = zsf_client_wait(c, slots[0], &slot_results, &slot_errors);
+    if (err)
+      break;
+
+    int n = c->mapping.slots[slots[0]].header->num_params;
+    memcpy(&results[offsets[0]], slot_results, n * sizeof(zsf_results_t));
+    for (int i = 0; i < n; i++) {
+      if (errors != NULL)
+        errors[offsets[0] + i] = slot_errors[i];
+      if (slot_errors[i] && !first_err)
+        first_err = slot_errors[i];
+    }
+    zsf_client_release(c, slots[0]);
+
+    num_in_flight--;
+    memmove(slots, slots + 1, num_in_flight * sizeof(int));
+    memmove(offsets, offsets + 1, num_in_flight * sizeof(int));
+  }
+
+  // After a failure, the slots still in flight are not returned to the
+  // server, as it is gone anyway
+  return err ? err : first_err;
+}
+
+void ZSF_CALLCONV zsf_client_disconnect(zsf_client_t *c) {
+  if (c == NULL)
+    return;
+
+  mapping_close(&c->mapping, 0);
+  free(c);
+}
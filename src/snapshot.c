@@ -0,0 +1,177 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "errors.h"
+#include "zsf.h"
+
+#define SNAPSHOT_MAGIC "ZSFSNAP"
+
+// Layout (native endianness):
+//   snapshot_header_t
+//   zsf_param_t[num_locks]
+//   zsf_phase_state_t[num_locks]
+//   zsf_phase_transports_t[num_locks]   (only if has_totals)
+//
+// The header is a multiple of 8 bytes, so that all arrays are aligned like
+// in memory when the buffer itself is.
+typedef struct snapshot_header_t {
+  char magic[8];
+  int32_t version;
+  int32_t num_locks;
+  int32_t has_totals;
+  int32_t param_size;
+  int32_t state_size;
+  int32_t transports_size;
+  int32_t reserved[2];
+} snapshot_header_t;
+
+static size_t snapshot_size(int num_locks, int with_totals) {
+  size_t per_lock = sizeof(zsf_param_t) + sizeof(zsf_phase_state_t);
+  if (with_totals)
+    per_lock += sizeof(zsf_phase_transports_t);
+  return sizeof(snapshot_header_t) + (size_t)num_locks * per_lock;
+}
+
+static void header_fill(snapshot_header_t *h, int num_locks, int with_totals) {
+  memset(h, 0, sizeof(snapshot_header_t));
+  memcpy(h->magic, SNAPSHOT_MAGIC, 8);
+  h->version = ZSF_SNAPSHOT_VERSION;
+  h->num_locks = num_locks;
+  h->has_totals = with_totals;
+  h->param_size = sizeof(zsf_param_t);
+  h->state_size = sizeof(zsf_phase_state_t);
+  h->transports_size = sizeof(zsf_phase_transports_t);
+}
+
+// Snapshots written by a build with a different layout of the structures
+// are rejected rather than converted.
+static int header_check(const snapshot_header_t *h) {
+  if (memcmp(h->magic, SNAPSHOT_MAGIC, 8) != 0 || h->version != ZSF_SNAPSHOT_VERSION ||
+      h->num_locks < 0 || (h->has_totals != 0 && h->has_totals != 1) ||
+      h->param_size != sizeof(zsf_param_t) || h->state_size != sizeof(zsf_phase_state_t) ||
+      h->transports_size != sizeof(zsf_phase_transports_t))
+    return ZSF_ERR_FILE_FORMAT;
+  return ZSF_SUCCESS;
+}
+
+size_t ZSF_CALLCONV zsf_snapshot_size(int num_locks, int with_totals) {
+  return num_locks < 0 ? 0 : snapshot_size(num_locks, with_totals != 0);
+}
+
+int ZSF_CALLCONV zsf_snapshot_write(void *buffer, size_t size, int num_locks,
+                                    const zsf_param_t *p, const zsf_phase_state_t *state,
+                                    const zsf_phase_transports_t *totals) {
+  int with_totals = totals != NULL;
+  if (num_locks < 0 || size < snapshot_size(num_locks, with_totals))
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  snapshot_header_t h;
+  header_fill(&h, num_locks, with_totals);
+
+  char *dst = buffer;
+  memcpy(dst, &h, sizeof(h));
+  dst += sizeof(h);
+  memcpy(dst, p, num_locks * sizeof(zsf_param_t));
+  dst += num_locks * sizeof(zsf_param_t);
+  memcpy(dst, state, num_locks * sizeof(zsf_phase_state_t));
+  dst += num_locks * sizeof(zsf_phase_state_t);
+  if (with_totals)
+    memcpy(dst, totals, num_locks * sizeof(zsf_phase_transports_t));
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_snapshot_read(const void *buffer, size_t size, int max_locks, int *num_locks,
+                                   zsf_param_t *p, zsf_phase_state_t *state,
+                                   zsf_phase_transports_t *totals) {
+  snapshot_header_t h;
+  if (size < sizeof(h))
+    return ZSF_ERR_FILE_FORMAT;
+  memcpy(&h, buffer, sizeof(h));
+
+  int err = header_check(&h);
+  if (err)
+    return err;
+  if (size < snapshot_size(h.num_locks, h.has_totals))
+    return ZSF_ERR_FILE_FORMAT;
+
+  *num_locks = h.num_locks;
+  if (p == NULL)
+    return ZSF_SUCCESS;
+  if (h.num_locks > max_locks)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  const char *src = (const char *)buffer + sizeof(h);
+  memcpy(p, src, h.num_locks * sizeof(zsf_param_t));
+  src += h.num_locks * sizeof(zsf_param_t);
+  memcpy(state, src, h.num_locks * sizeof(zsf_phase_state_t));
+  src += h.num_locks * sizeof(zsf_phase_state_t);
+  if (totals != NULL) {
+    if (h.has_totals)
+      memcpy(totals, src, h.num_locks * sizeof(zsf_phase_transports_t));
+    else
+      memset(totals, 0, h.num_locks * sizeof(zsf_phase_transports_t));
+  }
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_snapshot_save(const char *path, int num_locks, const zsf_param_t *p,
+                                   const zsf_phase_state_t *state,
+                                   const zsf_phase_transports_t *totals) {
+  if (num_locks < 0)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return ZSF_ERR_IO;
+
+  snapshot_header_t h;
+  header_fill(&h, num_locks, totals != NULL);
+
+  size_t n = num_locks;
+  int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  ok = ok && fwrite(p, sizeof(zsf_param_t), n, f) == n;
+  ok = ok && fwrite(state, sizeof(zsf_phase_state_t), n, f) == n;
+  if (totals != NULL)
+    ok = ok && fwrite(totals, sizeof(zsf_phase_transports_t), n, f) == n;
+
+  if (fclose(f) != 0)
+    ok = 0;
+  return ok ? ZSF_SUCCESS : ZSF_ERR_IO;
+}
+
+int ZSF_CALLCONV zsf_snapshot_load(const char *path, int max_locks, int *num_locks,
+                                   zsf_param_t *p, zsf_phase_state_t *state,
+                                   zsf_phase_transports_t *totals) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return ZSF_ERR_IO;
+
+  snapshot_header_t h;
+  int err = fread(&h, sizeof(h), 1, f) == 1 ? header_check(&h) : ZSF_ERR_FILE_FORMAT;
+  if (err) {
+    fclose(f);
+    return err;
+  }
+
+  *num_locks = h.num_locks;
+  if (p == NULL || h.num_locks > max_locks) {
+    fclose(f);
+    return p == NULL ? ZSF_SUCCESS : ZSF_ERR_INVALID_ARGUMENT;
+  }
+
+  size_t n = h.num_locks;
+  int ok = fread(p, sizeof(zsf_param_t), n, f) == n;
+  ok = ok && fread(state, sizeof(zsf_phase_state_t), n, f) == n;
+  if (totals != NULL) {
+    if (h.has_totals)
+      ok = ok && fread(totals, sizeof(zsf_phase_transports_t), n, f) == n;
+    else
+      memset(totals, 0, n * sizeof(zsf_phase_transports_t));
+  }
+  fclose(f);
+
+  return ok ? ZSF_SUCCESS : ZSF_ERR_FILE_FORMAT;
+}
@@ -0,0 +1,19 @@
+#ifndef ZSF_STEPPER_H
+#define ZSF_STEPPER_H
+
+#include <stddef.h>
+
+#include "zsf.h"
+
+// Steps the lockages of a lock one at a time, as zsf_step_lockages does,
+// but with the derived parameters of the lock calculated only once. For
+// callers that interleave the lockages of many locks (see network.c), which
+// allocate stepper_size() bytes (suitably aligned for doubles) per stepper.
+typedef struct stepper_t stepper_t;
+
+size_t stepper_size(void);
+void stepper_set_param(stepper_t *s, const zsf_param_t *p);
+int stepper_step(stepper_t *s, const zsf_lockage_t *l, zsf_phase_state_t *state,
+                 zsf_phase_transports_t *tp);
+
+#endif
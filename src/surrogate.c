@@ -0,0 +1,419 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "random.h"
+#include "zsf.h"
+
+// The table stores all fields of zsf_results_t per grid node, so that a
+// query only has to touch 2^d (linear) or 4^d (cubic) contiguous blocks of
+// memory.
+#define NUM_OUTPUTS ZSF_NUM_RESULTS_FIELDS
+
+#define SURROGATE_MAGIC "ZSFSURR"
+#define SURROGATE_VERSION 1
+#define FIELD_NAME_LENGTH 64
+
+struct zsf_surrogate_t {
+  zsf_param_t p;
+  int num_axes;
+  int axis_field[ZSF_SURROGATE_MAX_AXES];
+  int num_points[ZSF_SURROGATE_MAX_AXES];
+  double *axis_values[ZSF_SURROGATE_MAX_AXES];
+  size_t stride[ZSF_SURROGATE_MAX_AXES];
+  size_t num_nodes;
+  double *table;
+};
+
+static zsf_surrogate_t *surrogate_alloc(const zsf_param_t *p, int num_axes, const int *axis_field,
+                                        const int *num_points) {
+  zsf_surrogate_t *s = calloc(1, sizeof(zsf_surrogate_t));
+  if (s == NULL)
+    return NULL;
+
+  s->p = *p;
+  s->num_axes = num_axes;
+
+  // The last axis varies fastest
+  size_t num_nodes = 1;
+  for (int i = num_axes - 1; i >= 0; i--) {
+    s->axis_field[i] = axis_field[i];
+    s->num_points[i] = num_points[i];
+    s->stride[i] = num_nodes;
+    num_nodes *= (size_t)num_points[i];
+  }
+  s->num_nodes = num_nodes;
+
+  for (int i = 0; i < num_axes; i++) {
+    s->axis_values[i] = malloc(num_points[i] * sizeof(double));
+    if (s->axis_values[i] == NULL) {
+      zsf_surrogate_free(s);
+      return NULL;
+    }
+  }
+
+  s->table = malloc(num_nodes * NUM_OUTPUTS * sizeof(double));
+  if (s->table == NULL) {
+    zsf_surrogate_free(s);
+    return NULL;
+  }
+
+  return s;
+}
+
+void ZSF_CALLCONV zsf_surrogate_free(zsf_surrogate_t *s) {
+  if (s == NULL)
+    return;
+  for (int i = 0; i < s->num_axes; i++)
+    free(s->axis_values[i]);
+  free(s->table);
+  free(s);
+}
+
+// The grid values of an axis have to be finite and strictly increasing for
+// the interval lookup
+static int is_valid_axis(const double *values, int num_points) {
+  for (int j = 0; j < num_points; j++) {
+    if (!isfinite(values[j]) || (j > 0 && !(values[j] > values[j - 1])))
+      return 0;
+  }
+  return 1;
+}
+
+int ZSF_CALLCONV zsf_surrogate_build(const zsf_param_t *p, int num_axes,
+                                     const char *const *axis_names, const int *num_points,
+                                     const double *axis_values, zsf_surrogate_t **surrogate) {
+  *surrogate = NULL;
+
+  if (num_axes < 1 || num_axes > ZSF_SURROGATE_MAX_AXES)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int axis_field[ZSF_SURROGATE_MAX_AXES];
+  for (int i = 0; i < num_axes; i++) {
+    axis_field[i] = param_field_index(axis_names[i]);
+    if (axis_field[i] < 0 || num_points[i] < 2)
+      return ZSF_ERR_INVALID_ARGUMENT;
+    for (int j = 0; j < i; j++) {
+      if (axis_field[j] == axis_field[i])
+        return ZSF_ERR_INVALID_ARGUMENT;
+    }
+  }
+
+  zsf_surrogate_t *s = surrogate_alloc(p, num_axes, axis_field, num_points);
+  if (s == NULL)
+    return ZSF_ERR_OUT_OF_MEMORY;
+
+  const double *values = axis_values;
+  for (int i = 0; i < num_axes; i++) {
+    if (!is_valid_axis(values, num_points[i])) {
+      zsf_surrogate_free(s);
+      return ZSF_ERR_INVALID_ARGUMENT;
+    }
+    memcpy(s->axis_values[i], values, num_points[i] * sizeof(double));
+    values += num_points[i];
+  }
+
+  // Tabulate the steady results at every node of the grid
+  zsf_param_t node_p = *p;
+  for (size_t n = 0; n < s->num_nodes; n++) {
+    for (int i = 0; i < num_axes; i++) {
+      size_t j = (n / s->stride[i]) % (size_t)num_points[i];
+      *param_field(&node_p, axis_field[i]) = s->axis_values[i][j];
+    }
+
+    zsf_results_t results;
+    int err = zsf_calc_steady(&node_p, &results, NULL);
+    if (err) {
+      zsf_surrogate_free(s);
+      return err;
+    }
+    memcpy(&s->table[n * NUM_OUTPUTS], &results, sizeof(zsf_results_t));
+  }
+
+  *surrogate = s;
+  return ZSF_SUCCESS;
+}
+
+// Find the cell such that axis[i] <= x < axis[i + 1], clamping x to the
+// bounds of the axis.
+static int find_cell(const double *axis, int num_points, double *x) {
+  if (*x <= axis[0]) {
+    *x = axis[0];
+    return 0;
+  }
+  if (*x >= axis[num_points - 1]) {
+    *x = axis[num_points - 1];
+    return num_points - 2;
+  }
+
+  int lo = 0;
+  int hi = num_points - 1;
+  while (hi - lo > 1) {
+    int mid = (lo + hi) / 2;
+    if (*x < axis[mid])
+      hi = mid;
+    else
+      lo = mid;
+  }
+  return lo;
+}
+
+// Weights of the nodes i - 1, ..., i + 2 for a cubic Hermite spline with
+// finite difference (Catmull-Rom like) slopes on a non-uniform grid. At the
+// edges of the grid one-sided differences are used, in which case some
+// weights end up on the same node.
+static void cubic_weights(const double *axis, int num_points, int i, double x, int *nodes,
+                          double *w) {
+  int i0 = i > 0 ? i - 1 : i;
+  int i3 = i + 2 < num_points ? i + 2 : i + 1;
+
+  double h = axis[i + 1] - axis[i];
+  double t = (x - axis[i]) / h;
+  double t2 = t * t;
+  double t3 = t2 * t;
+
+  double h00 = 2.0 * t3 - 3.0 * t2 + 1.0;
+  double h10 = t3 - 2.0 * t2 + t;
+  double h01 = -2.0 * t3 + 3.0 * t2;
+  double h11 = t3 - t2;
+
+  double c1 = h10 * h / (axis[i + 1] - axis[i0]);
+  double c2 = h11 * h / (axis[i3] - axis[i]);
+
+  nodes[0] = i0;
+  nodes[1] = i;
+  nodes[2] = i + 1;
+  nodes[3] = i3;
+
+  w[0] = -c1;
+  w[1] = h00 - c2;
+  w[2] = h01 + c1;
+  w[3] = c2;
+}
+
+int ZSF_CALLCONV zsf_surrogate_eval(const zsf_surrogate_t *s, const double *x, int method,
+                                    zsf_results_t *results) {
+  int width;
+  if (method == ZSF_INTERP_LINEAR)
+    width = 2;
+  else if (method == ZSF_INTERP_CUBIC)
+    width = 4;
+  else
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  int nodes[ZSF_SURROGATE_MAX_AXES][4];
+  double weights[ZSF_SURROGATE_MAX_AXES][4];
+
+  for (int i = 0; i < s->num_axes; i++) {
+    double xi = x[i];
+    int cell = find_cell(s->axis_values[i], s->num_points[i], &xi);
+
+    if (width == 2) {
+      double t = (xi - s->axis_values[i][cell]) /
+                 (s->axis_values[i][cell + 1] - s->axis_values[i][cell]);
+      nodes[i][0] = cell;
+      nodes[i][1] = cell + 1;
+      weights[i][0] = 1.0 - t;
+      weights[i][1] = t;
+    } else {
+      cubic_weights(s->axis_values[i], s->num_points[i], cell, xi, nodes[i], weights[i]);
+    }
+  }
+
+  double out[NUM_OUTPUTS] = {0.0};
+
+  // Loop over all corners of the (hyper)cube, with the corner index as a
+  // base-width number with one digit per axis.
+  int num_corners = 1;
+  for (int i = 0; i < s->num_axes; i++)
+    num_corners *= width;
+
+  for (int c = 0; c < num_corners; c++) {
+    size_t offset = 0;
+    double w = 1.0;
+    int rem = c;
+    for (int i = s->num_axes - 1; i >= 0; i--) {
+      int k = rem % width;
+      rem /= width;
+      offset += nodes[i][k] * s->stride[i];
+      w *= weights[i][k];
+    }
+
+    const double *values = &s->table[offset * NUM_OUTPUTS];
+    for (int k = 0; k < NUM_OUTPUTS; k++)
+      out[k] += w * values[k];
+  }
+
+  memcpy(results, out, sizeof(zsf_results_t));
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_surrogate_validate(const zsf_surrogate_t *s, int num_samples, int seed,
+                                        int method, zsf_results_t *max_abs_error,
+                                        zsf_results_t *max_rel_error) {
+  if (num_samples < 1)
+    return ZSF_ERR_INVALID_ARGUMENT;
+
+  uint64_t rng = (uint64_t)seed;
+  zsf_param_t p = s->p;
+
+  double max_abs[NUM_OUTPUTS] = {0.0};
+  double max_rel[NUM_OUTPUTS] = {0.0};
+
+  for (int n = 0; n < num_samples; n++) {
+    // Random points inside the grid are (almost surely) not on a node, and
+    // therefore held out of the table.
+    double x[ZSF_SURROGATE_MAX_AXES];
+    for (int i = 0; i < s->num_axes; i++) {
+      double lo = s->axis_values[i][0];
+      double hi = s->axis_values[i][s->num_points[i] - 1];
+      x[i] = lo + random_uniform(&rng) * (hi - lo);
+      *param_field(&p, s->axis_field[i]) = x[i];
+    }
+
+    zsf_results_t exact, approx;
+    int err = zsf_calc_steady(&p, &exact, NULL);
+    if (err)
+      return err;
+    err = zsf_surrogate_eval(s, x, method, &approx);
+    if (err)
+      return err;
+
+    for (int k = 0; k < NUM_OUTPUTS; k++) {
+      double e = *results_field(&exact, k);
+      double abs_error = fabs(*results_field(&approx, k) - e);
+      max_abs[k] = fmax(max_abs[k], abs_error);
+      if (e != 0.0)
+        max_rel[k] = fmax(max_rel[k], abs_error / fabs(e));
+    }
+  }
+
+  if (max_abs_error != NULL)
+    memcpy(max_abs_error, max_abs, sizeof(zsf_results_t));
+  if (max_rel_error != NULL)
+    memcpy(max_rel_error, max_rel, sizeof(zsf_results_t));
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_surrogate_num_axes(const zsf_surrogate_t *s) { return s->num_axes; }
+
+const char *ZSF_CALLCONV zsf_surrogate_axis_name(const zsf_surrogate_t *s, int axis) {
+  if (axis < 0 || axis >= s->num_axes)
+    return NULL;
+  return param_field_names[s->axis_field[axis]];
+}
+
+// File layout (native endianness):
+//   char[8]    magic
+//   int32      version, num_axes, num_outputs, sizeof(zsf_param_t)
+//   zsf_param_t base parameters
+//   per axis:  char[64] parameter name, int32 number of points, double[] values
+//   double[]   table, num_outputs values per node
+int ZSF_CALLCONV zsf_surrogate_save(const zsf_surrogate_t *s, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return ZSF_ERR_IO;
+
+  int32_t header[4] = {SURROGATE_VERSION, s->num_axes, NUM_OUTPUTS, sizeof(zsf_param_t)};
+  int ok = fwrite(SURROGATE_MAGIC, 1, 8, f) == 8;
+  ok = ok && fwrite(header, sizeof(header), 1, f) == 1;
+  ok = ok && fwrite(&s->p, sizeof(zsf_param_t), 1, f) == 1;
+
+  for (int i = 0; i < s->num_axes && ok; i++) {
+    char name[FIELD_NAME_LENGTH] = {0};
+    strncpy(name, param_field_names[s->axis_field[i]], FIELD_NAME_LENGTH - 1);
+    int32_t num_points = s->num_points[i];
+    ok = ok && fwrite(name, 1, FIELD_NAME_LENGTH, f) == FIELD_NAME_LENGTH;
+    ok = ok && fwrite(&num_points, sizeof(num_points), 1, f) == 1;
+    ok = ok && fwrite(s->axis_values[i], sizeof(double), s->num_points[i], f) ==
+                   (size_t)s->num_points[i];
+  }
+
+  ok = ok && fwrite(s->table, sizeof(double) * NUM_OUTPUTS, s->num_nodes, f) == s->num_nodes;
+
+  if (fclose(f) != 0)
+    ok = 0;
+  return ok ? ZSF_SUCCESS : ZSF_ERR_IO;
+}
+
+int ZSF_CALLCONV zsf_surrogate_load(const char *path, zsf_surrogate_t **surrogate) {
+  *surrogate = NULL;
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL)
+    return ZSF_ERR_IO;
+
+  char magic[8];
+  int32_t header[4];
+  zsf_param_t p;
+  if (fread(magic, 1, 8, f) != 8 || fread(header, sizeof(header), 1, f) != 1 ||
+      fread(&p, sizeof(zsf_param_t), 1, f) != 1) {
+    fclose(f);
+    return ZSF_ERR_FILE_FORMAT;
+  }
+
+  int num_axes = header[1];
+  if (memcmp(magic, SURROGATE_MAGIC, 8) != 0 || header[0] != SURROGATE_VERSION ||
+      num_axes < 1 || num_axes > ZSF_SURROGATE_MAX_AXES || header[2] != NUM_OUTPUTS ||
+      header[3] != sizeof(zsf_param_t)) {
+    fclose(f);
+    return ZSF_ERR_FILE_FORMAT;
+  }
+
+  // We need to know the number of points on all axes before we can allocate,
+  // so remember where the axes start.
+  long axes_start = ftell(f);
+  int axis_field[ZSF_SURROGATE_MAX_AXES];
+  int num_points[ZSF_SURROGATE_MAX_AXES];
+  for (int i = 0; i < num_axes; i++) {
+    char name[FIELD_NAME_LENGTH];
+    int32_t n;
+    if (fread(name, 1, FIELD_NAME_LENGTH, f) != FIELD_NAME_LENGTH ||
+        fread(&n, sizeof(n), 1, f) != 1) {
+      fclose(f);
+      return ZSF_ERR_FILE_FORMAT;
+    }
+    name[FIELD_NAME_LENGTH - 1] = '\0';
+    axis_field[i] = param_field_index(name);
+    num_points[i] = n;
+    if (axis_field[i] < 0 || n < 2 || fseek(f, n * (long)sizeof(double), SEEK_CUR) != 0) {
+      fclose(f);
+      return ZSF_ERR_FILE_FORMAT;
+    }
+  }
+
+  zsf_surrogate_t *s = surrogate_alloc(&p, num_axes, axis_field, num_points);
+  if (s == NULL) {
+    fclose(f);
+    return ZSF_ERR_OUT_OF_MEMORY;
+  }
+
+  int ok = fseek(f, axes_start, SEEK_SET) == 0;
+  for (int i = 0; i < num_axes && ok; i++) {
+    ok = fseek(f, FIELD_NAME_LENGTH + sizeof(int32_t), SEEK_CUR) == 0;
+    ok = ok && fread(s->axis_values[i], sizeof(double), num_points[i], f) == (size_t)num_points[i];
+  }
+  ok = ok && fread(s->table, sizeof(double) * NUM_OUTPUTS, s->num_nodes, f) == s->num_nodes;
+  fclose(f);
+
+  if (!ok) {
+    zsf_surrogate_free(s);
+    return ZSF_ERR_FILE_FORMAT;
+  }
+
+  // The same axes as zsf_surrogate_build accepts
+  for (int i = 0; i < num_axes; i++) {
+    if (!is_valid_axis(s->axis_values[i], num_points[i])) {
+      zsf_surrogate_free(s);
+      return ZSF_ERR_INVALID_ARGUMENT;
+    }
+  }
+
+  *surrogate = s;
+  return ZSF_SUCCESS;
+}
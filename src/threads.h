@@ -0,0 +1,136 @@
+#ifndef ZSF_THREADS_H
+#define ZSF_THREADS_H
+
+// Minimal portable threads and atomics. We only need to start and join a
+// thread, to publish counters between exactly two threads, and to claim
+// shared slots with a compare-and-swap, so we do not depend on C11
+// threads.h/stdatomic.h (which MSVC only partly supports).
+
+#if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN
+#  include <intrin.h>
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <sched.h>
+#  include <time.h>
+#endif
+
+#if defined(_WIN32)
+typedef HANDLE thread_t;
+
+typedef struct thread_start_t {
+  void (*func)(void *);
+  void *arg;
+} thread_start_t;
+
+static DWORD WINAPI thread_trampoline(LPVOID start) {
+  thread_start_t *s = start;
+  s->func(s->arg);
+  return 0;
+}
+
+// The start record has to outlive the call, so the caller provides it
+static inline int thread_create(thread_t *t, thread_start_t *s, void (*func)(void *), void *arg) {
+  s->func = func;
+  s->arg = arg;
+  *t = CreateThread(NULL, 0, thread_trampoline, s, 0, NULL);
+  return *t == NULL;
+}
+
+static inline void thread_join(thread_t t) {
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+
+static inline void thread_yield(void) { SwitchToThread(); }
+static inline void thread_sleep_us(int us) { Sleep(us < 1000 ? 1 : us / 1000); }
+
+static inline long atomic_load_acquire(volatile long *x) { return _InterlockedOr(x, 0); }
+static inline void atomic_store_release(volatile long *x, long v) { _InterlockedExchange(x, v); }
+static inline int atomic_compare_exchange(volatile long *x, long expected, long desired) {
+  return _InterlockedCompareExchange(x, desired, expected) == expected;
+}
+#else
+typedef pthread_t thread_t;
+
+typedef struct thread_start_t {
+  void (*func)(void *);
+  void *arg;
+} thread_start_t;
+
+static void *thread_trampoline(void *start) {
+  thread_start_t *s = start;
+  s->func(s->arg);
+  return NULL;
+}
+
+// The start record has to outlive the call, so the caller provides it
+static inline int thread_create(thread_t *t, thread_start_t *s, void (*func)(void *), void *arg) {
+  s->func = func;
+  s->arg = arg;
+  return pthread_create(t, NULL, thread_trampoline, s) != 0;
+}
+
+static inline void thread_join(thread_t t) { pthread_join(t, NULL); }
+
+static inline void thread_yield(void) { sched_yield(); }
+static inline void thread_sleep_us(int us) {
+  struct timespec ts = {us / 1000000, (us % 1000000) * 1000L};
+  nanosleep(&ts, NULL);
+}
+
+static inline long atomic_load_acquire(volatile long *x) {
+  return __atomic_load_n(x, __ATOMIC_ACQUIRE);
+}
+static inline void atomic_store_release(volatile long *x, long v) {
+  __atomic_store_n(x, v, __ATOMIC_RELEASE);
+}
+static inline int atomic_compare_exchange(volatile long *x, long expected, long desired) {
+  return __atomic_compare_exchange_n(x, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+// Wait for a condition set by the other thread. Spins first, as the wait is
+// typically short when the two threads are in lockstep, then yields, and
+// finally sleeps so that an idle waiter does not keep a core busy.
+#define BACKOFF_SPIN 64
+#define BACKOFF_YIELD 1024
+#define BACKOFF_SLEEP_US 50
+#define BACKOFF_MAX_IDLE_SLEEP_US 10000
+
+typedef struct backoff_t {
+  int count;
+} backoff_t;
+
+static inline void backoff_wait(backoff_t *b) {
+  if (b->count < BACKOFF_SPIN) {
+    b->count++; // busy spin
+  } else if (b->count < BACKOFF_YIELD) {
+    thread_yield();
+    b->count++;
+  } else {
+    thread_sleep_us(BACKOFF_SLEEP_US);
+  }
+}
+
+// Whether the waiter sleeps, i.e. has waited long enough that checking on
+// the other side with a system call costs little in comparison
+static inline int backoff_sleeping(const backoff_t *b) { return b->count >= BACKOFF_YIELD; }
+
+// Wait for work that may not come for a long time. The sleeps double every
+// 64 sleeps, up to 10 ms after about a second, so that a waiter that stays
+// idle hardly ever wakes up. Work that arrives after that waits up to 10 ms.
+static inline void backoff_wait_idle(backoff_t *b) {
+  int level = (b->count - BACKOFF_YIELD) / 64;
+  if (b->count < BACKOFF_YIELD) {
+    backoff_wait(b);
+  } else if (level < 8) {
+    thread_sleep_us(BACKOFF_SLEEP_US << level);
+    b->count++;
+  } else {
+    thread_sleep_us(BACKOFF_MAX_IDLE_SLEEP_US);
+  }
+}
+
+#endif
@@ -4,11 +4,11 @@
 #include "zsf.h"
 #include <math.h>
 
-int is_close(double a, double b, double rtol, double atol);
-double sal_psu_2_density(double sal_psu, double temperature);
-double sal_2_density(double sal_kgm3, double temperature, double rtol, double atol);
+static inline int is_close(double a, double b, double rtol, double atol);
+static inline double sal_psu_2_density(double sal_psu, double temperature);
+static inline double sal_2_density(double sal_kgm3, double temperature, double rtol, double atol);
 
-int is_close(double a, double b, double rtol, double atol) {
+static inline int is_close(double a, double b, double rtol, double atol) {
   double max_abs = fmax(fabs(a), fabs(b));
   if (fabs(a - b) <= fmax(rtol * max_abs, atol))
     return 1;
@@ -16,7 +16,7 @@ int is_close(double a, double b, double rtol, double atol) {
     return 0;
 }
 
-double sal_psu_2_density(double sal_psu, double temperature) {
+static inline double sal_psu_2_density(double sal_psu, double temperature) {
   // Calculates the density of sea water using the UNESCO 1981 algorithm.
   double a = (8.24493E-1 - 4.0899E-3 * temperature + 7.6438E-5 * pow(temperature, 2.0) -
               8.2467E-7 * pow(temperature, 3.0) + 5.3875E-9 * pow(temperature, 4.0));
@@ -30,7 +30,7 @@ double sal_psu_2_density(double sal_psu, double temperature) {
   return rho_ref + a * sal_psu + b * pow(sal_psu, 1.5) + c * pow(sal_psu, 2.0);
 }
 
-double sal_2_density(double sal_kgm3, double temperature, double rtol, double atol) {
+static inline double sal_2_density(double sal_kgm3, double temperature, double rtol, double atol) {
   /*
     Calculates the density of sea water using the UNESCO 1981 algorith, but
     using salinity in kg/m3 as input.
@@ -0,0 +1,157 @@
+#include <math.h>
+
+#include "errors.h"
+#include "fields.h"
+#include "zsf.h"
+#include "zsf_f32.h"
+
+typedef float real_t;
+typedef zsf_param_f32_t param_t;
+typedef zsf_results_f32_t results_t;
+typedef zsf_phase_state_f32_t phase_state_t;
+typedef zsf_phase_transports_f32_t phase_transports_t;
+
+#define R(x) x##f
+#define FMAX fmaxf
+#define FMIN fminf
+#define FABS fabsf
+#define SQRT sqrtf
+#define CBRT cbrtf
+#define POW powf
+#define COPYSIGN copysignf
+#define EXP expf
+#define TANH_EXACT tanhf
+
+#define ASSERT_TOL R(1E-4)
+
+#include "phases.h"
+
+void ZSF_CALLCONV zsf_param_to_f32(const zsf_param_t *p, zsf_param_f32_t *p_f32) {
+  const double *src = (const double *)p;
+  float *dst = (float *)p_f32;
+  for (int i = 0; i < ZSF_NUM_PARAM_FIELDS; i++)
+    dst[i] = (float)src[i];
+}
+
+void ZSF_CALLCONV zsf_param_default_f32(zsf_param_f32_t *p) {
+  zsf_param_t p_f64;
+  zsf_param_default(&p_f64);
+  zsf_param_to_f32(&p_f64, p);
+}
+
+int ZSF_CALLCONV zsf_initialize_state_f32(const zsf_param_f32_t *p, zsf_phase_state_f32_t *state,
+                                          float sal_lock, float head_lock) {
+  state->salinity_lock = sal_lock;
+  state->saltmass_lock = sal_lock * (p->lock_length * p->lock_width * (head_lock - p->lock_bottom));
+  state->head_lock = head_lock;
+  state->volume_ship_in_lock = 0.0f;
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_step_phase_1_f32(const zsf_param_f32_t *p, float t_level,
+                                      zsf_phase_state_f32_t *state,
+                                      zsf_phase_transports_f32_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  int err = check_parameters_state(p, &o, state);
+  if (err) {
+    return err;
+  }
+
+  int features = kernel_features(p, &o, state);
+  step_phase_1_variants[features](p, &o, t_level, state, results);
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_step_phase_2_f32(const zsf_param_f32_t *p, float t_open_lake,
+                                      zsf_phase_state_f32_t *state,
+                                      zsf_phase_transports_f32_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  int err = check_parameters_state(p, &o, state);
+  if (err) {
+    return err;
+  }
+  if (fabsf(state->head_lock - p->head_lake) > 1E-4f) {
+    return ZSF_ERR_REMAINING_HEAD_DIFF;
+  }
+
+  int features = kernel_features(p, &o, state);
+  step_phase_2_variants[features](p, &o, t_open_lake, state, results);
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_step_phase_3_f32(const zsf_param_f32_t *p, float t_level,
+                                      zsf_phase_state_f32_t *state,
+                                      zsf_phase_transports_f32_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  int err = check_parameters_state(p, &o, state);
+  if (err) {
+    return err;
+  }
+
+  int features = kernel_features(p, &o, state);
+  step_phase_3_variants[features](p, &o, t_level, state, results);
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_step_phase_4_f32(const zsf_param_f32_t *p, float t_open_sea,
+                                      zsf_phase_state_f32_t *state,
+                                      zsf_phase_transports_f32_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  int err = check_parameters_state(p, &o, state);
+  if (err) {
+    return err;
+  }
+  if (fabsf(state->head_lock - p->head_sea) > 1E-4f) {
+    return ZSF_ERR_REMAINING_HEAD_DIFF;
+  }
+
+  int features = kernel_features(p, &o, state);
+  step_phase_4_variants[features](p, &o, t_open_sea, state, results);
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_step_flush_doors_closed_f32(const zsf_param_f32_t *p, float t_flushing,
+                                                 zsf_phase_state_f32_t *state,
+                                                 zsf_phase_transports_f32_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  int err = check_parameters_state(p, &o, state);
+  if (err) {
+    return err;
+  }
+
+  int features = kernel_features(p, &o, state);
+  step_flush_doors_closed_variants[features](p, &o, t_flushing, state, results);
+
+  return ZSF_SUCCESS;
+}
+
+int ZSF_CALLCONV zsf_calc_steady_f32(const zsf_param_f32_t *p, zsf_results_f32_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  steady_cycle_t c;
+  int err = steady_solve(p, &o, &c);
+  if (err) {
+    return err;
+  }
+
+  steady_totals_t t;
+  steady_results(p, &o, &c, results, &t);
+
+  return ZSF_SUCCESS;
+}
@@ -0,0 +1,134 @@
+##############################################################################
+# test_zsf_cli: tests of the zsf runner
+##############################################################################
+
+# Runs the zsf binary on small tables, and checks that the merged outputs of
+# all shards equal the output of a single run, and that merge rejects an
+# incomplete or inconsistent set of shards.
+#
+# Usage: cmake -DZSF=<zsf binary> -DWORK_DIR=<directory> -DCASE=<case>
+#              -P test_zsf_cli.cmake
+#
+# The "shards" case writes the outputs of the shards to WORK_DIR, where the
+# merge_* cases expect them.
+
+foreach(variable ZSF WORK_DIR CASE)
+    if(NOT DEFINED ${variable})
+        message(FATAL_ERROR "${variable} is not set")
+    endif()
+endforeach()
+
+# Runs zsf, and checks whether it fails with the expected error message, or
+# succeeds when there is none
+function(run_zsf expected_error)
+    execute_process(COMMAND ${ZSF} ${ARGN}
+        WORKING_DIRECTORY ${WORK_DIR}
+        RESULT_VARIABLE result
+        ERROR_VARIABLE error)
+    if(expected_error STREQUAL "")
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "zsf ${ARGN} failed (${result}):\n${error}")
+        endif()
+    elseif(result EQUAL 0)
+        message(FATAL_ERROR "zsf ${ARGN} did not fail")
+    elseif(NOT error MATCHES "${expected_error}")
+        message(FATAL_ERROR "zsf ${ARGN} did not fail with \"${expected_error}\":\n${error}")
+    endif()
+endfunction()
+
+function(check_same_files a b)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${a} ${b}
+        WORKING_DIRECTORY ${WORK_DIR}
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${a} and ${b} differ")
+    endif()
+endfunction()
+
+# Parameters of the steady state, one row per number of cycles. The table
+# with an extra row gives the shards a different total.
+function(write_parameters path num_rows)
+    set(lines "lock_length,lock_width,lock_bottom,num_cycles,door_time_to_open,leveling_time,")
+    string(APPEND lines "ship_volume_sea_to_lake,ship_volume_lake_to_sea,head_sea,salinity_sea,")
+    string(APPEND lines "temperature_sea,head_lake,salinity_lake,temperature_lake\n")
+    foreach(i RANGE 1 ${num_rows})
+        math(EXPR num_cycles "8 + ${i}")
+        math(EXPR volume "100 * ${i}")
+        string(APPEND lines
+            "148,14,-4.4,${num_cycles},300,300,${volume},${volume},0,25,15,-0.4,5,15\n")
+    endforeach()
+    file(WRITE ${WORK_DIR}/${path} "${lines}")
+endfunction()
+
+# Lockages of five locks, which are not sorted by lock
+function(write_lockages path)
+    set(lines "lock,time,routine,duration,ship_volume_lake_to_sea,ship_volume_sea_to_lake,")
+    string(APPEND lines "num_ships\n")
+    foreach(i RANGE 0 7)
+        math(EXPR time "600 * ${i}")
+        math(EXPR routine "1 + ${i} % 4")
+        foreach(lock 3 12 5 9 8)
+            math(EXPR volume "${lock} * 100")
+            string(APPEND lines "${lock},${time},${routine},300,${volume},${volume},1\n")
+        endforeach()
+    endforeach()
+    file(WRITE ${WORK_DIR}/${path} "${lines}")
+endfunction()
+
+set(lock_options --set head_sea=0.5 --set salinity_sea=25 --set salinity_lake=5)
+
+if(CASE STREQUAL "shards")
+    file(REMOVE_RECURSE ${WORK_DIR})
+    file(MAKE_DIRECTORY ${WORK_DIR})
+    write_parameters(parameters.csv 7)
+    write_parameters(parameters_8.csv 8)
+    write_lockages(lockages.csv)
+
+    # Steady state, with CSV and columnar outputs of the shards, merged in
+    # any order
+    run_zsf("" steady parameters.csv steady.csv)
+    foreach(shard 0 1 2)
+        run_zsf("" steady --threads 2 --shard ${shard}/3 parameters.csv steady_${shard}.csv)
+        run_zsf("" steady --shard ${shard}/3 parameters.csv steady_${shard}.zsfc)
+    endforeach()
+    run_zsf("" merge merged.csv steady_2.csv steady_0.csv steady_1.csv)
+    check_same_files(merged.csv steady.csv)
+    run_zsf("" merge merged.csv steady_1.zsfc steady_2.zsfc steady_0.zsfc)
+    check_same_files(merged.csv steady.csv)
+
+    # More shards than rows leaves some shards without any rows
+    foreach(shard RANGE 0 9)
+        run_zsf("" steady --shard ${shard}/10 parameters.csv steady_${shard}_10.csv)
+        list(APPEND inputs steady_${shard}_10.csv)
+    endforeach()
+    run_zsf("" merge merged.csv ${inputs})
+    check_same_files(merged.csv steady.csv)
+
+    # Unsteady, sharded by lock
+    run_zsf("" unsteady ${lock_options} lockages.csv unsteady.csv)
+    foreach(shard 0 1 2)
+        run_zsf("" unsteady ${lock_options} --shard ${shard}/3 lockages.csv unsteady_${shard}.csv)
+    endforeach()
+    run_zsf("" merge merged.csv unsteady_0.csv unsteady_2.csv unsteady_1.csv)
+    check_same_files(merged.csv unsteady.csv)
+
+    # Shards that do not belong with the others
+    run_zsf("" steady --shard 1/2 parameters.csv steady_1_2.csv)
+    run_zsf("" steady --shard 1/3 parameters_8.csv steady_1_3_8.csv)
+elseif(CASE STREQUAL "merge_missing")
+    run_zsf("shard 1/3 is missing" merge merged.csv steady_0.csv steady_2.csv)
+    run_zsf("shard 2/3 is missing" merge merged.csv unsteady_0.csv unsteady_1.csv)
+elseif(CASE STREQUAL "merge_duplicate")
+    run_zsf("steady_1.csv and steady_1.csv are both shard 1"
+        merge merged.csv steady_0.csv steady_1.csv steady_1.csv steady_2.csv)
+    run_zsf("steady_0.csv and steady_0.zsfc are both shard 0"
+        merge merged.csv steady_0.csv steady_1.csv steady_2.csv steady_0.zsfc)
+elseif(CASE STREQUAL "merge_num_shards")
+    run_zsf("steady_1_2.csv: invalid or inconsistent shard"
+        merge merged.csv steady_0.csv steady_1_2.csv steady_2.csv)
+elseif(CASE STREQUAL "merge_total")
+    run_zsf("steady_1_3_8.csv: invalid or inconsistent shard"
+        merge merged.csv steady_0.csv steady_1_3_8.csv steady_2.csv)
+else()
+    message(FATAL_ERROR "unknown case ${CASE}")
+endif()
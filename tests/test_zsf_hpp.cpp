@@ -0,0 +1,222 @@
+/*****************************************************************************
+ * test_zsf_hpp: tests of the C++ interface
+ *****************************************************************************/
+
+// Instantiates the header-only C++ interface in zsf.hpp, and checks it
+// against the C interface it wraps. Built once per supported C++ standard.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "zsf.hpp"
+
+extern "C" {
+#include "errors.h"
+}
+
+// The error codes of the C++ interface are those of the C library
+#define ZSF_CHECK_ERRC(NAME, CODE)                                                                 \
+  static_assert(static_cast<int>(zsf::errc::NAME) == (CODE), "zsf::errc::" #NAME)
+ZSF_CHECK_ERRC(success, ZSF_SUCCESS);
+ZSF_CHECK_ERRC(ship_too_big, ZSF_SHIP_TOO_BIG);
+ZSF_CHECK_ERRC(remaining_head_diff, ZSF_ERR_REMAINING_HEAD_DIFF);
+ZSF_CHECK_ERRC(sal_lock_out_of_bounds, ZSF_ERR_SAL_LOCK_OUT_OF_BOUNDS);
+ZSF_CHECK_ERRC(invalid_argument, ZSF_ERR_INVALID_ARGUMENT);
+ZSF_CHECK_ERRC(out_of_memory, ZSF_ERR_OUT_OF_MEMORY);
+ZSF_CHECK_ERRC(io, ZSF_ERR_IO);
+ZSF_CHECK_ERRC(file_format, ZSF_ERR_FILE_FORMAT);
+ZSF_CHECK_ERRC(compartment_out_of_bounds, ZSF_ERR_COMPARTMENT_OUT_OF_BOUNDS);
+ZSF_CHECK_ERRC(service_unavailable, ZSF_ERR_SERVICE_UNAVAILABLE);
+ZSF_CHECK_ERRC(schedule_infeasible, ZSF_ERR_SCHEDULE_INFEASIBLE);
+ZSF_CHECK_ERRC(not_converged, ZSF_ERR_NOT_CONVERGED);
+#undef ZSF_CHECK_ERRC
+
+// A new C error code has to be added to zsf::errc as well
+static_assert(static_cast<int>(zsf::errc::not_converged) == ZSF_NUM_ERRORS - 1,
+              "zsf::errc is missing error codes");
+
+// Handles are owned by exactly one object
+static_assert(!std::is_copy_constructible_v<zsf::lockage_generator>);
+static_assert(std::is_nothrow_move_constructible_v<zsf::lockage_generator>);
+
+static int num_failures = 0;
+
+#define CHECK(COND)                                                                                \
+  do {                                                                                             \
+    if (!(COND)) {                                                                                 \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #COND);              \
+      num_failures++;                                                                              \
+    }                                                                                              \
+  } while (0)
+
+template <class T> static bool same(const T &a, const T &b) {
+  return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+static void test_param_builder() {
+  zsf_param_t expected;
+  zsf_param_default(&expected);
+  expected.head_sea = 0.5;
+  expected.salinity_sea = 25.0;
+
+  zsf_param_t p = zsf::param_builder().head_sea(0.5).salinity_sea(25.0);
+  CHECK(same(p, expected));
+
+  // Starting from existing parameters
+  zsf_param_t q = zsf::param_builder(p).head_lake(-0.2).build();
+  expected.head_lake = -0.2;
+  CHECK(same(q, expected));
+}
+
+static void test_calc_steady_batch() {
+  std::vector<zsf_param_t> p;
+  for (int i = 0; i < 16; i++)
+    p.push_back(zsf::param_builder().head_sea(-0.5 + 0.1 * i));
+
+  std::vector<zsf_results_t> expected(p.size());
+  for (std::size_t i = 0; i < p.size(); i++)
+    CHECK(zsf_calc_steady(&p[i], &expected[i], nullptr) == ZSF_SUCCESS);
+  CHECK(same(zsf::calc_steady(p[3]), expected[3]));
+
+  std::vector<zsf_results_t> results(p.size());
+  CHECK(zsf::calc_steady_batch(p, results) == zsf::errc::success);
+  for (std::size_t i = 0; i < p.size(); i++)
+    CHECK(same(results[i], expected[i]));
+
+  // Failed calculations either throw, or are returned with their errors
+  p[5] = zsf::param_builder(p[5]).ship_volume_lake_to_sea(1e6);
+  bool thrown = false;
+  try {
+    zsf::calc_steady_batch(p, results);
+  } catch (const zsf::error &e) {
+    thrown = e.code() == zsf::errc::ship_too_big;
+  }
+  CHECK(thrown);
+
+  std::vector<int> errors(p.size());
+  CHECK(zsf::calc_steady_batch(p, results, errors) == zsf::errc::ship_too_big);
+  CHECK(errors[5] == ZSF_SHIP_TOO_BIG && errors[4] == ZSF_SUCCESS);
+  CHECK(results[5].salt_load_lake == ZSF_NAN);
+  CHECK(same(results[4], expected[4]));
+
+  // Selected fields with strides, which have to fit in the outputs
+  int mask = ZSF_OUTPUT_SALT_LOAD_LAKE | ZSF_OUTPUT_SALT_LOAD_SEA;
+  std::vector<double> outputs(2 * p.size());
+  CHECK(zsf::calc_steady_batch(p, mask, outputs, 2, 1, errors) == zsf::errc::ship_too_big);
+  CHECK(outputs[8] == expected[4].salt_load_lake && outputs[9] == expected[4].salt_load_sea);
+
+  thrown = false;
+  try {
+    zsf::calc_steady_batch(p, mask, zsf::span<double>(outputs.data(), outputs.size() - 1), 2, 1,
+                           errors);
+  } catch (const zsf::error &e) {
+    thrown = e.code() == zsf::errc::invalid_argument;
+  }
+  CHECK(thrown);
+
+#ifdef ZSF_HAS_EXECUTION
+  std::vector<zsf_results_t> parallel(p.size());
+  std::vector<int> parallel_errors(p.size());
+  CHECK(zsf::calc_steady_batch(std::execution::par, p, parallel, parallel_errors) ==
+        zsf::errc::ship_too_big);
+  CHECK(parallel_errors == errors);
+  for (std::size_t i = 0; i < p.size(); i++) {
+    if (i != 5)
+      CHECK(same(parallel[i], results[i]));
+  }
+#endif
+}
+
+static void test_lock() {
+  zsf_param_t p = zsf::param_builder().head_sea(0.5).salinity_sea(25.0);
+
+  zsf_phase_state_t state;
+  zsf_phase_transports_t expected;
+  CHECK(zsf_initialize_state(&p, &state, 15.0, 0.0) == ZSF_SUCCESS);
+  CHECK(zsf_step_phase_1(&p, 300.0, &state, &expected) == ZSF_SUCCESS);
+
+  zsf::lock l(p, 15.0, 0.0);
+  CHECK(same(l.step_phase_1(300.0), expected));
+  CHECK(same(l.state(), state));
+
+  // Every lockage needs its transports
+  std::vector<zsf_lockage_t> lockages(2, zsf_lockage_t{0.0, 1.0, 300.0, 0.0, 0.0, 0.0});
+  std::vector<zsf_phase_transports_t> transports(1);
+  bool thrown = false;
+  try {
+    l.step_lockages(lockages, transports);
+  } catch (const zsf::error &e) {
+    thrown = e.code() == zsf::errc::invalid_argument;
+  }
+  CHECK(thrown);
+}
+
+static void test_surrogate() {
+  const char *axis_names[] = {"head_sea", "salinity_sea"};
+  int num_points[] = {3, 2};
+  double axis_values[] = {-0.5, 0.0, 0.5, 20.0, 30.0};
+  zsf_param_t p = zsf::param_builder();
+
+  zsf::surrogate s = zsf::surrogate::build(p, axis_names, num_points, axis_values);
+  CHECK(s.num_axes() == 2);
+
+  // The grid values have to match the number of points of the axes
+  bool thrown = false;
+  try {
+    zsf::surrogate::build(p, axis_names, num_points, zsf::span<const double>(axis_values, 4));
+  } catch (const zsf::error &e) {
+    thrown = e.code() == zsf::errc::invalid_argument;
+  }
+  CHECK(thrown);
+}
+
+static void test_lockage_generator() {
+  zsf_traffic_t traffic = {20.0, 20.0, 0.0};
+  zsf_fleet_class_t fleet[] = {{1.0, 2000.0, 500.0, 1e9}};
+  zsf_lock_policy_t policy = {300.0, 600.0, 120.0, 3600.0, 6.0, 20000.0, 1.0, 1800.0};
+
+  zsf::lockage_generator g(traffic, fleet, policy, 42);
+  std::vector<zsf_lockage_t> buffer(1000);
+  zsf::span<zsf_lockage_t> lockages = g.next(86400.0, buffer);
+  CHECK(!lockages.empty() && lockages.size() < buffer.size());
+
+  // The same seed gives the same lockages
+  zsf_lockage_generator_t *c_generator = nullptr;
+  CHECK(zsf_lockage_generator_create(&traffic, 1, fleet, &policy, 42, &c_generator) ==
+        ZSF_SUCCESS);
+  std::vector<zsf_lockage_t> expected(buffer.size());
+  int num_lockages = 0;
+  CHECK(zsf_lockage_generator_next(c_generator, 86400.0, static_cast<int>(expected.size()),
+                                   expected.data(), &num_lockages) == ZSF_SUCCESS);
+  zsf_lockage_generator_free(c_generator);
+
+  CHECK(lockages.size() == static_cast<std::size_t>(num_lockages));
+  for (std::size_t i = 0; i < lockages.size(); i++)
+    CHECK(same(lockages[i], expected[i]));
+
+  // Ownership moves along with the object
+  zsf_lockage_generator_t *handle = g.get();
+  zsf::lockage_generator moved = std::move(g);
+  CHECK(moved.get() == handle && g.get() == nullptr);
+
+  zsf_param_t p = zsf::param_builder().lock_length(300.0).lock_width(25.0).lock_bottom(-7.0);
+  zsf::lock l(p, 15.0, 0.0);
+  zsf_results_t results = moved.run(l, 2 * 86400.0);
+  CHECK(std::isfinite(results.salt_load_lake));
+}
+
+int main() {
+  test_param_builder();
+  test_calc_steady_batch();
+  test_lock();
+  test_surrogate();
+  test_lockage_generator();
+
+  if (num_failures > 0)
+    std::fprintf(stderr, "%d checks failed\n", num_failures);
+  return num_failures > 0 ? 1 : 0;
+}
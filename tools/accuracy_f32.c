@@ -0,0 +1,122 @@
+/*****************************************************************************
+ * accuracy_f32: deviation of the single precision calculations
+ *****************************************************************************/
+
+// Samples the operational parameter envelope and reports, for every field of
+// zsf_results_t, how far the single precision steady state calculation
+// deviates from the double precision one. The phase-wise kernels are checked
+// the same way on every phase of one locking cycle (including flushing with
+// the doors closed) starting from the same state.
+//
+// Usage: accuracy_f32 [num_samples] [seed]
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "envelope.h"
+#include "report.h"
+#include "zsf.h"
+#include "zsf_f32.h"
+
+int main(int argc, char *argv[]) {
+  int num_samples = argc > 1 ? atoi(argv[1]) : 10000;
+  uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+
+  double *steady_ref = malloc(num_samples * NUM_RESULTS * sizeof(double));
+  double *steady_f32 = malloc(num_samples * NUM_RESULTS * sizeof(double));
+  double *phase_ref = malloc(5 * num_samples * NUM_TRANSPORTS * sizeof(double));
+  double *phase_f32 = malloc(5 * num_samples * NUM_TRANSPORTS * sizeof(double));
+
+  int n_steady = 0, n_phase = 0, n_mismatch = 0;
+
+  for (int i = 0; i < num_samples; i++) {
+    zsf_param_t p;
+    envelope_sample(seed, num_samples, i, &p);
+
+    zsf_param_f32_t p_f32;
+    zsf_param_to_f32(&p, &p_f32);
+
+    // Steady state
+    zsf_results_t r;
+    zsf_results_f32_t r_f32;
+    int err = zsf_calc_steady(&p, &r, NULL);
+    int err_f32 = zsf_calc_steady_f32(&p_f32, &r_f32);
+
+    if (err != err_f32) {
+      n_mismatch++;
+    } else if (!err) {
+      const double *src = (const double *)&r;
+      const float *src_f32 = (const float *)&r_f32;
+      for (size_t k = 0; k < NUM_RESULTS; k++) {
+        steady_ref[n_steady * NUM_RESULTS + k] = src[k];
+        steady_f32[n_steady * NUM_RESULTS + k] = src_f32[k];
+      }
+      n_steady++;
+    }
+
+    // One locking cycle, phase by phase
+    double sal_lock = 0.5 * (p.salinity_lake + p.salinity_sea);
+    zsf_phase_state_t s;
+    zsf_phase_state_f32_t s_f32;
+    zsf_initialize_state(&p, &s, sal_lock, p.head_sea);
+    zsf_initialize_state_f32(&p_f32, &s_f32, (float)sal_lock, p_f32.head_sea);
+
+    err = err_f32 = 0;
+    for (int phase = 1; phase <= 5 && !err && !err_f32; phase++) {
+      zsf_phase_transports_t t;
+      zsf_phase_transports_f32_t t_f32;
+      switch (phase) {
+      case 1:
+        err = zsf_step_phase_1(&p, 300.0, &s, &t);
+        err_f32 = zsf_step_phase_1_f32(&p_f32, 300.0f, &s_f32, &t_f32);
+        break;
+      case 2:
+        err = zsf_step_phase_2(&p, 1200.0, &s, &t);
+        err_f32 = zsf_step_phase_2_f32(&p_f32, 1200.0f, &s_f32, &t_f32);
+        break;
+      case 3:
+        err = zsf_step_flush_doors_closed(&p, 600.0, &s, &t);
+        err_f32 = zsf_step_flush_doors_closed_f32(&p_f32, 600.0f, &s_f32, &t_f32);
+        break;
+      case 4:
+        err = zsf_step_phase_3(&p, 300.0, &s, &t);
+        err_f32 = zsf_step_phase_3_f32(&p_f32, 300.0f, &s_f32, &t_f32);
+        break;
+      case 5:
+        err = zsf_step_phase_4(&p, 1200.0, &s, &t);
+        err_f32 = zsf_step_phase_4_f32(&p_f32, 1200.0f, &s_f32, &t_f32);
+        break;
+      }
+      if (err != err_f32) {
+        n_mismatch++;
+      } else if (!err) {
+        const double *src = (const double *)&t;
+        const float *src_f32 = (const float *)&t_f32;
+        for (size_t k = 0; k < NUM_TRANSPORTS; k++) {
+          phase_ref[n_phase * NUM_TRANSPORTS + k] = src[k];
+          phase_f32[n_phase * NUM_TRANSPORTS + k] = src_f32[k];
+        }
+        n_phase++;
+      }
+    }
+  }
+
+  printf("Single versus double precision over the operational envelope\n");
+  printf("Samples: %d, seed: %llu, differing error codes: %d\n", num_samples,
+         (unsigned long long)seed, n_mismatch);
+
+  if (n_steady > 0)
+    report("zsf_calc_steady", results_field_names, NUM_RESULTS, n_steady, steady_ref, steady_f32);
+  if (n_phase > 0)
+    report("Phase-wise, all phases", transports_field_names, NUM_TRANSPORTS, n_phase,
+           phase_ref, phase_f32);
+
+  free(steady_ref);
+  free(steady_f32);
+  free(phase_ref);
+  free(phase_f32);
+
+  return 0;
+}
@@ -0,0 +1,343 @@
+/*****************************************************************************
+ * accuracy_fast: accuracy versus speed of the fast math build variants
+ *****************************************************************************/
+
+// Compares the build variants of the kernels (precise, with the fast tanh
+// approximation, and with fast math on top of that) against a golden
+// dataset, and reports for every output how far they deviate next to how
+// much faster they are. The golden dataset holds the steady state and the
+// transports of every phase of one locking cycle over a Latin hypercube
+// design of the operational envelope, calculated by the precise variant
+// with tight convergence tolerances.
+//
+// Usage: accuracy_fast [golden.csv]
+//        accuracy_fast --generate golden.csv [num_samples] [seed]
+//
+// Returns a non-zero exit code if the precise variant does not reproduce
+// the golden dataset.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "accuracy_kernels.h"
+#include "envelope.h"
+#include "fields.h"
+#include "report.h"
+#include "zsf.h"
+
+#define NUM_CYCLE_FIELDS (CYCLE_NUM_PHASES * NUM_TRANSPORTS)
+
+// Deviation of the precise variant from the golden dataset that is still
+// acceptable, e.g. due to differences in the math library between platforms
+#define GOLDEN_RTOL 1E-8
+
+// Long enough for the header and the rows of the dataset
+#define MAX_LINE 16384
+
+// Minimum duration of the timing of every variant in seconds
+#define MIN_TIMING 0.25
+
+static const accuracy_variant_t *variants[] = {
+    &accuracy_variant_precise,
+    &accuracy_variant_fast_tanh,
+    &accuracy_variant_fast_math,
+};
+
+#define NUM_VARIANTS (sizeof(variants) / sizeof(variants[0]))
+
+static const char *phase_titles[CYCLE_NUM_PHASES] = {
+    "Phase 1", "Phase 2", "Flushing with doors closed", "Phase 3", "Phase 4"};
+
+typedef struct golden_t {
+  int num_samples;
+  zsf_param_t *p;
+  int *steady_err;
+  double *steady;
+  int *cycle_err;
+  double *cycle;
+} golden_t;
+
+static int golden_alloc(golden_t *g, int num_samples) {
+  g->num_samples = num_samples;
+  g->p = malloc(num_samples * sizeof(zsf_param_t));
+  g->steady_err = malloc(num_samples * sizeof(int));
+  g->steady = malloc(num_samples * NUM_RESULTS * sizeof(double));
+  g->cycle_err = malloc(num_samples * sizeof(int));
+  g->cycle = malloc(num_samples * NUM_CYCLE_FIELDS * sizeof(double));
+  return g->p && g->steady_err && g->steady && g->cycle_err && g->cycle;
+}
+
+static void golden_free(golden_t *g) {
+  free(g->p);
+  free(g->steady_err);
+  free(g->steady);
+  free(g->cycle_err);
+  free(g->cycle);
+}
+
+// The state at the start of the locking cycle, as in accuracy_f32
+static void initial_state(const zsf_param_t *p, zsf_phase_state_t *state) {
+  zsf_initialize_state(p, state, 0.5 * (p->salinity_lake + p->salinity_sea), p->head_sea);
+}
+
+// Calculate a sample with a variant. Outputs of failed calculations are NaN.
+static void calc_sample(const accuracy_variant_t *v, const zsf_param_t *p, int *steady_err,
+                        double *steady, int *cycle_err, double *cycle) {
+  zsf_results_t r;
+  *steady_err = v->calc_steady(p, &r);
+  for (size_t k = 0; k < NUM_RESULTS; k++)
+    steady[k] = *steady_err ? NAN : ((const double *)&r)[k];
+
+  zsf_phase_state_t state;
+  zsf_phase_transports_t t[CYCLE_NUM_PHASES];
+  initial_state(p, &state);
+  *cycle_err = v->step_cycle(p, &state, t);
+  for (size_t k = 0; k < NUM_CYCLE_FIELDS; k++)
+    cycle[k] = *cycle_err ? NAN : ((const double *)t)[k];
+}
+
+// The header row of the dataset, which follows the layout of the structures
+static void header(char *buf, size_t size) {
+  size_t len = 0;
+#define APPEND(...) len += snprintf(buf + len, len < size ? size - len : 0, __VA_ARGS__)
+  for (int j = 0; j < ZSF_NUM_PARAM_FIELDS; j++)
+    APPEND("%s,", param_field_names[j]);
+  APPEND("steady_err");
+  for (size_t k = 0; k < NUM_RESULTS; k++)
+    APPEND(",steady.%s", results_field_names[k]);
+  APPEND(",cycle_err");
+  for (int phase = 0; phase < CYCLE_NUM_PHASES; phase++)
+    for (size_t k = 0; k < NUM_TRANSPORTS; k++)
+      APPEND(",phase%d.%s", phase + 1, transports_field_names[k]);
+  APPEND("\n");
+#undef APPEND
+}
+
+static int generate(const char *path, int num_samples, uint64_t seed) {
+  FILE *f = fopen(path, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Could not open %s for writing\n", path);
+    return 1;
+  }
+
+  char expected[MAX_LINE];
+  header(expected, sizeof(expected));
+
+  fprintf(f, "# zsf golden dataset, samples %d, seed %llu\n", num_samples,
+          (unsigned long long)seed);
+  fputs(expected, f);
+
+  for (int i = 0; i < num_samples; i++) {
+    zsf_param_t p;
+    envelope_sample(seed, num_samples, i, &p);
+    p.rtol = 1E-12;
+    p.atol = 1E-12;
+
+    int steady_err, cycle_err;
+    double steady[NUM_RESULTS], cycle[NUM_CYCLE_FIELDS];
+    calc_sample(&accuracy_variant_precise, &p, &steady_err, steady, &cycle_err, cycle);
+
+    for (int j = 0; j < ZSF_NUM_PARAM_FIELDS; j++)
+      fprintf(f, "%.17g,", *param_field(&p, j));
+    fprintf(f, "%d", steady_err);
+    for (size_t k = 0; k < NUM_RESULTS; k++)
+      fprintf(f, ",%.17g", steady[k]);
+    fprintf(f, ",%d", cycle_err);
+    for (size_t k = 0; k < NUM_CYCLE_FIELDS; k++)
+      fprintf(f, ",%.17g", cycle[k]);
+    fprintf(f, "\n");
+  }
+
+  fclose(f);
+  printf("Wrote %d samples to %s\n", num_samples, path);
+  return 0;
+}
+
+static int read_values(const char *line, int n, double *values) {
+  char *end;
+  for (int j = 0; j < n; j++) {
+    values[j] = strtod(line, &end);
+    if (end == line || (*end != ',' && j < n - 1))
+      return 0;
+    line = end + 1;
+  }
+  return 1;
+}
+
+static int load(const char *path, golden_t *g) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    fprintf(stderr, "Could not open %s\n", path);
+    return 0;
+  }
+
+  // Check the header against the current layout of the structures
+  char expected[MAX_LINE], line[MAX_LINE];
+  header(expected, sizeof(expected));
+
+  int num_samples = 0;
+  int ok = fgets(line, sizeof(line), f) != NULL &&
+           sscanf(line, "# zsf golden dataset, samples %d", &num_samples) == 1;
+  ok = ok && fgets(line, sizeof(line), f) != NULL && strcmp(line, expected) == 0;
+  ok = ok && num_samples > 0 && golden_alloc(g, num_samples);
+
+  const int num_columns = ZSF_NUM_PARAM_FIELDS + 2 + NUM_RESULTS + NUM_CYCLE_FIELDS;
+  double values[ZSF_NUM_PARAM_FIELDS + 2 + NUM_RESULTS + NUM_CYCLE_FIELDS];
+  for (int i = 0; ok && i < num_samples; i++) {
+    ok = fgets(line, sizeof(line), f) != NULL && read_values(line, num_columns, values);
+    if (!ok)
+      break;
+
+    const double *v = values;
+    memcpy(&g->p[i], v, sizeof(zsf_param_t));
+    v += ZSF_NUM_PARAM_FIELDS;
+    g->steady_err[i] = (int)*v++;
+    memcpy(&g->steady[i * NUM_RESULTS], v, NUM_RESULTS * sizeof(double));
+    v += NUM_RESULTS;
+    g->cycle_err[i] = (int)*v++;
+    memcpy(&g->cycle[i * NUM_CYCLE_FIELDS], v, NUM_CYCLE_FIELDS * sizeof(double));
+  }
+
+  fclose(f);
+  if (!ok)
+    fprintf(stderr, "Invalid or incompatible golden dataset %s\n", path);
+  return ok;
+}
+
+// Time per calculation in seconds, repeating all samples until the timing
+// is long enough to be meaningful
+static double time_steady(const accuracy_variant_t *v, const golden_t *g) {
+  zsf_results_t r;
+  long num_calls = 0;
+  clock_t start = clock();
+  double elapsed;
+  do {
+    for (int i = 0; i < g->num_samples; i++)
+      v->calc_steady(&g->p[i], &r);
+    num_calls += g->num_samples;
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+  } while (elapsed < MIN_TIMING);
+  return elapsed / num_calls;
+}
+
+static double time_cycle(const accuracy_variant_t *v, const golden_t *g) {
+  zsf_phase_state_t state;
+  zsf_phase_transports_t t[CYCLE_NUM_PHASES];
+  long num_calls = 0;
+  clock_t start = clock();
+  double elapsed;
+  do {
+    for (int i = 0; i < g->num_samples; i++) {
+      initial_state(&g->p[i], &state);
+      v->step_cycle(&g->p[i], &state, t);
+    }
+    num_calls += g->num_samples;
+    elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+  } while (elapsed < MIN_TIMING);
+  return elapsed / num_calls;
+}
+
+static int compare(const golden_t *g) {
+  int n = g->num_samples;
+  double *steady = malloc(n * NUM_RESULTS * sizeof(double));
+  double *cycle = malloc(n * NUM_CYCLE_FIELDS * sizeof(double));
+  double *steady_ref = malloc(n * NUM_RESULTS * sizeof(double));
+  double *cycle_ref = malloc(n * NUM_CYCLE_FIELDS * sizeof(double));
+
+  double t_steady_precise = 0.0, t_cycle_precise = 0.0;
+  int status = 0;
+
+  for (size_t iv = 0; iv < NUM_VARIANTS; iv++) {
+    const accuracy_variant_t *v = variants[iv];
+
+    // Only samples that succeed in both are compared, phase transports per
+    // phase of the cycle
+    int n_steady = 0, n_cycle = 0, n_mismatch = 0;
+    for (int i = 0; i < n; i++) {
+      int steady_err, cycle_err;
+      double s[NUM_RESULTS], c[NUM_CYCLE_FIELDS];
+      calc_sample(v, &g->p[i], &steady_err, s, &cycle_err, c);
+
+      n_mismatch += (steady_err != g->steady_err[i]) + (cycle_err != g->cycle_err[i]);
+      if (!steady_err && !g->steady_err[i]) {
+        memcpy(&steady[n_steady * NUM_RESULTS], s, sizeof(s));
+        memcpy(&steady_ref[n_steady * NUM_RESULTS], &g->steady[i * NUM_RESULTS], sizeof(s));
+        n_steady++;
+      }
+      if (!cycle_err && !g->cycle_err[i]) {
+        memcpy(&cycle[n_cycle * NUM_CYCLE_FIELDS], c, sizeof(c));
+        memcpy(&cycle_ref[n_cycle * NUM_CYCLE_FIELDS], &g->cycle[i * NUM_CYCLE_FIELDS],
+               sizeof(c));
+        n_cycle++;
+      }
+    }
+
+    double t_steady = time_steady(v, g);
+    double t_cycle = time_cycle(v, g);
+    if (iv == 0) {
+      t_steady_precise = t_steady;
+      t_cycle_precise = t_cycle;
+    }
+
+    printf("\n=== Variant %s ===\n", v->name);
+    printf("Steady state: %.2f us per calculation, speedup %.2f\n", 1E6 * t_steady,
+           t_steady_precise / t_steady);
+    printf("Locking cycle: %.2f us per cycle, speedup %.2f\n", 1E6 * t_cycle,
+           t_cycle_precise / t_cycle);
+    printf("Differing error codes: %d\n", n_mismatch);
+
+    double max_rel = 0.0;
+    if (n_steady > 0)
+      max_rel = fmax(max_rel, report("zsf_calc_steady", results_field_names, NUM_RESULTS, n_steady,
+                                     steady_ref, steady));
+    for (int phase = 0; phase < CYCLE_NUM_PHASES && n_cycle > 0; phase++) {
+      // Gather the transports of this phase
+      double *ref = malloc(n_cycle * NUM_TRANSPORTS * sizeof(double));
+      double *approx = malloc(n_cycle * NUM_TRANSPORTS * sizeof(double));
+      for (int i = 0; i < n_cycle; i++) {
+        size_t offset = i * NUM_CYCLE_FIELDS + phase * NUM_TRANSPORTS;
+        memcpy(&ref[i * NUM_TRANSPORTS], &cycle_ref[offset], NUM_TRANSPORTS * sizeof(double));
+        memcpy(&approx[i * NUM_TRANSPORTS], &cycle[offset], NUM_TRANSPORTS * sizeof(double));
+      }
+
+      max_rel = fmax(max_rel, report(phase_titles[phase], transports_field_names, NUM_TRANSPORTS,
+                                     n_cycle, ref, approx));
+      free(ref);
+      free(approx);
+    }
+
+    if (iv == 0 && (n_mismatch > 0 || max_rel > GOLDEN_RTOL)) {
+      printf("\nThe precise variant does not reproduce the golden dataset\n");
+      status = 1;
+    }
+  }
+
+  free(steady);
+  free(cycle);
+  free(steady_ref);
+  free(cycle_ref);
+  return status;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 2 && strcmp(argv[1], "--generate") == 0) {
+    int num_samples = argc > 3 ? atoi(argv[3]) : 128;
+    uint64_t seed = argc > 4 ? strtoull(argv[4], NULL, 10) : 1;
+    return generate(argv[2], num_samples, seed);
+  }
+
+  const char *path = argc > 1 ? argv[1] : ACCURACY_GOLDEN_PATH;
+  golden_t g;
+  if (!load(path, &g))
+    return 1;
+
+  printf("Build variants versus the golden dataset %s\n", path);
+  printf("Samples: %d\n", g.num_samples);
+  int status = compare(&g);
+
+  golden_free(&g);
+  return status;
+}
@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * accuracy_kernels: the kernels in one build variant
+ *****************************************************************************/
+
+// Compiled once per build variant (see CMakeLists.txt), which is selected by
+// KERNEL_VARIANT, KERNEL_FAST_TANH and the floating point options of the
+// translation unit. As everything in phases.h is static, all variants can be
+// linked into one executable. The steady state and the phase steps follow
+// zsf_calc_steady and the zsf_step_* functions.
+
+#include <math.h>
+
+#include "accuracy_kernels.h"
+#include "errors.h"
+#include "util.h"
+#include "zsf.h"
+
+typedef double real_t;
+typedef zsf_param_t param_t;
+typedef zsf_results_t results_t;
+typedef zsf_phase_state_t phase_state_t;
+typedef zsf_phase_transports_t phase_transports_t;
+
+#define R(x) x
+#define FMAX fmax
+#define FMIN fmin
+#define FABS fabs
+#define SQRT sqrt
+#define CBRT cbrt
+#define POW pow
+#define COPYSIGN copysign
+#define EXP exp
+#define TANH_EXACT tanh
+
+// Independent of the USE_FAST_TANH option of the library itself
+#undef ZSF_USE_FAST_TANH
+#if KERNEL_FAST_TANH
+#  define ZSF_USE_FAST_TANH
+#endif
+
+#include "phases.h"
+
+#define STRINGIFY_(x) #x
+#define STRINGIFY(x) STRINGIFY_(x)
+#define VARIANT_NAME_(V) accuracy_variant_##V
+#define VARIANT_NAME(V) VARIANT_NAME_(V)
+
+static int calc_steady(const zsf_param_t *p, zsf_results_t *results) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  steady_cycle_t c;
+  int err = steady_solve(p, &o, &c);
+  if (err) {
+    return err;
+  }
+
+  steady_totals_t t;
+  steady_results(p, &o, &c, results, &t);
+  return ZSF_SUCCESS;
+}
+
+static int step_cycle(const zsf_param_t *p, zsf_phase_state_t *state,
+                      zsf_phase_transports_t *transports) {
+  derived_parameters_t o;
+  calculate_derived_parameters(p, &o);
+
+  for (int phase = 0; phase < CYCLE_NUM_PHASES; phase++) {
+    int err = check_parameters_state(p, &o, state);
+    if (err) {
+      return err;
+    }
+
+    int features = kernel_features(p, &o, state);
+    switch (phase) {
+    case 0:
+      step_phase_1_variants[features](p, &o, 300.0, state, &transports[phase]);
+      break;
+    case 1:
+      step_phase_2_variants[features](p, &o, 1200.0, state, &transports[phase]);
+      break;
+    case 2:
+      step_flush_doors_closed_variants[features](p, &o, 600.0, state, &transports[phase]);
+      break;
+    case 3:
+      step_phase_3_variants[features](p, &o, 300.0, state, &transports[phase]);
+      break;
+    case 4:
+      step_phase_4_variants[features](p, &o, 1200.0, state, &transports[phase]);
+      break;
+    }
+  }
+  return ZSF_SUCCESS;
+}
+
+const accuracy_variant_t VARIANT_NAME(KERNEL_VARIANT) = {STRINGIFY(KERNEL_VARIANT), calc_steady,
+                                                         step_cycle};
@@ -0,0 +1,23 @@
+#ifndef ZSF_TOOLS_ACCURACY_KERNELS_H
+#define ZSF_TOOLS_ACCURACY_KERNELS_H
+
+// The build variants of the kernels compared by accuracy_fast. Every variant
+// is a separate compilation of accuracy_kernels.c.
+
+#include "zsf.h"
+
+// One locking cycle, including flushing with the doors closed
+#define CYCLE_NUM_PHASES 5
+
+typedef struct accuracy_variant_t {
+  const char *name;
+  int (*calc_steady)(const zsf_param_t *p, zsf_results_t *results);
+  int (*step_cycle)(const zsf_param_t *p, zsf_phase_state_t *state,
+                    zsf_phase_transports_t *transports);
+} accuracy_variant_t;
+
+extern const accuracy_variant_t accuracy_variant_precise;
+extern const accuracy_variant_t accuracy_variant_fast_tanh;
+extern const accuracy_variant_t accuracy_variant_fast_math;
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef ZSF_TOOLS_ENVELOPE_H
+#define ZSF_TOOLS_ENVELOPE_H
+
+// The operational parameter envelope used by the accuracy harnesses, and a
+// reproducible way to sample it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "random.h"
+#include "zsf.h"
+
+typedef struct envelope_range_t {
+  const char *name;
+  size_t offset;
+  double lo;
+  double hi;
+} envelope_range_t;
+
+#define ENVELOPE_RANGE(NAME, LO, HI) {#NAME, offsetof(zsf_param_t, NAME), LO, HI}
+
+static const envelope_range_t envelope[] = {
+    ENVELOPE_RANGE(lock_length, 50.0, 400.0),
+    ENVELOPE_RANGE(lock_width, 8.0, 40.0),
+    ENVELOPE_RANGE(lock_bottom, -12.0, -3.0),
+    ENVELOPE_RANGE(num_cycles, 4.0, 40.0),
+    ENVELOPE_RANGE(head_sea, -2.0, 2.0),
+    ENVELOPE_RANGE(head_lake, -0.5, 0.5),
+    ENVELOPE_RANGE(salinity_sea, 10.0, 35.0),
+    ENVELOPE_RANGE(salinity_lake, 0.0, 8.0),
+    ENVELOPE_RANGE(temperature_sea, 2.0, 25.0),
+    ENVELOPE_RANGE(temperature_lake, 2.0, 25.0),
+    ENVELOPE_RANGE(ship_volume_sea_to_lake, 0.0, 1000.0),
+    ENVELOPE_RANGE(ship_volume_lake_to_sea, 0.0, 1000.0),
+    ENVELOPE_RANGE(flushing_discharge_high_tide, 0.0, 10.0),
+    ENVELOPE_RANGE(flushing_discharge_low_tide, 0.0, 10.0),
+    ENVELOPE_RANGE(density_current_factor_sea, 0.25, 1.0),
+    ENVELOPE_RANGE(density_current_factor_lake, 0.25, 1.0),
+    ENVELOPE_RANGE(distance_door_bubble_screen_sea, -20.0, 20.0),
+    ENVELOPE_RANGE(distance_door_bubble_screen_lake, -20.0, 20.0),
+    ENVELOPE_RANGE(sill_height_sea, 0.0, 1.0),
+    ENVELOPE_RANGE(sill_height_lake, 0.0, 1.0),
+};
+
+#define ENVELOPE_SIZE (sizeof(envelope) / sizeof(envelope[0]))
+
+// Fill p with sample i of a Latin hypercube design of n samples. The
+// permutations per dimension are derived from the seed, so that the design
+// can be regenerated from (n, seed) alone.
+static inline void envelope_sample(uint64_t seed, int n, int i, zsf_param_t *p) {
+  zsf_param_default(p);
+
+  for (size_t d = 0; d < ENVELOPE_SIZE; d++) {
+    // A multiplicative permutation of 0..n-1 per dimension (n need not be
+    // prime, so walk until we land inside the range).
+    uint64_t rng = seed * 1000003u + d;
+    uint64_t a = 1 + 2 * (uint64_t)(random_uniform(&rng) * n);
+    uint64_t b = (uint64_t)(random_uniform(&rng) * n);
+    uint64_t m = 1;
+    while (m < (uint64_t)n)
+      m <<= 1;
+    uint64_t k = (uint64_t)i;
+    do {
+      k = (a * k + b) & (m - 1);
+    } while (k >= (uint64_t)n);
+
+    uint64_t jitter_rng = seed ^ ((uint64_t)i << 20) ^ d;
+    double u = (k + random_uniform(&jitter_rng)) / n;
+
+    double *field = (double *)((char *)p + envelope[d].offset);
+    *field = envelope[d].lo + u * (envelope[d].hi - envelope[d].lo);
+  }
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef ZSF_TOOLS_REPORT_H
+#define ZSF_TOOLS_REPORT_H
+
+// Error statistics per output field, shared by the accuracy harnesses.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fields.h"
+#include "zsf.h"
+
+#define NUM_RESULTS ZSF_NUM_RESULTS_FIELDS
+#define NUM_TRANSPORTS ZSF_NUM_TRANSPORTS_FIELDS
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Relative errors are taken with respect to the magnitude of the field over
+// all samples where the field itself is (close to) zero. Samples where the
+// reference result is not finite are skipped; those where only the
+// approximate result is not finite are counted separately. Returns the
+// maximum relative error over all fields.
+static double report(const char *title, const char *const *names, int num_fields, int n,
+                     const double *ref, const double *approx) {
+  double *rel = malloc(n * sizeof(double));
+  double max_rel = 0.0;
+
+  printf("\n%s (%d samples)\n", title, n);
+  printf("%-22s %12s %12s %12s %12s %12s %8s\n", "field", "max abs", "max rel", "mean rel",
+         "p50 rel", "p99 rel", "nonfin");
+
+  for (int k = 0; k < num_fields; k++) {
+    double scale = 0.0;
+    for (int i = 0; i < n; i++)
+      scale = fmax(scale, fabs(ref[i * num_fields + k]));
+
+    double max_abs = 0.0, sum_rel = 0.0;
+    int m = 0, num_nonfinite = 0;
+    for (int i = 0; i < n; i++) {
+      double r = ref[i * num_fields + k];
+      double a = approx[i * num_fields + k];
+      if (!isfinite(r))
+        continue;
+      if (!isfinite(a)) {
+        num_nonfinite++;
+        continue;
+      }
+      double e = fabs(a - r);
+      max_abs = fmax(max_abs, e);
+      rel[m] = e / fmax(fabs(r), 1E-6 * scale + 1E-300);
+      sum_rel += rel[m++];
+    }
+    if (m == 0) {
+      printf("%-22s %12s %12s %12s %12s %12s %8d\n", names[k], "-", "-", "-", "-", "-",
+             num_nonfinite);
+      continue;
+    }
+    qsort(rel, m, sizeof(double), compare_doubles);
+    max_rel = fmax(max_rel, rel[m - 1]);
+
+    printf("%-22s %12.3e %12.3e %12.3e %12.3e %12.3e %8d\n", names[k], max_abs, rel[m - 1],
+           sum_rel / m, rel[(m - 1) / 2], rel[(int)(0.99 * (m - 1))], num_nonfinite);
+  }
+
+  free(rel);
+  return max_rel;
+}
+
+#endif
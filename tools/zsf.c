@@ -0,0 +1,1041 @@
+/*****************************************************************************
+ * zsf: command-line batch runner
+ *****************************************************************************/
+
+// Calculates the steady state for every row of a table of parameters, or
+// steps locks through a log of lockages, on all processors of the machine.
+// Large studies can be split over independent processes with --shard, each
+// calculating a deterministic part of the table, after which the outputs
+// of all shards are merged into one.
+//
+// Usage: zsf steady [options] <parameters> <output>
+//        zsf unsteady [options] <lockages> <output>
+//        zsf merge <output> <input>...
+//
+// Options:
+//   --threads n          number of threads (default: number of processors)
+//   --shard i/n          only calculate part i of n, counting from 0
+//   --set name=value     value of a parameter that is not in the table
+//   --parameters path    table of parameters, one row per lock (unsteady)
+//   --salinity-lock s    initial salinity of the locks (unsteady, default
+//                        salinity_lake)
+//   --head-lock h        initial head of the locks (unsteady, default
+//                        head_lake)
+//
+// Tables are CSV files with a header line, or columnar files as written by
+// zsf_output_open (recognised by their contents). Outputs are written as
+// CSV when their name ends with .csv or is - (standard output), and as
+// columnar files otherwise.
+//
+// The output of "steady" has a row for every parameter set, with its index
+// in the table, the error code and the fields of zsf_results_t. The
+// lockages of "unsteady" are grouped by their (optional) lock column, and
+// every lock starts from the given initial state. Its output has a row for
+// every lockage, with the fields of zsf_output_record_t.
+//
+// The output of a shard also has the shard, the number of shards and the
+// total number of rows or locks, so that "merge" can check that all shards
+// are there before it writes the output of a single run.
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#  include <unistd.h>
+#endif
+
+#include "errors.h"
+#include "fields.h"
+#include "threads.h"
+#include "zsf.h"
+
+#define MAX_COLUMNS 64
+#define NAME_LENGTH 32
+#define MAX_LINE (1 << 16)
+#define MAX_THREADS 256
+
+// Number of rows or lockages calculated at once, before they are written
+#define BLOCK_ROWS (1 << 14)
+#define BLOCK_LOCKAGES (1 << 16)
+
+// Ring buffer and chunk size of columnar outputs
+#define RING_CAPACITY 4096
+#define CHUNK_ROWS 4096
+
+#define NUM_STEADY_COLUMNS (2 + ZSF_NUM_RESULTS_FIELDS)
+#define NUM_UNSTEADY_COLUMNS (3 + ZSF_NUM_TRANSPORTS_FIELDS)
+
+static int num_processors(void) {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int)info.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+#endif
+}
+
+// Tables
+// ~~~~~~
+typedef struct table_t {
+  int num_columns;
+  char names[MAX_COLUMNS][NAME_LENGTH];
+  long num_rows;
+  double *values; // row by row
+} table_t;
+
+static int table_column(const table_t *t, const char *name) {
+  for (int c = 0; c < t->num_columns; c++) {
+    if (strcmp(t->names[c], name) == 0)
+      return c;
+  }
+  return -1;
+}
+
+static int table_reserve(table_t *t, long *capacity, long num_rows) {
+  if (num_rows <= *capacity)
+    return 1;
+  long n = (*capacity > 0) ? *capacity : 1024;
+  while (n < num_rows)
+    n *= 2;
+  double *values = realloc(t->values, (size_t)n * t->num_columns * sizeof(double));
+  if (values == NULL)
+    return 0;
+  t->values = values;
+  *capacity = n;
+  return 1;
+}
+
+// Strip whitespace and quotes around a field of a CSV line
+static char *trim(char *s) {
+  while (*s == ' ' || *s == '\t' || *s == '"')
+    s++;
+  size_t n = strlen(s);
+  while (n > 0 && (s[n - 1] == ' ' || s[n - 1] == '\t' || s[n - 1] == '"' || s[n - 1] == '\r' ||
+                   s[n - 1] == '\n'))
+    s[--n] = '\0';
+  return s;
+}
+
+static int read_csv(const char *path, FILE *f, table_t *t) {
+  char *line = malloc(MAX_LINE);
+  if (line == NULL) {
+    fprintf(stderr, "zsf: out of memory\n");
+    return 0;
+  }
+
+  int ok = fgets(line, MAX_LINE, f) != NULL;
+  if (!ok)
+    fprintf(stderr, "zsf: %s: missing header\n", path);
+
+  // The header holds the column names
+  for (char *s = line; ok && s != NULL; t->num_columns++) {
+    char *next = strchr(s, ',');
+    if (next != NULL)
+      *next++ = '\0';
+    s = trim(s);
+    if (t->num_columns == MAX_COLUMNS || strlen(s) == 0 || strlen(s) >= NAME_LENGTH) {
+      fprintf(stderr, "zsf: %s: invalid header\n", path);
+      ok = 0;
+      break;
+    }
+    strcpy(t->names[t->num_columns], s);
+    s = next;
+  }
+
+  long capacity = 0;
+  for (long line_number = 2; ok && fgets(line, MAX_LINE, f) != NULL; line_number++) {
+    if (strlen(trim(line)) == 0)
+      continue;
+    if (!table_reserve(t, &capacity, t->num_rows + 1)) {
+      fprintf(stderr, "zsf: out of memory\n");
+      ok = 0;
+      break;
+    }
+
+    double *row = &t->values[t->num_rows * t->num_columns];
+    char *s = line;
+    for (int c = 0; ok && c < t->num_columns; c++) {
+      char *end;
+      row[c] = strtod(s, &end);
+      while (*end == ' ' || *end == '\t')
+        end++;
+      ok = end != s && (*end == (c < t->num_columns - 1 ? ',' : '\0'));
+      s = end + 1;
+    }
+    if (!ok)
+      fprintf(stderr, "zsf: %s:%ld: expected %d numbers\n", path, line_number, t->num_columns);
+    t->num_rows++;
+  }
+
+  free(line);
+  return ok;
+}
+
+static int read_columnar(const char *path, table_t *t) {
+  zsf_output_reader_t *r;
+  int err = zsf_output_reader_open(path, &r);
+  if (err) {
+    fprintf(stderr, "zsf: %s: %s\n", path, zsf_error_msg(err));
+    return 0;
+  }
+
+  t->num_columns = zsf_output_reader_num_columns(r);
+  if (t->num_columns > MAX_COLUMNS) {
+    fprintf(stderr, "zsf: %s: too many columns\n", path);
+    zsf_output_reader_free(r);
+    return 0;
+  }
+  for (int c = 0; c < t->num_columns; c++)
+    strcpy(t->names[c], zsf_output_reader_column_name(r, c));
+
+  long capacity = 0;
+  double *values = NULL;
+  for (int k = 0; !err && k < zsf_output_reader_num_chunks(r); k++) {
+    int num_rows;
+    double min, max;
+    zsf_output_reader_chunk_info(r, k, 0, &num_rows, &min, &max);
+
+    double *column = realloc(values, (num_rows > 0 ? num_rows : 1) * sizeof(double));
+    if (column == NULL || !table_reserve(t, &capacity, t->num_rows + num_rows)) {
+      free(column);
+      values = NULL;
+      err = ZSF_ERR_OUT_OF_MEMORY;
+      break;
+    }
+    values = column;
+
+    for (int c = 0; !err && c < t->num_columns; c++) {
+      err = zsf_output_reader_read(r, k, c, values);
+      for (int i = 0; i < num_rows; i++)
+        t->values[(t->num_rows + i) * t->num_columns + c] = values[i];
+    }
+    t->num_rows += num_rows;
+  }
+
+  if (err)
+    fprintf(stderr, "zsf: %s: %s\n", path, zsf_error_msg(err));
+  free(values);
+  zsf_output_reader_free(r);
+  return !err;
+}
+
+static int read_table(const char *path, table_t *t) {
+  memset(t, 0, sizeof(table_t));
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "zsf: %s: could not open file\n", path);
+    return 0;
+  }
+
+  char magic[7];
+  int columnar = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                 memcmp(magic, "ZSFCOLS", sizeof(magic)) == 0;
+  if (columnar) {
+    fclose(f);
+    return read_columnar(path, t);
+  }
+
+  rewind(f);
+  int ok = read_csv(path, f, t);
+  fclose(f);
+  return ok;
+}
+
+static void table_free(table_t *t) {
+  free(t->values);
+  t->values = NULL;
+}
+
+// Outputs
+// ~~~~~~~
+typedef struct writer_t {
+  const char *path;
+  int num_columns;
+  FILE *csv;
+  zsf_output_t *output;
+} writer_t;
+
+static int is_csv(const char *path) {
+  size_t n = strlen(path);
+  return strcmp(path, "-") == 0 || (n >= 4 && strcmp(path + n - 4, ".csv") == 0);
+}
+
+static int writer_open(writer_t *w, const char *path, int num_columns,
+                       const char *const *names) {
+  memset(w, 0, sizeof(writer_t));
+  w->path = path;
+  w->num_columns = num_columns;
+
+  if (!is_csv(path)) {
+    int err = zsf_output_open_columns(path, num_columns, names, 1, RING_CAPACITY, CHUNK_ROWS,
+                                      &w->output);
+    if (err)
+      fprintf(stderr, "zsf: %s: %s\n", path, zsf_error_msg(err));
+    return !err;
+  }
+
+  w->csv = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+  if (w->csv == NULL) {
+    fprintf(stderr, "zsf: %s: could not open file\n", path);
+    return 0;
+  }
+  for (int c = 0; c < num_columns; c++)
+    fprintf(w->csv, c > 0 ? ",%s" : "%s", names[c]);
+  fputc('\n', w->csv);
+  return 1;
+}
+
+static int writer_write(writer_t *w, long num_rows, const double *rows) {
+  if (w->output != NULL) {
+    // Rows are pushed in pieces, so that the ring buffer never has to hold
+    // more than fits in an int
+    for (long i = 0; i < num_rows; i += BLOCK_ROWS) {
+      int n = (int)((num_rows - i < BLOCK_ROWS) ? num_rows - i : BLOCK_ROWS);
+      int err = zsf_output_push_rows(w->output, 0, n, &rows[i * w->num_columns]);
+      if (err) {
+        fprintf(stderr, "zsf: %s: %s\n", w->path, zsf_error_msg(err));
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  for (long i = 0; i < num_rows; i++) {
+    const double *row = &rows[i * w->num_columns];
+    for (int c = 0; c < w->num_columns; c++)
+      fprintf(w->csv, c > 0 ? ",%.17g" : "%.17g", row[c]);
+    fputc('\n', w->csv);
+  }
+  if (ferror(w->csv)) {
+    fprintf(stderr, "zsf: %s: could not write file\n", w->path);
+    return 0;
+  }
+  return 1;
+}
+
+static int writer_close(writer_t *w) {
+  int ok = 1;
+  if (w->output != NULL) {
+    int err = zsf_output_close(w->output);
+    if (err) {
+      fprintf(stderr, "zsf: %s: %s\n", w->path, zsf_error_msg(err));
+      ok = 0;
+    }
+  } else if (w->csv != NULL) {
+    ok = fflush(w->csv) == 0 && !ferror(w->csv);
+    if (w->csv != stdout)
+      ok = (fclose(w->csv) == 0) && ok;
+    if (!ok)
+      fprintf(stderr, "zsf: %s: could not write file\n", w->path);
+  }
+  return ok;
+}
+
+// Threads
+// ~~~~~~~
+// Every thread claims the next item until there are none left, so that
+// items of different cost are balanced over the threads.
+typedef struct work_t {
+  void (*func)(void *context, long item);
+  void *context;
+  long num_items;
+  volatile long next;
+} work_t;
+
+typedef struct worker_t {
+  work_t *work;
+  thread_t thread;
+  thread_start_t start;
+} worker_t;
+
+static void run_worker(void *arg) {
+  work_t *work = ((worker_t *)arg)->work;
+  while (1) {
+    long item = atomic_load_acquire(&work->next);
+    if (item >= work->num_items)
+      break;
+    if (atomic_compare_exchange(&work->next, item, item + 1))
+      work->func(work->context, item);
+  }
+}
+
+static void parallel_for(int num_threads, long num_items, void (*func)(void *, long),
+                         void *context) {
+  work_t work = {func, context, num_items, 0};
+  worker_t workers[MAX_THREADS];
+  int started[MAX_THREADS];
+
+  if (num_threads > num_items)
+    num_threads = (num_items > 0) ? (int)num_items : 1;
+
+  // The calling thread is one of the workers
+  for (int i = 1; i < num_threads; i++) {
+    workers[i].work = &work;
+    started[i] = thread_create(&workers[i].thread, &workers[i].start, run_worker, &workers[i]) == 0;
+  }
+  workers[0].work = &work;
+  run_worker(&workers[0]);
+  for (int i = 1; i < num_threads; i++) {
+    if (started[i])
+      thread_join(workers[i].thread);
+  }
+}
+
+// Options
+// ~~~~~~~
+typedef struct options_t {
+  int num_threads;
+  int shard;
+  int num_shards;
+  zsf_param_t p;
+  const char *parameters;
+  double salinity_lock;
+  double head_lock;
+} options_t;
+
+static int parse_number(const char *s, double *value) {
+  char *end;
+  *value = strtod(s, &end);
+  return end != s && *end == '\0';
+}
+
+// Parses the options, and returns the index of the first other argument, or
+// -1 on error
+static int parse_options(int argc, char *argv[], int first, options_t *o) {
+  o->num_threads = num_processors();
+  o->shard = 0;
+  o->num_shards = 1;
+  zsf_param_default(&o->p);
+  o->parameters = NULL;
+  o->salinity_lock = NAN;
+  o->head_lock = NAN;
+
+  int i = first;
+  for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++) {
+    const char *option = argv[i];
+    const char *value = (i + 1 < argc) ? argv[++i] : NULL;
+    int ok = value != NULL;
+
+    if (ok && strcmp(option, "--threads") == 0) {
+      o->num_threads = atoi(value);
+      ok = o->num_threads >= 1 && o->num_threads <= MAX_THREADS;
+    } else if (ok && strcmp(option, "--shard") == 0) {
+      ok = sscanf(value, "%d/%d", &o->shard, &o->num_shards) == 2 && o->num_shards >= 1 &&
+           o->shard >= 0 && o->shard < o->num_shards;
+    } else if (ok && strcmp(option, "--set") == 0) {
+      char name[NAME_LENGTH];
+      const char *eq = strchr(value, '=');
+      ok = eq != NULL && eq - value < NAME_LENGTH;
+      if (ok) {
+        memcpy(name, value, eq - value);
+        name[eq - value] = '\0';
+        int field = param_field_index(name);
+        ok = field >= 0 && parse_number(eq + 1, param_field(&o->p, field));
+      }
+    } else if (ok && strcmp(option, "--parameters") == 0) {
+      o->parameters = value;
+    } else if (ok && strcmp(option, "--salinity-lock") == 0) {
+      ok = parse_number(value, &o->salinity_lock);
+    } else if (ok && strcmp(option, "--head-lock") == 0) {
+      ok = parse_number(value, &o->head_lock);
+    } else {
+      ok = 0;
+    }
+
+    if (!ok) {
+      fprintf(stderr, "zsf: invalid option %s %s\n", option, value ? value : "");
+      return -1;
+    }
+  }
+  return i;
+}
+
+// The part of n items that belongs to a shard
+static void shard_range(int shard, int num_shards, long n, long *begin, long *end) {
+  *begin = (long)((long long)n * shard / num_shards);
+  *end = (long)((long long)n * (shard + 1) / num_shards);
+}
+
+// The outputs of shards end with the shard, the number of shards and the
+// total number of rows or locks, so that merge can check that all shards
+// are there. Merging leaves these columns out again.
+#define NUM_SHARD_COLUMNS 3
+
+static const char *const shard_column_names[NUM_SHARD_COLUMNS] = {"shard", "num_shards", "total"};
+
+static int num_shard_columns(const options_t *o) {
+  return o->num_shards > 1 ? NUM_SHARD_COLUMNS : 0;
+}
+
+static void set_shard_columns(const options_t *o, long total, double *row) {
+  row[0] = o->shard;
+  row[1] = o->num_shards;
+  row[2] = (double)total;
+}
+
+// The parameter field of every column of a table
+static int param_columns(const char *path, const table_t *t, int *fields) {
+  for (int c = 0; c < t->num_columns; c++) {
+    fields[c] = param_field_index(t->names[c]);
+    if (fields[c] < 0) {
+      fprintf(stderr, "zsf: %s: unknown parameter %s\n", path, t->names[c]);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void set_params(const table_t *t, const int *fields, long row, zsf_param_t *p) {
+  for (int c = 0; c < t->num_columns; c++)
+    *param_field(p, fields[c]) = t->values[row * t->num_columns + c];
+}
+
+// Steady state
+// ~~~~~~~~~~~~
+typedef struct steady_block_t {
+  const zsf_param_t *p;
+  long num_rows;
+  int num_columns;
+  int errors[BLOCK_ROWS];
+  double *outputs;
+} steady_block_t;
+
+// Rows are calculated in batches that are large enough to amortise the
+// claiming, and small enough to balance the threads
+#define STEADY_BATCH 64
+
+static void steady_batch(void *context, long item) {
+  steady_block_t *b = context;
+  long begin = item * STEADY_BATCH;
+  int n = (int)((b->num_rows - begin < STEADY_BATCH) ? b->num_rows - begin : STEADY_BATCH);
+  double *outputs = &b->outputs[begin * b->num_columns + 2];
+  zsf_calc_steady_batch(n, &b->p[begin], ZSF_OUTPUT_ALL, outputs, b->num_columns, 1,
+                        &b->errors[begin]);
+}
+
+static int run_steady(const options_t *o, const char *input, const char *output) {
+  table_t t;
+  if (!read_table(input, &t))
+    return 1;
+
+  int fields[MAX_COLUMNS];
+  int num_columns = NUM_STEADY_COLUMNS + num_shard_columns(o);
+  steady_block_t *b = malloc(sizeof(steady_block_t));
+  zsf_param_t *p = malloc(BLOCK_ROWS * sizeof(zsf_param_t));
+  double *outputs = malloc((size_t)BLOCK_ROWS * num_columns * sizeof(double));
+  if (b == NULL || p == NULL || outputs == NULL) {
+    fprintf(stderr, "zsf: out of memory\n");
+    free(b);
+    free(p);
+    free(outputs);
+    table_free(&t);
+    return 1;
+  }
+
+  const char *names[NUM_STEADY_COLUMNS + NUM_SHARD_COLUMNS] = {"row", "error"};
+  memcpy(&names[2], results_field_names, sizeof(results_field_names));
+  memcpy(&names[NUM_STEADY_COLUMNS], shard_column_names, sizeof(shard_column_names));
+
+  writer_t w;
+  int ok = param_columns(input, &t, fields) && writer_open(&w, output, num_columns, names);
+  int opened = ok;
+
+  long begin, end;
+  shard_range(o->shard, o->num_shards, t.num_rows, &begin, &end);
+
+  for (long row = begin; ok && row < end; row += BLOCK_ROWS) {
+    long n = (end - row < BLOCK_ROWS) ? end - row : BLOCK_ROWS;
+    for (long i = 0; i < n; i++) {
+      p[i] = o->p;
+      set_params(&t, fields, row + i, &p[i]);
+    }
+
+    b->p = p;
+    b->num_rows = n;
+    b->num_columns = num_columns;
+    b->outputs = outputs;
+    parallel_for(o->num_threads, (n + STEADY_BATCH - 1) / STEADY_BATCH, steady_batch, b);
+
+    for (long i = 0; i < n; i++) {
+      double *output_row = &outputs[i * num_columns];
+      output_row[0] = (double)(row + i);
+      output_row[1] = b->errors[i];
+      if (num_columns > NUM_STEADY_COLUMNS)
+        set_shard_columns(o, t.num_rows, &output_row[NUM_STEADY_COLUMNS]);
+    }
+    ok = writer_write(&w, n, outputs);
+  }
+
+  if (opened)
+    ok = writer_close(&w) && ok;
+
+  free(b);
+  free(p);
+  free(outputs);
+  table_free(&t);
+  return ok ? 0 : 1;
+}
+
+// Lockages
+// ~~~~~~~~
+typedef struct lock_t {
+  int id;
+  long begin; // range of its lockages
+  long end;
+  zsf_param_t p;
+  zsf_phase_state_t state;
+  int err;
+} lock_t;
+
+typedef struct unsteady_block_t {
+  const zsf_lockage_t *lockages;
+  lock_t *locks;
+  zsf_phase_transports_t *transports; // of the lockages of the block
+  long offset;                        // of the first lockage of the block
+} unsteady_block_t;
+
+static void step_lock(void *context, long item) {
+  unsteady_block_t *b = context;
+  lock_t *l = &b->locks[item];
+  zsf_phase_transports_t *tp = &b->transports[l->begin - b->offset];
+  int n = (int)(l->end - l->begin);
+
+  l->err = zsf_step_lockages(&l->p, n, &b->lockages[l->begin], &l->state, tp);
+  if (l->err) {
+    for (int i = 0; i < n; i++) {
+      double *fields = (double *)&tp[i];
+      for (int k = 0; k < ZSF_NUM_TRANSPORTS_FIELDS; k++)
+        fields[k] = ZSF_NAN;
+    }
+  }
+}
+
+typedef struct sort_key_t {
+  double lock;
+  long index;
+} sort_key_t;
+
+static int compare_lock(const void *a, const void *b) {
+  const sort_key_t *ka = a;
+  const sort_key_t *kb = b;
+  if (ka->lock != kb->lock)
+    return ka->lock < kb->lock ? -1 : 1;
+  return (ka->index > kb->index) - (ka->index < kb->index);
+}
+
+#define LOCKAGE_COLUMNS(X)                                                                         \
+  X(time)                                                                                          \
+  X(routine)                                                                                       \
+  X(duration)                                                                                      \
+  X(ship_volume_lake_to_sea)                                                                       \
+  X(ship_volume_sea_to_lake)                                                                       \
+  X(num_ships)
+
+// Read the lockages, grouped by lock in a stable order
+static int read_lockages(const char *path, zsf_lockage_t **lockages, double **lock_ids,
+                         long *num_lockages) {
+  table_t t;
+  if (!read_table(path, &t))
+    return 0;
+
+#define LOCKAGE_COLUMN(NAME) int NAME = table_column(&t, #NAME);
+  LOCKAGE_COLUMNS(LOCKAGE_COLUMN)
+#undef LOCKAGE_COLUMN
+  int lock = table_column(&t, "lock");
+
+  int ok = time >= 0 && routine >= 0 && duration >= 0;
+  if (!ok)
+    fprintf(stderr, "zsf: %s: missing time, routine or duration\n", path);
+
+  for (int c = 0; ok && c < t.num_columns; c++) {
+    if (c != time && c != routine && c != duration && c != ship_volume_lake_to_sea &&
+        c != ship_volume_sea_to_lake && c != num_ships && c != lock) {
+      fprintf(stderr, "zsf: %s: unknown column %s\n", path, t.names[c]);
+      ok = 0;
+    }
+  }
+
+  long n = t.num_rows;
+  sort_key_t *keys = malloc((n > 0 ? n : 1) * sizeof(sort_key_t));
+  *lockages = malloc((n > 0 ? n : 1) * sizeof(zsf_lockage_t));
+  *lock_ids = malloc((n > 0 ? n : 1) * sizeof(double));
+  if (ok && (keys == NULL || *lockages == NULL || *lock_ids == NULL)) {
+    fprintf(stderr, "zsf: out of memory\n");
+    ok = 0;
+  }
+
+  for (long i = 0; ok && i < n; i++) {
+    keys[i].lock = (lock >= 0) ? t.values[i * t.num_columns + lock] : 0.0;
+    keys[i].index = i;
+    if (!(keys[i].lock >= 0.0 && keys[i].lock < 1e9 && keys[i].lock == floor(keys[i].lock))) {
+      fprintf(stderr, "zsf: %s: invalid lock %g\n", path, keys[i].lock);
+      ok = 0;
+    }
+  }
+
+  if (ok) {
+    qsort(keys, n, sizeof(sort_key_t), compare_lock);
+    for (long i = 0; i < n; i++) {
+      const double *row = &t.values[keys[i].index * t.num_columns];
+      zsf_lockage_t *l = &(*lockages)[i];
+#define LOCKAGE_FIELD(NAME) l->NAME = (NAME >= 0) ? row[NAME] : 0.0;
+      LOCKAGE_COLUMNS(LOCKAGE_FIELD)
+#undef LOCKAGE_FIELD
+      (*lock_ids)[i] = keys[i].lock;
+    }
+    *num_lockages = n;
+  }
+
+  free(keys);
+  table_free(&t);
+  return ok;
+}
+
+static int run_unsteady(const options_t *o, const char *input, const char *output) {
+  zsf_lockage_t *lockages = NULL;
+  double *lock_ids = NULL;
+  long num_lockages = 0;
+  table_t params = {0};
+  int fields[MAX_COLUMNS];
+
+  int ok = read_lockages(input, &lockages, &lock_ids, &num_lockages);
+  if (ok && o->parameters != NULL)
+    ok = read_table(o->parameters, &params) && param_columns(o->parameters, &params, fields);
+
+  // The lockages of every lock
+  long num_locks = 0;
+  lock_t *locks = malloc((num_lockages > 0 ? num_lockages : 1) * sizeof(lock_t));
+  if (ok && locks == NULL) {
+    fprintf(stderr, "zsf: out of memory\n");
+    ok = 0;
+  }
+  for (long i = 0; ok && i < num_lockages; i++) {
+    if (i == 0 || lock_ids[i] != lock_ids[i - 1]) {
+      lock_t *l = &locks[num_locks++];
+      l->id = (int)lock_ids[i];
+      l->begin = i;
+    }
+    locks[num_locks - 1].end = i + 1;
+  }
+
+  long begin, end;
+  shard_range(o->shard, o->num_shards, num_locks, &begin, &end);
+
+  for (long k = begin; ok && k < end; k++) {
+    lock_t *l = &locks[k];
+    l->p = o->p;
+    if (o->parameters != NULL) {
+      if (l->id >= params.num_rows) {
+        fprintf(stderr, "zsf: %s: no parameters for lock %d\n", o->parameters, l->id);
+        ok = 0;
+        break;
+      }
+      set_params(&params, fields, l->id, &l->p);
+    }
+
+    double salinity_lock = isnan(o->salinity_lock) ? l->p.salinity_lake : o->salinity_lock;
+    double head_lock = isnan(o->head_lock) ? l->p.head_lake : o->head_lock;
+    l->err = zsf_initialize_state(&l->p, &l->state, salinity_lock, head_lock);
+    if (l->err) {
+      fprintf(stderr, "zsf: lock %d: %s\n", l->id, zsf_error_msg(l->err));
+      ok = 0;
+    }
+    if (l->end - l->begin > 0x7fffffff) {
+      fprintf(stderr, "zsf: lock %d: too many lockages\n", l->id);
+      ok = 0;
+    }
+  }
+
+  int num_columns = NUM_UNSTEADY_COLUMNS + num_shard_columns(o);
+  const char *names[NUM_UNSTEADY_COLUMNS + NUM_SHARD_COLUMNS] = {"time", "lock", "routine"};
+  memcpy(&names[3], transports_field_names, sizeof(transports_field_names));
+  memcpy(&names[NUM_UNSTEADY_COLUMNS], shard_column_names, sizeof(shard_column_names));
+
+  writer_t w;
+  int opened = ok && writer_open(&w, output, num_columns, names);
+  ok = ok && opened;
+
+  zsf_phase_transports_t *transports = NULL;
+  double *rows = NULL;
+  long capacity = 0;
+  int failed = 0;
+
+  // Whole locks are stepped at once, in blocks of about BLOCK_LOCKAGES
+  for (long k = begin; ok && k < end;) {
+    long k_end = k + 1;
+    while (k_end < end && locks[k_end].end - locks[k].begin <= BLOCK_LOCKAGES)
+      k_end++;
+    long offset = locks[k].begin;
+    long n = locks[k_end - 1].end - offset;
+
+    if (n > capacity) {
+      free(transports);
+      free(rows);
+      transports = malloc(n * sizeof(zsf_phase_transports_t));
+      rows = malloc((size_t)n * num_columns * sizeof(double));
+      capacity = n;
+      if (transports == NULL || rows == NULL) {
+        fprintf(stderr, "zsf: out of memory\n");
+        ok = 0;
+        break;
+      }
+    }
+
+    unsteady_block_t b = {lockages, &locks[k], transports, offset};
+    parallel_for(o->num_threads, k_end - k, step_lock, &b);
+
+    for (long j = k; j < k_end; j++) {
+      if (locks[j].err) {
+        fprintf(stderr, "zsf: lock %d: %s\n", locks[j].id, zsf_error_msg(locks[j].err));
+        failed = 1;
+      }
+    }
+
+    for (long i = 0; i < n; i++) {
+      double *row = &rows[i * num_columns];
+      row[0] = lockages[offset + i].time;
+      row[1] = lock_ids[offset + i];
+      row[2] = lockages[offset + i].routine;
+      memcpy(&row[3], &transports[i], sizeof(zsf_phase_transports_t));
+      if (num_columns > NUM_UNSTEADY_COLUMNS)
+        set_shard_columns(o, num_locks, &row[NUM_UNSTEADY_COLUMNS]);
+    }
+    ok = writer_write(&w, n, rows);
+    k = k_end;
+  }
+
+  if (opened)
+    ok = writer_close(&w) && ok;
+
+  free(transports);
+  free(rows);
+  free(locks);
+  free(lockages);
+  free(lock_ids);
+  table_free(&params);
+  return (ok && !failed) ? 0 : 1;
+}
+
+// Merging shards
+// ~~~~~~~~~~~~~~
+// Every shard holds a contiguous range of rows or locks, so the outputs are
+// merged by concatenating them in the order of the shards. All shards with
+// any rows or locks have to be there, each with exactly its own range.
+typedef struct shard_t {
+  const char *path;
+  int present;
+  long num_keys;
+  double first;
+  double last;
+} shard_t;
+
+static int key_column(const char *path, const table_t *t) {
+  int key = table_column(t, "row");
+  if (key < 0)
+    key = table_column(t, "lock");
+  if (key < 0)
+    fprintf(stderr, "zsf: %s: no row or lock column\n", path);
+  return key;
+}
+
+static int same_columns(const table_t *a, const table_t *b) {
+  if (a->num_columns != b->num_columns)
+    return 0;
+  for (int c = 0; c < a->num_columns; c++) {
+    if (strcmp(a->names[c], b->names[c]) != 0)
+      return 0;
+  }
+  return 1;
+}
+
+// The shard columns of an output, which have to be its last columns
+static int shard_columns(const char *path, const table_t *t) {
+  int c = t->num_columns - NUM_SHARD_COLUMNS;
+  for (int k = 0; k < NUM_SHARD_COLUMNS; k++) {
+    if (c < 0 || strcmp(t->names[c + k], shard_column_names[k]) != 0) {
+      fprintf(stderr, "zsf: %s: not the output of a shard\n", path);
+      return -1;
+    }
+  }
+  return c;
+}
+
+// Checks the shard columns of all rows, and gets the shard, the number of
+// shards and the total number of rows or locks. Outputs without any rows
+// are not identified by a shard, and only pass if num_shards is still 0.
+static int read_shard(const char *path, const table_t *t, int c, int *shard, int *num_shards,
+                      long *total) {
+  for (long r = 0; r < t->num_rows; r++) {
+    const double *v = &t->values[r * t->num_columns + c];
+    int valid = v[1] >= 2 && v[1] <= 1e6 && v[1] == floor(v[1]) && v[0] >= 0 && v[0] < v[1] &&
+                v[0] == floor(v[0]) && v[2] >= 0 && v[2] < 1e15 && v[2] == floor(v[2]);
+    if (valid && *num_shards == 0) {
+      *num_shards = (int)v[1];
+      *total = (long)v[2];
+    }
+    if (!valid || v[1] != *num_shards || v[2] != *total || (r > 0 && v[0] != *shard)) {
+      fprintf(stderr, "zsf: %s: invalid or inconsistent shard\n", path);
+      return 0;
+    }
+    *shard = (int)v[0];
+  }
+  return 1;
+}
+
+static int run_merge(const char *output, int num_inputs, char *inputs[]) {
+  shard_t *shards = NULL;
+  table_t first = {0};
+  int num_shards = 0;
+  long total = 0;
+  int ok = 1;
+
+  for (int i = 0; ok && i < num_inputs; i++) {
+    table_t t;
+    ok = read_table(inputs[i], &t);
+    int key = ok ? key_column(inputs[i], &t) : -1;
+    int c = ok ? shard_columns(inputs[i], &t) : -1;
+    ok = ok && key >= 0 && c >= 0;
+
+    if (ok && i == 0) {
+      first = t;
+      first.values = NULL;
+    } else if (ok && !same_columns(&first, &t)) {
+      fprintf(stderr, "zsf: %s: columns differ from %s\n", inputs[i], inputs[0]);
+      ok = 0;
+    }
+
+    int shard = -1;
+    ok = ok && read_shard(inputs[i], &t, c, &shard, &num_shards, &total);
+    if (ok && shards == NULL && num_shards > 0) {
+      shards = calloc(num_shards, sizeof(shard_t));
+      if (shards == NULL) {
+        fprintf(stderr, "zsf: out of memory\n");
+        ok = 0;
+      }
+    }
+
+    // The keys of the rows, which are sorted and unique for steady outputs
+    long num_keys = (t.num_rows > 0) ? 1 : 0;
+    for (long r = 1; ok && r < t.num_rows; r++) {
+      double k0 = t.values[(r - 1) * t.num_columns + key];
+      double k1 = t.values[r * t.num_columns + key];
+      if (k1 < k0 || (k1 == k0 && strcmp(t.names[key], "row") == 0)) {
+        fprintf(stderr, "zsf: %s: %s is not sorted\n", inputs[i], t.names[key]);
+        ok = 0;
+      }
+      num_keys += k1 != k0;
+    }
+
+    if (ok && t.num_rows > 0) {
+      shard_t *s = &shards[shard];
+      if (s->present) {
+        fprintf(stderr, "zsf: %s and %s are both shard %d\n", s->path, inputs[i], shard);
+        ok = 0;
+      }
+      s->path = inputs[i];
+      s->present = 1;
+      s->num_keys = num_keys;
+      s->first = t.values[key];
+      s->last = t.values[(t.num_rows - 1) * t.num_columns + key];
+    }
+    table_free(&t);
+  }
+
+  // Every shard has to cover exactly its own range of rows or locks
+  int is_steady = table_column(&first, "row") >= 0;
+  for (int i = 0; ok && i < num_shards; i++) {
+    const shard_t *s = &shards[i];
+    long begin, end;
+    shard_range(i, num_shards, total, &begin, &end);
+
+    if (!s->present && end > begin) {
+      fprintf(stderr, "zsf: shard %d/%d is missing\n", i, num_shards);
+      ok = 0;
+    } else if (s->present && (s->num_keys != end - begin || (is_steady && s->first != begin))) {
+      fprintf(stderr, "zsf: %s: does not cover shard %d/%d\n", s->path, i, num_shards);
+      ok = 0;
+    }
+  }
+  for (int i = 1, prev = -1; ok && i < num_shards; i++) {
+    prev = shards[i - 1].present ? i - 1 : prev;
+    if (prev >= 0 && shards[i].present && shards[i].first <= shards[prev].last) {
+      fprintf(stderr, "zsf: %s and %s overlap\n", shards[prev].path, shards[i].path);
+      ok = 0;
+    }
+  }
+
+  int num_columns = first.num_columns - NUM_SHARD_COLUMNS;
+  const char *names[MAX_COLUMNS];
+  for (int c = 0; c < num_columns; c++)
+    names[c] = first.names[c];
+
+  writer_t w;
+  int opened = ok && writer_open(&w, output, num_columns, names);
+  ok = ok && opened;
+
+  // Without the shard columns, the rows are written in place
+  for (int i = 0; ok && i < num_shards; i++) {
+    if (!shards[i].present)
+      continue;
+
+    table_t t;
+    ok = read_table(shards[i].path, &t);
+    for (long r = 0; ok && r < t.num_rows; r++)
+      memmove(&t.values[r * num_columns], &t.values[r * t.num_columns],
+              num_columns * sizeof(double));
+    ok = ok && writer_write(&w, t.num_rows, t.values);
+    table_free(&t);
+  }
+
+  if (opened)
+    ok = writer_close(&w) && ok;
+
+  free(shards);
+  return ok ? 0 : 1;
+}
+
+static int usage(void) {
+  fprintf(stderr, "usage: zsf steady [options] <parameters> <output>\n"
+                  "       zsf unsteady [options] <lockages> <output>\n"
+                  "       zsf merge <output> <input>...\n"
+                  "\n"
+                  "options:\n"
+                  "  --threads n          number of threads\n"
+                  "  --shard i/n          only calculate part i of n, counting from 0\n"
+                  "  --set name=value     value of a parameter that is not in the table\n"
+                  "  --parameters path    table of parameters, one row per lock (unsteady)\n"
+                  "  --salinity-lock s    initial salinity of the locks (unsteady)\n"
+                  "  --head-lock h        initial head of the locks (unsteady)\n");
+  return 2;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2)
+    return usage();
+
+  if (strcmp(argv[1], "merge") == 0) {
+    if (argc < 4)
+      return usage();
+    return run_merge(argv[2], argc - 3, &argv[3]);
+  }
+
+  options_t o;
+  int i = parse_options(argc, argv, 2, &o);
+  if (i < 0 || argc - i != 2)
+    return usage();
+
+  if (strcmp(argv[1], "steady") == 0)
+    return run_steady(&o, argv[i], argv[i + 1]);
+  if (strcmp(argv[1], "unsteady") == 0)
+    return run_unsteady(&o, argv[i], argv[i + 1]);
+  return usage();
+}
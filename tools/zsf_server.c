@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * zsf_server: shared-memory calculation service
+ *****************************************************************************/
+
+// Serves steady state calculations to all processes on this machine that
+// connect with zsf_client_connect, until interrupted (Ctrl+C). Prints how
+// many requests were coalesced, deduplicated and served from the cache on
+// exit.
+//
+// Usage: zsf_server [name] [num_threads] [num_slots] [slot_capacity] [cache_size]
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "zsf.h"
+
+static zsf_service_t *service = NULL;
+
+static void on_signal(int sig) {
+  (void)sig;
+  zsf_service_stop(service);
+}
+
+static int num_processors(void) {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int)info.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  const char *name = argc > 1 ? argv[1] : "zsf";
+  int num_threads = argc > 2 ? atoi(argv[2]) : num_processors();
+  int num_slots = argc > 3 ? atoi(argv[3]) : 64;
+  int slot_capacity = argc > 4 ? atoi(argv[4]) : 1024;
+  int cache_size = argc > 5 ? atoi(argv[5]) : 1 << 16;
+
+  int err = zsf_service_create(name, num_slots, slot_capacity, num_threads, cache_size, &service);
+  if (err) {
+    fprintf(stderr, "Could not create service '%s': %s\n", name, zsf_error_msg(err));
+    return 1;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  printf("Serving '%s' with %d threads, %d slots of %d parameters\n", name, num_threads, num_slots,
+         slot_capacity);
+  fflush(stdout);
+
+  zsf_service_run(service);
+
+  zsf_service_stats_t stats;
+  zsf_service_stats(service, &stats);
+  printf("%.0f requests in %.0f batches: %.0f calculated, %.0f duplicates, %.0f from cache\n",
+         stats.num_requests, stats.num_batches, stats.num_calculated, stats.num_duplicates,
+         stats.num_cached);
+
+  zsf_service_free(service);
+  return 0;
+}
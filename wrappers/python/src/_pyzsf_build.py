@@ -1,4 +1,5 @@
 import os
+import sys
 
 from cffi import FFI
 
@@ -97,6 +98,15 @@ ffibuilder.cdef(
         zsf_phase_transports_t transports_phase_4;
     } zsf_aux_results_t;
 
+    typedef struct zsf_locking_cycle_t {
+        double time;
+        double t_level;
+        double t_open_lake;
+        double t_open_sea;
+        double ship_volume_sea_to_lake;
+        double ship_volume_lake_to_sea;
+    } zsf_locking_cycle_t;
+
     int zsf_initialize_state(const zsf_param_t *p, zsf_phase_state_t *state,
                               double salinity_lock, double head_lock);
 
@@ -121,11 +131,342 @@ ffibuilder.cdef(
                                     zsf_phase_state_t *state,
                                     zsf_phase_transports_t *results);
 
+    int zsf_resolve_phase(const zsf_param_t *p, int routine, double duration,
+                          const zsf_phase_state_t *state, int num_times,
+                          const double *times, zsf_phase_transports_t *samples);
+
     void zsf_param_default(zsf_param_t *p);
 
     int zsf_calc_steady(const zsf_param_t *p, zsf_results_t *results,
                          zsf_aux_results_t *aux_results);
 
+    int zsf_calc_periodic(const zsf_param_t *p, double t_period,
+                          int num_samples, const double *head_sea,
+                          const double *salinity_sea, int num_lockings,
+                          const zsf_locking_cycle_t *cycles,
+                          zsf_results_t *results,
+                          zsf_phase_transports_t *cycle_transports,
+                          zsf_phase_state_t *state);
+
+    static const double ZSF_NAN;
+
+    typedef struct zsf_compartment_t {
+        double volume;
+        double salinity;
+    } zsf_compartment_t;
+
+    typedef struct zsf_box_forcing_t {
+        double inflow_lake;
+        double salinity_inflow_lake;
+        double outflow_lake;
+        double inflow_sea;
+        double salinity_inflow_sea;
+        double outflow_sea;
+    } zsf_box_forcing_t;
+
+    typedef struct zsf_box_output_t {
+        double volume_lake;
+        double salinity_lake;
+        double volume_sea;
+        double salinity_sea;
+        double salt_load_lake;
+        double salt_load_sea;
+    } zsf_box_output_t;
+
+    int zsf_run_box_model(int num_locks, const zsf_param_t *p, int num_samples,
+                          double dt_forcing, const zsf_box_forcing_t *forcing, double tolerance,
+                          double max_time_step, zsf_compartment_t *lake, zsf_compartment_t *sea,
+                          int num_outputs, const double *t_output, zsf_box_output_t *outputs);
+
+    #define ZSF_SURROGATE_MAX_AXES 8
+    #define ZSF_INTERP_LINEAR 1
+    #define ZSF_INTERP_CUBIC 3
+
+    #define ZSF_OUTPUT_ALL 0x3FF
+
+    int zsf_calc_steady_batch(int num_locks, const zsf_param_t *p, int output_mask,
+                              double *outputs, int row_stride, int column_stride, int *errors);
+
+    int zsf_calc_steady_sweep(const zsf_param_t *p, int num_axes, const char *const *axis_names,
+                              const int *num_points, const double *axis_values, int output_mask,
+                              double *outputs, int row_stride, int column_stride, int *errors);
+
+    int zsf_calc_steady_bounds(const zsf_param_t *p_lo, const zsf_param_t *p_hi, int max_boxes,
+                               zsf_results_t *results_lo, zsf_results_t *results_hi);
+
+    typedef struct zsf_surrogate_t zsf_surrogate_t;
+
+    int zsf_surrogate_build(const zsf_param_t *p, int num_axes,
+                            const char *const *axis_names,
+                            const int *num_points, const double *axis_values,
+                            zsf_surrogate_t **surrogate);
+
+    int zsf_surrogate_eval(const zsf_surrogate_t *surrogate, const double *x,
+                           int method, zsf_results_t *results);
+
+    int zsf_surrogate_validate(const zsf_surrogate_t *surrogate,
+                               int num_samples, int seed, int method,
+                               zsf_results_t *max_abs_error,
+                               zsf_results_t *max_rel_error);
+
+    int zsf_surrogate_num_axes(const zsf_surrogate_t *surrogate);
+
+    const char * zsf_surrogate_axis_name(const zsf_surrogate_t *surrogate, int axis);
+
+    int zsf_surrogate_save(const zsf_surrogate_t *surrogate, const char *path);
+
+    int zsf_surrogate_load(const char *path, zsf_surrogate_t **surrogate);
+
+    void zsf_surrogate_free(zsf_surrogate_t *surrogate);
+
+    typedef struct zsf_lockage_t {
+        double time;
+        double routine;
+        double duration;
+        double ship_volume_lake_to_sea;
+        double ship_volume_sea_to_lake;
+        double num_ships;
+    } zsf_lockage_t;
+
+    typedef struct zsf_traffic_t {
+        double ships_per_day_lake;
+        double ships_per_day_sea;
+        double annual_growth;
+    } zsf_traffic_t;
+
+    typedef struct zsf_fleet_class_t {
+        double share;
+        double volume_mean;
+        double volume_std;
+        double volume_max;
+    } zsf_fleet_class_t;
+
+    typedef struct zsf_lock_policy_t {
+        double leveling_time;
+        double door_time;
+        double time_per_ship;
+        double max_wait;
+        double max_ships;
+        double max_ship_volume;
+        double flushing_when_idle;
+        double max_flushing_time;
+    } zsf_lock_policy_t;
+
+    typedef struct zsf_traffic_stats_t {
+        double num_ships;
+        double num_lockings;
+        double mean_wait;
+        double max_wait;
+    } zsf_traffic_stats_t;
+
+    typedef struct zsf_lockage_generator_t zsf_lockage_generator_t;
+
+    int zsf_lockage_generator_create(const zsf_traffic_t *traffic, int num_classes,
+                                     const zsf_fleet_class_t *fleet,
+                                     const zsf_lock_policy_t *policy, int seed,
+                                     zsf_lockage_generator_t **generator);
+
+    int zsf_lockage_generator_next(zsf_lockage_generator_t *generator, double t_end,
+                                   int max_lockages, zsf_lockage_t *lockages,
+                                   int *num_lockages);
+
+    int zsf_lockage_generator_stats(const zsf_lockage_generator_t *generator,
+                                    zsf_traffic_stats_t *stats);
+
+    void zsf_lockage_generator_free(zsf_lockage_generator_t *generator);
+
+    int zsf_step_lockages(const zsf_param_t *p, int num_lockages,
+                          const zsf_lockage_t *lockages, zsf_phase_state_t *state,
+                          zsf_phase_transports_t *transports);
+
+    int zsf_step_lockages_parallel(const zsf_param_t *p, int num_lockages,
+                                   const zsf_lockage_t *lockages, zsf_phase_state_t *state,
+                                   zsf_phase_transports_t *transports, int num_threads);
+
+    int zsf_run_lockages(const zsf_param_t *p, zsf_lockage_generator_t *generator,
+                         double t_end, zsf_phase_state_t *state, zsf_results_t *results);
+
+    int zsf_replay_variants(int num_variants, const zsf_param_t *variants, int num_lockages,
+                            const zsf_lockage_t *lockages, zsf_phase_state_t *states,
+                            zsf_results_t *results);
+
+    typedef struct zsf_network_t zsf_network_t;
+
+    int zsf_network_create(int num_locks, const zsf_param_t *p, const zsf_phase_state_t *states,
+                           zsf_lockage_generator_t *const *generators, double dt_output,
+                           zsf_network_t **network);
+
+    int zsf_network_set_param(zsf_network_t *network, int lock, const zsf_param_t *p);
+
+    int zsf_network_advance(zsf_network_t *network, zsf_phase_transports_t *transports);
+
+    int zsf_network_state(const zsf_network_t *network, int lock, zsf_phase_state_t *state);
+
+    void zsf_network_free(zsf_network_t *network);
+
+    typedef struct zsf_tidal_constituent_t {
+        double amplitude;
+        double phase;
+        double speed;
+    } zsf_tidal_constituent_t;
+
+    typedef struct zsf_seasonal_t {
+        double mean;
+        double amplitude;
+        double t_max;
+        double amplitude_semiannual;
+        double t_max_semiannual;
+    } zsf_seasonal_t;
+
+    typedef struct zsf_forcing_t zsf_forcing_t;
+
+    int zsf_forcing_create(double mean_sea_level, int num_constituents,
+                           const zsf_tidal_constituent_t *constituents, int num_curves,
+                           const char *const *parameters, const zsf_seasonal_t *curves,
+                           zsf_forcing_t **forcing);
+
+    int zsf_forcing_eval(const zsf_forcing_t *forcing, const zsf_param_t *p, double t0,
+                         double dt, int num_times, zsf_param_t *out);
+
+    int zsf_calc_steady_forced(const zsf_param_t *p, const zsf_forcing_t *forcing, double t0,
+                               double dt, int num_times, int output_mask, double *outputs,
+                               int row_stride, int column_stride, int *errors);
+
+    int zsf_step_lockages_forced(const zsf_param_t *p, const zsf_forcing_t *forcing,
+                                 int num_lockages, const zsf_lockage_t *lockages,
+                                 zsf_phase_state_t *state, zsf_phase_transports_t *transports);
+
+    void zsf_forcing_free(zsf_forcing_t *forcing);
+
+    typedef struct zsf_ship_arrival_t {
+        double time;
+        double side;
+        double volume;
+    } zsf_ship_arrival_t;
+
+    typedef struct zsf_schedule_limits_t {
+        double t_end;
+        double leveling_time;
+        double door_time;
+        double time_per_ship;
+        double max_wait;
+        double max_ships;
+        double max_ship_volume;
+        double door_open_min;
+        double door_open_max;
+        double flushing_max;
+        double flushing_volume;
+        double num_candidates;
+    } zsf_schedule_limits_t;
+
+    int zsf_schedule_optimize(const zsf_param_t *p, const zsf_phase_state_t *state,
+                              int num_ships, const zsf_ship_arrival_t *ships,
+                              const zsf_schedule_limits_t *limits, int max_lockages,
+                              zsf_lockage_t *lockages, zsf_phase_transports_t *transports,
+                              int *num_lockages, zsf_results_t *results);
+
+    size_t zsf_snapshot_size(int num_locks, int with_totals);
+
+    int zsf_snapshot_write(void *buffer, size_t size, int num_locks, const zsf_param_t *p,
+                           const zsf_phase_state_t *state, const zsf_phase_transports_t *totals);
+
+    int zsf_snapshot_read(const void *buffer, size_t size, int max_locks, int *num_locks,
+                          zsf_param_t *p, zsf_phase_state_t *state,
+                          zsf_phase_transports_t *totals);
+
+    int zsf_snapshot_save(const char *path, int num_locks, const zsf_param_t *p,
+                          const zsf_phase_state_t *state, const zsf_phase_transports_t *totals);
+
+    int zsf_snapshot_load(const char *path, int max_locks, int *num_locks, zsf_param_t *p,
+                          zsf_phase_state_t *state, zsf_phase_transports_t *totals);
+
+    typedef struct zsf_async_t zsf_async_t;
+
+    int zsf_async_create(const zsf_phase_state_t *state, int max_lockages, zsf_async_t **async);
+
+    int zsf_async_step(zsf_async_t *async, const zsf_param_t *p, double dt, int num_lockages,
+                       const zsf_lockage_t *lockages, zsf_phase_transports_t *transports,
+                       zsf_phase_state_t *state);
+
+    int zsf_async_finish(zsf_async_t *async, zsf_phase_transports_t *transports,
+                         zsf_phase_state_t *state);
+
+    void zsf_async_free(zsf_async_t *async);
+
+    typedef struct zsf_output_record_t {
+      double time;
+      double lock;
+      double routine;
+      zsf_phase_transports_t transports;
+    } zsf_output_record_t;
+
+    typedef struct zsf_output_t zsf_output_t;
+    typedef struct zsf_output_reader_t zsf_output_reader_t;
+
+    int zsf_output_open(const char *path, int num_producers, int ring_capacity, int chunk_rows,
+                        zsf_output_t **output);
+
+    int zsf_output_push(zsf_output_t *output, int producer, int num_records,
+                        const zsf_output_record_t *records);
+
+    int zsf_output_close(zsf_output_t *output);
+
+    int zsf_output_reader_open(const char *path, zsf_output_reader_t **reader);
+
+    int zsf_output_reader_num_columns(const zsf_output_reader_t *reader);
+
+    const char *zsf_output_reader_column_name(const zsf_output_reader_t *reader, int column);
+
+    int zsf_output_reader_num_chunks(const zsf_output_reader_t *reader);
+
+    int zsf_output_reader_chunk_info(const zsf_output_reader_t *reader, int chunk, int column,
+                                     int *num_rows, double *min, double *max);
+
+    int zsf_output_reader_read(zsf_output_reader_t *reader, int chunk, int column,
+                               double *values);
+
+    void zsf_output_reader_free(zsf_output_reader_t *reader);
+
+    typedef struct zsf_service_stats_t {
+      double num_requests;
+      double num_batches;
+      double num_calculated;
+      double num_duplicates;
+      double num_cached;
+    } zsf_service_stats_t;
+
+    typedef struct zsf_service_t zsf_service_t;
+    typedef struct zsf_client_t zsf_client_t;
+
+    int zsf_service_create(const char *name, int num_slots, int slot_capacity, int num_threads,
+                           int cache_size, zsf_service_t **service);
+
+    int zsf_service_run(zsf_service_t *service);
+
+    void zsf_service_stop(zsf_service_t *service);
+
+    void zsf_service_stats(const zsf_service_t *service, zsf_service_stats_t *stats);
+
+    void zsf_service_free(zsf_service_t *service);
+
+    int zsf_client_connect(const char *name, zsf_client_t **client);
+
+    int zsf_client_slot_capacity(const zsf_client_t *client);
+
+    int zsf_client_acquire(zsf_client_t *client, int *slot, zsf_param_t **p);
+
+    int zsf_client_submit(zsf_client_t *client, int slot, int num_params);
+
+    int zsf_client_wait(zsf_client_t *client, int slot, const zsf_results_t **results,
+                        const int **errors);
+
+    void zsf_client_release(zsf_client_t *client, int slot);
+
+    int zsf_client_calc_steady_batch(zsf_client_t *client, int num_params, const zsf_param_t *p,
+                                     zsf_results_t *results, int *errors);
+
+    void zsf_client_disconnect(zsf_client_t *client);
+
     const char * zsf_error_msg(int code);
 
     const char * zsf_version();
@@ -137,10 +478,15 @@ if os.name == "posix":
 else:
     extra_compile_args = ["/MD"]
 
+# Older C libraries have shm_open in librt
+libraries = ["zsf-static"]
+if sys.platform.startswith("linux"):
+    libraries.append("rt")
+
 ffibuilder.set_source(
     "pyzsf._zsf_cffi",
     '#include "zsf.h"',
-    libraries=["zsf-static"],
+    libraries=libraries,
     define_macros=[("ZSF_STATIC", None), ("Py_LIMITED_API", None)],
     py_limited_api=True,
     extra_compile_args=extra_compile_args,
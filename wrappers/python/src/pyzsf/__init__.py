@@ -1,4 +1,25 @@
-from .pyzsf import ZSFUnsteady, zsf_calc_steady  # noqa: F401
+from .pyzsf import (  # noqa: F401
+    ZSFAsync,
+    ZSFForcing,
+    ZSFLockageGenerator,
+    ZSFNetwork,
+    ZSFOutputFile,
+    ZSFOutputWriter,
+    ZSFService,
+    ZSFServiceClient,
+    ZSFSurrogate,
+    ZSFUnsteady,
+    zsf_calc_periodic,
+    zsf_calc_steady,
+    zsf_calc_steady_batch,
+    zsf_calc_steady_bounds,
+    zsf_calc_steady_sweep,
+    zsf_optimize_schedule,
+    zsf_replay_variants,
+    zsf_run_box_model,
+    zsf_snapshot_load,
+    zsf_snapshot_save,
+)
 from .pyzsf import _zsf_version
 
 __version__ = _zsf_version()
@@ -1,4 +1,6 @@
-from typing import Dict
+import threading
+from array import array
+from typing import Any, Dict, List, Optional, Sequence, Tuple, Union
 
 from ._zsf_cffi import ffi, lib
 
@@ -23,20 +25,7 @@ def _zsf_version():
     return ffi.string(lib.zsf_version()).decode("utf-8")
 
 
-def zsf_calc_steady(auxiliary_results: bool = False, **parameters: float) -> Dict[str, float]:
-    """
-    Calculate the salt intrusion for a set of parameters, assuming steady
-    operation.
-
-    :param auxiliary_results: Whether or not to calculate and output auxiliary
-        results. See :c:struct:`zsf_aux_results_t`.
-    :param kwargs: Any parameters that should be changed versus the default.
-        See also :c:struct:`zsf_param_t` for an overview of the parameters.
-
-    :returns: A dictionary containing the cycle averaged salt fluxes and
-        discharges (see :c:struct:`zsf_results_t`). Also outputs values in
-        :c:struct:`zsf_aux_results_t` if ``auxiliary_results`` is `True`.
-    """
+def _param_t_from_kwargs(parameters: Dict[str, float]):
     param_t = ffi.new("zsf_param_t *")
 
     # Check input parameters
@@ -52,6 +41,37 @@ def zsf_calc_steady(auxiliary_results: bool = False, **parameters: float) -> Dic
     for p, v in parameters.items():
         setattr(param_t, p, v)
 
+    return param_t
+
+
+def _new_struct(cdecl: str, values: Dict[str, float]):
+    struct = ffi.new(cdecl)
+
+    names = set(dir(struct))
+    for k, v in values.items():
+        if k not in names:
+            raise TypeError(f"No such field '{k}'")
+        setattr(struct, k, v)
+
+    return struct
+
+
+def zsf_calc_steady(auxiliary_results: bool = False, **parameters: float) -> Dict[str, float]:
+    """
+    Calculate the salt intrusion for a set of parameters, assuming steady
+    operation.
+
+    :param auxiliary_results: Whether or not to calculate and output auxiliary
+        results. See :c:struct:`zsf_aux_results_t`.
+    :param kwargs: Any parameters that should be changed versus the default.
+        See also :c:struct:`zsf_param_t` for an overview of the parameters.
+
+    :returns: A dictionary containing the cycle averaged salt fluxes and
+        discharges (see :c:struct:`zsf_results_t`). Also outputs values in
+        :c:struct:`zsf_aux_results_t` if ``auxiliary_results`` is `True`.
+    """
+    param_t = _param_t_from_kwargs(parameters)
+
     # Get results
     results_t = ffi.new("zsf_results_t *")
     if auxiliary_results:
@@ -69,6 +89,308 @@ def zsf_calc_steady(auxiliary_results: bool = False, **parameters: float) -> Dic
     return {**_struct_to_dict(results_t), **_struct_to_dict(aux_results_t)}
 
 
+def zsf_calc_periodic(
+    t_period: float,
+    head_sea: Sequence[float],
+    cycles: Sequence[Dict[str, float]],
+    salinity_sea_series: Optional[Sequence[float]] = None,
+    **parameters: float,
+) -> Dict[str, Any]:
+    """
+    Calculate the periodic (e.g. tidal) steady state of a lock that is
+    operated according to a schedule of locking cycles.
+
+    :param t_period: The duration of the period in seconds.
+    :param head_sea: Equidistant samples of the head at sea over the period,
+        the first sample being at the start of the period.
+    :param cycles: The locking cycles in the period, ordered by their start
+        time. See :c:struct:`zsf_locking_cycle_t`.
+    :param salinity_sea_series: Optional equidistant samples of the salinity
+        at sea. If not specified, the parameter ``salinity_sea`` is used.
+    :param parameters: Any parameters that should be changed versus the
+        default. See also :c:struct:`zsf_param_t`.
+
+    :returns: A dictionary with the period averaged results (see
+        :c:struct:`zsf_results_t`), the transports of every locking cycle in
+        ``cycles``, and the periodic state at the start of the period in
+        ``state``.
+    """
+    param_t = _param_t_from_kwargs(parameters)
+
+    if salinity_sea_series is not None and len(salinity_sea_series) != len(head_sea):
+        raise ValueError("Time series of head and salinity at sea should have the same length")
+
+    cycles_t = ffi.new("zsf_locking_cycle_t[]", len(cycles))
+    for c_t, c in zip(cycles_t, cycles):
+        for k, v in c.items():
+            setattr(c_t, k, v)
+
+    results_t = ffi.new("zsf_results_t *")
+    cycle_transports_t = ffi.new("zsf_phase_transports_t[]", len(cycles))
+    state_t = ffi.new("zsf_phase_state_t *")
+
+    err = lib.zsf_calc_periodic(
+        param_t,
+        t_period,
+        len(head_sea),
+        ffi.new("double[]", list(head_sea)),
+        ffi.new("double[]", list(salinity_sea_series))
+        if salinity_sea_series is not None
+        else ffi.NULL,
+        len(cycles),
+        cycles_t,
+        results_t,
+        cycle_transports_t,
+        state_t,
+    )
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    return {
+        **_struct_to_dict(results_t),
+        "cycles": [_struct_to_dict(c) for c in cycle_transports_t],
+        "state": _struct_to_dict(state_t),
+    }
+
+
+def zsf_run_box_model(
+    locks: Sequence[Dict[str, float]],
+    lake: Dict[str, float],
+    sea: Dict[str, float],
+    dt_forcing: float,
+    forcing: Dict[str, Sequence[float]],
+    t_output: Sequence[float],
+    tolerance: float = 1e-3,
+    max_time_step: Optional[float] = None,
+) -> Dict[str, Any]:
+    """
+    Integrate the salt balance of a lake and a sea compartment, connected by
+    one or more locks. See also :c:func:`zsf_run_box_model`.
+
+    :param locks: The parameters of every lock that should be changed versus
+        the default. The salinities at lake and sea side are those of the
+        compartments.
+    :param lake: The initial ``volume`` and ``salinity`` of the lake. A
+        volume of zero means an infinitely large lake.
+    :param sea: The initial ``volume`` and ``salinity`` of the sea.
+    :param dt_forcing: The time between the samples of the forcing.
+    :param forcing: Equidistant samples of the fields of
+        :c:struct:`zsf_box_forcing_t`, all of the same length. Missing
+        inflows are zero, and missing outflows keep the volume constant.
+    :param t_output: The times at which to output the state, the last of
+        which is the end of the simulation.
+    :param tolerance: The tolerance of the local error in the salinities.
+    :param max_time_step: The maximum time step, by default ``dt_forcing``.
+
+    :returns: A dictionary with a list of values per field of
+        :c:struct:`zsf_box_output_t`, and the final state of the ``lake``
+        and ``sea``.
+    """
+    param_t = ffi.new("zsf_param_t[]", max(len(locks), 1))
+    for i, parameters in enumerate(locks):
+        param_t[i] = _param_t_from_kwargs(parameters)[0]
+
+    lengths = {len(v) for v in forcing.values()}
+    if len(lengths) != 1:
+        raise ValueError("All forcing series should have the same (non-zero) length")
+    num_samples = lengths.pop()
+
+    forcing_t = ffi.new("zsf_box_forcing_t[]", num_samples)
+    names = {name for name, _ in ffi.typeof("zsf_box_forcing_t").fields}
+    for k in forcing:
+        if k not in names:
+            raise TypeError(f"No such field '{k}'")
+    for i in range(num_samples):
+        forcing_t[i].outflow_lake = lib.ZSF_NAN
+        forcing_t[i].outflow_sea = lib.ZSF_NAN
+        for k, v in forcing.items():
+            setattr(forcing_t[i], k, v[i])
+
+    lake_t = _new_struct("zsf_compartment_t *", lake)
+    sea_t = _new_struct("zsf_compartment_t *", sea)
+    outputs_t = ffi.new("zsf_box_output_t[]", len(t_output))
+
+    err = lib.zsf_run_box_model(
+        len(locks),
+        param_t,
+        num_samples,
+        dt_forcing,
+        forcing_t,
+        tolerance,
+        max_time_step if max_time_step is not None else dt_forcing,
+        lake_t,
+        sea_t,
+        len(t_output),
+        ffi.new("double[]", list(t_output)),
+        outputs_t,
+    )
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    return {
+        **{name: [getattr(o, name) for o in outputs_t] for name in dir(outputs_t[0])},
+        "lake": _struct_to_dict(lake_t),
+        "sea": _struct_to_dict(sea_t),
+    }
+
+
+def _output_mask(outputs: Optional[Sequence[str]]) -> Tuple[int, List[str]]:
+    names = [name for name, _ in ffi.typeof("zsf_results_t").fields]
+    if outputs is None:
+        return lib.ZSF_OUTPUT_ALL, names
+
+    mask = 0
+    for o in outputs:
+        if o not in names:
+            raise TypeError(f"No such result '{o}'")
+        mask |= 1 << names.index(o)
+    return mask, [name for name in names if name in outputs]
+
+
+def _batch_results(names, outputs_t, num_rows, errors_t) -> Dict[str, List[float]]:
+    nan = float("nan")
+    results = {}
+    for j, name in enumerate(names):
+        column = ffi.unpack(outputs_t + j * num_rows, num_rows)
+        results[name] = [nan if errors_t[i] else x for i, x in enumerate(column)]
+    return results
+
+
+def _param_array_from_kwargs(parameters: Dict[str, Union[float, Sequence[float]]]):
+    lengths = {len(v) for v in parameters.values() if isinstance(v, Sequence)}
+    if len(lengths) > 1:
+        raise ValueError("All sequences of parameter values should have the same length")
+    n = lengths.pop() if lengths else 1
+
+    base_t = _param_t_from_kwargs(
+        {k: v for k, v in parameters.items() if not isinstance(v, Sequence)}
+    )
+    param_t = ffi.new("zsf_param_t[]", n)
+    for i in range(n):
+        param_t[i] = base_t[0]
+    for k, v in parameters.items():
+        if isinstance(v, Sequence):
+            if not hasattr(base_t, k):
+                raise TypeError(f"No such parameter '{k}'")
+            for i in range(n):
+                setattr(param_t[i], k, v[i])
+
+    return param_t, n
+
+
+def zsf_calc_steady_batch(
+    outputs: Optional[Sequence[str]] = None, **parameters: Union[float, Sequence[float]]
+) -> Dict[str, List[float]]:
+    """
+    Calculate the steady state for many sets of parameters at once.
+    See also :c:func:`zsf_calc_steady_batch`.
+
+    :param outputs: The names of the results to return (see
+        :c:struct:`zsf_results_t`), or ``None`` for all results.
+    :param parameters: Any parameters that should be changed versus the
+        default, either as a single value or as a sequence of values (one
+        per calculation). All sequences should have the same length.
+
+    :returns: A dictionary with a list of values per requested result. The
+        values of failed calculations are NaN.
+    """
+    mask, names = _output_mask(outputs)
+    param_t, n = _param_array_from_kwargs(parameters)
+
+    outputs_t = ffi.new("double[]", n * len(names))
+    errors_t = ffi.new("int[]", n)
+    err = lib.zsf_calc_steady_batch(n, param_t, mask, outputs_t, 1, n, errors_t)
+    # Errors of individual calculations are reported as NaN, other errors
+    # (i.e. invalid arguments) are raised.
+    if err and not any(errors_t[0:n]):
+        raise RuntimeError(_zsf_error_message(err))
+
+    return _batch_results(names, outputs_t, n, errors_t)
+
+
+def zsf_calc_steady_sweep(
+    axes: Dict[str, Sequence[float]], outputs: Optional[Sequence[str]] = None, **parameters: float
+) -> Dict[str, List[float]]:
+    """
+    Calculate the steady state on all nodes of a grid over one or more
+    parameters. See also :c:func:`zsf_calc_steady_sweep`.
+
+    :param axes: The values of each parameter to sweep over. The last axis
+        varies fastest in the results.
+    :param outputs: The names of the results to return (see
+        :c:struct:`zsf_results_t`), or ``None`` for all results.
+    :param parameters: Any other parameters that should be changed versus the
+        default.
+
+    :returns: A dictionary with a list of values per requested result. The
+        values of failed calculations are NaN.
+    """
+    mask, names = _output_mask(outputs)
+    param_t = _param_t_from_kwargs(parameters)
+
+    names_t = [ffi.new("char[]", k.encode("utf-8")) for k in axes]
+    num_points = [len(v) for v in axes.values()]
+    values = [x for v in axes.values() for x in v]
+
+    n = 1
+    for m in num_points:
+        n *= m
+
+    outputs_t = ffi.new("double[]", n * len(names))
+    errors_t = ffi.new("int[]", n)
+    err = lib.zsf_calc_steady_sweep(
+        param_t,
+        len(axes),
+        ffi.new("char *[]", names_t),
+        ffi.new("int[]", num_points),
+        ffi.new("double[]", values),
+        mask,
+        outputs_t,
+        1,
+        n,
+        errors_t,
+    )
+    # Errors of individual calculations are reported as NaN, other errors
+    # (i.e. invalid arguments) are raised.
+    if err and not any(errors_t[0:n]):
+        raise RuntimeError(_zsf_error_message(err))
+
+    return _batch_results(names, outputs_t, n, errors_t)
+
+
+def zsf_calc_steady_bounds(
+    ranges: Dict[str, Tuple[float, float]], max_boxes: int = 1, **parameters: float
+) -> Dict[str, Tuple[float, float]]:
+    """
+    Calculate guaranteed bounds on the steady results for all parameters in
+    the given ranges. See also :c:func:`zsf_calc_steady_bounds`.
+
+    :param ranges: The lower and upper bound of every uncertain parameter.
+    :param max_boxes: The maximum number of boxes the ranges are split into
+        to tighten the bounds.
+    :param parameters: Any other parameters that should be changed versus the
+        default.
+
+    :returns: A dictionary with the lower and upper bound of every result.
+    """
+    for k in ranges:
+        if k in parameters:
+            raise TypeError(f"Parameter '{k}' is both a range and a value")
+
+    p_lo = _param_t_from_kwargs({**parameters, **{k: v[0] for k, v in ranges.items()}})
+    p_hi = _param_t_from_kwargs({**parameters, **{k: v[1] for k, v in ranges.items()}})
+
+    results_lo = ffi.new("zsf_results_t *")
+    results_hi = ffi.new("zsf_results_t *")
+    err = lib.zsf_calc_steady_bounds(p_lo, p_hi, max_boxes, results_lo, results_hi)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    lo = _struct_to_dict(results_lo)
+    hi = _struct_to_dict(results_hi)
+    return {k: (lo[k], hi[k]) for k in lo}
+
+
 class ZSFUnsteady:
     """
     A class to calculate a lock in phase-wise fashion.
@@ -76,13 +398,7 @@ class ZSFUnsteady:
 
     def __init__(self, sal_lock, head_lock, **parameters: float):
 
-        self._param_t = ffi.new("zsf_param_t *")
-        self._state_t = ffi.new("zsf_phase_state_t *")
-        # We can reuse the same object for results,
-        # as we convert it to a dictionary before returning
-        self._results_t = ffi.new("zsf_phase_transports_t *")
-
-        self._param_t_names = set(dir(self._param_t))
+        self._allocate()
 
         # Set default values
         lib.zsf_param_default(self._param_t)
@@ -93,6 +409,23 @@ class ZSFUnsteady:
         # Initialize the state
         lib.zsf_initialize_state(self._param_t, self._state_t, sal_lock, head_lock)
 
+    def _allocate(self):
+        self._param_t = ffi.new("zsf_param_t *")
+        self._state_t = ffi.new("zsf_phase_state_t *")
+        # We can reuse the same object for results,
+        # as we convert it to a dictionary before returning
+        self._results_t = ffi.new("zsf_phase_transports_t *")
+
+        self._param_t_names = set(dir(self._param_t))
+
+    @classmethod
+    def _from_structs(cls, param_t, state_t) -> "ZSFUnsteady":
+        lock = cls.__new__(cls)
+        lock._allocate()
+        lock._param_t[0] = param_t
+        lock._state_t[0] = state_t
+        return lock
+
     def _set_parameters(self, **parameters: float):
         for p, v in parameters.items():
             if p not in self._param_t_names:
@@ -209,6 +542,70 @@ class ZSFUnsteady:
 
         return _struct_to_dict(self._results_t)
 
+    def step_lockages(
+        self, lockages: Sequence[Dict[str, float]], num_threads: int = 1
+    ) -> Dict[str, List[float]]:
+        """
+        Step through a sequence of lockages. The ship volumes are taken from
+        the lockages. See also :c:func:`zsf_step_lockages` .
+
+        :param lockages: The lockages, see :c:struct:`zsf_lockage_t`.
+        :param num_threads: The number of threads to split long sequences
+            over, see :c:func:`zsf_step_lockages_parallel`.
+
+        :returns: A dictionary with a list of values per field of
+                  :c:struct:`zsf_phase_transports_t`, one for every lockage.
+        """
+
+        n = len(lockages)
+        lockages_t = ffi.new("zsf_lockage_t[]", n)
+        for i, lockage in enumerate(lockages):
+            lockages_t[i] = _new_struct("zsf_lockage_t *", lockage)[0]
+
+        transports_t = ffi.new("zsf_phase_transports_t[]", n)
+        err = lib.zsf_step_lockages_parallel(
+            self._param_t, n, lockages_t, self._state_t, transports_t, num_threads
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        names = [name for name, _ in ffi.typeof("zsf_phase_transports_t").fields]
+        return {name: [getattr(transports_t[i], name) for i in range(n)] for name in names}
+
+    def resolve_phase(
+        self, routine: int, duration: float, times: Sequence[float], **parameters: float
+    ) -> Dict[str, List[float]]:
+        """
+        Sample the transports within a phase on a time grid, without stepping
+        through it. See also :c:func:`zsf_resolve_phase` .
+
+        :param routine: The phase (1 to 4), or -2/-4 for flushing with the
+            doors closed.
+        :param duration: Duration of the phase in seconds.
+        :param times: The times since the start of the phase at which to
+            sample, between 0 and ``duration``.
+        :param parameters: Any parameters that should be changed before
+            resolving this phase. Note that these changes persist.
+
+        :returns: A dictionary with a list of values per field of
+                  :c:struct:`zsf_phase_transports_t`. Volumes and mass
+                  transports are cumulative since the start of the phase,
+                  discharges and salinities are instantaneous.
+        """
+
+        self._set_parameters(**parameters)
+
+        n = len(times)
+        samples_t = ffi.new("zsf_phase_transports_t[]", n)
+        err = lib.zsf_resolve_phase(
+            self._param_t, routine, duration, self._state_t, n, list(times), samples_t
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        names = [name for name, _ in ffi.typeof("zsf_phase_transports_t").fields]
+        return {name: [getattr(samples_t[i], name) for i in range(n)] for name in names}
+
     @property
     def state(self) -> Dict[str, float]:
         """
@@ -219,3 +616,924 @@ class ZSFUnsteady:
         """
 
         return _struct_to_dict(self._state_t)
+
+    def snapshot(self) -> bytes:
+        """
+        Get a snapshot of the parameters and state of the lock, from which
+        the calculation can be continued bit-identically with
+        :meth:`restore`. See also :c:func:`zsf_snapshot_write`.
+        """
+        size = lib.zsf_snapshot_size(1, 0)
+        buffer = ffi.new("char[]", size)
+        err = lib.zsf_snapshot_write(buffer, size, 1, self._param_t, self._state_t, ffi.NULL)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return ffi.buffer(buffer, size)[:]
+
+    @classmethod
+    def restore(cls, snapshot: bytes) -> "ZSFUnsteady":
+        """
+        Create a lock from a snapshot made with :meth:`snapshot`.
+        """
+        locks = _snapshot_read(snapshot)
+        if len(locks) != 1:
+            raise ValueError(f"Snapshot holds {len(locks)} locks instead of one")
+        return locks[0]
+
+
+def _snapshot_read(snapshot: bytes) -> List[ZSFUnsteady]:
+    num_locks = ffi.new("int *")
+    err = lib.zsf_snapshot_read(snapshot, len(snapshot), 0, num_locks, ffi.NULL, ffi.NULL, ffi.NULL)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    n = num_locks[0]
+    param_t = ffi.new("zsf_param_t[]", n)
+    state_t = ffi.new("zsf_phase_state_t[]", n)
+    err = lib.zsf_snapshot_read(snapshot, len(snapshot), n, num_locks, param_t, state_t, ffi.NULL)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    return [ZSFUnsteady._from_structs(param_t[i], state_t[i]) for i in range(n)]
+
+
+def zsf_snapshot_save(path: str, locks: Sequence[ZSFUnsteady]):
+    """
+    Write a snapshot of the parameters and states of a number of locks to a
+    binary file. See also :c:func:`zsf_snapshot_save`.
+    """
+    n = len(locks)
+    param_t = ffi.new("zsf_param_t[]", n)
+    state_t = ffi.new("zsf_phase_state_t[]", n)
+    for i, lock in enumerate(locks):
+        param_t[i] = lock._param_t[0]
+        state_t[i] = lock._state_t[0]
+
+    err = lib.zsf_snapshot_save(str(path).encode("utf-8"), n, param_t, state_t, ffi.NULL)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+
+def zsf_snapshot_load(path: str) -> List[ZSFUnsteady]:
+    """
+    Read the locks from a snapshot written by :func:`zsf_snapshot_save`.
+    See also :c:func:`zsf_snapshot_load`.
+    """
+    path_c = str(path).encode("utf-8")
+    num_locks = ffi.new("int *")
+    err = lib.zsf_snapshot_load(path_c, 0, num_locks, ffi.NULL, ffi.NULL, ffi.NULL)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    n = num_locks[0]
+    param_t = ffi.new("zsf_param_t[]", n)
+    state_t = ffi.new("zsf_phase_state_t[]", n)
+    err = lib.zsf_snapshot_load(path_c, n, num_locks, param_t, state_t, ffi.NULL)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    return [ZSFUnsteady._from_structs(param_t[i], state_t[i]) for i in range(n)]
+
+
+_INTERPOLATION_METHODS = {"linear": lib.ZSF_INTERP_LINEAR, "cubic": lib.ZSF_INTERP_CUBIC}
+
+
+class ZSFSurrogate:
+    """
+    A table of steady results on a grid over one or more parameters, for fast
+    approximate lookups. See also :c:func:`zsf_surrogate_build`.
+    """
+
+    def __init__(self, surrogate_ptr):
+        # Use one of the class methods `build` or `load` instead
+        self._surrogate = ffi.gc(surrogate_ptr, lib.zsf_surrogate_free)
+        self.axes = tuple(
+            ffi.string(lib.zsf_surrogate_axis_name(self._surrogate, i)).decode("utf-8")
+            for i in range(lib.zsf_surrogate_num_axes(self._surrogate))
+        )
+
+    @classmethod
+    def build(cls, axes: Dict[str, Sequence[float]], **parameters: float) -> "ZSFSurrogate":
+        """
+        Tabulate the steady results on a grid.
+
+        :param axes: The (strictly increasing) grid values per parameter name.
+        :param parameters: Any parameters that should be changed versus the
+            default. These are the same for all points in the table.
+        """
+        param_t = _param_t_from_kwargs(parameters)
+
+        names = [ffi.new("char[]", k.encode("utf-8")) for k in axes]
+        values = [float(v) for vs in axes.values() for v in vs]
+
+        surrogate_ptr = ffi.new("zsf_surrogate_t **")
+        err = lib.zsf_surrogate_build(
+            param_t,
+            len(axes),
+            ffi.new("char *[]", names),
+            ffi.new("int[]", [len(v) for v in axes.values()]),
+            ffi.new("double[]", values),
+            surrogate_ptr,
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return cls(surrogate_ptr[0])
+
+    @classmethod
+    def load(cls, path: str) -> "ZSFSurrogate":
+        """
+        Load a surrogate from a file written by :py:meth:`save`.
+        """
+        surrogate_ptr = ffi.new("zsf_surrogate_t **")
+        err = lib.zsf_surrogate_load(str(path).encode("utf-8"), surrogate_ptr)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return cls(surrogate_ptr[0])
+
+    def save(self, path: str):
+        """
+        Save the surrogate to a binary file.
+        """
+        err = lib.zsf_surrogate_save(self._surrogate, str(path).encode("utf-8"))
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+    def __call__(self, method: str = "linear", **values: float) -> Dict[str, float]:
+        """
+        Interpolate the steady results.
+
+        :param method: Either "linear" or "cubic".
+        :param values: The value of every parameter along the axes of the table.
+
+        :returns: See :c:struct:`zsf_results_t`.
+        """
+        if set(values) != set(self.axes):
+            raise TypeError(f"Expected values for exactly the parameters {self.axes}")
+
+        results_t = ffi.new("zsf_results_t *")
+        x = ffi.new("double[]", [values[k] for k in self.axes])
+        err = lib.zsf_surrogate_eval(self._surrogate, x, _INTERPOLATION_METHODS[method], results_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _struct_to_dict(results_t)
+
+    def validate(
+        self, num_samples: int = 100, seed: int = 0, method: str = "linear"
+    ) -> Tuple[Dict[str, float], Dict[str, float]]:
+        """
+        Compare the interpolated results with those of :py:func:`zsf_calc_steady`
+        at random points inside the grid.
+
+        :returns: The maximum absolute and relative error per result.
+        """
+        max_abs_t = ffi.new("zsf_results_t *")
+        max_rel_t = ffi.new("zsf_results_t *")
+        err = lib.zsf_surrogate_validate(
+            self._surrogate, num_samples, seed, _INTERPOLATION_METHODS[method], max_abs_t, max_rel_t
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _struct_to_dict(max_abs_t), _struct_to_dict(max_rel_t)
+
+
+class ZSFLockageGenerator:
+    """
+    Generates the lockages of a lock from a traffic model, without having to
+    write them to file first. See also :c:func:`zsf_lockage_generator_create`.
+
+    :param traffic: The arrival rates, see :c:struct:`zsf_traffic_t`.
+    :param fleet: The classes of ships in the fleet mix, see
+        :c:struct:`zsf_fleet_class_t`.
+    :param policy: The operating policy of the lock, see
+        :c:struct:`zsf_lock_policy_t`.
+    :param seed: Seed of the random number generator.
+    """
+
+    def __init__(
+        self,
+        traffic: Dict[str, float],
+        fleet: Sequence[Dict[str, float]],
+        policy: Dict[str, float],
+        seed: int = 0,
+    ):
+        traffic_t = _new_struct("zsf_traffic_t *", traffic)
+        policy_t = _new_struct("zsf_lock_policy_t *", policy)
+
+        fleet_t = ffi.new("zsf_fleet_class_t[]", len(fleet))
+        for c_t, c in zip(fleet_t, fleet):
+            for k, v in c.items():
+                setattr(c_t, k, v)
+
+        generator_ptr = ffi.new("zsf_lockage_generator_t **")
+        err = lib.zsf_lockage_generator_create(
+            traffic_t, len(fleet), fleet_t, policy_t, seed, generator_ptr
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        self._generator = ffi.gc(generator_ptr[0], lib.zsf_lockage_generator_free)
+
+    def generate(self, t_end: float, batch_size: int = 1024) -> List[Dict[str, float]]:
+        """
+        Get the next lockages that start before ``t_end``.
+
+        :returns: A list of lockages, see :c:struct:`zsf_lockage_t`.
+        """
+        lockages_t = ffi.new("zsf_lockage_t[]", batch_size)
+        num_lockages = ffi.new("int *")
+
+        lockages = []
+        while True:
+            err = lib.zsf_lockage_generator_next(
+                self._generator, t_end, batch_size, lockages_t, num_lockages
+            )
+            if err:
+                raise RuntimeError(_zsf_error_message(err))
+
+            n = num_lockages[0]
+            lockages.extend(_struct_to_dict(l_t) for l_t in lockages_t[0:n])
+            if n < batch_size:
+                return lockages
+
+    def run(self, lock: ZSFUnsteady, t_end: float) -> Dict[str, float]:
+        """
+        Step the lock through the next lockages that start before ``t_end``.
+        The parameters of the lock are used for all lockages, except for the
+        ship volumes. See also :c:func:`zsf_run_lockages`.
+
+        :returns: The results averaged over the time since the previous call,
+            see :c:struct:`zsf_results_t`.
+        """
+        results_t = ffi.new("zsf_results_t *")
+        err = lib.zsf_run_lockages(lock._param_t, self._generator, t_end, lock._state_t, results_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _struct_to_dict(results_t)
+
+    @property
+    def stats(self) -> Dict[str, float]:
+        """
+        Statistics on the ships that departed so far, see
+        :c:struct:`zsf_traffic_stats_t`.
+        """
+        stats_t = ffi.new("zsf_traffic_stats_t *")
+        lib.zsf_lockage_generator_stats(self._generator, stats_t)
+        return _struct_to_dict(stats_t)
+
+
+class ZSFNetwork:
+    """
+    A network of independently operated locks, each with the lockages of its
+    own generator. A discrete-event engine steps every lock only at its own
+    phase boundaries, and hands out the transports of all locks on a common
+    output clock. See also :c:func:`zsf_network_create`.
+
+    :param locks: The locks, with their parameters and initial states. They
+        are not changed.
+    :param generators: The lockage generator of every lock. They are used by
+        the network, and should not be used otherwise.
+    :param dt_output: The output interval in seconds.
+    """
+
+    def __init__(
+        self,
+        locks: Sequence[ZSFUnsteady],
+        generators: Sequence[ZSFLockageGenerator],
+        dt_output: float,
+    ):
+        if len(generators) != len(locks):
+            raise ValueError("Need one generator per lock")
+
+        n = len(locks)
+        self._param_t = ffi.new("zsf_param_t[]", n)
+        state_t = ffi.new("zsf_phase_state_t[]", n)
+        for i, lock in enumerate(locks):
+            self._param_t[i] = lock._param_t[0]
+            state_t[i] = lock._state_t[0]
+        self._param_t_names = set(dir(self._param_t[0]))
+
+        # The network does not own the generators, so keep them alive
+        self._generators = list(generators)
+        generators_t = ffi.new(
+            "zsf_lockage_generator_t *[]", [g._generator for g in self._generators]
+        )
+
+        network_ptr = ffi.new("zsf_network_t **")
+        err = lib.zsf_network_create(
+            n, self._param_t, state_t, generators_t, dt_output, network_ptr
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        self._network = ffi.gc(network_ptr[0], lib.zsf_network_free)
+
+        self._transports_t = ffi.new("zsf_phase_transports_t[]", n)
+
+    def advance(self) -> List[Dict[str, float]]:
+        """
+        Process all events up to the next output time. See also
+        :c:func:`zsf_network_advance`.
+
+        :returns: The transports of every lock over the output interval, see
+            :c:struct:`zsf_phase_transports_t`.
+        """
+        err = lib.zsf_network_advance(self._network, self._transports_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return [_struct_to_dict(t) for t in self._transports_t]
+
+    def set_parameters(self, lock: int, **parameters: float):
+        """
+        Change parameters of a lock from its next lockage on. Note that these
+        changes persist.
+        """
+        for p, v in parameters.items():
+            if p not in self._param_t_names:
+                raise TypeError(f"No such parameter '{p}'")
+            setattr(self._param_t[lock], p, v)
+
+        err = lib.zsf_network_set_param(self._network, lock, ffi.addressof(self._param_t, lock))
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+    def state(self, lock: int) -> Dict[str, float]:
+        """
+        The state of a lock after the last lockage that has started, see
+        :c:struct:`zsf_phase_state_t`.
+        """
+        state_t = ffi.new("zsf_phase_state_t *")
+        err = lib.zsf_network_state(self._network, lock, state_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _struct_to_dict(state_t)
+
+
+class ZSFForcing:
+    """
+    Boundary conditions evaluated on demand from a harmonic tide and seasonal
+    curves, instead of series passed in. See also
+    :c:func:`zsf_forcing_create`.
+
+    :param constituents: The tidal constituents of the head at sea, see
+        :c:struct:`zsf_tidal_constituent_t`.
+    :param mean_sea_level: The mean of the head at sea, or ``None`` to not
+        force the head at sea (without constituents).
+    :param seasonal: The seasonal curve per parameter name, see
+        :c:struct:`zsf_seasonal_t`.
+    """
+
+    def __init__(
+        self,
+        constituents: Sequence[Dict[str, float]] = (),
+        mean_sea_level: Optional[float] = 0.0,
+        seasonal: Optional[Dict[str, Dict[str, float]]] = None,
+    ):
+        seasonal = seasonal or {}
+        if mean_sea_level is None:
+            mean_sea_level = lib.ZSF_NAN
+
+        constituents_t = ffi.new("zsf_tidal_constituent_t[]", len(constituents))
+        for i, c in enumerate(constituents):
+            constituents_t[i] = _new_struct("zsf_tidal_constituent_t *", c)[0]
+
+        # Keep the names alive until the call returns
+        names_c = [ffi.new("char[]", name.encode()) for name in seasonal]
+        curves_t = ffi.new("zsf_seasonal_t[]", len(seasonal))
+        for i, curve in enumerate(seasonal.values()):
+            curves_t[i] = _new_struct("zsf_seasonal_t *", curve)[0]
+
+        forcing_ptr = ffi.new("zsf_forcing_t **")
+        err = lib.zsf_forcing_create(
+            mean_sea_level,
+            len(constituents),
+            constituents_t,
+            len(seasonal),
+            ffi.new("char *[]", names_c),
+            curves_t,
+            forcing_ptr,
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        self._forcing = ffi.gc(forcing_ptr[0], lib.zsf_forcing_free)
+        self._forced = (["head_sea"] if mean_sea_level != lib.ZSF_NAN else []) + list(seasonal)
+
+    def eval(
+        self, t0: float, dt: float, num_times: int, **parameters: float
+    ) -> Dict[str, List[float]]:
+        """
+        Evaluate the forced parameters at the times ``t0 + i * dt``. See also
+        :c:func:`zsf_forcing_eval`.
+
+        :param parameters: Any parameters that should be changed versus the
+            default. Seasonal curves with a mean of ``ZSF_NAN`` vary around
+            these.
+
+        :returns: A dictionary with a list of values per forced parameter.
+        """
+        param_t = _param_t_from_kwargs(parameters)
+        out_t = ffi.new("zsf_param_t[]", num_times)
+        err = lib.zsf_forcing_eval(self._forcing, param_t, t0, dt, num_times, out_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return {name: [getattr(p_t, name) for p_t in out_t] for name in self._forced}
+
+    def calc_steady(
+        self,
+        t0: float,
+        dt: float,
+        num_times: int,
+        outputs: Optional[Sequence[str]] = None,
+        **parameters: float,
+    ) -> Dict[str, List[float]]:
+        """
+        Calculate the steady state at the times ``t0 + i * dt``, without
+        materializing the parameters at all times. See also
+        :c:func:`zsf_calc_steady_forced`.
+
+        :param outputs: The names of the results to return (see
+            :c:struct:`zsf_results_t`), or ``None`` for all results.
+        :param parameters: Any parameters that should be changed versus the
+            default.
+
+        :returns: A dictionary with a list of values per requested result. The
+            values of failed calculations are NaN.
+        """
+        mask, names = _output_mask(outputs)
+        param_t = _param_t_from_kwargs(parameters)
+
+        outputs_t = ffi.new("double[]", num_times * len(names))
+        errors_t = ffi.new("int[]", num_times)
+        err = lib.zsf_calc_steady_forced(
+            param_t, self._forcing, t0, dt, num_times, mask, outputs_t, 1, num_times, errors_t
+        )
+        if err and not any(errors_t[0:num_times]):
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _batch_results(names, outputs_t, num_times, errors_t)
+
+    def step_lockages(
+        self, lock: ZSFUnsteady, lockages: Sequence[Dict[str, float]]
+    ) -> Dict[str, List[float]]:
+        """
+        Step the lock through a sequence of lockages, with the forced
+        parameters evaluated at the time of every lockage. See also
+        :c:func:`zsf_step_lockages_forced`.
+
+        :param lockages: The lockages, see :c:struct:`zsf_lockage_t`.
+
+        :returns: A dictionary with a list of values per field of
+                  :c:struct:`zsf_phase_transports_t`, one for every lockage.
+        """
+        n = len(lockages)
+        lockages_t = ffi.new("zsf_lockage_t[]", n)
+        for i, lockage in enumerate(lockages):
+            lockages_t[i] = _new_struct("zsf_lockage_t *", lockage)[0]
+
+        transports_t = ffi.new("zsf_phase_transports_t[]", n)
+        err = lib.zsf_step_lockages_forced(
+            lock._param_t, self._forcing, n, lockages_t, lock._state_t, transports_t
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        names = [name for name, _ in ffi.typeof("zsf_phase_transports_t").fields]
+        return {name: [getattr(transports_t[i], name) for i in range(n)] for name in names}
+
+
+def zsf_replay_variants(
+    lock: ZSFUnsteady, lockages: Sequence[Dict[str, float]], variants: Sequence[Dict[str, float]]
+) -> Tuple[List[Dict[str, float]], List[ZSFUnsteady]]:
+    """
+    Step copies of a lock through the same lockages, for a number of
+    variants of its countermeasures. The work that does not depend on the
+    countermeasures is shared by all variants, which makes this a lot faster
+    than replaying every variant separately. See also
+    :c:func:`zsf_replay_variants`.
+
+    :param lock: The lock to start from. It is not changed.
+    :param lockages: The lockages, see :c:struct:`zsf_lockage_t`.
+    :param variants: The parameters in which every variant differs from the
+        lock, e.g. ``{"flushing_discharge_high_tide": 1.0}``.
+
+    :returns: The results of every variant averaged over the lockages (see
+        :c:struct:`zsf_results_t`), and the locks at the end of the lockages.
+    """
+    n = len(variants)
+    param_t = ffi.new("zsf_param_t[]", n)
+    state_t = ffi.new("zsf_phase_state_t[]", n)
+    for i, variant in enumerate(variants):
+        param_t[i] = lock._param_t[0]
+        for k, v in variant.items():
+            if k not in lock._param_t_names:
+                raise TypeError(f"No such parameter '{k}'")
+            setattr(param_t[i], k, v)
+        state_t[i] = lock._state_t[0]
+
+    lockages_t = ffi.new("zsf_lockage_t[]", len(lockages))
+    for i, lockage in enumerate(lockages):
+        lockages_t[i] = _new_struct("zsf_lockage_t *", lockage)[0]
+
+    results_t = ffi.new("zsf_results_t[]", n)
+    err = lib.zsf_replay_variants(n, param_t, len(lockages), lockages_t, state_t, results_t)
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    results = [_struct_to_dict(results_t[i]) for i in range(n)]
+    locks = [ZSFUnsteady._from_structs(param_t[i], state_t[i]) for i in range(n)]
+    return results, locks
+
+
+def zsf_optimize_schedule(
+    lock: ZSFUnsteady, ships: Sequence[Dict[str, float]], limits: Dict[str, float]
+) -> Tuple[List[Dict[str, float]], List[Dict[str, float]], Dict[str, float]]:
+    """
+    Find the door open and flushing times that minimise the salt intrusion
+    into the lake for the given ship arrivals, within the limits on waiting
+    time and flushing water. See also :c:func:`zsf_schedule_optimize`.
+
+    :param lock: The lock to start from. It is not changed.
+    :param ships: The ship arrivals, see :c:struct:`zsf_ship_arrival_t`.
+    :param limits: The limits of the operation, see
+        :c:struct:`zsf_schedule_limits_t`. The number of candidate times per
+        visit ``num_candidates`` defaults to 8.
+
+    :returns: The lockages of the optimal schedule (see
+        :c:struct:`zsf_lockage_t`), their transports (see
+        :c:struct:`zsf_phase_transports_t`), and the transports averaged over
+        the period (see :c:struct:`zsf_results_t`).
+    """
+    limits_t = _new_struct("zsf_schedule_limits_t *", {"num_candidates": 8.0, **limits})
+
+    n = len(ships)
+    ships_t = ffi.new("zsf_ship_arrival_t[]", max(n, 1))
+    for i, ship in enumerate(ships):
+        ships_t[i] = _new_struct("zsf_ship_arrival_t *", ship)[0]
+
+    # Every visit of the lock takes at most three lockages, and starts with
+    # leveling.
+    max_lockages = 3 * (int(limits_t.t_end / limits_t.leveling_time) + 2)
+    lockages_t = ffi.new("zsf_lockage_t[]", max_lockages)
+    transports_t = ffi.new("zsf_phase_transports_t[]", max_lockages)
+    num_lockages = ffi.new("int *")
+    results_t = ffi.new("zsf_results_t *")
+
+    err = lib.zsf_schedule_optimize(
+        lock._param_t,
+        lock._state_t,
+        n,
+        ships_t,
+        limits_t,
+        max_lockages,
+        lockages_t,
+        transports_t,
+        num_lockages,
+        results_t,
+    )
+    if err:
+        raise RuntimeError(_zsf_error_message(err))
+
+    lockages = [_struct_to_dict(lockages_t[i]) for i in range(num_lockages[0])]
+    transports = [_struct_to_dict(transports_t[i]) for i in range(num_lockages[0])]
+    return lockages, transports, _struct_to_dict(results_t)
+
+
+class ZSFAsync:
+    """
+    Calculates a lock in a worker thread, in parallel with the host model.
+    Every timestep the inputs of that timestep are posted, and the results of
+    the previous timestep are returned. See also :c:func:`zsf_async_step`.
+
+    :param sal_lock: Initial salinity of the lock.
+    :param head_lock: Initial head of the lock.
+    :param max_lockages: The maximum number of lockages per timestep.
+    :param parameters: The parameters of the lock, see :c:struct:`zsf_param_t`.
+    """
+
+    def __init__(self, sal_lock, head_lock, max_lockages: int = 64, **parameters: float):
+        self._param_t = _param_t_from_kwargs(parameters)
+        self._param_t_names = set(dir(self._param_t))
+        self._max_lockages = max_lockages
+
+        state_t = ffi.new("zsf_phase_state_t *")
+        lib.zsf_initialize_state(self._param_t, state_t, sal_lock, head_lock)
+
+        async_ptr = ffi.new("zsf_async_t **")
+        err = lib.zsf_async_create(state_t, max_lockages, async_ptr)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        self._async = ffi.gc(async_ptr[0], lib.zsf_async_free)
+
+        self._lockages_t = ffi.new("zsf_lockage_t[]", max(max_lockages, 1))
+        self._transports_t = ffi.new("zsf_phase_transports_t *")
+        self._state_t = ffi.new("zsf_phase_state_t *")
+
+    def step(
+        self, dt: float, lockages: Sequence[Dict[str, float]], **parameters: float
+    ) -> Tuple[Dict[str, float], Dict[str, float]]:
+        """
+        Post the lockages of the next timestep, and get the results of the
+        previous one.
+
+        :param dt: Duration of the timestep in seconds.
+        :param lockages: The lockages in this timestep, see
+            :c:struct:`zsf_lockage_t`.
+        :param parameters: Any parameters that should be changed before
+            this timestep. Note that these changes persist.
+
+        :returns: The transports over the previous timestep
+            (:c:struct:`zsf_phase_transports_t`), and the state of the lock
+            at its end (:c:struct:`zsf_phase_state_t`).
+        """
+        for p, v in parameters.items():
+            if p not in self._param_t_names:
+                raise TypeError(f"No such parameter '{p}'")
+            setattr(self._param_t, p, v)
+
+        if len(lockages) > self._max_lockages:
+            raise ValueError(f"More than {self._max_lockages} lockages in one timestep")
+        for i, lockage in enumerate(lockages):
+            self._lockages_t[i] = _new_struct("zsf_lockage_t *", lockage)[0]
+
+        err = lib.zsf_async_step(
+            self._async,
+            self._param_t,
+            dt,
+            len(lockages),
+            self._lockages_t,
+            self._transports_t,
+            self._state_t,
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _struct_to_dict(self._transports_t), _struct_to_dict(self._state_t)
+
+    def finish(self) -> Tuple[Dict[str, float], Dict[str, float]]:
+        """
+        Wait for the results of the last posted timestep.
+        See also :c:func:`zsf_async_finish`.
+        """
+        err = lib.zsf_async_finish(self._async, self._transports_t, self._state_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+        return _struct_to_dict(self._transports_t), _struct_to_dict(self._state_t)
+
+
+class ZSFOutputWriter:
+    """
+    Writes records to a compressed columnar file in a background thread.
+    Records are pushed into a ring buffer per producer, and pushing only
+    waits for the writer when that buffer is full. See also
+    :c:func:`zsf_output_open`.
+
+    :param path: The output file.
+    :param num_producers: The number of producers, e.g. stepping threads.
+    :param ring_capacity: The number of records in the ring buffer of every
+        producer. Has to be a power of two.
+    :param chunk_rows: The number of records per chunk of the file.
+    """
+
+    def __init__(
+        self, path: str, num_producers: int = 1, ring_capacity: int = 4096, chunk_rows: int = 65536
+    ):
+        output_ptr = ffi.new("zsf_output_t **")
+        err = lib.zsf_output_open(
+            str(path).encode("utf-8"), num_producers, ring_capacity, chunk_rows, output_ptr
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        self._output = ffi.gc(output_ptr[0], lib.zsf_output_close)
+
+    def push(self, records: Sequence[Dict[str, Any]], producer: int = 0):
+        """
+        Push records, see :c:struct:`zsf_output_record_t`. Every record is a
+        dictionary with the time, lock and routine, and optionally the
+        transports as returned by e.g. :py:meth:`ZSFUnsteady.step_phase_1`.
+        """
+        if self._output is None:
+            raise ValueError("Output is closed")
+
+        records_t = ffi.new("zsf_output_record_t[]", list(records))
+        err = lib.zsf_output_push(self._output, producer, len(records_t), records_t)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+    def close(self):
+        """
+        Write all pushed records and close the file.
+        """
+        if self._output is None:
+            return
+
+        output, self._output = self._output, None
+        ffi.gc(output, None)
+        err = lib.zsf_output_close(output)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+
+class ZSFOutputFile:
+    """
+    Lazy reader of a file written by :py:class:`ZSFOutputWriter`. Opening the
+    file only reads the directory of its chunks, and columns are decoded
+    when they are accessed. See also :c:func:`zsf_output_reader_open`.
+
+    Columns are returned as an :py:class:`array.array` of doubles, which
+    e.g. :py:func:`numpy.asarray` wraps without a copy.
+    """
+
+    def __init__(self, path: str):
+        reader_ptr = ffi.new("zsf_output_reader_t **")
+        err = lib.zsf_output_reader_open(str(path).encode("utf-8"), reader_ptr)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        self._reader = ffi.gc(reader_ptr[0], lib.zsf_output_reader_free)
+
+        self.columns = tuple(
+            ffi.string(lib.zsf_output_reader_column_name(self._reader, i)).decode("utf-8")
+            for i in range(lib.zsf_output_reader_num_columns(self._reader))
+        )
+        self.num_chunks = lib.zsf_output_reader_num_chunks(self._reader)
+        self.num_rows = sum(rows for rows, _, _ in self.chunk_stats(self.columns[0]))
+
+    def _column_index(self, column: str) -> int:
+        try:
+            return self.columns.index(column)
+        except ValueError:
+            raise KeyError(f"No such column '{column}'") from None
+
+    def chunk_stats(self, column: str) -> List[Tuple[int, float, float]]:
+        """
+        The number of rows, and the minimum and maximum of a column, of
+        every chunk.
+        """
+        c = self._column_index(column)
+        num_rows = ffi.new("int *")
+        min_ = ffi.new("double *")
+        max_ = ffi.new("double *")
+
+        stats = []
+        for i in range(self.num_chunks):
+            lib.zsf_output_reader_chunk_info(self._reader, i, c, num_rows, min_, max_)
+            stats.append((num_rows[0], min_[0], max_[0]))
+        return stats
+
+    def read_chunk(self, chunk: int, column: str) -> array:
+        """
+        Decode one column of one chunk.
+        """
+        c = self._column_index(column)
+        if not 0 <= chunk < self.num_chunks:
+            raise IndexError(f"No such chunk {chunk}")
+
+        num_rows = ffi.new("int *")
+        value = ffi.new("double *")
+        lib.zsf_output_reader_chunk_info(self._reader, chunk, c, num_rows, value, value)
+
+        values = array("d", bytes(8 * num_rows[0]))
+        err = lib.zsf_output_reader_read(
+            self._reader, chunk, c, ffi.from_buffer("double[]", values)
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        return values
+
+    def __getitem__(self, column: str) -> array:
+        values = array("d")
+        for i in range(self.num_chunks):
+            values.extend(self.read_chunk(i, column))
+        return values
+
+    def select(
+        self, columns: Sequence[str], where: str, low: float, high: float
+    ) -> Dict[str, array]:
+        """
+        Read the rows for which column ``where`` lies in [low, high]. Only
+        the chunks that may hold such rows are decoded, based on their
+        minimum and maximum of that column.
+        """
+        selected = {k: array("d") for k in columns}
+
+        for i, (_, min_, max_) in enumerate(self.chunk_stats(where)):
+            if max_ < low or min_ > high:
+                continue
+
+            mask = [low <= v <= high for v in self.read_chunk(i, where)]
+            for k in columns:
+                values = self.read_chunk(i, k)
+                selected[k].extend(v for v, m in zip(values, mask) if m)
+
+        return selected
+
+
+class ZSFService:
+    """
+    A calculation service, shared by all processes on this machine through
+    shared memory. Usually the ``zsf_server`` executable runs the service,
+    but it can also be run from a background thread of this process. See
+    also :c:func:`zsf_service_create`.
+
+    :param name: The name of the service, with which clients connect.
+    :param num_slots: The number of slots for requests.
+    :param slot_capacity: The maximum number of parameters per slot.
+    :param num_threads: The number of calculation threads.
+    :param cache_size: The number of results to keep in the cache.
+    """
+
+    def __init__(
+        self,
+        name: str,
+        num_slots: int = 64,
+        slot_capacity: int = 1024,
+        num_threads: int = 1,
+        cache_size: int = 1 << 16,
+    ):
+        service_ptr = ffi.new("zsf_service_t **")
+        err = lib.zsf_service_create(
+            name.encode("utf-8"), num_slots, slot_capacity, num_threads, cache_size, service_ptr
+        )
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        self._service = ffi.gc(service_ptr[0], lib.zsf_service_free)
+        self._thread = None
+
+    def start(self):
+        """
+        Serve the clients from a background thread.
+        """
+        self._thread = threading.Thread(target=lib.zsf_service_run, args=(self._service,))
+        self._thread.start()
+
+    def stop(self):
+        """
+        Stop serving, and wait for the background thread.
+        """
+        lib.zsf_service_stop(self._service)
+        if self._thread is not None:
+            self._thread.join()
+            self._thread = None
+
+    @property
+    def stats(self) -> Dict[str, float]:
+        """
+        The number of requests, batches and calculations so far, see
+        :c:struct:`zsf_service_stats_t`.
+        """
+        stats_t = ffi.new("zsf_service_stats_t *")
+        lib.zsf_service_stats(self._service, stats_t)
+        return _struct_to_dict(stats_t)
+
+
+class ZSFServiceClient:
+    """
+    A client of a calculation service. See also :c:func:`zsf_client_connect`.
+
+    :param name: The name of the service.
+    """
+
+    def __init__(self, name: str):
+        client_ptr = ffi.new("zsf_client_t **")
+        err = lib.zsf_client_connect(name.encode("utf-8"), client_ptr)
+        if err:
+            raise RuntimeError(_zsf_error_message(err))
+        self._client = ffi.gc(client_ptr[0], lib.zsf_client_disconnect)
+
+    def calc_steady_batch(
+        self, **parameters: Union[float, Sequence[float]]
+    ) -> Dict[str, List[float]]:
+        """
+        Calculate the steady state for many sets of parameters through the
+        service, like :py:func:`zsf_calc_steady_batch` with all outputs.
+        See also :c:func:`zsf_client_calc_steady_batch`.
+        """
+        param_t, n = _param_array_from_kwargs(parameters)
+
+        results_t = ffi.new("zsf_results_t[]", n)
+        errors_t = ffi.new("int[]", n)
+        err = lib.zsf_client_calc_steady_batch(self._client, n, param_t, results_t, errors_t)
+        if err and not any(errors_t[0:n]):
+            raise RuntimeError(_zsf_error_message(err))
+
+        names = [name for name, _ in ffi.typeof("zsf_results_t").fields]
+        values = ffi.unpack(ffi.cast("double *", results_t), n * len(names))
+        nan = float("nan")
+        return {
+            name: [nan if errors_t[i] else values[i * len(names) + j] for i in range(n)]
+            for j, name in enumerate(names)
+        }
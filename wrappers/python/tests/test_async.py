@@ -0,0 +1,83 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFAsync, ZSFUnsteady
+
+
+class TestAsync(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 148.0,
+            "lock_width": 14.0,
+            "lock_bottom": -4.4,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 25.0,
+            "salinity_lake": 5.0,
+        }
+
+    @staticmethod
+    def _lockages(n):
+        return [
+            {"routine": 1, "duration": 300.0},
+            {"routine": 2, "duration": 900.0, "ship_volume_lake_to_sea": 500.0 + 10 * n},
+            {"routine": 3, "duration": 300.0},
+            {"routine": 4, "duration": 900.0, "ship_volume_sea_to_lake": 300.0},
+        ]
+
+    def test_one_step_lag(self):
+        dt = 2400.0
+        num_steps = 20
+
+        lock = ZSFAsync(10.0, 0.0, max_lockages=4, **self.parameters)
+        lock_ref = ZSFUnsteady(10.0, 0.0, **self.parameters)
+
+        initial_state = lock_ref.state
+        previous = None
+        for n in range(num_steps):
+            head_sea = 0.5 + 0.1 * np.sin(n)
+            transports, state = lock.step(dt, self._lockages(n), head_sea=head_sea)
+
+            if n == 0:
+                self.assertEqual(transports["mass_transport_lake"], 0.0)
+                self.assertEqual(state, initial_state)
+            else:
+                self.assertEqual(transports["mass_transport_lake"], previous[0])
+                self.assertEqual(transports["discharge_from_sea"], previous[1] / dt)
+                self.assertEqual(state, previous[2])
+
+            mass_transport_lake = 0.0
+            volume_from_sea = 0.0
+            for lockage in self._lockages(n):
+                ships = {
+                    "ship_volume_lake_to_sea": lockage.get("ship_volume_lake_to_sea", 0.0),
+                    "ship_volume_sea_to_lake": lockage.get("ship_volume_sea_to_lake", 0.0),
+                }
+                step = [
+                    lock_ref.step_phase_1,
+                    lock_ref.step_phase_2,
+                    lock_ref.step_phase_3,
+                    lock_ref.step_phase_4,
+                ][lockage["routine"] - 1]
+                t = step(lockage["duration"], head_sea=head_sea, **ships)
+                mass_transport_lake += t["mass_transport_lake"]
+                volume_from_sea += t["volume_from_sea"]
+            previous = (mass_transport_lake, volume_from_sea, lock_ref.state)
+
+        transports, state = lock.finish()
+        self.assertEqual(transports["mass_transport_lake"], previous[0])
+        self.assertEqual(state, previous[2])
+
+    def test_error_is_reported_one_step_later(self):
+        lock = ZSFAsync(10.0, 0.0, max_lockages=4, **self.parameters)
+
+        # Opening the door at sea side while the lock is at lake level
+        lock.step(600.0, [{"routine": 4, "duration": 600.0}])
+        with self.assertRaises(RuntimeError):
+            lock.step(600.0, [])
+
+    def test_too_many_lockages(self):
+        lock = ZSFAsync(10.0, 0.0, max_lockages=2, **self.parameters)
+        with self.assertRaises(ValueError):
+            lock.step(2400.0, self._lockages(0))
@@ -0,0 +1,77 @@
+import math
+import unittest
+
+import numpy as np
+
+from pyzsf import zsf_calc_steady, zsf_calc_steady_batch, zsf_calc_steady_sweep
+
+
+class TestBatch(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 148.0,
+            "lock_width": 14.0,
+            "lock_bottom": -4.4,
+            "num_cycles": 20.0,
+            "door_time_to_open": 360.0,
+            "leveling_time": 300.0,
+            "salinity_sea": 25.0,
+            "salinity_lake": 5.0,
+        }
+
+    def test_batch_equals_steady(self):
+        heads = [-0.5, 0.0, 0.3, 1.2]
+        ships = [0.0, 500.0, 1000.0, 2000.0]
+        outputs = ["salt_load_lake", "discharge_to_lake"]
+
+        batch = zsf_calc_steady_batch(
+            outputs, head_sea=heads, ship_volume_lake_to_sea=ships, **self.parameters
+        )
+        self.assertEqual(list(batch), outputs)
+
+        for i, (h, s) in enumerate(zip(heads, ships)):
+            r = zsf_calc_steady(head_sea=h, ship_volume_lake_to_sea=s, **self.parameters)
+            for o in outputs:
+                self.assertEqual(batch[o][i], r[o])
+
+    def test_all_outputs(self):
+        batch = zsf_calc_steady_batch(head_sea=[0.0, 0.5], **self.parameters)
+        r = zsf_calc_steady(head_sea=0.5, **self.parameters)
+        self.assertEqual(len(batch), 10)
+        self.assertEqual({k: v[1] for k, v in batch.items()}, {k: r[k] for k in batch})
+
+    def test_sweep_order(self):
+        heads = [0.0, 0.5, 1.0]
+        salinities = [10.0, 20.0]
+        sweep = zsf_calc_steady_sweep(
+            {"head_sea": heads, "salinity_sea": salinities},
+            ["mass_transport_lake"],
+            **self.parameters
+        )
+
+        expected = [
+            zsf_calc_steady(**{**self.parameters, "head_sea": h, "salinity_sea": s})[
+                "mass_transport_lake"
+            ]
+            for h in heads
+            for s in salinities
+        ]
+        np.testing.assert_array_equal(sweep["mass_transport_lake"], expected)
+
+    def test_failed_calculations(self):
+        # The ship does not fit in the lock in the second calculation
+        batch = zsf_calc_steady_batch(
+            ["salt_load_lake"], ship_volume_lake_to_sea=[0.0, 1e7, 0.0], **self.parameters
+        )
+        values = batch["salt_load_lake"]
+        self.assertTrue(math.isfinite(values[0]))
+        self.assertTrue(math.isnan(values[1]))
+        self.assertEqual(values[0], values[2])
+
+    def test_invalid_arguments(self):
+        with self.assertRaises(TypeError):
+            zsf_calc_steady_batch(["no_such_result"], **self.parameters)
+        with self.assertRaises(ValueError):
+            zsf_calc_steady_batch(head_sea=[0.0, 0.5], head_lake=[0.0], **self.parameters)
+        with self.assertRaises(RuntimeError):
+            zsf_calc_steady_sweep({"no_such_parameter": [1.0]}, **self.parameters)
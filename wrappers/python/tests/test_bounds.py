@@ -0,0 +1,77 @@
+import itertools
+import unittest
+
+import numpy as np
+
+from pyzsf import zsf_calc_steady, zsf_calc_steady_bounds
+
+
+class TestBounds(unittest.TestCase):
+    def setUp(self):
+        self.ranges = {
+            "head_sea": (-0.5, 0.5),
+            "salinity_sea": (20.0, 30.0),
+            "flushing_discharge_high_tide": (0.0, 0.2),
+        }
+
+    def assertContains(self, bounds, results, slack=1e-9):
+        for k, v in results.items():
+            lo, hi = bounds[k]
+            tol = slack * max(1.0, abs(v))
+            self.assertGreaterEqual(v, lo - tol, k)
+            self.assertLessEqual(v, hi + tol, k)
+
+    def test_point(self):
+        # The bounds of a single parameter set are (almost) exact
+        parameters = {"head_sea": 0.2, "salinity_sea": 25.0}
+        ranges = {k: (v, v) for k, v in parameters.items()}
+        bounds = zsf_calc_steady_bounds(ranges)
+        results = zsf_calc_steady(rtol=1e-12, atol=1e-12, **parameters)
+
+        self.assertContains(bounds, results)
+        for k, v in results.items():
+            lo, hi = bounds[k]
+            self.assertLess(hi - lo, 1e-8 * max(1.0, abs(v)), k)
+
+    def test_contains(self):
+        bounds = zsf_calc_steady_bounds(self.ranges, max_boxes=16, lock_length=200.0)
+
+        rng = np.random.RandomState(0)
+        corners = itertools.product(*self.ranges.values())
+        samples = zip(*[rng.uniform(lo, hi, 50) for lo, hi in self.ranges.values()])
+        for values in itertools.chain(corners, samples):
+            parameters = dict(zip(self.ranges, values))
+            results = zsf_calc_steady(rtol=1e-12, atol=1e-12, lock_length=200.0, **parameters)
+            self.assertContains(bounds, results)
+
+    def test_splitting(self):
+        widths = []
+        for max_boxes in [1, 8, 64]:
+            lo, hi = zsf_calc_steady_bounds(self.ranges, max_boxes=max_boxes)["salt_load_lake"]
+            widths.append(hi - lo)
+        self.assertLessEqual(widths[1], widths[0])
+        self.assertLess(widths[2], widths[0])
+
+        # Close to the range over a grid of parameters
+        grid = itertools.product(*[np.linspace(lo, hi, 5) for lo, hi in self.ranges.values()])
+        salt_loads = [
+            zsf_calc_steady(rtol=1e-12, atol=1e-12, **dict(zip(self.ranges, values)))[
+                "salt_load_lake"
+            ]
+            for values in grid
+        ]
+        self.assertLess(widths[2], 1.05 * (max(salt_loads) - min(salt_loads)))
+
+    def test_invalid(self):
+        with self.assertRaises(RuntimeError):
+            zsf_calc_steady_bounds({"head_sea": (0.5, -0.5)})
+        with self.assertRaises(RuntimeError):
+            zsf_calc_steady_bounds(self.ranges, max_boxes=0)
+        with self.assertRaises(RuntimeError):
+            zsf_calc_steady_bounds({"ship_volume_lake_to_sea": (0.0, 1e6)})
+        with self.assertRaises(TypeError):
+            zsf_calc_steady_bounds({"head_sea": (0.0, 1.0)}, head_sea=0.5)
+
+
+if __name__ == "__main__":
+    unittest.main()
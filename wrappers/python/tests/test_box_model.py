@@ -0,0 +1,119 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import zsf_calc_steady, zsf_run_box_model
+
+
+class TestBoxModel(unittest.TestCase):
+    def setUp(self):
+        self.lock = {
+            "lock_length": 148.0,
+            "lock_width": 14.0,
+            "lock_bottom": -4.4,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "flushing_discharge_high_tide": 1.0,
+            "flushing_discharge_low_tide": 1.0,
+            "ship_volume_sea_to_lake": 0.0,
+            "ship_volume_lake_to_sea": 0.0,
+        }
+        self.year = 365.25 * 86400.0
+
+    def test_conservation(self):
+        # Without inflows or outflows, the locks only move water and salt
+        # between the compartments.
+        lake = {"volume": 1e8, "salinity": 1.0}
+        sea = {"volume": 5e8, "salinity": 30.0}
+        forcing = {"outflow_lake": [0.0], "outflow_sea": [0.0]}
+
+        r = zsf_run_box_model(
+            [self.lock, {**self.lock, "lock_length": 100.0}],
+            lake,
+            sea,
+            86400.0,
+            forcing,
+            [0.5 * self.year, self.year],
+            tolerance=1e-6,
+        )
+
+        self.assertGreater(r["lake"]["salinity"], lake["salinity"])
+        self.assertLess(r["sea"]["salinity"], sea["salinity"])
+
+        volume = r["lake"]["volume"] + r["sea"]["volume"]
+        salt = (
+            r["lake"]["volume"] * r["lake"]["salinity"] + r["sea"]["volume"] * r["sea"]["salinity"]
+        )
+        np.testing.assert_allclose(volume, lake["volume"] + sea["volume"], rtol=1e-12)
+        np.testing.assert_allclose(
+            salt, lake["volume"] * lake["salinity"] + sea["volume"] * sea["salinity"], rtol=1e-5
+        )
+
+    def test_equilibrium(self):
+        # With a constant river discharge, the lake tends to the salinity at
+        # which the discharge of salt by the river balances the salt load.
+        inflow = 20.0
+        salinity_inflow = 0.2
+
+        r = zsf_run_box_model(
+            [self.lock],
+            {"volume": 2e8, "salinity": 0.2},
+            {"volume": 0.0, "salinity": 30.0},
+            86400.0,
+            {"inflow_lake": [inflow], "salinity_inflow_lake": [salinity_inflow]},
+            np.linspace(0.0, 20 * self.year, 21),
+            tolerance=1e-6,
+            max_time_step=30 * 86400.0,
+        )
+
+        self.assertEqual(r["sea"]["salinity"], 30.0)
+        self.assertEqual(r["lake"]["volume"], 2e8)
+        self.assertTrue(np.all(np.diff(r["salinity_lake"]) >= 0.0))
+
+        salinity_lake = r["lake"]["salinity"]
+        steady = zsf_calc_steady(**self.lock, salinity_lake=salinity_lake, salinity_sea=30.0)
+        self.assertAlmostEqual(r["salt_load_lake"][-1], steady["salt_load_lake"], 6)
+
+        outflow = inflow + steady["discharge_to_lake"] - steady["discharge_from_lake"]
+        balance = inflow * salinity_inflow - outflow * salinity_lake - steady["salt_load_lake"]
+        self.assertLess(abs(balance), 1e-3 * abs(steady["salt_load_lake"]))
+
+    def test_tolerance(self):
+        q = 20.0 + 10.0 * np.sin(2 * np.pi * np.arange(365 * 5) / 365.25)
+
+        def run(tolerance):
+            r = zsf_run_box_model(
+                [self.lock],
+                {"volume": 2e8, "salinity": 0.3},
+                {"volume": 0.0, "salinity": 30.0},
+                86400.0,
+                {"inflow_lake": list(q), "salinity_inflow_lake": [0.2] * len(q)},
+                np.linspace(0.0, 5 * self.year, 61),
+                tolerance=tolerance,
+            )
+            return np.array(r["salinity_lake"])
+
+        reference = run(1e-8)
+        np.testing.assert_allclose(run(1e-4), reference, atol=1e-2)
+        np.testing.assert_allclose(run(1e-6), reference, atol=1e-4)
+
+    def test_invalid_arguments(self):
+        lake = {"volume": 1e7, "salinity": 1.0}
+        sea = {"volume": 0.0, "salinity": 30.0}
+
+        with self.assertRaises(RuntimeError):
+            zsf_run_box_model([self.lock], lake, sea, 86400.0, {"inflow_lake": [1.0]}, [2.0, 1.0])
+        with self.assertRaises(ValueError):
+            zsf_run_box_model(
+                [self.lock], lake, sea, 86400.0, {"inflow_lake": [1.0], "inflow_sea": []}, [1.0]
+            )
+
+        # The lake cannot be saltier than the sea
+        with self.assertRaises(RuntimeError):
+            zsf_run_box_model(
+                [self.lock], {**lake, "salinity": 35.0}, sea, 86400.0, {"inflow_lake": [1.0]}, [1.0]
+            )
+
+        # The flushing drains the lake in about four months
+        with self.assertRaises(RuntimeError):
+            zsf_run_box_model([self.lock], lake, sea, 86400.0, {"outflow_lake": [0.0]}, [self.year])
@@ -0,0 +1,151 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFForcing, ZSFLockageGenerator, ZSFUnsteady, zsf_calc_steady_batch
+
+SECONDS_PER_YEAR = 365.25 * 86400.0
+
+
+class TestForcing(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 300.0,
+            "lock_width": 25.0,
+            "lock_bottom": -7.0,
+            "head_lake": 0.0,
+            "salinity_lake": 1.0,
+            "temperature_lake": 12.0,
+        }
+
+        # M2, S2 and K1, with made-up phases
+        self.constituents = [
+            {"amplitude": 0.8, "phase": 40.0, "speed": 28.9841042},
+            {"amplitude": 0.2, "phase": 95.0, "speed": 30.0},
+            {"amplitude": 0.1, "phase": 210.0, "speed": 15.0410686},
+        ]
+        self.seasonal = {
+            "salinity_sea": {
+                "mean": 25.0,
+                "amplitude": 3.0,
+                "t_max": 60 * 86400.0,
+                "amplitude_semiannual": 0.5,
+                "t_max_semiannual": 20 * 86400.0,
+            },
+            "temperature_sea": {
+                "mean": 11.0,
+                "amplitude": 7.0,
+                "t_max": 220 * 86400.0,
+                "amplitude_semiannual": 0.0,
+                "t_max_semiannual": 0.0,
+            },
+        }
+
+    def test_eval(self):
+        forcing = ZSFForcing(self.constituents, 0.1, self.seasonal)
+
+        t0, dt, n = 1.5e9, 600.0, 1000
+        values = forcing.eval(t0, dt, n)
+        self.assertEqual(set(values), {"head_sea", "salinity_sea", "temperature_sea"})
+
+        t = t0 + dt * np.arange(n)
+        head_sea = 0.1 + sum(
+            c["amplitude"] * np.cos(np.radians(c["speed"] * t / 3600.0 - c["phase"]))
+            for c in self.constituents
+        )
+        np.testing.assert_allclose(values["head_sea"], head_sea, rtol=0.0, atol=1e-10)
+
+        omega = 2 * np.pi / SECONDS_PER_YEAR
+        c = self.seasonal["salinity_sea"]
+        salinity_sea = (
+            c["mean"]
+            + c["amplitude"] * np.cos(omega * (t - c["t_max"]))
+            + c["amplitude_semiannual"] * np.cos(2 * omega * (t - c["t_max_semiannual"]))
+        )
+        np.testing.assert_allclose(values["salinity_sea"], salinity_sea, rtol=0.0, atol=1e-10)
+
+        # A curve peaks at t_max
+        year = forcing.eval(0.0, 86400.0, 365)
+        self.assertEqual(int(np.argmax(year["temperature_sea"])), 220)
+
+    def test_mean_from_parameters(self):
+        curve = {"mean": -999.0, "amplitude": 2.0, "t_max": 0.0}
+        forcing = ZSFForcing(mean_sea_level=None, seasonal={"salinity_lake": curve})
+
+        values = forcing.eval(0.0, SECONDS_PER_YEAR / 2, 2, salinity_lake=4.0)
+        self.assertEqual(set(values), {"salinity_lake"})
+        np.testing.assert_allclose(values["salinity_lake"], [6.0, 2.0])
+
+    def test_calc_steady(self):
+        forcing = ZSFForcing(self.constituents, 0.1, self.seasonal)
+
+        # Spans several blocks, with a partial one at the end
+        t0, dt, n = 0.0, 3600.0, 200
+        values = forcing.eval(t0, dt, n)
+        expected = zsf_calc_steady_batch(**self.parameters, **values)
+
+        results = forcing.calc_steady(t0, dt, n, **self.parameters)
+        for k, v in expected.items():
+            np.testing.assert_allclose(results[k], v, rtol=1e-12)
+
+        subset = forcing.calc_steady(t0, dt, n, ["salt_load_lake"], **self.parameters)
+        self.assertEqual(list(subset), ["salt_load_lake"])
+        np.testing.assert_allclose(subset["salt_load_lake"], expected["salt_load_lake"])
+
+    def test_step_lockages(self):
+        generator = ZSFLockageGenerator(
+            {"ships_per_day_lake": 20.0, "ships_per_day_sea": 20.0, "annual_growth": 0.0},
+            [{"share": 1.0, "volume_mean": 2000.0, "volume_std": 500.0, "volume_max": 1e9}],
+            {
+                "leveling_time": 300.0,
+                "door_time": 600.0,
+                "time_per_ship": 120.0,
+                "max_wait": 3600.0,
+                "max_ships": 6.0,
+                "max_ship_volume": 20000.0,
+                "flushing_when_idle": 1.0,
+                "max_flushing_time": 1800.0,
+            },
+        )
+        lockages = generator.generate(3 * 86400.0)
+        forcing = ZSFForcing(self.constituents, 0.1, self.seasonal)
+
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        transports = forcing.step_lockages(lock, lockages)
+
+        # Replay the lockages one by one, with the parameters evaluated at the
+        # time the lock levels to, or at the start of the lockage
+        ref = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        head_lock = 0.0
+        for i, lockage in enumerate(lockages):
+            routine = int(lockage["routine"])
+            t = lockage["time"]
+            if routine in (1, 3):
+                t += lockage["duration"]
+            values = {k: v[0] for k, v in forcing.eval(t, 0.0, 1).items()}
+            if routine == 4:
+                values["head_sea"] = head_lock
+            ref._set_parameters(**values)
+
+            tp = ref.step_lockages([lockage])
+            head_lock = ref.state["head_lock"]
+            for k, v in tp.items():
+                self.assertAlmostEqual(transports[k][i], v[0], delta=1e-9 * (1.0 + abs(v[0])))
+
+        for k, v in ref.state.items():
+            self.assertAlmostEqual(lock.state[k], v, delta=1e-9 * (1.0 + abs(v)))
+
+    def test_invalid(self):
+        curve = {"mean": 1.0, "amplitude": 1.0, "t_max": 0.0}
+        with self.assertRaises(RuntimeError):
+            ZSFForcing(seasonal={"no_such_parameter": curve})
+        with self.assertRaises(RuntimeError):
+            ZSFForcing(seasonal={"head_sea": curve})
+        with self.assertRaises(RuntimeError):
+            ZSFForcing(self.constituents, None)
+        with self.assertRaises(TypeError):
+            ZSFForcing([{"amplitude": 1.0, "period": 12.0}])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,166 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFLockageGenerator, ZSFUnsteady
+
+
+class TestLockages(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 300.0,
+            "lock_width": 25.0,
+            "lock_bottom": -7.0,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 28.0,
+            "salinity_lake": 1.0,
+            "flushing_discharge_high_tide": 2.0,
+            "flushing_discharge_low_tide": 2.0,
+        }
+
+        self.traffic = {"ships_per_day_lake": 30.0, "ships_per_day_sea": 30.0, "annual_growth": 0.0}
+        self.fleet = [
+            {"share": 0.7, "volume_mean": 1500.0, "volume_std": 500.0, "volume_max": 1e9},
+            {"share": 0.3, "volume_mean": 6000.0, "volume_std": 2000.0, "volume_max": 1e9},
+        ]
+        self.policy = {
+            "leveling_time": 300.0,
+            "door_time": 600.0,
+            "time_per_ship": 120.0,
+            "max_wait": 3600.0,
+            "max_ships": 6.0,
+            "max_ship_volume": 20000.0,
+            "flushing_when_idle": 1.0,
+            "max_flushing_time": 1800.0,
+        }
+
+    def _generator(self, seed=0, **traffic):
+        return ZSFLockageGenerator({**self.traffic, **traffic}, self.fleet, self.policy, seed)
+
+    def test_sequence_is_consistent(self):
+        lockages = self._generator().generate(30 * 86400.0)
+        self.assertGreater(len(lockages), 1000)
+
+        side = "lake"
+        for prev, cur in zip(lockages, lockages[1:]):
+            self.assertGreaterEqual(cur["time"], prev["time"] + prev["duration"] - 1e-6)
+
+        for lockage in lockages:
+            routine = int(lockage["routine"])
+            self.assertGreater(lockage["duration"], 0.0)
+
+            if routine == 1:
+                side = "lake"
+            elif routine == 3:
+                side = "sea"
+            elif routine in (2, -2):
+                self.assertEqual(side, "lake")
+            elif routine in (4, -4):
+                self.assertEqual(side, "sea")
+
+            if routine != 2:
+                self.assertEqual(lockage["ship_volume_lake_to_sea"], 0.0)
+            if routine != 4:
+                self.assertEqual(lockage["ship_volume_sea_to_lake"], 0.0)
+            self.assertLessEqual(lockage["num_ships"], self.policy["max_ships"])
+
+    def test_reproducible(self):
+        a = self._generator(seed=3).generate(5 * 86400.0)
+        b = self._generator(seed=3).generate(5 * 86400.0)
+        c = self._generator(seed=4).generate(5 * 86400.0)
+        self.assertEqual(a, b)
+        self.assertNotEqual(a, c)
+
+    def test_run_equals_stepping(self):
+        t_end = 10 * 86400.0
+
+        # Streamed through the phase engine in C
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        results = self._generator().run(lock, t_end)
+
+        # Stepping through the same lockages one by one
+        lock_ref = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        mass_transport_lake = 0.0
+        volume_to_sea = 0.0
+        for lockage in self._generator().generate(t_end):
+            routine = int(lockage["routine"])
+            ships = {
+                "ship_volume_lake_to_sea": lockage["ship_volume_lake_to_sea"],
+                "ship_volume_sea_to_lake": lockage["ship_volume_sea_to_lake"],
+            }
+            step = {
+                1: lock_ref.step_phase_1,
+                2: lock_ref.step_phase_2,
+                3: lock_ref.step_phase_3,
+                4: lock_ref.step_phase_4,
+                -2: lock_ref.step_flush_doors_closed,
+                -4: lock_ref.step_flush_doors_closed,
+            }[routine]
+            transports = step(lockage["duration"], **ships)
+            mass_transport_lake += transports["mass_transport_lake"]
+            volume_to_sea += transports["volume_to_sea"]
+
+        np.testing.assert_allclose(results["mass_transport_lake"], mass_transport_lake, rtol=1e-12)
+        np.testing.assert_allclose(results["discharge_to_sea"], volume_to_sea / t_end, rtol=1e-12)
+        self.assertEqual(lock.state, lock_ref.state)
+
+    def test_runs_continue(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        generator = self._generator()
+        first = generator.run(lock, 10 * 86400.0)
+        second = generator.run(lock, 20 * 86400.0)
+
+        lock_ref = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        both = self._generator().run(lock_ref, 20 * 86400.0)
+
+        np.testing.assert_allclose(
+            first["mass_transport_lake"] + second["mass_transport_lake"],
+            both["mass_transport_lake"],
+            rtol=1e-10,
+        )
+        self.assertEqual(lock.state, lock_ref.state)
+
+    def test_traffic_growth(self):
+        year = 365.25 * 86400.0
+        generator = self._generator(annual_growth=0.05)
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+
+        generator.run(lock, year)
+        ships_first_year = generator.stats["num_ships"]
+
+        generator.run(lock, 10 * year)
+        ships_before = generator.stats["num_ships"]
+        generator.run(lock, 11 * year)
+        ships_last_year = generator.stats["num_ships"] - ships_before
+
+        np.testing.assert_allclose(ships_last_year / ships_first_year, 1.05**10, rtol=0.05)
+
+    def test_traffic_decline(self):
+        # With a declining traffic, the total number of ships is finite
+        year = 365.25 * 86400.0
+        generator = self._generator(annual_growth=-0.5, ships_per_day_lake=10.0)
+        lockages = generator.generate(1000 * year)
+        self.assertGreater(len(lockages), 0)
+        self.assertEqual(generator.generate(2000 * year), [])
+
+        growth = np.log1p(-0.5) / year
+        expected = (10.0 + 30.0) / 86400.0 / -growth
+        np.testing.assert_allclose(generator.stats["num_ships"], expected, rtol=0.05)
+
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        self._generator(annual_growth=-0.5).run(lock, 1000 * year)
+
+    def test_fleet_mix(self):
+        lockages = self._generator().generate(365 * 86400.0)
+        num_ships = sum(lockage["num_ships"] for lockage in lockages)
+        volume = sum(
+            lockage["ship_volume_lake_to_sea"] + lockage["ship_volume_sea_to_lake"]
+            for lockage in lockages
+        )
+        np.testing.assert_allclose(volume / num_ships, 0.7 * 1500.0 + 0.3 * 6000.0, rtol=0.02)
+        np.testing.assert_allclose(num_ships / 365.0, 60.0, rtol=0.02)
+
+    def test_invalid_policy(self):
+        with self.assertRaises(RuntimeError):
+            ZSFLockageGenerator(self.traffic, self.fleet, {**self.policy, "leveling_time": 0.0})
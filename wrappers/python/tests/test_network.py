@@ -0,0 +1,120 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFLockageGenerator, ZSFNetwork, ZSFUnsteady
+
+
+class TestNetwork(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 300.0,
+            "lock_width": 25.0,
+            "lock_bottom": -7.0,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 28.0,
+            "salinity_lake": 1.0,
+            "flushing_discharge_high_tide": 2.0,
+            "flushing_discharge_low_tide": 2.0,
+        }
+
+        self.fleet = [
+            {"share": 0.7, "volume_mean": 1500.0, "volume_std": 500.0, "volume_max": 1e9},
+            {"share": 0.3, "volume_mean": 6000.0, "volume_std": 2000.0, "volume_max": 1e9},
+        ]
+        self.policy = {
+            "leveling_time": 300.0,
+            "door_time": 600.0,
+            "time_per_ship": 120.0,
+            "max_wait": 3600.0,
+            "max_ships": 6.0,
+            "max_ship_volume": 20000.0,
+            "flushing_when_idle": 1.0,
+            "max_flushing_time": 1800.0,
+        }
+
+        # Locks with different traffic, and thus different schedules
+        self.ships_per_day = [10.0, 30.0, 60.0]
+
+    def _generators(self):
+        return [
+            ZSFLockageGenerator(
+                {"ships_per_day_lake": n, "ships_per_day_sea": n, "annual_growth": 0.0},
+                self.fleet,
+                self.policy,
+                seed,
+            )
+            for seed, n in enumerate(self.ships_per_day)
+        ]
+
+    def _locks(self):
+        return [ZSFUnsteady(15.0, 0.0, **self.parameters) for _ in self.ships_per_day]
+
+    def test_matches_lockages(self):
+        dt = 900.0
+        num_outputs = 192
+        t_end = num_outputs * dt
+
+        network = ZSFNetwork(self._locks(), self._generators(), dt)
+        outputs = [network.advance() for _ in range(num_outputs)]
+
+        for i, generator in enumerate(self._generators()):
+            lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+            lockages = generator.generate(t_end)
+            transports = lock.step_lockages(lockages)
+            self.assertEqual(network.state(i), lock.state)
+
+            # Spread the transports of every phase evenly over its duration
+            edges = dt * np.arange(num_outputs + 1)
+            expected = {k: np.zeros(num_outputs) for k in ["mass_transport_lake", "volume_to_sea"]}
+            for j, lockage in enumerate(lockages):
+                t0 = lockage["time"]
+                t1 = t0 + lockage["duration"]
+                overlap = np.clip(np.minimum(edges[1:], t1) - np.maximum(edges[:-1], t0), 0.0, None)
+                for k, v in expected.items():
+                    v += transports[k][j] * overlap / lockage["duration"]
+
+            for k, v in expected.items():
+                actual = np.array([output[i][k] for output in outputs])
+                np.testing.assert_allclose(actual, v, rtol=1e-9, atol=1e-6)
+
+            discharges = np.array([output[i]["discharge_to_sea"] for output in outputs])
+            np.testing.assert_allclose(discharges, expected["volume_to_sea"] / dt, rtol=1e-9)
+
+    def test_output_interval(self):
+        # The totals do not depend on the output interval
+        t_end = 2 * 86400.0
+        totals = []
+        for dt in [60.0, 3600.0, 86400.0]:
+            network = ZSFNetwork(self._locks(), self._generators(), dt)
+            outputs = [network.advance() for _ in range(int(t_end / dt))]
+            totals.append([sum(o[i]["mass_transport_lake"] for o in outputs) for i in range(3)])
+        np.testing.assert_allclose(totals[0], totals[1], rtol=1e-10)
+        np.testing.assert_allclose(totals[0], totals[2], rtol=1e-10)
+
+    def test_set_parameters(self):
+        a = ZSFNetwork(self._locks(), self._generators(), 3600.0)
+        b = ZSFNetwork(self._locks(), self._generators(), 3600.0)
+        b.set_parameters(1, flushing_discharge_high_tide=0.0, flushing_discharge_low_tide=0.0)
+
+        outputs_a = [a.advance() for _ in range(24)]
+        outputs_b = [b.advance() for _ in range(24)]
+        for lock in [0, 2]:
+            self.assertEqual([o[lock] for o in outputs_a], [o[lock] for o in outputs_b])
+        flushing_a = sum(o[1]["volume_from_lake"] for o in outputs_a)
+        flushing_b = sum(o[1]["volume_from_lake"] for o in outputs_b)
+        self.assertLess(flushing_b, flushing_a)
+
+        with self.assertRaises(TypeError):
+            b.set_parameters(0, no_such_parameter=1.0)
+
+    def test_invalid(self):
+        with self.assertRaises(RuntimeError):
+            ZSFNetwork(self._locks(), self._generators(), 0.0)
+        with self.assertRaises(ValueError):
+            ZSFNetwork(self._locks(), self._generators()[:2], 3600.0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,153 @@
+import os
+import tempfile
+import threading
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFOutputFile, ZSFOutputWriter, ZSFUnsteady
+
+
+def _records(lock, times):
+    return [
+        {
+            "time": t,
+            "lock": lock,
+            "routine": 1 + i % 4,
+            "transports": {"mass_transport_lake": 1000.0 + np.sin(t / 3600.0)},
+        }
+        for i, t in enumerate(times)
+    ]
+
+
+class TestOutput(unittest.TestCase):
+    def setUp(self):
+        self.tmpdir = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmpdir.name, "output.zsf")
+
+    def tearDown(self):
+        self.tmpdir.cleanup()
+
+    def test_roundtrip(self):
+        # Small ring buffers and chunks, so that the producers regularly have
+        # to wait for the writer, and the records span many chunks.
+        num_producers = 4
+        times = 60.0 * np.arange(5000)
+
+        with ZSFOutputWriter(self.path, num_producers, ring_capacity=8, chunk_rows=100) as w:
+
+            def produce(producer):
+                records = _records(producer, times)
+                for start in range(0, len(records), 50):
+                    end = start + 50
+                    w.push(records[start:end], producer)
+
+            threads = [threading.Thread(target=produce, args=(i,)) for i in range(num_producers)]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+
+        f = ZSFOutputFile(self.path)
+        self.assertEqual(f.columns[:4], ("time", "lock", "routine", "mass_transport_lake"))
+        self.assertEqual(f.num_rows, num_producers * len(times))
+        self.assertEqual(f.num_chunks, num_producers * len(times) // 100)
+
+        lock = np.asarray(f["lock"])
+        time = np.asarray(f["time"])
+        mass_transport_lake = np.asarray(f["mass_transport_lake"])
+        self.assertTrue(np.all(np.asarray(f["volume_to_sea"]) == 0.0))
+
+        # The records of every producer are in the order they were pushed
+        for i in range(num_producers):
+            np.testing.assert_array_equal(time[lock == i], times)
+            np.testing.assert_array_equal(
+                mass_transport_lake[lock == i], 1000.0 + np.sin(times / 3600.0)
+            )
+
+    def test_transports(self):
+        lock = ZSFUnsteady(15.0, 0.0, head_sea=0.5, salinity_sea=25.0, salinity_lake=5.0)
+        records = []
+        for i in range(100):
+            step = [lock.step_phase_1, lock.step_phase_2, lock.step_phase_3, lock.step_phase_4]
+            transports = step[i % 4](300.0)
+            records.append({"time": 300.0 * i, "routine": 1 + i % 4, "transports": transports})
+
+        with ZSFOutputWriter(self.path) as w:
+            w.push(records)
+
+        f = ZSFOutputFile(self.path)
+        self.assertEqual(f.num_chunks, 1)
+        for k in records[0]["transports"]:
+            np.testing.assert_array_equal(f[k], [r["transports"][k] for r in records])
+
+    def test_compression(self):
+        times = 60.0 * np.arange(100000)
+        with ZSFOutputWriter(self.path) as w:
+            w.push(_records(0, times))
+
+        raw_size = len(times) * 15 * 8
+        self.assertLess(os.path.getsize(self.path), 0.3 * raw_size)
+
+    def test_select(self):
+        times = 60.0 * np.arange(1000)
+        with ZSFOutputWriter(self.path, chunk_rows=100) as w:
+            w.push(_records(0, times))
+
+        f = ZSFOutputFile(self.path)
+        stats = f.chunk_stats("time")
+        self.assertEqual(len(stats), 10)
+        self.assertEqual(stats[3], (100, times[300], times[399]))
+
+        selected = f.select(["time", "routine"], "time", times[250], times[420])
+        np.testing.assert_array_equal(selected["time"], times[250:421])
+        np.testing.assert_array_equal(selected["routine"], 1 + np.arange(250, 421) % 4)
+
+    def test_truncated(self):
+        times = 60.0 * np.arange(1000)
+        with ZSFOutputWriter(self.path, chunk_rows=100) as w:
+            w.push(_records(0, times))
+
+        # An aborted run leaves an incomplete last chunk
+        size = os.path.getsize(self.path)
+        with open(self.path, "r+b") as fp:
+            fp.truncate(size - 10)
+
+        f = ZSFOutputFile(self.path)
+        self.assertEqual(f.num_rows, 900)
+        np.testing.assert_array_equal(f["time"], times[:900])
+
+    def test_truncated_anywhere(self):
+        with ZSFOutputWriter(self.path, chunk_rows=100):
+            pass
+        header_size = os.path.getsize(self.path)
+
+        times = 60.0 * np.arange(300)
+        with ZSFOutputWriter(self.path, chunk_rows=100) as w:
+            w.push(_records(0, times))
+        with open(self.path, "rb") as fp:
+            data = fp.read()
+
+        # Wherever the run was aborted, in a chunk header, column info or the
+        # encoded columns, all chunks before it are read
+        truncated = os.path.join(self.tmpdir.name, "truncated.zsf")
+        num_rows = []
+        for size in range(header_size, len(data) + 1):
+            with open(truncated, "wb") as fp:
+                fp.write(data[:size])
+            f = ZSFOutputFile(truncated)
+            np.testing.assert_array_equal(f["time"], times[: f.num_rows])
+            num_rows.append(f.num_rows)
+        self.assertEqual(sorted(set(num_rows)), [0, 100, 200, 300])
+        self.assertEqual(num_rows, sorted(num_rows))
+
+    def test_invalid(self):
+        with self.assertRaises(RuntimeError):
+            ZSFOutputWriter(self.path, ring_capacity=100)
+        with self.assertRaises(RuntimeError):
+            ZSFOutputFile(os.path.join(self.tmpdir.name, "missing.zsf"))
+
+        with open(self.path, "wb") as fp:
+            fp.write(b"not an output file, but long enough to hold a header")
+        with self.assertRaises(RuntimeError):
+            ZSFOutputFile(self.path)
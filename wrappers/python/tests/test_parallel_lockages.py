@@ -0,0 +1,83 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFLockageGenerator, ZSFUnsteady
+
+
+class TestParallelLockages(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 300.0,
+            "lock_width": 25.0,
+            "lock_bottom": -7.0,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 28.0,
+            "salinity_lake": 1.0,
+            "rtol": 1e-10,
+            "atol": 1e-12,
+        }
+
+        traffic = {"ships_per_day_lake": 30.0, "ships_per_day_sea": 30.0, "annual_growth": 0.0}
+        fleet = [{"share": 1.0, "volume_mean": 3000.0, "volume_std": 1000.0, "volume_max": 1e9}]
+        policy = {
+            "leveling_time": 300.0,
+            "door_time": 600.0,
+            "time_per_ship": 120.0,
+            "max_wait": 3600.0,
+            "max_ships": 6.0,
+            "max_ship_volume": 20000.0,
+            "flushing_when_idle": 1.0,
+            "max_flushing_time": 1800.0,
+        }
+        self.lockages = ZSFLockageGenerator(traffic, fleet, policy).generate(120 * 86400.0)
+
+    def _compare(self, **parameters):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters, **parameters)
+        reference = lock.step_lockages(self.lockages)
+
+        for num_threads in [2, 3, 8]:
+            lock_parallel = ZSFUnsteady(15.0, 0.0, **self.parameters, **parameters)
+            transports = lock_parallel.step_lockages(self.lockages, num_threads)
+
+            for k, v in reference.items():
+                np.testing.assert_allclose(transports[k], v, rtol=1e-8, atol=1e-8)
+            for k, v in lock.state.items():
+                np.testing.assert_allclose(lock_parallel.state[k], v, rtol=1e-10)
+
+    def test_matches_sequential(self):
+        self.assertGreater(len(self.lockages), 8 * 1024)
+        self._compare()
+
+    def test_matches_sequential_countermeasures(self):
+        # The lock forgets its salinity much slower with an effective bubble
+        # screen and no flushing.
+        self._compare(density_current_factor_sea=0.1, density_current_factor_lake=0.1)
+        self._compare(
+            flushing_discharge_high_tide=2.0,
+            flushing_discharge_low_tide=2.0,
+            distance_door_bubble_screen_sea=-10.0,
+            sill_height_lake=1.0,
+        )
+
+    def test_short_sequence(self):
+        # Too short to split, so the same as sequential stepping
+        lockages = self.lockages[:100]
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        lock_parallel = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        self.assertEqual(lock.step_lockages(lockages), lock_parallel.step_lockages(lockages, 4))
+        self.assertEqual(lock.state, lock_parallel.state)
+
+    def test_errors(self):
+        lockages = list(self.lockages)
+        lockages[len(lockages) // 2] = {**lockages[len(lockages) // 2], "routine": 5.0}
+
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        state = lock.state
+        with self.assertRaises(RuntimeError):
+            lock.step_lockages(lockages, 4)
+        self.assertEqual(lock.state, state)
+
+        with self.assertRaises(RuntimeError):
+            lock.step_lockages(self.lockages, 0)
@@ -0,0 +1,104 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFUnsteady, zsf_calc_periodic, zsf_calc_steady
+
+
+class TestPeriodic(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 240.0,
+            "lock_width": 12.0,
+            "lock_bottom": -4.0,
+            "num_cycles": 24.0,
+            "door_time_to_open": 300.0,
+            "leveling_time": 300.0,
+            "head_lake": 0.0,
+            "salinity_sea": 25.0,
+            "salinity_lake": 5.0,
+            "flushing_discharge_high_tide": 5.0,
+            "flushing_discharge_low_tide": 2.0,
+            "rtol": 1e-8,
+            "atol": 1e-10,
+        }
+
+        # A day with 24 locking cycles, as in the steady calculation
+        self.t_period = 24 * 3600.0
+        t_cycle = self.t_period / 24
+        t_open = 0.5 * t_cycle - 300.0 - 300.0
+        self.cycles = [
+            {"time": i * t_cycle, "t_level": 300.0, "t_open_lake": t_open, "t_open_sea": t_open}
+            for i in range(24)
+        ]
+
+    def test_constant_head_equals_steady(self):
+        for head_sea in (-0.5, 0.5):
+            steady = zsf_calc_steady(**self.parameters, head_sea=head_sea)
+            periodic = zsf_calc_periodic(self.t_period, [head_sea], self.cycles, **self.parameters)
+
+            for k, v in steady.items():
+                if k.startswith("mass_transport_"):
+                    # Mass transports are per period instead of per cycle
+                    v *= len(self.cycles)
+                np.testing.assert_allclose(periodic[k], v, rtol=1e-6, err_msg=k)
+
+    def test_tide_equals_spin_up(self):
+        # Semi-diurnal tide, which changes the direction of leveling and the
+        # flushing discharge within a day
+        t = np.linspace(0.0, self.t_period, 96, endpoint=False)
+        head_sea = 1.0 * np.sin(2 * np.pi * t / (self.t_period / 2))
+
+        periodic = zsf_calc_periodic(self.t_period, head_sea, self.cycles, **self.parameters)
+
+        # Brute force spin-up over many days
+        def head_at(time):
+            return np.interp(time % self.t_period, t, head_sea, period=self.t_period)
+
+        c = ZSFUnsteady(15.0, head_at(-600.0), **self.parameters)
+        for _ in range(20):
+            mass_transport_lake = 0.0
+            for cycle in self.cycles:
+                h = head_at(cycle["time"] + 300.0)
+                mass_transport_lake += c.step_phase_1(300.0, head_sea=h)["mass_transport_lake"]
+                mass_transport_lake += c.step_phase_2(cycle["t_open_lake"])["mass_transport_lake"]
+                h = head_at(cycle["time"] + 600.0 + cycle["t_open_lake"])
+                mass_transport_lake += c.step_phase_3(300.0, head_sea=h)["mass_transport_lake"]
+                mass_transport_lake += c.step_phase_4(cycle["t_open_sea"])["mass_transport_lake"]
+
+        np.testing.assert_allclose(
+            periodic["state"]["salinity_lock"], c.state["salinity_lock"], rtol=1e-6
+        )
+        np.testing.assert_allclose(periodic["mass_transport_lake"], mass_transport_lake, rtol=1e-6)
+        np.testing.assert_allclose(
+            sum(x["mass_transport_lake"] for x in periodic["cycles"]), mass_transport_lake, rtol=1e-6
+        )
+
+    def test_salinity_series_above_parameter(self):
+        # A single short locking per period exchanges little water, so the
+        # salinity of the lock converges slowly. The salinity at sea of the
+        # series, and not the parameter, bounds the periodic salinity.
+        cycles = [{"time": 0.0, "t_level": 300.0, "t_open_lake": 0.1, "t_open_sea": 0.1}]
+        periodic = zsf_calc_periodic(
+            self.t_period, [0.5], cycles, salinity_sea_series=[30.0], **self.parameters
+        )
+
+        parameters = {**self.parameters, "salinity_sea": 30.0}
+        c = ZSFUnsteady(15.0, 0.5, **parameters)
+        for _ in range(2000):
+            c.step_phase_1(300.0, head_sea=0.5)
+            c.step_phase_2(0.1)
+            c.step_phase_3(300.0, head_sea=0.5)
+            c.step_phase_4(0.1)
+
+        np.testing.assert_allclose(
+            periodic["state"]["salinity_lock"], c.state["salinity_lock"], rtol=1e-9
+        )
+
+    def test_not_converged(self):
+        # No salinity is ever within negative tolerances, so the iteration
+        # runs out of iterations
+        parameters = {**self.parameters, "rtol": -1.0, "atol": -1.0}
+
+        with self.assertRaisesRegex(RuntimeError, "did not converge"):
+            zsf_calc_periodic(self.t_period, [0.5], self.cycles, **parameters)
@@ -0,0 +1,121 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFLockageGenerator, ZSFUnsteady, zsf_replay_variants
+
+
+class TestReplayVariants(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 300.0,
+            "lock_width": 25.0,
+            "lock_bottom": -7.0,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 28.0,
+            "salinity_lake": 1.0,
+        }
+
+        traffic = {"ships_per_day_lake": 30.0, "ships_per_day_sea": 30.0, "annual_growth": 0.0}
+        fleet = [
+            {"share": 0.7, "volume_mean": 1500.0, "volume_std": 500.0, "volume_max": 1e9},
+            {"share": 0.3, "volume_mean": 6000.0, "volume_std": 2000.0, "volume_max": 1e9},
+        ]
+        policy = {
+            "leveling_time": 300.0,
+            "door_time": 600.0,
+            "time_per_ship": 120.0,
+            "max_wait": 3600.0,
+            "max_ships": 6.0,
+            "max_ship_volume": 20000.0,
+            "flushing_when_idle": 1.0,
+            "max_flushing_time": 1800.0,
+        }
+        self.lockages = ZSFLockageGenerator(traffic, fleet, policy).generate(10 * 86400.0)
+
+        self.variants = [
+            {},
+            {"flushing_discharge_high_tide": 2.0, "flushing_discharge_low_tide": 2.0},
+            {"density_current_factor_sea": 0.25, "density_current_factor_lake": 0.25},
+            {"distance_door_bubble_screen_sea": 20.0, "distance_door_bubble_screen_lake": -20.0},
+            {"sill_height_sea": 1.5, "sill_height_lake": 1.0},
+            {
+                "flushing_discharge_high_tide": 1.0,
+                "density_current_factor_sea": 0.5,
+                "distance_door_bubble_screen_sea": -10.0,
+                "sill_height_lake": 0.5,
+            },
+        ]
+
+    def _step(self, lock):
+        # Stepping through the lockages one by one
+        totals = {"mass_transport_lake": 0.0, "mass_transport_sea": 0.0, "volume_to_sea": 0.0}
+        for lockage in self.lockages:
+            ships = {
+                "ship_volume_lake_to_sea": lockage["ship_volume_lake_to_sea"],
+                "ship_volume_sea_to_lake": lockage["ship_volume_sea_to_lake"],
+            }
+            step = {
+                1: lock.step_phase_1,
+                2: lock.step_phase_2,
+                3: lock.step_phase_3,
+                4: lock.step_phase_4,
+                -2: lock.step_flush_doors_closed,
+                -4: lock.step_flush_doors_closed,
+            }[int(lockage["routine"])]
+            transports = step(lockage["duration"], **ships)
+            for k in totals:
+                totals[k] += transports[k]
+        return totals
+
+    def test_equals_separate_replays(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        state = lock.state
+        results, locks = zsf_replay_variants(lock, self.lockages, self.variants)
+        self.assertEqual(lock.state, state)
+
+        last = self.lockages[-1]
+        duration = last["time"] + last["duration"] - self.lockages[0]["time"]
+
+        for variant, r, lock_variant in zip(self.variants, results, locks):
+            lock_ref = ZSFUnsteady(15.0, 0.0, **self.parameters, **variant)
+            totals = self._step(lock_ref)
+
+            np.testing.assert_allclose(
+                r["mass_transport_lake"], totals["mass_transport_lake"], rtol=1e-12
+            )
+            np.testing.assert_allclose(
+                r["mass_transport_sea"], totals["mass_transport_sea"], rtol=1e-12
+            )
+            np.testing.assert_allclose(
+                r["discharge_to_sea"], totals["volume_to_sea"] / duration, rtol=1e-12
+            )
+            for k, v in lock_ref.state.items():
+                np.testing.assert_allclose(lock_variant.state[k], v, rtol=1e-12)
+
+        # The countermeasures make a difference
+        salt_loads = [r["salt_load_lake"] for r in results]
+        self.assertEqual(len(set(salt_loads)), len(salt_loads))
+
+    def test_continue(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        _, locks = zsf_replay_variants(lock, self.lockages, self.variants[1:2])
+
+        lock_ref = ZSFUnsteady(15.0, 0.0, **self.parameters, **self.variants[1])
+        self._step(lock_ref)
+
+        self.assertEqual(locks[0].step_phase_1(300.0), lock_ref.step_phase_1(300.0))
+
+    def test_invalid(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+
+        # Only the countermeasures may differ
+        with self.assertRaises(RuntimeError):
+            zsf_replay_variants(lock, self.lockages, [{}, {"head_sea": 1.0}])
+        with self.assertRaises(TypeError):
+            zsf_replay_variants(lock, self.lockages, [{"flushing_discharge": 1.0}])
+        with self.assertRaises(RuntimeError):
+            zsf_replay_variants(lock, [], [{}])
+        with self.assertRaises(RuntimeError):
+            zsf_replay_variants(lock, [{**self.lockages[0], "routine": 5.0}], [{}])
@@ -0,0 +1,101 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFUnsteady
+
+
+class TestResolve(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 148.0,
+            "lock_width": 14.0,
+            "lock_bottom": -4.4,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 25.0,
+            "salinity_lake": 5.0,
+            "flushing_discharge_high_tide": 2.0,
+            "flushing_discharge_low_tide": 2.0,
+            "distance_door_bubble_screen_lake": 5.0,
+            "distance_door_bubble_screen_sea": -5.0,
+            "density_current_factor_lake": 0.3,
+            "density_current_factor_sea": 0.3,
+            "ship_volume_lake_to_sea": 800.0,
+            "ship_volume_sea_to_lake": 600.0,
+        }
+        self.phases = [(1, 300.0), (2, 900.0), (3, 300.0), (4, 900.0), (-4, 600.0)]
+
+    def _step(self, lock, routine, duration):
+        step = {
+            1: lock.step_phase_1,
+            2: lock.step_phase_2,
+            3: lock.step_phase_3,
+            4: lock.step_phase_4,
+            -4: lock.step_flush_doors_closed,
+        }[routine]
+        return step(duration)
+
+    def test_end_equals_totals(self):
+        lock = ZSFUnsteady(15.0, 0.5, **self.parameters)
+
+        for routine, duration in self.phases:
+            state = lock.state
+            samples = lock.resolve_phase(routine, duration, [0.0, duration / 2, duration])
+            self.assertEqual(lock.state, state)
+
+            totals = self._step(lock, routine, duration)
+            for k in [
+                "mass_transport_lake",
+                "mass_transport_sea",
+                "volume_from_lake",
+                "volume_to_lake",
+                "volume_from_sea",
+                "volume_to_sea",
+            ]:
+                self.assertEqual(samples[k][-1], totals[k], msg=f"phase {routine}, {k}")
+
+    def test_rates_are_derivatives(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        duration = 900.0
+        times = np.linspace(1.0, duration - 1.0, 50)
+        dt = 1e-3
+
+        samples = lock.resolve_phase(2, duration, times)
+        later = lock.resolve_phase(2, duration, times + dt)
+
+        for side in ["from_lake", "to_lake", "to_sea"]:
+            volume = np.array(samples[f"volume_{side}"])
+            volume_later = np.array(later[f"volume_{side}"])
+            discharge = np.array(samples[f"discharge_{side}"])
+            np.testing.assert_allclose(
+                (volume_later - volume) / dt, discharge, rtol=1e-4, atol=1e-6
+            )
+
+        # Only the flushing leaves the lock at sea side in phase 2
+        mass = np.array(samples["mass_transport_sea"])
+        mass_later = np.array(later["mass_transport_sea"])
+        np.testing.assert_allclose(
+            (mass_later - mass) / dt,
+            np.array(samples["salinity_to_sea"]) * np.array(samples["discharge_to_sea"]),
+            rtol=1e-4,
+        )
+
+    def test_cumulative_monotonic(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        times = np.linspace(0.0, 900.0, 101)
+        samples = lock.resolve_phase(2, 900.0, times)
+
+        for k in ["volume_from_lake", "volume_to_lake", "volume_to_sea", "mass_transport_sea"]:
+            self.assertTrue(np.all(np.diff(samples[k]) >= 0.0), msg=k)
+
+    def test_invalid_arguments(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        with self.assertRaises(RuntimeError):
+            lock.resolve_phase(2, 900.0, [0.0, 901.0])
+        with self.assertRaises(RuntimeError):
+            lock.resolve_phase(5, 900.0, [0.0])
+
+        # Lock is at lake level, so the door at sea side cannot be opened
+        with self.assertRaises(RuntimeError):
+            lock.resolve_phase(4, 900.0, [0.0])
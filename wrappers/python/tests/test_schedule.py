@@ -0,0 +1,118 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFUnsteady, zsf_optimize_schedule
+
+
+class TestSchedule(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 300.0,
+            "lock_width": 25.0,
+            "lock_bottom": -7.0,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 28.0,
+            "salinity_lake": 1.0,
+            "flushing_discharge_high_tide": 2.0,
+            "flushing_discharge_low_tide": 2.0,
+        }
+
+        # A day of traffic, 30 ships per day at either side
+        rng = np.random.RandomState(1)
+        self.ships = []
+        for side in [0.0, 1.0]:
+            for t in np.sort(rng.uniform(0.0, 80000.0, 30)):
+                self.ships.append({"time": t, "side": side, "volume": rng.uniform(1000.0, 5000.0)})
+
+        self.limits = {
+            "t_end": 86400.0,
+            "leveling_time": 300.0,
+            "door_time": 600.0,
+            "time_per_ship": 120.0,
+            "max_wait": 7200.0,
+            "max_ships": 6.0,
+            "max_ship_volume": 20000.0,
+            "door_open_min": 600.0,
+            "door_open_max": 3600.0,
+            "flushing_max": 1800.0,
+            "flushing_volume": 20000.0,
+        }
+
+    def test_schedule(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        state = lock.state
+        lockages, transports, results = zsf_optimize_schedule(lock, self.ships, self.limits)
+        self.assertEqual(lock.state, state)
+
+        # All ships pass, and the doors only open at the side the lock is
+        # leveled to.
+        self.assertEqual(sum(x["num_ships"] for x in lockages), len(self.ships))
+        level = None
+        for lockage in lockages:
+            routine = int(lockage["routine"])
+            if routine in [1, 3]:
+                level = routine
+            else:
+                self.assertEqual(abs(routine), level + 1)
+            if routine in [2, 4]:
+                self.assertGreaterEqual(lockage["duration"], self.limits["door_open_min"])
+            if routine < 0:
+                self.assertLessEqual(lockage["duration"], self.limits["flushing_max"])
+
+        flushing = sum(
+            x["volume_from_lake"] for x, y in zip(transports, lockages) if y["routine"] < 0
+        )
+        self.assertGreater(flushing, 0.0)
+        self.assertLessEqual(flushing, self.limits["flushing_volume"])
+
+        # The transports are those of the lockages
+        replay = lock.step_lockages(lockages)
+        for k, v in replay.items():
+            np.testing.assert_allclose([x[k] for x in transports], v, rtol=1e-12)
+        np.testing.assert_allclose(
+            results["salt_load_lake"],
+            sum(replay["mass_transport_lake"]) / self.limits["t_end"],
+            rtol=1e-12,
+        )
+
+    def test_beats_fixed_schedule(self):
+        # The same door open time on every visit, and no flushing
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        fixed = {**self.limits, "door_open_min": 1200.0, "door_open_max": 1200.0}
+        _, _, results_fixed = zsf_optimize_schedule(
+            lock, self.ships, {**fixed, "flushing_max": 0.0}
+        )
+
+        _, _, results = zsf_optimize_schedule(lock, self.ships, self.limits)
+        self.assertGreater(results["salt_load_lake"], results_fixed["salt_load_lake"])
+
+        # More candidates do not make it worse here
+        _, _, results_fine = zsf_optimize_schedule(
+            lock, self.ships, {**self.limits, "num_candidates": 16.0}
+        )
+        self.assertGreater(results_fine["salt_load_lake"], results_fixed["salt_load_lake"])
+
+    def test_no_flushing_water(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        lockages, _, _ = zsf_optimize_schedule(
+            lock, self.ships, {**self.limits, "flushing_volume": 0.0}
+        )
+        self.assertFalse(any(x["routine"] < 0 for x in lockages))
+
+    def test_infeasible(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        with self.assertRaises(RuntimeError):
+            zsf_optimize_schedule(lock, self.ships, {**self.limits, "max_wait": 600.0})
+
+    def test_invalid(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        with self.assertRaises(RuntimeError):
+            zsf_optimize_schedule(lock, self.ships, {**self.limits, "num_candidates": 1.0})
+        with self.assertRaises(RuntimeError):
+            zsf_optimize_schedule(lock, self.ships, {**self.limits, "door_open_min": 4000.0})
+        with self.assertRaises(RuntimeError):
+            zsf_optimize_schedule(lock, [{**self.ships[0], "side": 2.0}], self.limits)
+        with self.assertRaises(TypeError):
+            zsf_optimize_schedule(lock, self.ships, {**self.limits, "t_start": 0.0})
@@ -0,0 +1,135 @@
+import os
+import subprocess
+import sys
+import threading
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFService, ZSFServiceClient, zsf_calc_steady_batch
+
+
+class TestService(unittest.TestCase):
+    def setUp(self):
+        self.name = f"pyzsf-test-{os.getpid()}"
+        self.service = ZSFService(self.name, num_slots=8, slot_capacity=16, num_threads=3)
+        self.service.start()
+
+    def tearDown(self):
+        self.service.stop()
+
+    def test_results(self):
+        head_sea = list(np.linspace(-0.5, 1.0, 50))
+        client = ZSFServiceClient(self.name)
+
+        # More parameters than fit in the slots, with every set twice
+        r = client.calc_steady_batch(head_sea=head_sea + head_sea, salinity_sea=25.0)
+        ref = zsf_calc_steady_batch(head_sea=head_sea + head_sea, salinity_sea=25.0)
+        for k, v in ref.items():
+            np.testing.assert_array_equal(r[k], v, err_msg=k)
+
+        stats = self.service.stats
+        self.assertEqual(stats["num_requests"], 100)
+        self.assertEqual(stats["num_calculated"], 50)
+        self.assertEqual(stats["num_duplicates"] + stats["num_cached"], 50)
+
+        # Repeated requests come from the cache
+        client.calc_steady_batch(head_sea=head_sea, salinity_sea=25.0)
+        self.assertEqual(self.service.stats["num_calculated"], 50)
+
+    def test_errors(self):
+        client = ZSFServiceClient(self.name)
+        r = client.calc_steady_batch(head_sea=[0.5, 0.5], ship_volume_lake_to_sea=[0.0, 1e6])
+
+        self.assertFalse(np.isnan(r["salt_load_lake"][0]))
+        self.assertTrue(np.isnan(r["salt_load_lake"][1]))
+
+    def test_concurrent_clients(self):
+        ref = zsf_calc_steady_batch(head_sea=list(np.linspace(-0.5, 1.0, 40)))
+        results = [None] * 8
+
+        def run(i):
+            client = ZSFServiceClient(self.name)
+            results[i] = client.calc_steady_batch(head_sea=list(np.linspace(-0.5, 1.0, 40)))
+
+        threads = [threading.Thread(target=run, args=(i,)) for i in range(len(results))]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        for r in results:
+            np.testing.assert_array_equal(r["salt_load_lake"], ref["salt_load_lake"])
+
+    def test_other_process(self):
+        script = (
+            "from pyzsf import ZSFServiceClient;"
+            f"r = ZSFServiceClient('{self.name}').calc_steady_batch(head_sea=[0.25, 0.75]);"
+            "print(repr(r['salt_load_lake']))"
+        )
+        out = subprocess.run(
+            [sys.executable, "-c", script], capture_output=True, check=True, timeout=60
+        )
+
+        ref = zsf_calc_steady_batch(head_sea=[0.25, 0.75])
+        self.assertEqual(eval(out.stdout.decode()), ref["salt_load_lake"])
+
+    def test_name_in_use(self):
+        with self.assertRaises(RuntimeError):
+            ZSFService(self.name)
+
+        # The running service keeps its name
+        ref = zsf_calc_steady_batch(head_sea=[0.5])
+        r = ZSFServiceClient(self.name).calc_steady_batch(head_sea=0.5)
+        self.assertEqual(r["salt_load_lake"], ref["salt_load_lake"])
+
+        # Until it stops
+        self.service.stop()
+        other = ZSFService(self.name)
+        other.start()
+        try:
+            r = ZSFServiceClient(self.name).calc_steady_batch(head_sea=0.5)
+            self.assertEqual(r["salt_load_lake"], ref["salt_load_lake"])
+        finally:
+            other.stop()
+
+    @unittest.skipIf(sys.platform == "win32", "the name is held until all clients disconnect")
+    def test_killed_server(self):
+        name = f"{self.name}-killed"
+        script = (
+            "import sys, time; from pyzsf import ZSFService;"
+            f"s = ZSFService('{name}'); s.start(); print('ready', flush=True); time.sleep(60)"
+        )
+        server = subprocess.Popen([sys.executable, "-c", script], stdout=subprocess.PIPE)
+        try:
+            self.assertEqual(server.stdout.readline().strip(), b"ready")
+            client = ZSFServiceClient(name)
+        finally:
+            server.kill()
+            server.wait()
+            server.stdout.close()
+
+        # Clients give up rather than wait for the dead server
+        with self.assertRaises(RuntimeError):
+            client.calc_steady_batch(head_sea=0.5)
+        with self.assertRaises(RuntimeError):
+            ZSFServiceClient(name)
+
+        # And its name can be taken by a new server
+        other = ZSFService(name)
+        other.start()
+        try:
+            ref = zsf_calc_steady_batch(head_sea=[0.5])
+            r = ZSFServiceClient(name).calc_steady_batch(head_sea=0.5)
+            self.assertEqual(r["salt_load_lake"], ref["salt_load_lake"])
+        finally:
+            other.stop()
+
+    def test_unavailable(self):
+        with self.assertRaises(RuntimeError):
+            ZSFServiceClient(f"{self.name}-missing")
+
+        client = ZSFServiceClient(self.name)
+        self.service.stop()
+        with self.assertRaises(RuntimeError):
+            client.calc_steady_batch(head_sea=0.5)
@@ -0,0 +1,71 @@
+import os
+import tempfile
+import unittest
+
+from pyzsf import ZSFUnsteady, zsf_snapshot_load, zsf_snapshot_save
+
+
+class TestSnapshot(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 148.0,
+            "lock_width": 14.0,
+            "lock_bottom": -4.4,
+            "head_sea": 0.3,
+            "head_lake": 0.0,
+            "salinity_sea": 25.0,
+            "salinity_lake": 5.0,
+            "ship_volume_sea_to_lake": 800.0,
+            "ship_volume_lake_to_sea": 1200.0,
+        }
+
+    @staticmethod
+    def _cycle(lock):
+        transports = []
+        transports.append(lock.step_phase_1(300.0))
+        transports.append(lock.step_phase_2(1800.0))
+        transports.append(lock.step_phase_3(300.0))
+        transports.append(lock.step_phase_4(1800.0))
+        return transports
+
+    def test_restart_is_bit_identical(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        for _ in range(3):
+            self._cycle(lock)
+
+        restored = ZSFUnsteady.restore(lock.snapshot())
+        self.assertEqual(restored.state, lock.state)
+
+        for _ in range(3):
+            self.assertEqual(self._cycle(restored), self._cycle(lock))
+        self.assertEqual(restored.state, lock.state)
+
+    def test_parameters_are_restored(self):
+        lock = ZSFUnsteady(15.0, 0.0, **self.parameters)
+        lock.step_phase_1(300.0, head_lake=0.1)
+
+        restored = ZSFUnsteady.restore(lock.snapshot())
+        self.assertEqual(restored.step_phase_2(600.0), lock.step_phase_2(600.0))
+
+    def test_fleet_file(self):
+        locks = [ZSFUnsteady(5.0 + 0.2 * i, 0.0, **self.parameters) for i in range(100)]
+        for lock in locks[::3]:
+            self._cycle(lock)
+
+        with tempfile.TemporaryDirectory() as d:
+            path = os.path.join(d, "fleet.zsfsnap")
+            zsf_snapshot_save(path, locks)
+            restored = zsf_snapshot_load(path)
+
+        self.assertEqual(len(restored), len(locks))
+        for a, b in zip(restored, locks):
+            self.assertEqual(a.state, b.state)
+            self.assertEqual(self._cycle(a), self._cycle(b))
+
+    def test_invalid_snapshot(self):
+        snapshot = ZSFUnsteady(15.0, 0.0, **self.parameters).snapshot()
+
+        with self.assertRaises(RuntimeError):
+            ZSFUnsteady.restore(snapshot[:-8])
+        with self.assertRaises(RuntimeError):
+            ZSFUnsteady.restore(b"X" + snapshot[1:])
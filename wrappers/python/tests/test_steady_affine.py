@@ -0,0 +1,54 @@
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFUnsteady, zsf_calc_steady
+
+
+class TestSteadyAffine(unittest.TestCase):
+    def setUp(self):
+        # The flushing velocity exceeds the velocity of the (weak) density
+        # current, so there is no lock exchange and a locking cycle is an
+        # affine map of the salinity of the lock.
+        self.parameters = {
+            "lock_length": 148.0,
+            "lock_width": 14.0,
+            "lock_bottom": -4.4,
+            "leveling_time": 300.0,
+            "head_sea": 0.5,
+            "head_lake": 0.0,
+            "salinity_sea": 25.0,
+            "salinity_lake": 5.0,
+            "flushing_discharge_high_tide": 1.0,
+            "flushing_discharge_low_tide": 1.0,
+            "density_current_factor_lake": 0.01,
+            "density_current_factor_sea": 0.01,
+            "ship_volume_sea_to_lake": 0.0,
+            "ship_volume_lake_to_sea": 0.0,
+        }
+
+    def test_exact_fixed_point(self):
+        steady = zsf_calc_steady(auxiliary_results=True, **self.parameters)
+
+        lock = ZSFUnsteady(
+            steady["salinity_lock_4"], self.parameters["head_sea"], **self.parameters
+        )
+        phases = [
+            (lock.step_phase_1, self.parameters["leveling_time"]),
+            (lock.step_phase_2, steady["t_open_lake"]),
+            (lock.step_phase_3, self.parameters["leveling_time"]),
+            (lock.step_phase_4, steady["t_open_sea"]),
+        ]
+
+        for i, (step, duration) in enumerate(phases, 1):
+            transports = step(duration)
+            for k, v in steady[f"transports_phase_{i}"].items():
+                np.testing.assert_allclose(transports[k], v, rtol=1e-12, atol=1e-9, err_msg=k)
+            self.assertAlmostEqual(lock.state["salinity_lock"], steady[f"salinity_lock_{i}"], 12)
+
+    def test_independent_of_tolerance(self):
+        loose = zsf_calc_steady(**self.parameters, rtol=1e-3, atol=1e-3)
+        tight = zsf_calc_steady(**self.parameters, rtol=1e-14, atol=1e-14)
+
+        for k, v in tight.items():
+            np.testing.assert_allclose(loose[k], v, rtol=1e-12, err_msg=k)
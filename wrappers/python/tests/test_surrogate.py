@@ -0,0 +1,77 @@
+import os
+import tempfile
+import unittest
+
+import numpy as np
+
+from pyzsf import ZSFSurrogate, zsf_calc_steady
+
+
+class TestSurrogate(unittest.TestCase):
+    def setUp(self):
+        self.parameters = {
+            "lock_length": 240.0,
+            "lock_width": 12.0,
+            "lock_bottom": -4.0,
+            "num_cycles": 24.0,
+            "head_lake": 0.0,
+            "temperature_sea": 15.0,
+            "temperature_lake": 15.0,
+        }
+        self.axes = {
+            "head_sea": np.linspace(-1.0, 1.0, 9),
+            "salinity_sea": np.linspace(20.0, 30.0, 6),
+            "salinity_lake": np.linspace(0.5, 5.0, 6),
+        }
+        self.surrogate = ZSFSurrogate.build(self.axes, **self.parameters)
+
+    def test_nodes_exact(self):
+        values = {"head_sea": 0.5, "salinity_sea": 24.0, "salinity_lake": 2.3}
+        reference = zsf_calc_steady(**self.parameters, **values)
+
+        for method in ("linear", "cubic"):
+            results = self.surrogate(method=method, **values)
+            np.testing.assert_allclose(
+                results["salt_load_lake"], reference["salt_load_lake"], rtol=1e-12
+            )
+
+    def test_interpolation_error(self):
+        max_abs_linear, max_rel_linear = self.surrogate.validate(50, method="linear")
+        max_abs_cubic, max_rel_cubic = self.surrogate.validate(50, method="cubic")
+
+        self.assertLess(max_rel_linear["salt_load_lake"], 0.05)
+        self.assertLess(max_rel_cubic["salt_load_lake"], max_rel_linear["salt_load_lake"])
+
+    def test_save_load(self):
+        values = {"head_sea": 0.13, "salinity_sea": 27.1, "salinity_lake": 1.7}
+
+        with tempfile.TemporaryDirectory() as d:
+            path = os.path.join(d, "surrogate.bin")
+            self.surrogate.save(path)
+            loaded = ZSFSurrogate.load(path)
+
+        self.assertEqual(loaded.axes, tuple(self.axes))
+        self.assertEqual(loaded(**values), self.surrogate(**values))
+
+    def test_load_invalid_axis(self):
+        with tempfile.TemporaryDirectory() as d:
+            path = os.path.join(d, "surrogate.bin")
+            self.surrogate.save(path)
+            with open(path, "rb") as f:
+                data = f.read()
+
+            # Corrupt the second grid value of head_sea
+            head_sea = self.axes["head_sea"].tobytes()
+            begin = data.index(head_sea) + 8
+            end = begin + 8
+            for value in (np.nan, -2.0):
+                with open(path, "wb") as f:
+                    f.write(data[:begin] + np.float64(value).tobytes() + data[end:])
+                with self.assertRaises(RuntimeError):
+                    ZSFSurrogate.load(path)
+
+    def test_invalid_axis(self):
+        with self.assertRaises(RuntimeError):
+            ZSFSurrogate.build({"no_such_parameter": [0.0, 1.0]})
+        with self.assertRaises(RuntimeError):
+            ZSFSurrogate.build({"head_sea": [1.0, 0.0]})